@@ -1,6 +1,10 @@
 set(sources
   src/common/arrow.cc
+  src/common/cancellation.cc
+  src/common/memorypool.cc
   src/common/status.cc
+  src/common/threadpool.cc
+  src/dataframe/cache.cc
   src/dataframe/dataframe.cc
   src/datasource/datasource.cc
   src/execution/execution_context.cc
@@ -8,8 +12,15 @@ set(sources
   src/optimization/optimizer.cc
   src/optimization/utils.cc
   src/physicalplan/accumulator.cc
+  src/physicalplan/bitmap.cc
   src/physicalplan/physicalexpression.cc
   src/physicalplan/physicalplan.cc
+  src/physicalplan/pipeline.cc
+  src/physicalplan/runtimefilter.cc
+  src/physicalplan/sketch.cc
+  src/physicalplan/sort.cc
+  src/physicalplan/window.cc
+  src/physicalplan/spill.cc
   src/planner/planner.cc
   src/sql/expressions.cc
   src/sql/parser.cc
@@ -25,12 +36,16 @@ set(exe_sources
 
 set(headers
     include/common/arrow.h
+    include/common/cancellation.h
     include/common/debug.h
     include/common/iterator.h
     include/common/key.h
     include/common/macros.h
+    include/common/memorypool.h
     include/common/status.h
+    include/common/threadpool.h
     include/common/utils.h
+    include/dataframe/cache.h
     include/dataframe/dataframe.h
     include/datasource/datasource.h
     include/execution/execution_context.h
@@ -38,8 +53,15 @@ set(headers
     include/optimization/utils.h
     include/physicalplan/accumulator.h
     include/physicalplan/aggregationexpression.h
+    include/physicalplan/bitmap.h
     include/physicalplan/physicalexpression.h
     include/physicalplan/physicalplan.h
+    include/physicalplan/pipeline.h
+    include/physicalplan/runtimefilter.h
+    include/physicalplan/sketch.h
+    include/physicalplan/sort.h
+    include/physicalplan/window.h
+    include/physicalplan/spill.h
     include/planner/planner.h
     include/logicalplan/logicalexpression.h
     include/logicalplan/logicalplan.h
@@ -54,10 +76,23 @@ set(headers
 )
 
 set(test_sources
+  src/common/cancellation_test.cc
+  src/common/memorypool_test.cc
+  src/common/threadpool_test.cc
+  src/dataframe/cache_test.cc
   src/datasource/datasource_test.cc
   src/physicalplan/accumulator_test.cc
   src/physicalplan/aggregationexpression_test.cc
+  src/physicalplan/bitmap_test.cc
   src/physicalplan/physicalexpression_test.cc
   src/physicalplan/physicalplan_test.cc
+  src/physicalplan/pipeline_test.cc
+  src/physicalplan/runtimefilter_test.cc
+  src/physicalplan/sketch_test.cc
+  src/physicalplan/sort_test.cc
+  src/physicalplan/window_test.cc
+  src/physicalplan/spill_test.cc
+  src/planner/planner_test.cc
+  src/sql/sql_planner_test.cc
   src/toyquery_test.cc
 )
@@ -5,6 +5,8 @@
  * @brief This file contains useful functions defined for easier use of Apache Arrow.
  */
 
+#include <optional>
+
 #include "absl/status/statusor.h"
 #include "arrow/api.h"
 
@@ -26,6 +28,95 @@ absl::StatusOr<std::shared_ptr<arrow::Schema>> FilterSchema(
     std::shared_ptr<arrow::Schema> schema,
     std::vector<std::string> projection);
 
+/**
+ * @brief Filter an arrow::Array keeping only the rows for which the predicate is true.
+ *
+ * @param data: the array to filter
+ * @param predicate: the boolean mask, must have the same length as data
+ * @param pool: the memory pool the filtered array is allocated from
+ * @return absl::StatusOr<std::shared_ptr<arrow::Array>>: the filtered array
+ */
+absl::StatusOr<std::shared_ptr<arrow::Array>> FilterArray(
+    std::shared_ptr<arrow::Array> data,
+    std::shared_ptr<arrow::BooleanArray> predicate,
+    arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+/**
+ * @brief Filter every column of the record batch using the given predicate.
+ *
+ * @param batch: the record batch to filter
+ * @param predicate: the boolean mask, must have the same length as the batch
+ * @param pool: the memory pool the filtered columns are allocated from
+ * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>: the filtered record batch
+ */
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> FilterRecordBatch(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    std::shared_ptr<arrow::BooleanArray> predicate,
+    arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+/**
+ * @brief Gather the rows of an arrow::Array at the given indices.
+ *
+ * Null values are preserved and indices may repeat.
+ *
+ * @param data: the array to gather the rows from
+ * @param indices: the row indices in the order they should appear in the output
+ * @return absl::StatusOr<std::shared_ptr<arrow::Array>>: the gathered array
+ */
+absl::StatusOr<std::shared_ptr<arrow::Array>> TakeArray(
+    std::shared_ptr<arrow::Array> data,
+    const std::vector<int64_t>& indices);
+
+/**
+ * @brief Gather the rows of every column of the record batch at the given indices.
+ *
+ * @param batch: the record batch to gather the rows from
+ * @param indices: the row indices in the order they should appear in the output
+ * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>: the gathered record batch
+ */
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TakeRecordBatch(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    const std::vector<int64_t>& indices);
+
+/**
+ * @brief Compare two non null values of arrays having the same type.
+ *
+ * Only BOOL, INT64, DOUBLE and STRING are supported, values of other types compare as equal.
+ *
+ * @param left: the array of the left value
+ * @param left_row: the row index of the left value
+ * @param right: the array of the right value
+ * @param right_row: the row index of the right value
+ * @return int: negative if left < right, zero if they are equal, positive if left > right
+ */
+int CompareArrayValues(const arrow::Array& left, int64_t left_row, const arrow::Array& right, int64_t right_row);
+
+/**
+ * @brief Compare two scalars, e.g. a literal with the min/max statistics of a chunk of a column.
+ *
+ * Integers and floating points compare as numbers whatever their width, strings and binaries compare bytewise.
+ *
+ * @param left: the left scalar
+ * @param right: the right scalar
+ * @return std::optional<int>: negative if left < right, zero if they are equal, positive if left > right. Empty if
+ * either of them is null or they aren't comparable.
+ */
+std::optional<int> CompareScalars(const arrow::Scalar& left, const arrow::Scalar& right);
+
+/**
+ * @brief Concatenate the record batches column by column.
+ *
+ * @param schema: the schema of the record batches
+ * @param batches: the record batches to concatenate
+ * @param pool: the memory pool of the concatenated arrays
+ * @return absl::StatusOr<std::vector<std::shared_ptr<arrow::Array>>>: one array per field of the schema, empty arrays if
+ * there is no batch. ResourceExhausted if the pool is out of memory
+ */
+absl::StatusOr<std::vector<std::shared_ptr<arrow::Array>>> ConcatenateRecordBatches(
+    std::shared_ptr<arrow::Schema> schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches,
+    arrow::MemoryPool* pool = arrow::default_memory_pool());
+
 }  // namespace toyquery
 
 #endif  // COMMON_ARROW_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef COMMON_CANCELLATION_H
+#define COMMON_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "common/macros.h"
+
+namespace toyquery {
+
+/**
+ * @brief The cancellation state of a query, shared by all the operators of its plan.
+ *
+ * The query is stopped either explicitly with Cancel or once its deadline has passed. The operators check the token
+ * cooperatively, at the start of Next and in their long loops, and unwind with the status returned by Check. The token
+ * can be cancelled from any thread.
+ */
+class CancellationToken {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  CancellationToken() = default;
+
+  /**
+   * @brief Construct a token linked to the given parent, e.g. the token of a query linked to the one of its context.
+   *
+   * The token is stopped whenever its parent is, while cancelling it or setting its deadline leaves the parent as is.
+   *
+   * @param parent: the token whose cancellation and deadline also apply to this one
+   */
+  explicit CancellationToken(std::shared_ptr<CancellationToken> parent) : parent_{ std::move(parent) } { }
+
+  /**
+   * @brief Cancel the query.
+   */
+  void Cancel() { cancelled_ = true; }
+
+  /**
+   * @brief Set the point in time after which the query is stopped.
+   */
+  void SetDeadline(Clock::time_point deadline) { deadline_ = deadline.time_since_epoch().count(); }
+
+  /**
+   * @brief Set the deadline of the query to the given duration from now.
+   */
+  void SetTimeout(Clock::duration timeout) { SetDeadline(Clock::now() + timeout); }
+
+  /**
+   * @brief Check if the query can go on.
+   *
+   * @return absl::Status: Cancelled if the query was cancelled, DeadlineExceeded if it is past its deadline, Ok
+   * otherwise. The parent token, if any, is checked too.
+   */
+  absl::Status Check() const;
+
+ private:
+  std::atomic<bool> cancelled_{ false };
+  // the deadline in ticks of the clock, no deadline if zero.
+  std::atomic<Clock::rep> deadline_{ 0 };
+  std::shared_ptr<CancellationToken> parent_;
+
+  DISALLOW_COPY_AND_ASSIGN(CancellationToken);
+};
+
+}  // namespace toyquery
+
+#endif  // COMMON_CANCELLATION_H
@@ -0,0 +1,126 @@
+#ifndef COMMON_MEMORYPOOL_H
+#define COMMON_MEMORYPOOL_H
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "arrow/memory_pool.h"
+#include "common/macros.h"
+
+namespace toyquery {
+
+/**
+ * @brief The memory used by an operator of a query.
+ */
+struct OperatorMemoryUsage {
+  std::string name;
+  int64_t bytes_allocated;
+  int64_t peak_bytes_allocated;
+};
+
+/**
+ * @brief An arrow::MemoryPool tracking the memory allocated through it, up to a hard limit.
+ *
+ * A query owns one pool, whose children attribute the allocations to the operators of the query. The allocations of a
+ * child are charged to its parent as well, an allocation failing with OutOfMemory if it takes any of them over its
+ * limit. The memory itself is allocated from the default pool.
+ */
+class TrackingMemoryPool : public arrow::MemoryPool {
+ public:
+  TrackingMemoryPool(
+      std::string name,
+      int64_t limit = std::numeric_limits<int64_t>::max(),
+      TrackingMemoryPool* parent = nullptr);
+  ~TrackingMemoryPool() override = default;
+
+  using arrow::MemoryPool::Allocate;
+  using arrow::MemoryPool::Free;
+  using arrow::MemoryPool::Reallocate;
+
+  arrow::Status Allocate(int64_t size, int64_t alignment, uint8_t** out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, int64_t alignment, uint8_t** ptr) override;
+  void Free(uint8_t* buffer, int64_t size, int64_t alignment) override;
+
+  /**
+   * @brief Get the number of bytes currently allocated.
+   */
+  int64_t bytes_allocated() const override { return bytes_allocated_; }
+
+  /**
+   * @brief Get the peak number of bytes allocated.
+   */
+  int64_t max_memory() const override { return peak_bytes_allocated_; }
+
+  int64_t total_bytes_allocated() const override { return total_bytes_allocated_; }
+  int64_t num_allocations() const override { return num_allocations_; }
+  std::string backend_name() const override { return arrow::default_memory_pool()->backend_name(); }
+
+  /**
+   * @brief Get the name of the pool, the operator it is attributed to for a child pool.
+   */
+  const std::string& Name() const { return name_; }
+
+  /**
+   * @brief Get the hard limit of the pool.
+   */
+  int64_t Limit() const { return limit_; }
+
+  /**
+   * @brief Get the number of bytes that can still be allocated before hitting the limit of the pool or of its parents.
+   */
+  int64_t Available() const;
+
+  /**
+   * @brief Create a pool attributing its allocations to the given operator, charged to this pool too.
+   */
+  std::shared_ptr<TrackingMemoryPool> CreateChild(std::string name);
+
+  /**
+   * @brief Get the memory used by each child pool, in creation order.
+   */
+  std::vector<OperatorMemoryUsage> Attribution();
+
+  /**
+   * @brief Charge memory held outside of arrow buffers (e.g. the entries of a hash table) to the pool and its parents.
+   *
+   * @param size: the number of bytes to charge
+   * @return arrow::Status: OutOfMemory, without charging anything, if any limit would be exceeded
+   */
+  arrow::Status Reserve(int64_t size);
+
+  /**
+   * @brief Give back the memory charged by Reserve.
+   *
+   * @param size: the number of bytes to give back
+   */
+  void Release(int64_t size);
+
+ private:
+  // charge the bytes to the pool and its parents, fails without charging anything if any limit would be exceeded.
+  bool reserve(int64_t size);
+
+  // give the bytes back to the pool and its parents.
+  void release(int64_t size);
+
+  std::string name_;
+  int64_t limit_;
+  TrackingMemoryPool* parent_;
+
+  std::atomic<int64_t> bytes_allocated_{ 0 };
+  std::atomic<int64_t> peak_bytes_allocated_{ 0 };
+  std::atomic<int64_t> total_bytes_allocated_{ 0 };
+  std::atomic<int64_t> num_allocations_{ 0 };
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<TrackingMemoryPool>> children_;
+
+  DISALLOW_COPY_AND_ASSIGN(TrackingMemoryPool);
+};
+
+}  // namespace toyquery
+
+#endif  // COMMON_MEMORYPOOL_H
@@ -26,7 +26,7 @@ absl::string_view GetMessageFromStatus(absl::Status status);
  */
 absl::string_view GetMessageFromStatus(arrow::Status status);
 
-#define GetMessageFromResult(result) result.status().detail()->ToString()
+#define GetMessageFromResult(result) result.status().message()
 
 #define GetMessageFromResultLeftOrRight(left, right) \
   ((!left.ok()) ? GetMessageFromResult(left) : GetMessageFromResult(right))
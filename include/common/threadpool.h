@@ -0,0 +1,69 @@
+#ifndef COMMON_THREADPOOL_H
+#define COMMON_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/macros.h"
+
+namespace toyquery {
+
+/**
+ * @brief A fixed size pool of threads executing tasks, with one task queue per thread.
+ *
+ * A task submitted from a thread of the pool is pushed to the queue of that thread, which runs its most recent task
+ * first so that a task rescheduling itself keeps running on the same thread, with its data still in cache. Idle threads
+ * steal the oldest task of the queues of the other threads. Tasks submitted from outside the pool are distributed over
+ * the queues in round robin.
+ *
+ * The destructor runs the pending tasks before joining the threads.
+ */
+class ThreadPool {
+ public:
+  ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  /**
+   * @brief Schedule the task to run on one of the threads of the pool.
+   */
+  void Submit(std::function<void()> task);
+
+  /**
+   * @brief Get the number of threads of the pool.
+   */
+  int NumThreads() const { return workers_.size(); }
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    std::thread thread;
+  };
+
+  // the loop run by each thread of the pool.
+  void run(int worker_idx);
+
+  // pop the most recent task of the worker, or steal the oldest task of another worker.
+  bool popTask(int worker_idx, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<uint64_t> next_worker_{ 0 };
+
+  // the number of tasks queued but not yet picked by a worker.
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  int64_t queued_tasks_{ 0 };
+  bool stopping_{ false };
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace toyquery
+
+#endif  // COMMON_THREADPOOL_H
\ No newline at end of file
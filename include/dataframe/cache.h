@@ -0,0 +1,161 @@
+#ifndef DATAFRAME_CACHE_H
+#define DATAFRAME_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "arrow/api.h"
+#include "common/macros.h"
+#include "datasource/datasource.h"
+#include "logicalplan/logicalplan.h"
+
+namespace toyquery {
+namespace dataframe {
+
+/**
+ * @brief The result of a cached dataframe, either as a table or as an lz4 compressed arrow ipc stream.
+ */
+struct CachedResult {
+  std::shared_ptr<arrow::Schema> schema;
+  std::shared_ptr<arrow::Table> table;
+  std::shared_ptr<arrow::Buffer> compressed;
+  // the bytes held in memory by the result.
+  int64_t bytes{ 0 };
+  // the memory pool of the query the table was computed by, kept alive as long as the table.
+  std::shared_ptr<TrackingMemoryPool> pool;
+};
+
+/**
+ * @brief The results of the cached dataframes, evicting the least recently used ones beyond a byte budget.
+ *
+ * An evicted result is computed again by the next query scanning it. The cache is thread-safe.
+ */
+class BatchCache {
+ public:
+  BatchCache(int64_t budget);
+  ~BatchCache();
+
+  /**
+   * @brief Get the cache used by the dataframes which aren't given one, with a budget of 1 GiB.
+   */
+  static std::shared_ptr<BatchCache> Default();
+
+  /**
+   * @brief Get a key identifying a new entry of the cache.
+   */
+  int64_t NextKey();
+
+  /**
+   * @brief Get the result cached under the key and mark it as the most recently used one.
+   *
+   * @return std::shared_ptr<CachedResult>: the result, nullptr if it isn't cached.
+   */
+  std::shared_ptr<CachedResult> Get(int64_t key);
+
+  /**
+   * @brief Cache the result under the key, evicting the least recently used results until it fits in the budget.
+   *
+   * A result larger than the whole budget isn't cached.
+   */
+  void Put(int64_t key, std::shared_ptr<CachedResult> result);
+
+  /**
+   * @brief Drop the result cached under the key, if any.
+   */
+  void Evict(int64_t key);
+
+  /**
+   * @brief Set the byte budget of the cache, evicting the least recently used results beyond it.
+   */
+  void SetBudget(int64_t budget);
+
+  /**
+   * @brief Get the bytes held by the cached results.
+   */
+  int64_t Bytes();
+
+  /**
+   * @brief Get the number of cached results.
+   */
+  size_t Size();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BatchCache);
+
+  // evict the least recently used results until the cached ones fit in the budget. Requires mutex_.
+  void evict();
+
+  std::mutex mutex_;
+  int64_t budget_;
+  int64_t bytes_{ 0 };
+  int64_t next_key_{ 0 };
+
+  // the keys from the most to the least recently used, and their results with their position in the list.
+  std::list<int64_t> lru_;
+  std::unordered_map<int64_t, std::pair<std::shared_ptr<CachedResult>, std::list<int64_t>::iterator>> results_;
+};
+
+/**
+ * @brief A data source executing a logical plan on its first scan and scanning the cached result afterwards.
+ */
+class CachedDataSource : public toyquery::datasource::DataSource {
+ public:
+  CachedDataSource(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> plan,
+      std::shared_ptr<BatchCache> cache,
+      bool compressed);
+
+  ~CachedDataSource() override;
+
+  /**
+   * @copydoc DataSource::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc DataSource::Scan
+   *
+   * @note The plan is executed again if its result was evicted from the cache.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) override;
+
+  /**
+   * @copydoc DataSource::Scan(std::vector<std::string>, const std::vector<ColumnPredicate>&, const ScanContext&)
+   *
+   * @note The plan is executed on behalf of the scanning query: it is cancelled with it, it allocates from its memory
+   * pool and it is planned with its parallelism. The filter isn't used.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(
+      std::vector<std::string> projection,
+      const std::vector<toyquery::datasource::ColumnPredicate>& filter,
+      const toyquery::datasource::ScanContext& context) override;
+  using toyquery::datasource::DataSource::Scan;
+
+  /**
+   * @brief Drop the cached result, the next scan executes the plan again.
+   */
+  void Unpersist();
+
+ private:
+  // execute the plan on behalf of the given query and keep its result, compressed if required.
+  absl::StatusOr<std::shared_ptr<CachedResult>> execute(const toyquery::datasource::ScanContext& context);
+
+  std::shared_ptr<toyquery::logicalplan::LogicalPlan> plan_;
+  std::shared_ptr<BatchCache> cache_;
+  bool compressed_;
+  int64_t key_;
+
+  // serializes the executions of the plan, so that concurrent first scans execute it once.
+  std::mutex mutex_;
+};
+
+}  // namespace dataframe
+}  // namespace toyquery
+
+#endif  // DATAFRAME_CACHE_H
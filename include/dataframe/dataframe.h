@@ -1,10 +1,13 @@
 #ifndef DATAFRAME_DATAFRAME_H
 #define DATAFRAME_DATAFRAME_H
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "arrow/api.h"
 #include "common/macros.h"
+#include "dataframe/cache.h"
 #include "logicalplan/logicalexpression.h"
 #include "logicalplan/logicalplan.h"
 
@@ -14,6 +17,8 @@ namespace dataframe {
 using ::toyquery::logicalplan::AggregateExpression;
 using ::toyquery::logicalplan::LogicalExpression;
 using ::toyquery::logicalplan::LogicalPlan;
+using ::toyquery::logicalplan::SortKey;
+using ::toyquery::logicalplan::WindowFunction;
 
 /**
  * @brief An interface to easily create logical plans.
@@ -51,6 +56,70 @@ class DataFrame {
       std::vector<std::shared_ptr<LogicalExpression>> group_by,
       std::vector<std::shared_ptr<AggregateExpression>> aggregate_expr) = 0;
 
+  /**
+   * @brief Inner join the dataframe with another dataframe
+   *
+   * @param right the dataframe to join with, used as the build side of the join
+   * @param on the pairs of (left column, right column) to join on
+   * @return std::shared_ptr<DataFrame> the joined dataframe
+   */
+  virtual std::shared_ptr<DataFrame> Join(
+      std::shared_ptr<DataFrame> right,
+      std::vector<std::pair<std::string, std::string>> on) = 0;
+
+  /**
+   * @brief Sort the dataframe
+   *
+   * @param sort_keys the keys to sort on, in order of precedence
+   * @return std::shared_ptr<DataFrame> the sorted dataframe
+   */
+  virtual std::shared_ptr<DataFrame> Sort(std::vector<SortKey> sort_keys) = 0;
+
+  /**
+   * @brief Skip the first offset rows of the dataframe and only keep the rows after them, up to the limit
+   *
+   * @param limit the maximum number of rows to keep, -1 if unlimited
+   * @param offset the number of rows to skip
+   * @return std::shared_ptr<DataFrame> the limited dataframe
+   */
+  virtual std::shared_ptr<DataFrame> Limit(int64_t limit, int64_t offset) = 0;
+
+  /**
+   * @brief Only keep one occurrence of each row of the dataframe
+   *
+   * @return std::shared_ptr<DataFrame> the dataframe without duplicate rows
+   */
+  virtual std::shared_ptr<DataFrame> Distinct() = 0;
+
+  /**
+   * @brief Append the result of window functions to each row of the dataframe
+   *
+   * @param partition_by the keys splitting the rows into partitions, the whole dataframe is a single partition if empty
+   * @param order_by the keys ordering the rows within each partition
+   * @param functions the window functions to evaluate over the frame of each row
+   * @return std::shared_ptr<DataFrame> the dataframe with one more column per window function
+   */
+  virtual std::shared_ptr<DataFrame> Window(
+      std::vector<std::shared_ptr<LogicalExpression>> partition_by,
+      std::vector<SortKey> order_by,
+      std::vector<WindowFunction> functions) = 0;
+
+  /**
+   * @brief Cache the result of the dataframe, computed by the first query scanning it and reused by the next ones
+   *
+   * @param compressed whether the result is kept lz4 compressed, trading cpu for memory
+   * @param cache the cache holding the result, which evicts the least recently used results beyond its budget
+   * @return std::shared_ptr<DataFrame> the dataframe scanning the cached result
+   */
+  virtual std::shared_ptr<DataFrame> Cache(bool compressed, std::shared_ptr<BatchCache> cache) = 0;
+
+  /**
+   * @brief Cache the uncompressed result of the dataframe in the default cache
+   *
+   * @return std::shared_ptr<DataFrame> the dataframe scanning the cached result
+   */
+  std::shared_ptr<DataFrame> Cache() { return Cache(false, BatchCache::Default()); }
+
   /**
    * @brief Get the schema of the dataframe
    *
@@ -92,6 +161,42 @@ class DataFrameImpl : public DataFrame {
       std::vector<std::shared_ptr<LogicalExpression>> group_by,
       std::vector<std::shared_ptr<AggregateExpression>> aggregate_expr) override;
 
+  /**
+   * @copydoc DataFrame::Join
+   */
+  std::shared_ptr<DataFrame> Join(
+      std::shared_ptr<DataFrame> right,
+      std::vector<std::pair<std::string, std::string>> on) override;
+
+  /**
+   * @copydoc DataFrame::Sort
+   */
+  std::shared_ptr<DataFrame> Sort(std::vector<SortKey> sort_keys) override;
+
+  /**
+   * @copydoc DataFrame::Limit
+   */
+  std::shared_ptr<DataFrame> Limit(int64_t limit, int64_t offset) override;
+
+  /**
+   * @copydoc DataFrame::Distinct
+   */
+  std::shared_ptr<DataFrame> Distinct() override;
+
+  /**
+   * @copydoc DataFrame::Window
+   */
+  std::shared_ptr<DataFrame> Window(
+      std::vector<std::shared_ptr<LogicalExpression>> partition_by,
+      std::vector<SortKey> order_by,
+      std::vector<WindowFunction> functions) override;
+
+  /**
+   * @copydoc DataFrame::Cache(bool, std::shared_ptr<BatchCache>)
+   */
+  std::shared_ptr<DataFrame> Cache(bool compressed, std::shared_ptr<BatchCache> cache) override;
+  using DataFrame::Cache;
+
   /**
    * @copydoc DataFrame::GetSchema
    */
@@ -1,15 +1,58 @@
 #ifndef DATASOURCE_DATASOURCE_H
 #define DATASOURCE_DATASOURCE_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "arrow/api.h"
+#include "arrow/io/api.h"
+#include "common/cancellation.h"
 #include "common/macros.h"
+#include "common/memorypool.h"
+#include "parquet/metadata.h"
 
 namespace toyquery {
 namespace datasource {
 
+/**
+ * @brief A comparison of a column with a literal value, pushed down to the data sources to skip chunks of rows.
+ */
+struct ColumnPredicate {
+  enum class Op { Eq, Neq, Lt, LtEq, Gt, GtEq };
+
+  /**
+   * @brief Check if a chunk whose values of the column lie within [min, max] can hold a row satisfying the predicate.
+   *
+   * @param min: the smallest value of the column in the chunk, null if unknown
+   * @param max: the largest value of the column in the chunk, null if unknown
+   * @return bool: false only if no row of the chunk can satisfy the predicate
+   */
+  bool MayMatch(const std::shared_ptr<arrow::Scalar>& min, const std::shared_ptr<arrow::Scalar>& max) const;
+
+  /**
+   * @brief Get string representation to print for debugging.
+   */
+  std::string ToString() const;
+
+  std::string column;
+  Op op;
+  std::shared_ptr<arrow::Scalar> value;
+};
+
+/**
+ * @brief The query scanning a data source, for the sources executing a query of their own to run it on its behalf.
+ */
+struct ScanContext {
+  // the cancellation token of the query, null if it can't be cancelled.
+  std::shared_ptr<CancellationToken> token;
+  // the memory pool of the query, null to allocate from the default pool.
+  std::shared_ptr<TrackingMemoryPool> pool;
+  // the degree of parallelism and the prefetch depth the query is planned with.
+  int parallelism{ 1 };
+  int prefetch_depth{ 2 };
+};
+
 /**
  * @brief Base class for all data sources.
  *
@@ -30,33 +73,120 @@ class DataSource {
   /**
    * @brief Scan the data source, selecting the specified columns by name.
    *
+   * The record batches are produced lazily as the reader is pulled, releasing the reader stops the scan.
+   *
    * @param projection: the columns to select.
-   * @return absl::StatusOr<std::shared_ptr<arrow::TableBatchReader>>: the iterator to iterate over the record batches.
+   * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>>: the iterator to iterate over the record batches.
    */
-  virtual absl::StatusOr<std::shared_ptr<arrow::TableBatchReader>> Scan(std::vector<std::string> projection) = 0;
+  virtual absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) = 0;
+
+  /**
+   * @brief Scan the data source, selecting the specified columns by name and skipping the chunks of rows which can't
+   * satisfy the filter.
+   *
+   * The filter only prunes, the rows of the chunks which are read aren't filtered. Sources without statistics ignore it.
+   *
+   * @param projection: the columns to select.
+   * @param filter: the conjunction of predicates the rows of the query satisfy.
+   * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>>: the iterator to iterate over the record batches.
+   */
+  virtual absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(
+      std::vector<std::string> projection,
+      const std::vector<ColumnPredicate>& filter) {
+    return Scan(projection);
+  }
+
+  /**
+   * @brief Scan the data source on behalf of the given query, selecting the specified columns by name and skipping the
+   * chunks of rows which can't satisfy the filter.
+   *
+   * Only the sources executing a query of their own use the context, the others ignore it.
+   *
+   * @param projection: the columns to select.
+   * @param filter: the conjunction of predicates the rows of the query satisfy.
+   * @param context: the query scanning the source.
+   * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>>: the iterator to iterate over the record batches.
+   */
+  virtual absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(
+      std::vector<std::string> projection,
+      const std::vector<ColumnPredicate>& filter,
+      const ScanContext& context) {
+    return Scan(projection, filter);
+  }
+
+  /**
+   * @brief Get the columns on which the data of the source is sorted in ascending order.
+   *
+   * @return const std::vector<std::string>&: the sort columns, most significant first. Empty if the data isn't sorted.
+   */
+  const std::vector<std::string>& SortedBy() const { return sorted_by_; }
+
+  /**
+   * @brief Declare that the data of the source is sorted in ascending order on the given columns.
+   *
+   * @param sorted_by: the sort columns, most significant first.
+   */
+  void SetSortedBy(std::vector<std::string> sorted_by) { sorted_by_ = std::move(sorted_by); }
 
  private:
+  std::vector<std::string> sorted_by_;
+
   DISALLOW_COPY_AND_ASSIGN(DataSource);
 };
 
+/**
+ * @brief The options of the csv reader.
+ */
+struct CsvReadOptions {
+  // the number of threads parsing the blocks of the file in parallel, the file is parsed on the scanning thread if 1.
+  int num_threads{ 1 };
+  // the size of the blocks of the file, in bytes, extended to the end of their last record. Quoted values can contain
+  // newlines.
+  int32_t block_size{ 1 << 20 };
+  // the number of blocks read and parsed ahead of the consumer when parsing in parallel, twice the threads if 0.
+  int read_ahead{ 0 };
+  // whether the batches of the parallel scan are returned in file order, rather than as soon as they are parsed.
+  bool preserve_order{ true };
+  // the size of the sample at the start of the file the types of the columns are inferred from, in bytes, extended to
+  // the end of its last line.
+  int64_t schema_sample_size{ 1 << 16 };
+  // the number of threads decompressing the blocks of a bgzf compressed file in parallel, one per core if 0. The other
+  // compressed files are decompressed on a single thread.
+  int decompression_threads{ 0 };
+};
+
 class CsvDataSource : public DataSource {
  public:
   CsvDataSource(std::string filename, int batch_size);
   CsvDataSource(std::string filename, int batch_size, std::shared_ptr<arrow::Schema> schema);
+  CsvDataSource(
+      std::string filename,
+      int batch_size,
+      std::shared_ptr<arrow::Schema> schema,
+      CsvReadOptions options);
 
   ~CsvDataSource() override;
 
   /**
    * @copydoc DataSource::Schema
    *
-   * @note Expensive operation: The csv file is read in order to obtain the schema if not already provided.
+   * @note The types of the columns are inferred from a sample of schema_sample_size bytes at the start of the csv file
+   * if the schema isn't provided. The scans then convert the columns to these types rather than inferring them again.
    */
   absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
 
   /**
    * @copydoc DataSource::Scan
+   *
+   * @note The file is read and parsed one block at a time as the batches are pulled, the blocks being cut into batches
+   * of batch_size rows. With more than one thread, up to read_ahead blocks are parsed in parallel instead, which
+   * requires that no value of the file contains a newline.
+   *
+   * A gzip, zstd or lz4 compressed file, detected from its first bytes, is decompressed ahead of the parser on other
+   * threads and always parsed one block at a time.
    */
-  absl::StatusOr<std::shared_ptr<arrow::TableBatchReader>> Scan(std::vector<std::string> projection) override;
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) override;
+  using DataSource::Scan;
 
   /**
    * @brief Read a file into an arrow::Table
@@ -67,8 +197,222 @@ class CsvDataSource : public DataSource {
   absl::StatusOr<std::shared_ptr<arrow::Table>> ReadFile(std::vector<std::string> projection);
 
  private:
+  // infer the schema of the csv file from the sample at its start.
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> inferSchema();
+
+  // open the csv file, decompressing it if it is compressed.
+  absl::StatusOr<std::shared_ptr<arrow::io::InputStream>> openInput();
+
+  // open a streaming reader over the csv file, applying the projection.
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> openReader(std::vector<std::string> projection);
+
+  // open a reader parsing the blocks of the csv file in parallel, applying the projection.
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> openParallelReader(std::vector<std::string> projection);
+
+  std::string filename_;
+  int batch_size_;
+  std::shared_ptr<arrow::Schema> schema_;
+  CsvReadOptions options_;
+};
+
+/**
+ * @brief The options of the parquet reader.
+ */
+struct ParquetReadOptions {
+  // the number of threads decoding the row groups of the file in parallel, one per core if 0.
+  int num_threads{ 0 };
+  // the number of row groups decoded ahead of the consumer, twice the threads if 0.
+  int read_ahead{ 0 };
+  // whether the batches are returned in file order, rather than as soon as their row group is decoded.
+  bool preserve_order{ true };
+  // whether the columns of the filter of a scan are decoded first, the other columns being decoded only for the row
+  // groups with rows satisfying the filter.
+  bool late_materialization{ true };
+  // the number of rows of the slices the other columns are decoded in with late materialization, so that only one of
+  // them is held at once. The slices after the last row satisfying the filter aren't decoded.
+  int64_t slice_size{ 1 << 16 };
+};
+
+class ParquetDataSource : public DataSource {
+ public:
+  ParquetDataSource(std::string filename, int batch_size);
+  ParquetDataSource(std::string filename, int batch_size, ParquetReadOptions options);
+
+  ~ParquetDataSource() override;
+
+  /**
+   * @copydoc DataSource::Schema
+   *
+   * @note The schema is read from the footer of the parquet file.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc DataSource::Scan
+   *
+   * @note Only the column chunks of the projected columns are read. The row groups are decoded on a thread pool, at
+   * most read_ahead of them in flight, and cut into batches of batch_size rows.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) override;
+
+  /**
+   * @copydoc DataSource::Scan(std::vector<std::string>, const std::vector<ColumnPredicate>&)
+   *
+   * @note The row groups whose min/max statistics show that none of their rows satisfies the filter aren't read. With
+   * late materialization, the rows which don't satisfy the filter on the top level columns aren't returned either.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(
+      std::vector<std::string> projection,
+      const std::vector<ColumnPredicate>& filter) override;
+
+ private:
+  // open the parquet file and read its footer, once.
+  absl::Status open();
+
+  // check if the statistics of the row group show that none of its rows satisfies the filter.
+  bool pruneRowGroup(int row_group, const std::vector<ColumnPredicate>& filter);
+
+  std::string filename_;
+  int batch_size_;
+  ParquetReadOptions options_;
+
+  std::shared_ptr<arrow::io::RandomAccessFile> file_;
+  std::shared_ptr<parquet::FileMetaData> metadata_;
+  std::shared_ptr<arrow::Schema> schema_;
+  // the indices of the leaf columns of each field of the schema, a nested field having several.
+  std::vector<std::vector<int>> column_indices_;
+};
+
+class IpcDataSource : public DataSource {
+ public:
+  IpcDataSource(std::string filename);
+
+  ~IpcDataSource() override;
+
+  /**
+   * @copydoc DataSource::Schema
+   *
+   * @note The schema is read from the footer of the arrow ipc file.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc DataSource::Scan
+   *
+   * @note The file is memory-mapped once and the batches point into the mapping, nothing is parsed or copied. Only
+   * the buffers of the projected columns are touched, the batches having the size they were written with.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) override;
+  using DataSource::Scan;
+
+ private:
+  // map the file and read its footer, once.
+  absl::Status open();
+
   std::string filename_;
+
+  std::shared_ptr<arrow::io::MemoryMappedFile> file_;
+  std::shared_ptr<arrow::Schema> schema_;
+};
+
+class InMemoryDataSource : public DataSource {
+ public:
+  InMemoryDataSource(std::shared_ptr<arrow::Table> table);
+  InMemoryDataSource(std::shared_ptr<arrow::Schema> schema, std::vector<std::shared_ptr<arrow::Table>> tables);
+
+  ~InMemoryDataSource() override;
+
+  /**
+   * @copydoc DataSource::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc DataSource::Scan
+   *
+   * @note The batches are the chunks of the tables, in order, nothing is copied.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) override;
+  using DataSource::Scan;
+
+ private:
+  std::shared_ptr<arrow::Schema> schema_;
+  // the tables all have the schema of the source.
+  std::vector<std::shared_ptr<arrow::Table>> tables_;
+};
+
+/**
+ * @brief The options of the dataset reader.
+ */
+struct DatasetOptions {
+  // the number of files scanned concurrently, a few batches at a time, and of the tasks reading them in flight.
+  int max_files_in_flight{ 4 };
+  // whether the batches are returned in the order of the files, rather than as soon as they are read. The batches of
+  // the files after the first one in flight are then held until it is returned.
+  bool preserve_order{ true };
+};
+
+/**
+ * @brief A file of a dataset, with its values of the partition columns of the dataset, null for a missing value.
+ */
+struct DatasetFile {
+  std::string path;
+  std::vector<std::shared_ptr<arrow::Scalar>> partition_values;
+};
+
+/**
+ * @brief A data source over the csv, parquet or arrow ipc files of a directory or matching a glob pattern.
+ *
+ * The directories named key=value between the root of the dataset and the files, e.g. events/date=2026-10-01/part-0.csv,
+ * add partition columns to the schema of the files, typed int64, double or string depending on their values.
+ */
+class DatasetDataSource : public DataSource {
+ public:
+  DatasetDataSource(std::string path, int batch_size);
+  DatasetDataSource(std::string path, int batch_size, DatasetOptions options);
+
+  ~DatasetDataSource() override;
+
+  /**
+   * @copydoc DataSource::Schema
+   *
+   * @note The schema of the first file followed by the partition columns.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc DataSource::Scan
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(std::vector<std::string> projection) override;
+
+  /**
+   * @copydoc DataSource::Scan(std::vector<std::string>, const std::vector<ColumnPredicate>&)
+   *
+   * @note The files whose partition values don't satisfy the filter are pruned before being opened, the rest of the
+   * filter is passed on to the sources of the files.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> Scan(
+      std::vector<std::string> projection,
+      const std::vector<ColumnPredicate>& filter) override;
+
+ private:
+  // discover the files and the partition columns of the dataset, once.
+  absl::Status open();
+
+  // list the files under the root of the dataset matching its pattern, if any, relative to the root.
+  absl::StatusOr<std::vector<std::string>> listFiles();
+
+  std::string path_;
   int batch_size_;
+  DatasetOptions options_;
+
+  // the directory the partitions are relative to, and the glob pattern of the files below it, empty for all the files.
+  std::string root_;
+  std::string pattern_;
+
+  std::vector<DatasetFile> files_;
+  std::shared_ptr<arrow::Schema> file_schema_;
+  std::shared_ptr<arrow::Schema> partition_schema_;
   std::shared_ptr<arrow::Schema> schema_;
 };
 
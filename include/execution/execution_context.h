@@ -1,13 +1,23 @@
 #ifndef EXECUTION_EXECUTION_CONTEXT_H
 #define EXECUTION_EXECUTION_CONTEXT_H
 
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+
 #include "absl/status/statusor.h"
+#include "common/cancellation.h"
+#include "common/memorypool.h"
 #include "dataframe/dataframe.h"
+#include "physicalplan/physicalplan.h"
 
 namespace toyquery {
 namespace execution {
 
 using ::toyquery::dataframe::DataFrame;
+using ::toyquery::physicalplan::PhysicalPlan;
 
 /**
  * @brief Utility to create an initial dataframe from a datasource.
@@ -16,6 +26,14 @@ using ::toyquery::dataframe::DataFrame;
 class ExecutionContext {
  public:
   ExecutionContext() = default;
+
+  /**
+   * @brief Construct a new Execution Context object running the queries with the given degree of parallelism.
+   *
+   * @param parallelism: the number of threads running the pipelines of each query
+   */
+  ExecutionContext(int parallelism) : parallelism_{ parallelism } { }
+
   ~ExecutionContext() = default;
 
   /**
@@ -34,7 +52,105 @@ class ExecutionContext {
    */
   absl::StatusOr<std::shared_ptr<DataFrame>> Parquet(const std::string& filename);
 
+  /**
+   * @brief Create a dataframe from an Arrow IPC (Feather v2) file, memory-mapped and read without copies.
+   *
+   * @param filename: the arrow ipc file name
+   * @return absl::StatusOr<std::shared_ptr<DataFrame>>: the created dataframe.
+   */
+  absl::StatusOr<std::shared_ptr<DataFrame>> Ipc(const std::string& filename);
+
+  /**
+   * @brief Create a dataframe from the files of a directory or of a glob pattern, with Hive-style partition columns.
+   *
+   * @param path: the directory or the glob pattern of the files, e.g. /data/events/date=2024-*
+   * @return absl::StatusOr<std::shared_ptr<DataFrame>>: the created dataframe.
+   */
+  absl::StatusOr<std::shared_ptr<DataFrame>> Dataset(const std::string& path);
+
+  /**
+   * @brief Optimize the logical plan of the dataframe and create the physical plan executing it.
+   *
+   * The query gets its own cancellation token, linked to the token of the context and reachable through
+   * PhysicalPlan::QueryCancellationToken to cancel the query alone. Its timeout, if any, starts from now.
+   *
+   * @param df: the dataframe to execute.
+   * @return absl::StatusOr<std::shared_ptr<PhysicalPlan>>: the physical plan, run on parallelism threads.
+   */
+  absl::StatusOr<std::shared_ptr<PhysicalPlan>> CreatePhysicalPlan(std::shared_ptr<DataFrame> df);
+
+  /**
+   * @brief Set the number of rows of the batches read from the files of the dataframes created from now on.
+   */
+  void SetBatchSize(int batch_size) { batch_size_ = batch_size; }
+
+  /**
+   * @brief Set the number of threads running the pipelines of the queries.
+   */
+  void SetParallelism(int parallelism) { parallelism_ = parallelism; }
+
+  /**
+   * @brief Get the number of threads running the pipelines of the queries.
+   */
+  int Parallelism() const { return parallelism_; }
+
+  /**
+   * @brief Set whether the queries run as push-based pipelines rather than pulling batches operator by operator.
+   */
+  void SetPushBased(bool push_based) { push_based_ = push_based; }
+
+  /**
+   * @brief Set the number of batches read ahead of the consumer on a background thread, above each scan.
+   *
+   * 2 by default, zero turns the prefetching off.
+   */
+  void SetPrefetchDepth(int prefetch_depth) { prefetch_depth_ = prefetch_depth; }
+
+  /**
+   * @brief Cancel the queries planned by the context so far, their plans unwind with a Cancelled status.
+   *
+   * The queries planned afterwards aren't cancelled.
+   */
+  void Cancel();
+
+  /**
+   * @brief Set the point in time after which the queries planned by the context unwind with a DeadlineExceeded status.
+   */
+  void SetDeadline(CancellationToken::Clock::time_point deadline);
+
+  /**
+   * @brief Set the time each query planned from now on can run for, counted from its planning.
+   */
+  void SetTimeout(CancellationToken::Clock::duration timeout);
+
+  /**
+   * @brief Replace the cancellation token the queries planned from now on are linked to, e.g. to cancel a group of them.
+   */
+  void SetCancellationToken(std::shared_ptr<CancellationToken> token);
+
+  /**
+   * @brief Get the cancellation token the queries planned by the context are linked to.
+   */
+  std::shared_ptr<CancellationToken> Token();
+
+  /**
+   * @brief Set the hard limit on the memory allocated by each query, which fails with a ResourceExhausted status over it.
+   *
+   * Each query gets its own memory pool, reachable through PhysicalPlan::QueryMemoryPool for its peak usage and its
+   * attribution to the operators.
+   */
+  void SetMemoryLimit(int64_t memory_limit) { memory_limit_ = memory_limit; }
+
  private:
+  int parallelism_{ 1 };
+  int batch_size_{ 1024 };
+  bool push_based_{ false };
+  int prefetch_depth_{ 2 };
+  // guards the token, which can be cancelled from another thread than the one planning the queries.
+  std::mutex mutex_;
+  std::shared_ptr<CancellationToken> token_{ std::make_shared<CancellationToken>() };
+  std::optional<CancellationToken::Clock::duration> timeout_;
+  int64_t memory_limit_{ std::numeric_limits<int64_t>::max() };
 };
 
 }  // namespace execution
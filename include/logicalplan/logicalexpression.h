@@ -49,6 +49,8 @@ enum class LogicalExpressionType {
   Max,
   Avg,
   Count,
+  ApproxCountDistinct,
+  ApproxPercentile,
 
   // misc.
   Cast,
@@ -385,7 +387,7 @@ struct And : public BooleanBinaryExpression {
   /**
    * @copydoc LogicalExpression::type()
    */
-  LogicalExpressionType type() override { return LogicalExpressionType::Add; }
+  LogicalExpressionType type() override { return LogicalExpressionType::And; }
 };
 
 /**
@@ -655,15 +657,75 @@ struct Avg : public AggregateExpression {
 };
 
 /**
- * @brief The COUNT aggregate logical expression.
+ * @brief The COUNT aggregate logical expression, COUNT(DISTINCT) if distinct is set.
  */
 struct Count : public AggregateExpression {
-  Count(std::shared_ptr<LogicalExpression> input) : AggregateExpression("count", input) { }
+  Count(std::shared_ptr<LogicalExpression> input, bool distinct = false)
+      : AggregateExpression(distinct ? "count_distinct" : "count", input),
+        distinct_{ distinct } { }
+
+  /**
+   * @copydoc LogicalExpression::ToField()
+   *
+   * The count is an integer whatever the type of expr.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Field>> ToField(std::shared_ptr<LogicalPlan> input) override {
+    return std::make_shared<arrow::Field>(this->name_, arrow::int64());
+  }
 
   /**
    * @copydoc LogicalExpression::type()
    */
   LogicalExpressionType type() override { return LogicalExpressionType::Count; }
+
+  bool distinct_;
+};
+
+/**
+ * @brief The APPROX_COUNT_DISTINCT aggregate logical expression.
+ */
+struct ApproxCountDistinct : public AggregateExpression {
+  ApproxCountDistinct(std::shared_ptr<LogicalExpression> input) : AggregateExpression("approx_count_distinct", input) { }
+
+  /**
+   * @copydoc LogicalExpression::ToField()
+   *
+   * The estimated count is an integer whatever the type of expr.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Field>> ToField(std::shared_ptr<LogicalPlan> input) override {
+    return std::make_shared<arrow::Field>(this->name_, arrow::int64());
+  }
+
+  /**
+   * @copydoc LogicalExpression::type()
+   */
+  LogicalExpressionType type() override { return LogicalExpressionType::ApproxCountDistinct; }
+};
+
+/**
+ * @brief The APPROX_PERCENTILE aggregate logical expression.
+ */
+struct ApproxPercentile : public AggregateExpression {
+  ApproxPercentile(std::shared_ptr<LogicalExpression> input, double percentile)
+      : AggregateExpression("approx_percentile", input),
+        percentile_{ percentile } { }
+
+  /**
+   * @copydoc LogicalExpression::ToField()
+   *
+   * The estimated percentile is interpolated between the values, it's a double whatever the numeric type of expr.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Field>> ToField(std::shared_ptr<LogicalPlan> input) override {
+    return std::make_shared<arrow::Field>(this->name_, arrow::float64());
+  }
+
+  /**
+   * @copydoc LogicalExpression::type()
+   */
+  LogicalExpressionType type() override { return LogicalExpressionType::ApproxPercentile; }
+
+  // the percentile to estimate, in [0, 1].
+  double percentile_;
 };
 
 }  // namespace logicalplan
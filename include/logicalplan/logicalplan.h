@@ -1,7 +1,9 @@
 #ifndef LOGICALPLAN_LOGICALPLAN_H
 #define LOGICALPLAN_LOGICALPLAN_H
 
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/status/statusor.h"
@@ -22,6 +24,11 @@ enum class LogicalPlanType {
   Projection,
   Selection,
   Aggregation,
+  Join,
+  Sort,
+  Limit,
+  Distinct,
+  Window,
 };
 
 /**
@@ -54,6 +61,15 @@ struct LogicalPlan {
    */
   virtual LogicalPlanType Type() = 0;
 
+  /**
+   * @brief Get the names of the columns the output of the plan is known to be sorted on, in ascending order.
+   *
+   * The output is sorted on the first column, then on the second one for rows with equal first column and so on.
+   *
+   * @return std::vector<std::string>: the sort columns, empty if the order is unknown.
+   */
+  virtual std::vector<std::string> SortedBy();
+
   /**
    * @brief Get string representation to print for debugging.
    *
@@ -68,12 +84,19 @@ struct LogicalPlan {
 /**
  * @brief Scan logical plan scans over a datasource applying an optional projection.
  *
+ * The filter pushed down from the selections above lets the source skip the chunks of rows which can't satisfy it, the
+ * selections still filter the rows which are read.
  */
 struct Scan : public LogicalPlan {
-  Scan(std::string path, std::shared_ptr<toyquery::datasource::DataSource> source, std::vector<std::string> projection)
+  Scan(
+      std::string path,
+      std::shared_ptr<toyquery::datasource::DataSource> source,
+      std::vector<std::string> projection,
+      std::vector<toyquery::datasource::ColumnPredicate> filter = {})
       : path_{ std::move(path) },
         source_{ std::move(source) },
-        projection_{ std::move(projection) } { }
+        projection_{ std::move(projection) },
+        filter_{ std::move(filter) } { }
 
   ~Scan() = default;
 
@@ -92,6 +115,11 @@ struct Scan : public LogicalPlan {
    */
   LogicalPlanType Type() override;
 
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
   /**
    * @copydoc LogicalPlan::ToString()
    */
@@ -100,6 +128,7 @@ struct Scan : public LogicalPlan {
   std::string path_;
   std::shared_ptr<toyquery::datasource::DataSource> source_;
   std::vector<std::string> projection_;
+  std::vector<toyquery::datasource::ColumnPredicate> filter_;
 };
 
 /**
@@ -129,6 +158,11 @@ struct Projection : public LogicalPlan {
    */
   LogicalPlanType Type() override;
 
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
   /**
    * @copydoc LogicalPlan::ToString()
    */
@@ -166,6 +200,11 @@ struct Selection : public LogicalPlan {
    */
   LogicalPlanType Type() override;
 
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
   /**
    * @copydoc LogicalPlan::ToString()
    */
@@ -217,6 +256,279 @@ struct Aggregation : public LogicalPlan {
   std::vector<std::shared_ptr<AggregateExpression>> aggregation_expr_;
 };
 
+/**
+ * @brief Join plan computes the inner equi-join of two input plans.
+ *
+ */
+struct Join : public LogicalPlan {
+  Join(
+      std::shared_ptr<LogicalPlan> left,
+      std::shared_ptr<LogicalPlan> right,
+      std::vector<std::pair<std::string, std::string>> on)
+      : left_{ std::move(left) },
+        right_{ std::move(right) },
+        on_{ std::move(on) } { }
+
+  ~Join() = default;
+
+  /**
+   * @copydoc LogicalPlan::Schema()
+   *
+   * The schema of Join is [left fields] + [right fields]
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc LogicalPlan::Children()
+   */
+  std::vector<std::shared_ptr<LogicalPlan>> Children() override;
+
+  /**
+   * @copydoc LogicalPlan::Type()
+   */
+  LogicalPlanType Type() override;
+
+  /**
+   * @copydoc LogicalPlan::ToString()
+   */
+  std::string ToString() override;
+
+  std::shared_ptr<LogicalPlan> left_;
+  std::shared_ptr<LogicalPlan> right_;
+  // pairs of (left column, right column) which should be equal.
+  std::vector<std::pair<std::string, std::string>> on_;
+};
+
+/**
+ * @brief An expression to sort on, along with the direction and the placement of the nulls.
+ */
+struct SortKey {
+  std::shared_ptr<LogicalExpression> expr_;
+  bool ascending_{ true };
+  bool nulls_first_{ false };
+};
+
+/**
+ * @brief Sort plan orders the output of the input plan on a list of sort keys.
+ *
+ */
+struct Sort : public LogicalPlan {
+  Sort(std::shared_ptr<LogicalPlan> input, std::vector<SortKey> sort_keys)
+      : input_{ std::move(input) },
+        sort_keys_{ std::move(sort_keys) } { }
+
+  ~Sort() = default;
+
+  /**
+   * @copydoc LogicalPlan::Schema()
+   *
+   * Sort doesn't alter the schema of the input.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc LogicalPlan::Children()
+   */
+  std::vector<std::shared_ptr<LogicalPlan>> Children() override;
+
+  /**
+   * @copydoc LogicalPlan::Type()
+   */
+  LogicalPlanType Type() override;
+
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
+  /**
+   * @copydoc LogicalPlan::ToString()
+   */
+  std::string ToString() override;
+
+  std::shared_ptr<LogicalPlan> input_;
+  std::vector<SortKey> sort_keys_;
+};
+
+/**
+ * @brief Limit plan skips the first offset rows of the output of the input plan and keeps at most limit rows after them.
+ *
+ */
+struct Limit : public LogicalPlan {
+  Limit(std::shared_ptr<LogicalPlan> input, int64_t limit, int64_t offset)
+      : input_{ std::move(input) },
+        limit_{ limit },
+        offset_{ offset } { }
+
+  ~Limit() = default;
+
+  /**
+   * @copydoc LogicalPlan::Schema()
+   *
+   * Limit doesn't alter the schema of the input.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc LogicalPlan::Children()
+   */
+  std::vector<std::shared_ptr<LogicalPlan>> Children() override;
+
+  /**
+   * @copydoc LogicalPlan::Type()
+   */
+  LogicalPlanType Type() override;
+
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
+  /**
+   * @copydoc LogicalPlan::ToString()
+   */
+  std::string ToString() override;
+
+  std::shared_ptr<LogicalPlan> input_;
+  // the maximum number of rows to keep, -1 if unlimited.
+  int64_t limit_;
+  int64_t offset_;
+};
+
+/**
+ * @brief Distinct plan only keeps one occurrence of each row of the output of the input plan.
+ *
+ */
+struct Distinct : public LogicalPlan {
+  Distinct(std::shared_ptr<LogicalPlan> input) : input_{ std::move(input) } { }
+
+  ~Distinct() = default;
+
+  /**
+   * @copydoc LogicalPlan::Schema()
+   *
+   * Distinct doesn't alter the schema of the input.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc LogicalPlan::Children()
+   */
+  std::vector<std::shared_ptr<LogicalPlan>> Children() override;
+
+  /**
+   * @copydoc LogicalPlan::Type()
+   */
+  LogicalPlanType Type() override;
+
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
+  /**
+   * @copydoc LogicalPlan::ToString()
+   */
+  std::string ToString() override;
+
+  std::shared_ptr<LogicalPlan> input_;
+};
+
+/**
+ * @brief The functions which can be evaluated over a window.
+ */
+enum class WindowFunctionType { RowNumber, Rank, DenseRank, Count, Sum, Avg, Min, Max };
+
+/**
+ * @brief The unit of the offsets of a window frame.
+ *
+ * ROWS offsets count rows from the current one, RANGE offsets are distances from the value of the order key of the
+ * current row, and a RANGE frame always includes the peers (the rows with equal order keys) of its bounds.
+ */
+enum class WindowFrameUnits { Rows, Range };
+
+/**
+ * @brief An unbounded start or end of a window frame.
+ */
+static constexpr int64_t WINDOW_FRAME_UNBOUNDED_PRECEDING = std::numeric_limits<int64_t>::min();
+static constexpr int64_t WINDOW_FRAME_UNBOUNDED_FOLLOWING = std::numeric_limits<int64_t>::max();
+
+/**
+ * @brief The rows of the partition the function is evaluated over, relative to the current row.
+ *
+ * The start and the end are signed offsets: negative for PRECEDING, 0 for CURRENT ROW and positive for FOLLOWING. The
+ * default frame is RANGE BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW, i.e. a running aggregate.
+ */
+struct WindowFrame {
+  WindowFrameUnits units_{ WindowFrameUnits::Range };
+  int64_t start_{ WINDOW_FRAME_UNBOUNDED_PRECEDING };
+  int64_t end_{ 0 };
+};
+
+/**
+ * @brief A function evaluated over a window, e.g. SUM(amount) OVER (... ROWS BETWEEN 2 PRECEDING AND CURRENT ROW).
+ */
+struct WindowFunction {
+  WindowFunctionType type_;
+  // the input of the aggregate functions, null for the ranking functions.
+  std::shared_ptr<LogicalExpression> expr_;
+  WindowFrame frame_;
+  // the name of the output column.
+  std::string name_;
+};
+
+/**
+ * @brief Window plan appends the result of window functions to each row of the output of the input plan.
+ *
+ * The rows are split into partitions on the partition keys and ordered within each partition on the order keys. Each
+ * function is then evaluated on each row over the frame of that row within its partition.
+ */
+struct Window : public LogicalPlan {
+  Window(
+      std::shared_ptr<LogicalPlan> input,
+      std::vector<std::shared_ptr<LogicalExpression>> partition_by,
+      std::vector<SortKey> order_by,
+      std::vector<WindowFunction> functions)
+      : input_{ std::move(input) },
+        partition_by_{ std::move(partition_by) },
+        order_by_{ std::move(order_by) },
+        functions_{ std::move(functions) } { }
+
+  ~Window() = default;
+
+  /**
+   * @copydoc LogicalPlan::Schema()
+   *
+   * The columns of the input followed by one column per window function.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc LogicalPlan::Children()
+   */
+  std::vector<std::shared_ptr<LogicalPlan>> Children() override;
+
+  /**
+   * @copydoc LogicalPlan::Type()
+   */
+  LogicalPlanType Type() override;
+
+  /**
+   * @copydoc LogicalPlan::SortedBy()
+   */
+  std::vector<std::string> SortedBy() override;
+
+  /**
+   * @copydoc LogicalPlan::ToString()
+   */
+  std::string ToString() override;
+
+  std::shared_ptr<LogicalPlan> input_;
+  std::vector<std::shared_ptr<LogicalExpression>> partition_by_;
+  std::vector<SortKey> order_by_;
+  std::vector<WindowFunction> functions_;
+};
+
 }  // namespace logicalplan
 }  // namespace toyquery
 
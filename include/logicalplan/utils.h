@@ -22,7 +22,9 @@ bool IsAggregateExpression(std::shared_ptr<toyquery::logicalplan::LogicalExpress
     case LogicalExpressionType::Avg:
     case LogicalExpressionType::Max:
     case LogicalExpressionType::Min:
-    case LogicalExpressionType::Count: {
+    case LogicalExpressionType::Count:
+    case LogicalExpressionType::ApproxCountDistinct:
+    case LogicalExpressionType::ApproxPercentile: {
       return true;
     }
 
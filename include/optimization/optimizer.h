@@ -2,6 +2,7 @@
 #define OPTIMIZATION_OPTIMIZER_H
 
 #include <unordered_set>
+#include <vector>
 
 #include "common/macros.h"
 #include "logicalplan/logicalplan.h"
@@ -69,6 +70,29 @@ class ProjectionPushDownRule : public OptimizerRule {
       std::unordered_set<std::string> column_names);
 };
 
+/**
+ * @brief Rule to push the comparisons of columns with literals of the selections down into the scans below them.
+ *
+ * The selections are kept, the pushed down predicates only let the data sources skip the chunks of rows which can't
+ * satisfy them, e.g. the parquet row groups whose min/max statistics are out of range.
+ */
+class PredicatePushDownRule : public OptimizerRule {
+ public:
+  PredicatePushDownRule() = default;
+  ~PredicatePushDownRule() override = default;
+
+  /**
+   * @copydoc OptimizerRule::Optimize
+   */
+  absl::StatusOr<std::shared_ptr<toyquery::logicalplan::LogicalPlan>> Optimize(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan) override;
+
+ private:
+  absl::StatusOr<std::shared_ptr<toyquery::logicalplan::LogicalPlan>> pushDown(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan,
+      std::vector<toyquery::datasource::ColumnPredicate> filter);
+};
+
 }  // namespace optimization
 }  // namespace toyquery
 
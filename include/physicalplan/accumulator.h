@@ -2,11 +2,15 @@
 #define PHYSICALPLAN_ACCUMULATOR_H
 
 #include <memory>
+#include <unordered_set>
 
 #include "absl/status/statusor.h"
 #include "arrow/api.h"
+#include "common/key.h"
 #include "common/macros.h"
 #include "common/status.h"
+#include "physicalplan/bitmap.h"
+#include "physicalplan/sketch.h"
 
 namespace toyquery {
 namespace physicalplan {
@@ -34,6 +38,16 @@ class Accumulator {
    */
   virtual absl::StatusOr<std::shared_ptr<arrow::Scalar>> FinalValue() = 0;
 
+  /**
+   * @brief Merge the values accumulated by another accumulator of the same kind into this one.
+   *
+   * Combines the partial aggregations computed on different parts of the input. Accumulates the final value of the other
+   * accumulator by default.
+   *
+   * @return absl::Status the result of the operation
+   */
+  virtual absl::Status Merge(Accumulator& other);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Accumulator);
 };
@@ -104,6 +118,124 @@ class SumAccumulator : public Accumulator {
   std::shared_ptr<arrow::Scalar> value_{};
 };
 
+/**
+ * @brief Accumulator to count the non null values among a set of values.
+ *
+ */
+class CountAccumulator : public Accumulator {
+ public:
+  CountAccumulator() = default;
+
+  /**
+   * @copydoc Accumulator::Accumulate
+   */
+  absl::Status Accumulate(std::shared_ptr<arrow::Scalar> value) override;
+
+  /**
+   * @copydoc Accumulator::FinalValue
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Scalar>> FinalValue() override;
+
+  /**
+   * @copydoc Accumulator::Merge
+   */
+  absl::Status Merge(Accumulator& other) override;
+
+ private:
+  int64_t count_{ 0 };
+};
+
+/**
+ * @brief Accumulator to count the distinct non null values among a set of values.
+ *
+ * The integer values are kept in a roaring bitmap, the values of the other types in a hash set.
+ */
+class CountDistinctAccumulator : public Accumulator {
+ public:
+  CountDistinctAccumulator() = default;
+
+  /**
+   * @copydoc Accumulator::Accumulate
+   */
+  absl::Status Accumulate(std::shared_ptr<arrow::Scalar> value) override;
+
+  /**
+   * @copydoc Accumulator::FinalValue
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Scalar>> FinalValue() override;
+
+  /**
+   * @copydoc Accumulator::Merge
+   */
+  absl::Status Merge(Accumulator& other) override;
+
+ private:
+  RoaringBitmap integer_values_;
+  std::unordered_set<toyquery::Key> values_;
+};
+
+/**
+ * @brief Accumulator to estimate the number of distinct non null values among a set of values.
+ *
+ * Uses a HyperLogLog sketch, whose memory is fixed whatever the number of values.
+ */
+class ApproxCountDistinctAccumulator : public Accumulator {
+ public:
+  ApproxCountDistinctAccumulator() = default;
+
+  /**
+   * @copydoc Accumulator::Accumulate
+   */
+  absl::Status Accumulate(std::shared_ptr<arrow::Scalar> value) override;
+
+  /**
+   * @copydoc Accumulator::FinalValue
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Scalar>> FinalValue() override;
+
+  /**
+   * @copydoc Accumulator::Merge
+   */
+  absl::Status Merge(Accumulator& other) override;
+
+ private:
+  HyperLogLog sketch_;
+};
+
+/**
+ * @brief Accumulator to estimate a percentile of a set of numeric values.
+ *
+ * Uses a t-digest sketch, whose memory is bounded by its compression whatever the number of values.
+ */
+class ApproxPercentileAccumulator : public Accumulator {
+ public:
+  /**
+   * @brief Construct a new Approx Percentile Accumulator object.
+   *
+   * @param percentile the percentile to estimate, in [0, 1]
+   */
+  ApproxPercentileAccumulator(double percentile) : percentile_{ percentile } { }
+
+  /**
+   * @copydoc Accumulator::Accumulate
+   */
+  absl::Status Accumulate(std::shared_ptr<arrow::Scalar> value) override;
+
+  /**
+   * @copydoc Accumulator::FinalValue
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Scalar>> FinalValue() override;
+
+  /**
+   * @copydoc Accumulator::Merge
+   */
+  absl::Status Merge(Accumulator& other) override;
+
+ private:
+  double percentile_;
+  TDigest sketch_;
+};
+
 }  // namespace physicalplan
 }  // namespace toyquery
 
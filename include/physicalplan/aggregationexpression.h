@@ -81,6 +81,73 @@ class SumExpression : public AggregationExpression {
   absl::StatusOr<std::shared_ptr<Accumulator>> CreateAccumulator() override { return std::make_shared<SumAccumulator>(); }
 };
 
+/**
+ * @brief Count aggregation expression
+ *
+ */
+class CountExpression : public AggregationExpression {
+ public:
+  CountExpression(std::shared_ptr<PhysicalExpression> input) : AggregationExpression(input) { }
+
+  /**
+   * @copydoc AggregationExpression::CreateAccumulator
+   */
+  absl::StatusOr<std::shared_ptr<Accumulator>> CreateAccumulator() override { return std::make_shared<CountAccumulator>(); }
+};
+
+/**
+ * @brief Count distinct aggregation expression
+ *
+ */
+class CountDistinctExpression : public AggregationExpression {
+ public:
+  CountDistinctExpression(std::shared_ptr<PhysicalExpression> input) : AggregationExpression(input) { }
+
+  /**
+   * @copydoc AggregationExpression::CreateAccumulator
+   */
+  absl::StatusOr<std::shared_ptr<Accumulator>> CreateAccumulator() override {
+    return std::make_shared<CountDistinctAccumulator>();
+  }
+};
+
+/**
+ * @brief Approximate count distinct aggregation expression
+ *
+ */
+class ApproxCountDistinctExpression : public AggregationExpression {
+ public:
+  ApproxCountDistinctExpression(std::shared_ptr<PhysicalExpression> input) : AggregationExpression(input) { }
+
+  /**
+   * @copydoc AggregationExpression::CreateAccumulator
+   */
+  absl::StatusOr<std::shared_ptr<Accumulator>> CreateAccumulator() override {
+    return std::make_shared<ApproxCountDistinctAccumulator>();
+  }
+};
+
+/**
+ * @brief Approximate percentile aggregation expression
+ *
+ */
+class ApproxPercentileExpression : public AggregationExpression {
+ public:
+  ApproxPercentileExpression(std::shared_ptr<PhysicalExpression> input, double percentile)
+      : AggregationExpression(input),
+        percentile_{ percentile } { }
+
+  /**
+   * @copydoc AggregationExpression::CreateAccumulator
+   */
+  absl::StatusOr<std::shared_ptr<Accumulator>> CreateAccumulator() override {
+    return std::make_shared<ApproxPercentileAccumulator>(percentile_);
+  }
+
+ private:
+  double percentile_;
+};
+
 }  // namespace physicalplan
 }  // namespace toyquery
 
@@ -0,0 +1,75 @@
+#ifndef PHYSICALPLAN_BITMAP_H
+#define PHYSICALPLAN_BITMAP_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace toyquery {
+namespace physicalplan {
+
+/**
+ * @brief A compressed set of 64 bit integers, following the roaring bitmap layout.
+ *
+ * The values are split on their high 48 bits into chunks of 2^16 values. Each chunk is stored in a container holding the
+ * low 16 bits of its values, either as a sorted array while the chunk is sparse or as a 2^16 bit set once it's dense.
+ * Dense integer domains cost about a bit per value and sparse ones two bytes per value, instead of the tens of bytes of a
+ * hash set entry.
+ *
+ * Bitmaps built on disjoint parts of the input can be merged, e.g. partial aggregations running in parallel.
+ */
+class RoaringBitmap {
+ public:
+  RoaringBitmap() = default;
+
+  /**
+   * @brief Add the value to the set.
+   *
+   * @return bool: true if the value wasn't in the set yet
+   */
+  bool Add(uint64_t value);
+
+  /**
+   * @brief Check if the value is in the set.
+   */
+  bool Contains(uint64_t value) const;
+
+  /**
+   * @brief Add all the values of the other bitmap to this one.
+   */
+  void Merge(const RoaringBitmap& other);
+
+  /**
+   * @brief Get the number of values in the set.
+   */
+  int64_t Cardinality() const { return cardinality_; }
+
+  /**
+   * @brief Get the memory used by the containers.
+   */
+  int64_t SizeInBytes() const;
+
+ private:
+  // the low 16 bits of the values of a chunk.
+  struct Container {
+    bool Add(uint16_t low);
+    bool Contains(uint16_t low) const;
+    void Merge(const Container& other);
+
+    // convert the sorted array to a bit set, once it grows past the size of the bit set.
+    void toBitset();
+
+    std::vector<uint16_t> array_;
+    std::vector<uint64_t> bitset_;
+    int64_t cardinality_{ 0 };
+  };
+
+  // containers keyed by the high 48 bits of their values.
+  std::map<uint64_t, Container> containers_;
+  int64_t cardinality_{ 0 };
+};
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_BITMAP_H
\ No newline at end of file
@@ -31,9 +31,12 @@ class PhysicalExpression {
    * @brief Evaluate the expression on the record batch to generate output column.
    *
    * @param input: the input record batch
+   * @param pool: the memory pool the output column is allocated from, the pool of the operator evaluating it
    * @return absl::StatusOr<std::shared_ptr<arrow::Array>>: the output column
    */
-  virtual absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) = 0;
+  virtual absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) = 0;
 
   /**
    * @brief Get string representation to print for debugging.
@@ -56,13 +59,20 @@ class Column : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @copydoc PhysicalExpression::ToString()
    */
   std::string ToString() override;
 
+  /**
+   * @brief Get the index of the column in the input.
+   */
+  int Index() const { return idx_; }
+
  private:
   int idx_;
 };
@@ -79,7 +89,9 @@ class LiteralLong : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @copydoc PhysicalExpression::ToString()
@@ -102,7 +114,9 @@ class LiteralDouble : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @copydoc PhysicalExpression::ToString()
@@ -125,7 +139,9 @@ class LiteralString : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @copydoc PhysicalExpression::ToString()
@@ -148,7 +164,9 @@ class LiteralBoolean : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @copydoc PhysicalExpression::ToString()
@@ -175,18 +193,22 @@ class BooleanExpression : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @brief Compare two arrow::Array using the boolean expression.
    *
    * @param left: the left operand
    * @param right: the right operand
+   * @param pool: the memory pool the result is allocated from
    * @return absl::StatusOr<std::shared_ptr<arrow::Array>>: the resulting expression arrow::Array
    */
   absl::StatusOr<std::shared_ptr<arrow::Array>> Compare(
       const std::shared_ptr<arrow::Array> left,
-      const std::shared_ptr<arrow::Array> right);
+      const std::shared_ptr<arrow::Array> right,
+      arrow::MemoryPool* pool);
 
   /**
    * @brief Evaluate the expression on two scalers.
@@ -364,18 +386,22 @@ class BinaryExpression : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @brief Evaluate the expression on two arrow::Array.
    *
    * @param left the left operand
    * @param right the right operand
+   * @param pool the memory pool the result is allocated from
    * @return absl::StatusOr<std::shared_ptr<arrow::Array>>: the resulting arrow::Array
    */
   virtual absl::StatusOr<std::shared_ptr<arrow::Array>> EvaluateBinaryExpression(
       const std::shared_ptr<arrow::Array> left,
-      const std::shared_ptr<arrow::Array> right) = 0;
+      const std::shared_ptr<arrow::Array> right,
+      arrow::MemoryPool* pool) = 0;
 
  private:
   std::shared_ptr<PhysicalExpression> left_;
@@ -395,7 +421,8 @@ class MathExpression : public BinaryExpression {
    */
   absl::StatusOr<std::shared_ptr<arrow::Array>> EvaluateBinaryExpression(
       const std::shared_ptr<arrow::Array> left,
-      const std::shared_ptr<arrow::Array> right) override;
+      const std::shared_ptr<arrow::Array> right,
+      arrow::MemoryPool* pool) override;
 
   /**
    * @brief Evaluate the math expression on the two scalars
@@ -519,7 +546,9 @@ class Cast : public PhysicalExpression {
   /**
    * @copydoc PhysicalExpression::Evaluate()
    */
-  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(const std::shared_ptr<arrow::RecordBatch> input) override;
+  absl::StatusOr<std::shared_ptr<arrow::Array>> Evaluate(
+      const std::shared_ptr<arrow::RecordBatch> input,
+      arrow::MemoryPool* pool = arrow::default_memory_pool()) override;
 
   /**
    * @copydoc PhysicalExpression::ToString()
@@ -1,24 +1,43 @@
 #ifndef PHYSICALPLAN_PHYSICALPLAN_H
 #define PHYSICALPLAN_PHYSICALPLAN_H
 
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "arrow/api.h"
+#include "common/cancellation.h"
+#include "common/key.h"
 #include "common/macros.h"
+#include "common/memorypool.h"
+#include "common/threadpool.h"
 #include "datasource/datasource.h"
 #include "logicalplan/logicalexpression.h"
 #include "physicalplan/aggregationexpression.h"
+#include "physicalplan/bitmap.h"
 #include "physicalplan/physicalexpression.h"
+#include "physicalplan/runtimefilter.h"
+#include "physicalplan/sort.h"
+#include "physicalplan/spill.h"
+#include "physicalplan/window.h"
 
 namespace toyquery {
 namespace physicalplan {
 
 namespace {
 
+using ::toyquery::datasource::ColumnPredicate;
 using ::toyquery::datasource::DataSource;
+using ::toyquery::datasource::ScanContext;
 
 }
 
@@ -62,6 +81,16 @@ class PhysicalPlan {
    */
   virtual absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() = 0;
 
+  /**
+   * @brief Signal that the consumer won't pull any more record batches from the plan.
+   *
+   * The plan can stop its work and release its resources early, e.g. a scan stops reading its data source. Cancels the
+   * children by default.
+   *
+   * @note Next returns the end of the stream once the work has been stopped.
+   */
+  virtual void Cancel();
+
   /**
    * @brief Get string representation to print for debugging.
    *
@@ -69,17 +98,112 @@ class PhysicalPlan {
    */
   virtual std::string ToString() = 0;
 
+  /**
+   * @brief Attach the cancellation token of the query to the plan and its children.
+   *
+   * @param token: the token checked by Next, which returns its Cancelled or DeadlineExceeded status once triggered
+   */
+  virtual void SetCancellationToken(std::shared_ptr<CancellationToken> token);
+
+  /**
+   * @brief Attach the memory pool of the query to the plan and its children.
+   *
+   * Each operator allocates from its own child pool of the query pool, so that the memory of the query is attributed
+   * to its operators. The allocations over the limit of the query fail with a ResourceExhausted status, the operators
+   * able to spill (Sort, GraceHashJoin) also spill before reaching it.
+   *
+   * @param query_pool: the memory pool of the query
+   */
+  virtual void SetMemoryPool(std::shared_ptr<TrackingMemoryPool> query_pool);
+
+  /**
+   * @brief Get the memory pool of the query the plan is part of, nullptr if none was attached.
+   */
+  std::shared_ptr<TrackingMemoryPool> QueryMemoryPool() { return query_pool_; }
+
+  /**
+   * @brief Get the cancellation token of the query the plan is part of, nullptr if none was attached.
+   */
+  std::shared_ptr<CancellationToken> QueryCancellationToken() { return token_; }
+
+ protected:
+  // check if the query was cancelled or is past its deadline.
+  absl::Status checkCancelled() { return token_ == nullptr ? absl::OkStatus() : token_->Check(); }
+
+  // the memory pool the operator allocates from.
+  arrow::MemoryPool* memoryPool();
+
+  // the number of bytes the operator can still use before hitting the memory limit of the query.
+  int64_t memoryAvailable();
+
+  // charge memory held outside of arrow buffers to the pool of the operator, ResourceExhausted over the memory limit.
+  absl::Status reserveMemory(int64_t size);
+
+  // give back the memory charged by reserveMemory.
+  void releaseMemory(int64_t size);
+
  private:
+  std::shared_ptr<CancellationToken> token_;
+  std::shared_ptr<TrackingMemoryPool> query_pool_;
+  std::shared_ptr<TrackingMemoryPool> pool_;
+
   DISALLOW_COPY_AND_ASSIGN(PhysicalPlan);
 };
 
+/**
+ * @brief A physical plan transforming each batch of its input on its own, which can be fused into a pipeline.
+ *
+ * In a push-based pipeline, the batches are pushed through Process instead of being pulled with Next.
+ */
+class StreamingOperator {
+ public:
+  virtual ~StreamingOperator() = default;
+
+  /**
+   * @brief Process a batch of the input.
+   *
+   * @param batch: the input batch
+   * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>: the output batch, nullptr if no row is left.
+   */
+  virtual absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Process(std::shared_ptr<arrow::RecordBatch> batch) = 0;
+};
+
+/**
+ * @brief A physical plan consuming its whole input before producing any output, which ends a pipeline.
+ *
+ * In a push-based pipeline, the input batches are pushed through Consume followed by a single Finish, after which Next
+ * returns the output without pulling the input.
+ */
+class PipelineBreaker {
+ public:
+  virtual ~PipelineBreaker() = default;
+
+  /**
+   * @brief Consume a batch of the input.
+   */
+  virtual absl::Status Consume(std::shared_ptr<arrow::RecordBatch> batch) = 0;
+
+  /**
+   * @brief Signal the end of the input, the output is ready to be read with Next.
+   */
+  virtual absl::Status Finish() = 0;
+
+  /**
+   * @brief Check if the whole input has been consumed.
+   */
+  virtual bool Finished() = 0;
+};
+
 /**
  * @brief The scan execution
  *
  */
 class Scan : public PhysicalPlan {
  public:
-  Scan(std::shared_ptr<DataSource> data_source, std::vector<std::string> projection);
+  Scan(
+      std::shared_ptr<DataSource> data_source,
+      std::vector<std::string> projection,
+      std::vector<ColumnPredicate> filter = {});
   ~Scan() override;
 
   /**
@@ -102,24 +226,49 @@ class Scan : public PhysicalPlan {
    */
   absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
 
+  /**
+   * @copydoc PhysicalPlan::Cancel
+   */
+  void Cancel() override;
+
   /**
    * @copydoc PhysicalPlan::ToString
    */
   std::string ToString() override;
 
+  /**
+   * @brief Attach a runtime filter published by a join on the given column of the scan output.
+   *
+   * @param column_idx: the index of the filtered column in the output schema of the scan
+   * @param filter: the runtime filter
+   */
+  void AddRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter);
+
+  /**
+   * @brief Set the degree of parallelism and the prefetch depth of the query, passed to the source with its token and
+   * memory pool when it is scanned.
+   */
+  void SetQueryOptions(int parallelism, int prefetch_depth);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Scan);
 
   std::shared_ptr<DataSource> data_source_;
   std::vector<std::string> projection_;
-  std::shared_ptr<arrow::TableBatchReader> batch_reader_{ nullptr };
+  // the predicates the source prunes its chunks of rows with.
+  std::vector<ColumnPredicate> filter_;
+  std::shared_ptr<arrow::RecordBatchReader> batch_reader_{ nullptr };
+  bool cancelled_{ false };
+  std::vector<RuntimeFilterTarget> runtime_filters_;
+  int parallelism_{ 1 };
+  int prefetch_depth_{ 2 };
 };
 
 /**
  * @brief The projection execution
  *
  */
-class Projection : public PhysicalPlan {
+class Projection : public PhysicalPlan, public StreamingOperator {
  public:
   Projection(
       std::shared_ptr<PhysicalPlan> input,
@@ -148,11 +297,24 @@ class Projection : public PhysicalPlan {
    */
   absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
 
+  /**
+   * @copydoc StreamingOperator::Process
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Process(std::shared_ptr<arrow::RecordBatch> batch) override;
+
   /**
    * @copydoc PhysicalPlan::ToString
    */
   std::string ToString() override;
 
+  /**
+   * @brief Get the input column passed through as is at the given index of the projection output.
+   *
+   * @param column_idx: the index of the column in the output schema of the projection
+   * @return int: the index of the column in the input, -1 if the output column is computed
+   */
+  int PassedThroughColumn(int column_idx);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Projection);
 
@@ -165,7 +327,7 @@ class Projection : public PhysicalPlan {
  * @brief The selection execution
  *
  */
-class Selection : public PhysicalPlan {
+class Selection : public PhysicalPlan, public StreamingOperator {
  public:
   Selection(std::shared_ptr<PhysicalPlan> input, std::shared_ptr<PhysicalExpression> predicate);
   ~Selection() override;
@@ -190,18 +352,28 @@ class Selection : public PhysicalPlan {
    */
   absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
 
+  /**
+   * @copydoc StreamingOperator::Process
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Process(std::shared_ptr<arrow::RecordBatch> batch) override;
+
   /**
    * @copydoc PhysicalPlan::ToString
    */
   std::string ToString() override;
 
- private:
-  absl::StatusOr<std::shared_ptr<arrow::Array>> filterColumn(
-      std::shared_ptr<arrow::Array> data,
-      std::shared_ptr<arrow::BooleanArray> predicate);
+  /**
+   * @brief Attach a runtime filter published by a join on the given column of the selection output.
+   *
+   * @param column_idx: the index of the filtered column in the output schema of the selection
+   * @param filter: the runtime filter
+   */
+  void AddRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter);
 
+ private:
   std::shared_ptr<PhysicalPlan> input_;
   std::shared_ptr<PhysicalExpression> predicate_;
+  std::vector<RuntimeFilterTarget> runtime_filters_;
 
   DISALLOW_COPY_AND_ASSIGN(Selection);
 };
@@ -210,13 +382,29 @@ class Selection : public PhysicalPlan {
  * @brief The hash aggregation execution
  *
  */
-class HashAggregation : public PhysicalPlan {
+class HashAggregation : public PhysicalPlan, public PipelineBreaker {
  public:
   HashAggregation(
       std::shared_ptr<PhysicalPlan> input,
       std::shared_ptr<arrow::Schema> schema,
       std::vector<std::shared_ptr<PhysicalExpression>> grouping_expressions,
       std::vector<std::shared_ptr<AggregationExpression>> aggregation_expressions);
+
+  /**
+   * @brief Construct the final aggregation merging the groups of partial aggregations.
+   *
+   * The partial aggregations run as the pipelines gathered by the input, each on a part of the rows. They then only
+   * keep their groups, which are merged by the final aggregation through Accumulator::Merge once the input is drained,
+   * so that aggregations whose state isn't their final value (e.g. COUNT(DISTINCT)) can be split too.
+   *
+   * @param input: the plan running the partial aggregations, which return no batch
+   * @param schema: the schema of the partial (and final) aggregations
+   * @param partials: the partial aggregations
+   */
+  HashAggregation(
+      std::shared_ptr<PhysicalPlan> input,
+      std::shared_ptr<arrow::Schema> schema,
+      std::vector<std::shared_ptr<HashAggregation>> partials);
   ~HashAggregation() override;
 
   /**
@@ -244,20 +432,1009 @@ class HashAggregation : public PhysicalPlan {
    */
   std::string ToString() override;
 
+  /**
+   * @copydoc PipelineBreaker::Consume
+   */
+  absl::Status Consume(std::shared_ptr<arrow::RecordBatch> batch) override;
+
+  /**
+   * @copydoc PipelineBreaker::Finish
+   */
+  absl::Status Finish() override;
+
+  /**
+   * @copydoc PipelineBreaker::Finished
+   */
+  bool Finished() override { return batch_reader_ != nullptr; }
+
  private:
-  absl::StatusOr<std::vector<std::shared_ptr<arrow::RecordBatch>>> getAllInputBatches();
+  // pull the whole input and consume it.
+  absl::Status consumeInput();
+
+  // merge the groups of the partial aggregations into the groups of this one.
+  absl::Status mergePartials();
+
+  // charge the estimated memory of a new group to the pool of the operator.
+  absl::Status reserveGroup();
+
+  // give back the memory charged for the groups, once they are cleared.
+  void releaseGroups();
 
   std::shared_ptr<PhysicalPlan> input_;
   std::shared_ptr<arrow::Schema> schema_;
   std::vector<std::shared_ptr<PhysicalExpression>> grouping_expressions_;
   std::vector<std::shared_ptr<AggregationExpression>> aggregation_expressions_;
 
+  // the partial aggregations merged by this final one, if any.
+  std::vector<std::shared_ptr<HashAggregation>> partials_;
+  // whether this is a partial aggregation, which keeps its groups for the final one instead of returning them.
+  bool partial_{ false };
+  bool consumed_{ false };
+
+  // map from the tuple of grouping keys to list of accumulators
+  // <gk1, gk2, gk3 .. gkx> -> [ac1, ac2, .. acy]
+  std::unordered_map<toyquery::Key, std::vector<std::shared_ptr<Accumulator>>> groups_;
+  // the memory charged for the groups, which are not allocated from the pool of the operator.
+  int64_t reserved_bytes_{ 0 };
+
   std::unique_ptr<arrow::TableBatchReader> batch_reader_;
   std::shared_ptr<arrow::Table> processed_table_;
 
   DISALLOW_COPY_AND_ASSIGN(HashAggregation);
 };
 
+/**
+ * @brief Map from the tuple of join keys to the build rows having those keys.
+ */
+using JoinHashTable = std::unordered_map<toyquery::Key, std::vector<int64_t>>;
+
+/**
+ * @brief The hash join execution
+ *
+ * Inner equi-join. The build (right) input is fully consumed into a hash table on the first call to Next, after which
+ * the probe (left) input is streamed through it. Once the build side is consumed, a runtime filter holding the min/max
+ * range and a bloom filter of each build key is published so that the probe side operators can drop non matching rows
+ * before they reach the join.
+ *
+ * The output contains the probe columns followed by the build columns.
+ */
+class HashJoin : public PhysicalPlan {
+ public:
+  HashJoin(
+      std::shared_ptr<PhysicalPlan> probe,
+      std::shared_ptr<PhysicalPlan> build,
+      std::shared_ptr<arrow::Schema> schema,
+      std::vector<int> probe_keys,
+      std::vector<int> build_keys);
+  ~HashJoin() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+  /**
+   * @brief Get the runtime filters published by the build side, one per join key.
+   *
+   * @return std::vector<std::shared_ptr<RuntimeFilter>>: the i-th filter applies on the i-th probe key.
+   */
+  std::vector<std::shared_ptr<RuntimeFilter>> RuntimeFilters();
+
+  /**
+   * @brief Apply a runtime filter on the probe batches before they are joined.
+   *
+   * Meant for the filters which no operator of the probe side could take, e.g. when the key is computed.
+   *
+   * @param column_idx: the index of the filtered column in the output schema of the probe side
+   * @param filter: the runtime filter
+   */
+  void AddProbeRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter);
+
+ private:
+  absl::Status build();
+
+  std::shared_ptr<PhysicalPlan> probe_;
+  std::shared_ptr<PhysicalPlan> build_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::vector<int> probe_keys_;
+  std::vector<int> build_keys_;
+  std::vector<std::shared_ptr<RuntimeFilter>> runtime_filters_;
+  std::vector<RuntimeFilterTarget> probe_filters_;
+
+  bool built_{ false };
+  // the build side columns concatenated across all the build batches.
+  std::vector<std::shared_ptr<arrow::Array>> build_columns_;
+  JoinHashTable hash_table_;
+
+  DISALLOW_COPY_AND_ASSIGN(HashJoin);
+};
+
+/**
+ * @brief The spill metrics of an operator.
+ */
+struct SpillMetrics {
+  // number of partitions (or sorted runs) written to disk.
+  int64_t spilled_partitions{ 0 };
+  // number of rows written to disk.
+  int64_t spilled_rows{ 0 };
+  // size of the spilled data in memory.
+  int64_t spilled_bytes{ 0 };
+  // number of spill files created.
+  int64_t spill_files{ 0 };
+  // deepest level of recursive repartitioning.
+  int max_recursion_depth{ 0 };
+};
+
+/**
+ * @brief The scan of a spill file execution
+ *
+ * Streams back the record batches spilled by an operator. The spill file is deleted once the scan is destroyed.
+ */
+class SpillScan : public PhysicalPlan {
+ public:
+  SpillScan(std::string path, std::shared_ptr<arrow::Schema> schema);
+  ~SpillScan() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  std::string path_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::unique_ptr<SpillFileReader> reader_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpillScan);
+};
+
+/**
+ * @brief The grace (hybrid) hash join execution
+ *
+ * Inner equi-join which doesn't need the build side to fit in memory. Both inputs are hash partitioned on the join keys.
+ * The build partitions stay in memory as long as the memory limit allows, the largest one is spilled to a local Arrow IPC
+ * file otherwise. The probe rows falling in an in-memory partition are joined right away while the ones falling in a
+ * spilled partition are spilled as well. Once the probe side is exhausted, each pair of spilled partitions is joined by
+ * a nested grace hash join which repartitions it using different hash bits.
+ *
+ * Like the hash join, it publishes runtime filters of all the build keys, spilled or not, once the build side is consumed.
+ *
+ * The output contains the probe columns followed by the build columns.
+ */
+class GraceHashJoin : public PhysicalPlan {
+ public:
+  GraceHashJoin(
+      std::shared_ptr<PhysicalPlan> probe,
+      std::shared_ptr<PhysicalPlan> build,
+      std::shared_ptr<arrow::Schema> schema,
+      std::vector<int> probe_keys,
+      std::vector<int> build_keys,
+      int64_t memory_limit,
+      int num_partitions,
+      std::string spill_directory,
+      int level = 0);
+  ~GraceHashJoin() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+  /**
+   * @brief Get the spill metrics, including the ones of the nested joins.
+   */
+  SpillMetrics Metrics() const { return metrics_; }
+
+  /**
+   * @copydoc HashJoin::RuntimeFilters
+   */
+  std::vector<std::shared_ptr<RuntimeFilter>> RuntimeFilters();
+
+  /**
+   * @copydoc HashJoin::AddProbeRuntimeFilter
+   */
+  void AddProbeRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter);
+
+ private:
+  // A hash partition of both sides of the join.
+  struct Partition {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> build_batches;
+    int64_t build_bytes{ 0 };
+
+    // set once the partition is spilled, the probe file is created on the first probe row of the partition.
+    std::unique_ptr<SpillFileWriter> build_file;
+    std::unique_ptr<SpillFileWriter> probe_file;
+  };
+
+  absl::Status build();
+  absl::Status spillPartition(int partition_idx);
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> nextFromSpilledPartitions();
+
+  // split the batch into one batch per partition, nullptr for the partitions without rows. Rows having a null key are
+  // dropped since they never match.
+  absl::StatusOr<std::vector<std::shared_ptr<arrow::RecordBatch>>> partitionBatch(
+      std::shared_ptr<arrow::RecordBatch> batch,
+      const std::vector<int>& keys);
+
+  std::shared_ptr<PhysicalPlan> probe_;
+  std::shared_ptr<PhysicalPlan> build_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::vector<int> probe_keys_;
+  std::vector<int> build_keys_;
+  int64_t memory_limit_;
+  int num_partitions_;
+  std::string spill_directory_;
+  int level_;
+  std::vector<std::shared_ptr<RuntimeFilter>> runtime_filters_;
+  std::vector<RuntimeFilterTarget> probe_filters_;
+
+  bool built_{ false };
+  bool probe_done_{ false };
+  int64_t memory_used_{ 0 };
+  std::vector<Partition> partitions_;
+
+  // the in-memory build partitions, concatenated.
+  std::vector<std::shared_ptr<arrow::Array>> build_columns_;
+  JoinHashTable hash_table_;
+
+  // the nested join of the spilled partition currently being joined.
+  int current_partition_{ -1 };
+  std::shared_ptr<GraceHashJoin> current_join_;
+
+  SpillMetrics metrics_;
+
+  DISALLOW_COPY_AND_ASSIGN(GraceHashJoin);
+};
+
+/**
+ * @brief The sort-merge join execution
+ *
+ * Inner equi-join of two inputs which are both sorted in ascending order on their join keys. The inputs are merged in a
+ * single streaming pass: only the current batch of each side and the run of right rows sharing the current key are
+ * kept in memory. Rows having a null key never match and are skipped.
+ *
+ * The output contains the left columns followed by the right columns.
+ */
+class SortMergeJoin : public PhysicalPlan {
+ public:
+  SortMergeJoin(
+      std::shared_ptr<PhysicalPlan> left,
+      std::shared_ptr<PhysicalPlan> right,
+      std::shared_ptr<arrow::Schema> schema,
+      std::vector<int> left_keys,
+      std::vector<int> right_keys);
+  ~SortMergeJoin() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  // A reference to a row of an input batch.
+  using RowRef = std::pair<std::shared_ptr<arrow::RecordBatch>, int64_t>;
+
+  // The read position in one of the inputs.
+  struct Cursor {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    int64_t row{ 0 };
+    bool done{ false };
+  };
+
+  // The output rows of one side, grouped by the batch they come from.
+  struct OutputPiece {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    std::vector<int64_t> indices;
+  };
+
+  absl::Status advance(Cursor& cursor, std::shared_ptr<PhysicalPlan>& input);
+  absl::Status skipNullKeys(Cursor& cursor, std::shared_ptr<PhysicalPlan>& input, const std::vector<int>& keys);
+  int compareKeys(
+      const RowRef& left,
+      const std::vector<int>& left_keys,
+      const RowRef& right,
+      const std::vector<int>& right_keys);
+  void appendOutputRow(std::vector<OutputPiece>& pieces, const RowRef& row);
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> flushOutput();
+
+  std::shared_ptr<PhysicalPlan> left_;
+  std::shared_ptr<PhysicalPlan> right_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::vector<int> left_keys_;
+  std::vector<int> right_keys_;
+
+  bool started_{ false };
+  Cursor left_cursor_;
+  Cursor right_cursor_;
+  // the right rows sharing the key currently being joined.
+  std::vector<RowRef> right_run_;
+
+  int64_t output_rows_{ 0 };
+  std::vector<OutputPiece> left_output_;
+  std::vector<OutputPiece> right_output_;
+
+  DISALLOW_COPY_AND_ASSIGN(SortMergeJoin);
+};
+
+/**
+ * @brief The sort execution
+ *
+ * The input is consumed on the first call to Next. The permutation of the row indices is sorted on the evaluated sort
+ * keys, see SortIndices, after which every column is gathered once and emitted in batches.
+ *
+ * When the buffered input grows over the memory limit, it is sorted and spilled as a run to a compressed Arrow IPC file.
+ * Once the input is exhausted, the spilled runs and the last in-memory run are merged with a loser tree, reading a single
+ * batch of each run at a time, so the sorted output is streamed without ever being fully materialized.
+ */
+class Sort : public PhysicalPlan, public PipelineBreaker {
+ public:
+  Sort(
+      std::shared_ptr<PhysicalPlan> input,
+      std::vector<SortKey> sort_keys,
+      int64_t memory_limit = std::numeric_limits<int64_t>::max(),
+      std::string spill_directory = "");
+  ~Sort() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+  /**
+   * @brief Get the spill metrics of the sort, a spilled partition is a sorted run.
+   */
+  const SpillMetrics& Metrics() const { return metrics_; }
+
+  /**
+   * @copydoc PipelineBreaker::Consume
+   */
+  absl::Status Consume(std::shared_ptr<arrow::RecordBatch> batch) override;
+
+  /**
+   * @copydoc PipelineBreaker::Finish
+   */
+  absl::Status Finish() override;
+
+  /**
+   * @copydoc PipelineBreaker::Finished
+   */
+  bool Finished() override { return sorted_input_; }
+
+ private:
+  // A sorted run being merged, either spilled or kept in memory.
+  struct Run {
+    std::unique_ptr<SpillFileReader> reader;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    std::vector<std::shared_ptr<arrow::Array>> keys;
+    int64_t row{ 0 };
+  };
+
+  // pull the whole input and consume it.
+  absl::Status consumeInput();
+
+  // sort the buffered record batches into a single record batch.
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> sortBatches(
+      std::shared_ptr<arrow::Schema> schema,
+      const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches);
+
+  // sort the buffered record batches and spill them as a new run.
+  absl::Status spillRun(
+      std::shared_ptr<arrow::Schema> schema,
+      const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches);
+
+  // move the run to its next row, loading its next batch if needed.
+  absl::Status advanceRun(Run& run);
+
+  // check if the current row of the run a should be emitted before the one of the run b.
+  bool runLess(int a, int b);
+
+  // merge the next output batch out of the runs.
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> mergeRuns();
+
+  std::shared_ptr<PhysicalPlan> input_;
+  std::vector<SortKey> sort_keys_;
+  int64_t memory_limit_;
+  std::string spill_directory_;
+
+  // the input batches not yet sorted into a run.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> buffered_;
+  int64_t buffered_bytes_{ 0 };
+
+  bool sorted_input_{ false };
+  std::shared_ptr<arrow::RecordBatch> sorted_;
+  int64_t offset_{ 0 };
+
+  std::vector<std::string> run_paths_;
+  std::vector<Run> runs_;
+  std::unique_ptr<LoserTree> merge_tree_;
+
+  SpillMetrics metrics_;
+
+  DISALLOW_COPY_AND_ASSIGN(Sort);
+};
+
+/**
+ * @brief The top-k execution, for ORDER BY followed by LIMIT.
+ *
+ * Only the best k rows seen so far are kept: the incoming rows which don't sort strictly before the current k-th row are
+ * dropped, the others are buffered and the buffer is cut back to the best k rows once it reaches twice that size. Each
+ * time the k-th row changes, its value of the first sort key is published as a one-sided range filter, which the
+ * operators below (Selection, Scan) can use to drop the rows that cannot make it into the result.
+ */
+class TopK : public PhysicalPlan {
+ public:
+  TopK(std::shared_ptr<PhysicalPlan> input, std::vector<SortKey> sort_keys, int64_t k);
+  ~TopK() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+  /**
+   * @brief Get the dynamic filter on the first sort key, holding the current k-th value.
+   */
+  std::shared_ptr<RuntimeFilter> Filter() { return filter_; }
+
+ private:
+  // consume the whole input, keeping the best k rows.
+  absl::Status consumeInput();
+
+  // sort the buffer, cut it back to the best k rows and publish the new k-th value.
+  absl::Status compact(std::shared_ptr<arrow::Schema> schema);
+
+  // drop the rows of the batch which don't sort strictly before the current k-th row.
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> filterBatch(std::shared_ptr<arrow::RecordBatch> batch);
+
+  std::shared_ptr<PhysicalPlan> input_;
+  std::vector<SortKey> sort_keys_;
+  int64_t k_;
+  std::shared_ptr<RuntimeFilter> filter_;
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> buffer_;
+  int64_t buffered_rows_{ 0 };
+  // the sort keys of the current k-th row, empty until k rows have been seen.
+  std::vector<std::shared_ptr<arrow::Array>> threshold_keys_;
+
+  bool consumed_input_{ false };
+  std::shared_ptr<arrow::RecordBatch> result_;
+  int64_t offset_{ 0 };
+
+  DISALLOW_COPY_AND_ASSIGN(TopK);
+};
+
+/**
+ * @brief The limit execution, for LIMIT and OFFSET.
+ *
+ * Skips the first offset rows of the input and returns at most limit rows after them. The input is cancelled as soon as
+ * the limit is reached so that the operators below, down to the scans, stop producing rows that would be thrown away.
+ */
+class Limit : public PhysicalPlan {
+ public:
+  Limit(std::shared_ptr<PhysicalPlan> input, int64_t limit, int64_t offset);
+  ~Limit() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  std::shared_ptr<PhysicalPlan> input_;
+  int64_t limit_;
+  int64_t offset_;
+
+  int64_t skipped_{ 0 };
+  int64_t returned_{ 0 };
+
+  DISALLOW_COPY_AND_ASSIGN(Limit);
+};
+
+/**
+ * @brief The distinct execution, for SELECT DISTINCT.
+ *
+ * Streams the input and only returns the first occurrence of each row, in input order. The rows seen so far are kept in
+ * a roaring bitmap when the input is a single integer column and in a hash set otherwise.
+ */
+class Distinct : public PhysicalPlan {
+ public:
+  Distinct(std::shared_ptr<PhysicalPlan> input);
+  ~Distinct() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  // mark the rows of the batch which haven't been seen before, and remember them.
+  absl::StatusOr<std::shared_ptr<arrow::BooleanArray>> firstOccurrences(std::shared_ptr<arrow::RecordBatch> batch);
+
+  std::shared_ptr<PhysicalPlan> input_;
+
+  RoaringBitmap seen_integers_;
+  std::unordered_set<toyquery::Key> seen_rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(Distinct);
+};
+
+/**
+ * @brief The window execution, evaluating window functions over the partitions of the input.
+ *
+ * The input is consumed on the first call to Next and sorted on the partition keys followed by the order keys. The value
+ * of each function is then computed for every row with a single pass over each partition, see EvaluateWindowFunction,
+ * and appended to the input columns.
+ */
+class Window : public PhysicalPlan {
+ public:
+  Window(
+      std::shared_ptr<PhysicalPlan> input,
+      std::shared_ptr<arrow::Schema> schema,
+      std::vector<std::shared_ptr<PhysicalExpression>> partition_by,
+      std::vector<SortKey> order_by,
+      std::vector<WindowFunction> functions);
+  ~Window() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  // consume and sort the input, then evaluate the window functions on it.
+  absl::Status evaluateInput();
+
+  std::shared_ptr<PhysicalPlan> input_;
+  std::shared_ptr<arrow::Schema> schema_;
+  std::vector<std::shared_ptr<PhysicalExpression>> partition_by_;
+  std::vector<SortKey> order_by_;
+  std::vector<WindowFunction> functions_;
+
+  bool evaluated_input_{ false };
+  std::shared_ptr<arrow::RecordBatch> result_;
+  int64_t offset_{ 0 };
+
+  DISALLOW_COPY_AND_ASSIGN(Window);
+};
+
+/**
+ * @brief The prefetch execution, pulling its input on a background thread.
+ *
+ * The input is pulled ahead of the consumer into a bounded queue of at most depth batches, so that the reading and
+ * parsing done below overlap with the work done above. The background thread waits while the queue is full. An error
+ * of the input is returned once the batches queued before it have been consumed.
+ */
+class Prefetch : public PhysicalPlan {
+ public:
+  Prefetch(std::shared_ptr<PhysicalPlan> input, int depth);
+  ~Prefetch() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::Cancel
+   */
+  void Cancel() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  // the loop run by the background thread, pulling the input into the queue.
+  void prefetch();
+
+  // stop the background thread and wait for it.
+  void stop();
+
+  std::shared_ptr<PhysicalPlan> input_;
+  int depth_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<std::shared_ptr<arrow::RecordBatch>> ready_;
+  absl::Status status_;
+  bool started_{ false };
+  bool done_{ false };
+  bool cancelled_{ false };
+
+  DISALLOW_COPY_AND_ASSIGN(Prefetch);
+};
+
+/**
+ * @brief A source of morsels shared by the instances of a pipeline running in parallel.
+ *
+ * The batches of the source plan are coalesced into morsels of MORSEL_SIZE rows, only the last one can be smaller, and
+ * handed out to whichever pipeline instance asks for its next input first. The source itself is only pulled by a single
+ * instance at a time, the other ones keep taking the morsels already queued meanwhile.
+ */
+class MorselQueue {
+ public:
+  MorselQueue(std::shared_ptr<PhysicalPlan> source);
+
+  /**
+   * @brief Get the schema of the morsels.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema();
+
+  /**
+   * @brief Prepare the source plan, only once however many pipeline instances share the queue.
+   */
+  absl::Status Prepare();
+
+  /**
+   * @brief Get the next morsel, nullptr once the source is exhausted.
+   *
+   * @param pool: the memory pool the batches of the source are coalesced with
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next(arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+  /**
+   * @brief Cancel the source plan, no more morsels are handed out.
+   */
+  void Cancel();
+
+  /**
+   * @brief Attach the cancellation token of the query to the source plan.
+   */
+  void SetCancellationToken(std::shared_ptr<CancellationToken> token);
+
+  /**
+   * @brief Attach the memory pool of the query to the source plan, only once however many pipeline instances share the
+   * queue.
+   */
+  void SetMemoryPool(std::shared_ptr<TrackingMemoryPool> query_pool);
+
+ private:
+  // pull the source until it has a whole morsel or is exhausted, then queue the morsels. Called with source_mutex_ held.
+  absl::Status fetch(arrow::MemoryPool* pool);
+
+  // held while pulling the source.
+  std::mutex source_mutex_;
+  std::shared_ptr<PhysicalPlan> source_;
+  bool prepared_{ false };
+  bool has_memory_pool_{ false };
+  // the rows pulled past the last whole morsel, they start the next one.
+  std::shared_ptr<arrow::RecordBatch> rest_;
+
+  // held while taking a morsel.
+  std::mutex mutex_;
+  std::deque<std::shared_ptr<arrow::RecordBatch>> morsels_;
+  bool exhausted_{ false };
+
+  DISALLOW_COPY_AND_ASSIGN(MorselQueue);
+};
+
+/**
+ * @brief The leaf of a pipeline instance, reading its input from the morsels shared with the other instances.
+ */
+class MorselScan : public PhysicalPlan {
+ public:
+  MorselScan(std::shared_ptr<MorselQueue> morsels);
+  ~MorselScan() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::Cancel
+   */
+  void Cancel() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+  /**
+   * @copydoc PhysicalPlan::SetCancellationToken
+   *
+   * The token is attached to the source of the morsels as well.
+   */
+  void SetCancellationToken(std::shared_ptr<CancellationToken> token) override;
+
+  /**
+   * @copydoc PhysicalPlan::SetMemoryPool
+   *
+   * The pool is attached to the source of the morsels as well.
+   */
+  void SetMemoryPool(std::shared_ptr<TrackingMemoryPool> query_pool) override;
+
+ private:
+  std::shared_ptr<MorselQueue> morsels_;
+
+  DISALLOW_COPY_AND_ASSIGN(MorselScan);
+};
+
+/**
+ * @brief The gather execution, running instances of a pipeline in parallel and merging their output.
+ *
+ * Each pipeline instance (e.g. MorselScan -> Selection -> Projection -> partial HashAggregation) pulls its morsels from
+ * a shared MorselQueue. Pulling one batch out of an instance is a task of the thread pool which, once done, reschedules
+ * itself on the same thread so that the instance keeps its locality, idle threads stealing the tasks left behind.
+ *
+ * The output batches are buffered in a bounded queue, in no particular order. An instance whose output doesn't fit in
+ * the queue is parked until the consumer catches up.
+ */
+class Gather : public PhysicalPlan {
+ public:
+  Gather(std::vector<std::shared_ptr<PhysicalPlan>> pipelines, std::shared_ptr<ThreadPool> thread_pool);
+  ~Gather() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::Cancel
+   */
+  void Cancel() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+ private:
+  // The state shared with the tasks of the thread pool, which can outlive the gather.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::shared_ptr<arrow::RecordBatch>> ready;
+    size_t max_ready{ 0 };
+    // the pipeline instances waiting for room in the ready queue.
+    std::vector<std::shared_ptr<PhysicalPlan>> parked;
+    // the instances not yet exhausted and the tasks not yet completed.
+    int active{ 0 };
+    int running{ 0 };
+    absl::Status status;
+    bool cancelled{ false };
+  };
+
+  // schedule a task pulling the next batch of the pipeline instance, the state lock must be held.
+  static void schedule(std::shared_ptr<State> state, ThreadPool* thread_pool, std::shared_ptr<PhysicalPlan> pipeline);
+
+  std::vector<std::shared_ptr<PhysicalPlan>> pipelines_;
+  std::shared_ptr<ThreadPool> thread_pool_;
+  std::shared_ptr<State> state_;
+  bool started_{ false };
+
+  DISALLOW_COPY_AND_ASSIGN(Gather);
+};
+
 }  // namespace physicalplan
 }  // namespace toyquery
 
@@ -0,0 +1,130 @@
+#ifndef PHYSICALPLAN_PIPELINE_H
+#define PHYSICALPLAN_PIPELINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "arrow/api.h"
+#include "common/macros.h"
+#include "physicalplan/physicalplan.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+/**
+ * @brief A push-based pipeline.
+ *
+ * The batches pulled from the source are pushed through the chain of streaming operators, fused into a single loop, and
+ * then into the sink. The source is either a leaf of the plan, an operator which isn't part of any pipeline (e.g. a
+ * join) or a pipeline breaker whose own input pipelines are done. The last pipeline of a plan has no sink, its output
+ * is pulled instead.
+ */
+class Pipeline {
+ public:
+  Pipeline(
+      std::shared_ptr<PhysicalPlan> source,
+      std::vector<std::shared_ptr<StreamingOperator>> operators,
+      std::shared_ptr<PipelineBreaker> sink);
+
+  /**
+   * @brief Push the whole source through the operators into the sink, then finish the sink.
+   */
+  absl::Status Run();
+
+  /**
+   * @brief Push the batches of the source through the operators until one of them comes out, for the pipeline without
+   * a sink.
+   *
+   * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>: the next output batch, nullptr when the stream ends.
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next();
+
+  /**
+   * @brief Get the source of the pipeline.
+   */
+  std::shared_ptr<PhysicalPlan> Source() { return source_; }
+
+  /**
+   * @brief Get the number of operators fused into the pipeline.
+   */
+  int NumOperators() const { return operators_.size(); }
+
+  /**
+   * @brief Get the sink of the pipeline, nullptr for the last pipeline of a plan.
+   */
+  std::shared_ptr<PipelineBreaker> Sink() { return sink_; }
+
+ private:
+  std::shared_ptr<PhysicalPlan> source_;
+  // the operators, in the order the batches are pushed through them.
+  std::vector<std::shared_ptr<StreamingOperator>> operators_;
+  std::shared_ptr<PipelineBreaker> sink_;
+
+  DISALLOW_COPY_AND_ASSIGN(Pipeline);
+};
+
+/**
+ * @brief Split the plan into pipelines at its pipeline breakers (HashAggregation, Sort).
+ *
+ * @param plan: the physical plan
+ * @return absl::StatusOr<std::vector<std::shared_ptr<Pipeline>>>: the pipelines in the order they have to run, the
+ * last one producing the output of the plan.
+ */
+absl::StatusOr<std::vector<std::shared_ptr<Pipeline>>> BuildPipelines(std::shared_ptr<PhysicalPlan> plan);
+
+/**
+ * @brief The push-based execution of a plan, adapted to the pull API.
+ *
+ * On the first call to Next, the pipelines feeding the pipeline breakers are run to completion in order. The output of
+ * the plan is then pulled out of the last pipeline.
+ */
+class PipelineExecution : public PhysicalPlan {
+ public:
+  PipelineExecution(std::shared_ptr<PhysicalPlan> plan);
+  ~PipelineExecution() override;
+
+  /**
+   * @copydoc PhysicalPlan::Schema
+   */
+  absl::StatusOr<std::shared_ptr<arrow::Schema>> Schema() override;
+
+  /**
+   * @copydoc PhysicalPlan::Children
+   */
+  std::vector<std::shared_ptr<PhysicalPlan>> Children() override;
+
+  /**
+   * @copydoc PhysicalPlan::Prepare
+   */
+  absl::Status Prepare() override;
+
+  /**
+   * @copydoc PhysicalPlan::Next
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+  /**
+   * @copydoc PhysicalPlan::ToString
+   */
+  std::string ToString() override;
+
+  /**
+   * @brief Get the pipelines of the plan, empty until the plan is prepared.
+   */
+  const std::vector<std::shared_ptr<Pipeline>>& Pipelines() const { return pipelines_; }
+
+ private:
+  std::shared_ptr<PhysicalPlan> plan_;
+  std::vector<std::shared_ptr<Pipeline>> pipelines_;
+  bool ran_breakers_{ false };
+
+  DISALLOW_COPY_AND_ASSIGN(PipelineExecution);
+};
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_PIPELINE_H
@@ -0,0 +1,196 @@
+#ifndef PHYSICALPLAN_RUNTIMEFILTER_H
+#define PHYSICALPLAN_RUNTIMEFILTER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "arrow/api.h"
+#include "common/macros.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+/**
+ * @brief A fixed size bloom filter over 64 bit hashes.
+ *
+ * The k probe positions are derived from a single hash using double hashing.
+ */
+class BloomFilter {
+ public:
+  /**
+   * @brief Construct a new Bloom Filter object sized for the expected number of items.
+   *
+   * @param expected_items: the number of items expected to be inserted
+   * @param false_positive_rate: the targeted false positive rate, in (0, 1)
+   */
+  BloomFilter(int64_t expected_items, double false_positive_rate);
+
+  /**
+   * @brief Insert the hash into the filter.
+   */
+  void Insert(uint64_t hash);
+
+  /**
+   * @brief Check if the hash might have been inserted.
+   *
+   * @return bool: false if the hash was definitely not inserted, true otherwise
+   */
+  bool MightContain(uint64_t hash) const;
+
+  /**
+   * @brief Get the memory used by the bit set.
+   */
+  int64_t SizeInBytes() const;
+
+ private:
+  uint64_t num_bits_;
+  int num_hashes_;
+  std::vector<uint64_t> bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(BloomFilter);
+};
+
+/**
+ * @brief Hash the value at the given row of the array.
+ *
+ * The hash only depends on the logical value so that equal values in different arrays produce the same hash.
+ *
+ * @param array: the array containing the value
+ * @param row: the row index of the value
+ * @return uint64_t: the hash of the value
+ */
+uint64_t HashArrayValue(const arrow::Array& array, int64_t row);
+
+/**
+ * @brief A dynamic filter published by the build side of a join and consumed by the probe side.
+ *
+ * Once the build side of a hash join has been consumed, it publishes the min/max range and a bloom filter of its join key.
+ * Operators on the probe side (Scan, Selection) use it to drop batches whose key range doesn't overlap the build side and
+ * rows whose key definitely isn't present in the build side, before they ever reach the join.
+ *
+ * A top-k publishes a one-sided range holding its current k-th value instead, see PublishRange.
+ *
+ * A filter which hasn't been published yet lets everything pass. It can be published while other threads evaluate it,
+ * e.g. a scan prefetched on its own thread, the rows read before the publication simply aren't filtered.
+ */
+class RuntimeFilter {
+ public:
+  RuntimeFilter(std::string name);
+
+  /**
+   * @brief Publish the filter using all the key values of the build side.
+   *
+   * @param build_keys: the key column of the build side, one array per build batch
+   * @return absl::Status: the status of the operation
+   */
+  absl::Status Publish(const std::vector<std::shared_ptr<arrow::Array>>& build_keys);
+
+  /**
+   * @brief Publish a range that the values should fall in, without a bloom filter.
+   *
+   * Unlike Publish, it can be called again to tighten the range as the producer makes progress, e.g. a top-k publishing
+   * its current k-th value.
+   *
+   * @param bounds: the [lower, upper] bounds of the range, a null bound leaves that side unbounded
+   * @param keep_nulls: whether the null values pass the filter
+   * @return absl::Status: the status of the operation
+   */
+  absl::Status PublishRange(std::shared_ptr<arrow::Array> bounds, bool keep_nulls);
+
+  /**
+   * @brief Check if the filter has been published.
+   */
+  bool IsReady() const;
+
+  /**
+   * @brief Check if any value of the probe column might find a match on the build side.
+   *
+   * Only compares the min/max of the column, computed once, with the range of the build side and is meant to skip whole
+   * batches cheaply.
+   *
+   * @param column: the probe side key column
+   * @return absl::StatusOr<bool>: false if no row of the column can match
+   */
+  absl::StatusOr<bool> MightMatch(const std::shared_ptr<arrow::Array>& column);
+
+  /**
+   * @brief Evaluate the filter on each row of the probe column.
+   *
+   * @param column: the probe side key column
+   * @return absl::StatusOr<std::shared_ptr<arrow::BooleanArray>>: true for the rows that might find a match
+   */
+  absl::StatusOr<std::shared_ptr<arrow::BooleanArray>> Evaluate(const std::shared_ptr<arrow::Array>& column);
+
+  /**
+   * @brief Get the number of probe rows dropped by this filter.
+   */
+  int64_t RowsFiltered() const { return rows_filtered_.load(); }
+
+  /**
+   * @brief Get the number of probe batches skipped entirely by this filter.
+   */
+  int64_t BatchesSkipped() const { return batches_skipped_.load(); }
+
+  /**
+   * @brief Get string representation to print for debugging.
+   *
+   * @return std::string: the string representation of the filter.
+   */
+  std::string ToString();
+
+ private:
+  // A publication of the filter, replaced as a whole so that the threads evaluating the filter see a consistent one.
+  struct Published {
+    bool empty{ true };
+    bool keep_nulls{ false };
+
+    // [min, max] of the build side keys, null if unknown. A null bound leaves that side unbounded.
+    std::shared_ptr<arrow::Array> bounds;
+    std::shared_ptr<BloomFilter> bloom_filter;
+  };
+
+  // get the current publication, nullptr if the filter hasn't been published yet.
+  std::shared_ptr<const Published> published() const;
+
+  // check if the value at row is within the [min, max] range of the build side.
+  static bool inRange(const Published& published, const arrow::Array& column, int64_t row);
+
+  // check if the [min, max] range of the non null values of the column overlaps the range of the build side.
+  static absl::StatusOr<bool> overlapsRange(const Published& published, const std::shared_ptr<arrow::Array>& column);
+
+  std::string name_;
+
+  mutable std::mutex mutex_;
+  std::shared_ptr<const Published> published_;
+
+  std::atomic<int64_t> rows_filtered_{ 0 };
+  std::atomic<int64_t> batches_skipped_{ 0 };
+
+  DISALLOW_COPY_AND_ASSIGN(RuntimeFilter);
+};
+
+/**
+ * @brief A runtime filter attached to a column of an operator's output.
+ */
+using RuntimeFilterTarget = std::pair<int, std::shared_ptr<RuntimeFilter>>;
+
+/**
+ * @brief Apply the attached runtime filters on the record batch.
+ *
+ * @param batch: the record batch to filter
+ * @param filters: the runtime filters along with the index of the column they apply on
+ * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>: the filtered batch, nullptr if no row can match.
+ */
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> ApplyRuntimeFilters(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    const std::vector<RuntimeFilterTarget>& filters);
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_RUNTIMEFILTER_H
\ No newline at end of file
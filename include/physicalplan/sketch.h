@@ -0,0 +1,132 @@
+#ifndef PHYSICALPLAN_SKETCH_H
+#define PHYSICALPLAN_SKETCH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "arrow/api.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+/**
+ * @brief Hash the value of the scalar.
+ *
+ * The hash only depends on the logical value and its bits are spread over the whole 64 bit word, as the sketches expect.
+ *
+ * @param value: the non null scalar to hash
+ * @return uint64_t: the hash of the value
+ */
+uint64_t HashScalarValue(const arrow::Scalar& value);
+
+/**
+ * @brief A HyperLogLog sketch estimating the number of distinct values of a set.
+ *
+ * The hashes are spread over 2^precision registers on their first bits, each register keeps the longest run of leading
+ * zeros seen on the remaining bits. The memory is fixed at one byte per register and the relative standard error is
+ * about 1.04 / sqrt(2^precision), i.e. 4KB and 1.6% with the default precision.
+ */
+class HyperLogLog {
+ public:
+  /**
+   * @brief Construct a new HyperLogLog sketch.
+   *
+   * @param precision: the number of bits of the hash selecting the register, in [4, 16]
+   */
+  HyperLogLog(int precision = 12);
+
+  /**
+   * @brief Add the hash of a value to the sketch.
+   */
+  void Add(uint64_t hash);
+
+  /**
+   * @brief Add the values seen by the other sketch, which must have the same precision.
+   *
+   * @return bool: false if the precisions differ and the sketch was left untouched
+   */
+  bool Merge(const HyperLogLog& other);
+
+  /**
+   * @brief Estimate the number of distinct values added to the sketch.
+   */
+  int64_t Estimate() const;
+
+  /**
+   * @brief Get the memory used by the registers.
+   */
+  int64_t SizeInBytes() const { return registers_.size(); }
+
+ private:
+  int precision_;
+  std::vector<uint8_t> registers_;
+};
+
+/**
+ * @brief A merging t-digest sketch estimating the quantiles of a set of values.
+ *
+ * The values are summarized by at most about compression centroids (mean, weight). The centroids are small close to the
+ * tails and large around the median, which keeps the extreme percentiles accurate. The incoming values are buffered and
+ * merged into the centroids when the buffer is full, so the memory stays bounded by the compression.
+ */
+class TDigest {
+ public:
+  /**
+   * @brief Construct a new TDigest sketch.
+   *
+   * @param compression: bounds the number of centroids, higher is more accurate
+   */
+  TDigest(double compression = 100);
+
+  /**
+   * @brief Add the value to the sketch.
+   */
+  void Add(double value);
+
+  /**
+   * @brief Add the values summarized by the other sketch.
+   */
+  void Merge(const TDigest& other);
+
+  /**
+   * @brief Estimate the value at the given quantile.
+   *
+   * @param quantile: the quantile, in [0, 1]
+   * @return double: the estimated value, NaN if the sketch is empty
+   */
+  double Quantile(double quantile);
+
+  /**
+   * @brief Get the total weight of the values added to the sketch.
+   */
+  double Count() const { return total_weight_ + buffered_weight_; }
+
+  /**
+   * @brief Get the number of centroids, once the buffered values have been merged.
+   */
+  int64_t NumCentroids();
+
+ private:
+  struct Centroid {
+    double mean_;
+    double weight_;
+  };
+
+  // merge the buffered centroids into the digest.
+  void compress();
+
+  double compression_;
+  std::vector<Centroid> centroids_;
+  double total_weight_{ 0 };
+
+  std::vector<Centroid> buffer_;
+  double buffered_weight_{ 0 };
+
+  double min_;
+  double max_;
+};
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_SKETCH_H
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef PHYSICALPLAN_SORT_H
+#define PHYSICALPLAN_SORT_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "arrow/api.h"
+#include "common/macros.h"
+#include "physicalplan/physicalexpression.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+/**
+ * @brief An expression to sort on, along with the direction and the placement of the nulls.
+ */
+struct SortKey {
+  std::shared_ptr<PhysicalExpression> expr;
+  bool ascending{ true };
+  bool nulls_first{ false };
+};
+
+/**
+ * @brief Evaluate the sort key expressions on the record batch.
+ *
+ * @param batch: the record batch to evaluate the keys on
+ * @param sort_keys: the sort keys
+ * @param pool: the memory pool the computed key columns are allocated from
+ * @return absl::StatusOr<std::vector<std::shared_ptr<arrow::Array>>>: one key column per sort key
+ */
+absl::StatusOr<std::vector<std::shared_ptr<arrow::Array>>> EvaluateSortKeys(
+    const std::shared_ptr<arrow::RecordBatch>& batch,
+    const std::vector<SortKey>& sort_keys,
+    arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+/**
+ * @brief Compare two rows on the sort keys.
+ *
+ * @param left_keys: the key columns of the left row, as returned by EvaluateSortKeys
+ * @param left_row: the index of the left row
+ * @param right_keys: the key columns of the right row, as returned by EvaluateSortKeys
+ * @param right_row: the index of the right row
+ * @param sort_keys: the sort keys
+ * @return int: negative if the left row sorts first, positive if the right row sorts first, zero if they are equal
+ */
+int CompareSortKeys(
+    const std::vector<std::shared_ptr<arrow::Array>>& left_keys,
+    int64_t left_row,
+    const std::vector<std::shared_ptr<arrow::Array>>& right_keys,
+    int64_t right_row,
+    const std::vector<SortKey>& sort_keys);
+
+/**
+ * @brief Compute the permutation of the rows which sorts them on the sort keys.
+ *
+ * When all the keys are fixed width (bool, int64, double), the rows are sorted with a stable LSD radix sort over an order
+ * preserving 64 bit encoding of each key, starting from the last key. Otherwise, a comparison sort is used.
+ *
+ * @param keys: the key columns, as returned by EvaluateSortKeys
+ * @param sort_keys: the sort keys
+ * @return std::vector<int64_t>: the indices of the rows in sorted order
+ */
+std::vector<int64_t> SortIndices(
+    const std::vector<std::shared_ptr<arrow::Array>>& keys,
+    const std::vector<SortKey>& sort_keys);
+
+/**
+ * @brief A tournament tree of losers used to merge k sorted sources.
+ *
+ * Each internal node keeps the loser of the match played between its two subtrees, so that once the head of the winning
+ * source changes, the new winner is found by replaying the matches on the path from its leaf to the root only, i.e.
+ * log2(k) comparisons.
+ */
+class LoserTree {
+ public:
+  /**
+   * @brief Construct a new Loser Tree object over the current heads of the sources.
+   *
+   * @param num_sources: the number of sources to merge, at least 1
+   * @param less: returns true if the head of the first source should be emitted before the one of the second source
+   */
+  LoserTree(int num_sources, std::function<bool(int, int)> less);
+
+  /**
+   * @brief Get the index of the source whose head should be emitted next.
+   */
+  int Winner() const { return nodes_[0]; }
+
+  /**
+   * @brief Replay the matches of the winner once its head has changed.
+   */
+  void Update();
+
+ private:
+  int num_sources_;
+  std::function<bool(int, int)> less_;
+  // nodes_[0] is the overall winner, nodes_[1..k-1] the losers of the internal nodes.
+  std::vector<int> nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoserTree);
+};
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_SORT_H
\ No newline at end of file
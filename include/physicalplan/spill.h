@@ -0,0 +1,135 @@
+#ifndef PHYSICALPLAN_SPILL_H
+#define PHYSICALPLAN_SPILL_H
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "arrow/api.h"
+#include "arrow/io/api.h"
+#include "arrow/ipc/api.h"
+#include "arrow/util/compression.h"
+#include "common/macros.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+/**
+ * @brief Get a new unique path for a spill file in the given directory.
+ *
+ * @param directory: the directory of the spill file, the system temporary directory if empty
+ * @param prefix: the prefix of the file name, used to identify the operator which spilled
+ * @return std::string: the path of the spill file
+ */
+std::string MakeSpillPath(const std::string& directory, const std::string& prefix);
+
+/**
+ * @brief Writes the record batches spilled by an operator to a local Arrow IPC file.
+ */
+class SpillFileWriter {
+ public:
+  /**
+   * @brief Create the spill file at the given path.
+   *
+   * The record batch buffers are compressed with the given codec, or written uncompressed if the codec isn't available in
+   * the Arrow build.
+   *
+   * @param path: the path of the spill file
+   * @param schema: the schema of the spilled record batches
+   * @param compression: the compression codec of the record batch buffers
+   * @return absl::StatusOr<std::unique_ptr<SpillFileWriter>>: the writer
+   */
+  static absl::StatusOr<std::unique_ptr<SpillFileWriter>> Open(
+      std::string path,
+      std::shared_ptr<arrow::Schema> schema,
+      arrow::Compression::type compression = arrow::Compression::UNCOMPRESSED);
+
+  ~SpillFileWriter();
+
+  /**
+   * @brief Append the record batch to the spill file.
+   */
+  absl::Status Write(std::shared_ptr<arrow::RecordBatch> batch);
+
+  /**
+   * @brief Finish the spill file, it can be read once closed.
+   */
+  absl::Status Close();
+
+  /**
+   * @brief Get the path of the spill file.
+   */
+  const std::string& Path() const { return path_; }
+
+  /**
+   * @brief Get the number of rows written.
+   */
+  int64_t NumRows() const { return num_rows_; }
+
+  /**
+   * @brief Get the in-memory size of the record batches written.
+   */
+  int64_t NumBytes() const { return num_bytes_; }
+
+ private:
+  SpillFileWriter(
+      std::string path,
+      std::shared_ptr<arrow::io::OutputStream> sink,
+      std::shared_ptr<arrow::ipc::RecordBatchWriter> writer);
+
+  std::string path_;
+  std::shared_ptr<arrow::io::OutputStream> sink_;
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer_;
+  bool closed_{ false };
+  int64_t num_rows_{ 0 };
+  int64_t num_bytes_{ 0 };
+
+  DISALLOW_COPY_AND_ASSIGN(SpillFileWriter);
+};
+
+/**
+ * @brief Reads back the record batches of a spill file, one at a time. The file is deleted once the reader is destroyed.
+ */
+class SpillFileReader {
+ public:
+  /**
+   * @brief Open the spill file at the given path.
+   *
+   * @param path: the path of a closed spill file
+   * @return absl::StatusOr<std::unique_ptr<SpillFileReader>>: the reader
+   */
+  static absl::StatusOr<std::unique_ptr<SpillFileReader>> Open(std::string path);
+
+  ~SpillFileReader();
+
+  /**
+   * @brief Get the schema of the spilled record batches.
+   */
+  std::shared_ptr<arrow::Schema> Schema() const { return reader_->schema(); }
+
+  /**
+   * @brief Get the next record batch of the spill file.
+   *
+   * @return absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>: the next record batch, nullptr once the file ends
+   */
+  absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next();
+
+ private:
+  SpillFileReader(
+      std::string path,
+      std::shared_ptr<arrow::io::RandomAccessFile> file,
+      std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader);
+
+  std::string path_;
+  std::shared_ptr<arrow::io::RandomAccessFile> file_;
+  std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader_;
+  int next_batch_{ 0 };
+
+  DISALLOW_COPY_AND_ASSIGN(SpillFileReader);
+};
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_SPILL_H
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef PHYSICALPLAN_WINDOW_H
+#define PHYSICALPLAN_WINDOW_H
+
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "arrow/api.h"
+#include "logicalplan/logicalplan.h"
+#include "physicalplan/physicalexpression.h"
+#include "physicalplan/sort.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+using ::toyquery::logicalplan::WindowFrame;
+using ::toyquery::logicalplan::WindowFrameUnits;
+using ::toyquery::logicalplan::WindowFunctionType;
+
+/**
+ * @brief A function evaluated over a window.
+ */
+struct WindowFunction {
+  WindowFunctionType type;
+  // the input of the aggregate functions, null for the ranking functions.
+  std::shared_ptr<PhysicalExpression> input;
+  WindowFrame frame;
+};
+
+/**
+ * @brief Evaluate a window function on every row of the record batch.
+ *
+ * The frame of each row is computed within its partition. Both ends of the frame only move forward from one row to the
+ * next, so the aggregates are maintained incrementally as the frame slides: the values entering and leaving the frame
+ * are added to and subtracted from running sums, and the candidates for the min/max are kept in a monotonic deque.
+ * Evaluating a partition is linear in its size whatever the size of the frames.
+ *
+ * @param function: the window function
+ * @param batch: the rows, sorted on the partition keys and then on the order keys
+ * @param partitions: the index of the first row of each partition, followed by the number of rows
+ * @param order_keys: the order key columns, as returned by EvaluateSortKeys
+ * @param order_by: the order keys
+ * @param pool: the memory pool the values of the function are allocated from
+ * @return absl::StatusOr<std::shared_ptr<arrow::Array>>: the value of the function for each row
+ */
+absl::StatusOr<std::shared_ptr<arrow::Array>> EvaluateWindowFunction(
+    const WindowFunction& function,
+    const std::shared_ptr<arrow::RecordBatch>& batch,
+    const std::vector<int64_t>& partitions,
+    const std::vector<std::shared_ptr<arrow::Array>>& order_keys,
+    const std::vector<SortKey>& order_by,
+    arrow::MemoryPool* pool = arrow::default_memory_pool());
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+#endif  // PHYSICALPLAN_WINDOW_H
\ No newline at end of file
@@ -1,11 +1,14 @@
 #ifndef PLANNER_PLANNER_H
 #define PLANNER_PLANNER_H
 
+#include <limits>
 #include <memory>
+#include <string>
 
 #include "absl/status/statusor.h"
 #include "logicalplan/logicalplan.h"
 #include "physicalplan/physicalplan.h"
+#include "physicalplan/pipeline.h"
 
 namespace toyquery {
 namespace planner {
@@ -16,6 +19,36 @@ namespace planner {
  */
 class QueryPlanner {
  public:
+  QueryPlanner() = default;
+
+  /**
+   * @brief Construct a new Query Planner object whose blocking operators spill to disk over the memory limit.
+   *
+   * @param memory_limit: the memory that the blocking operators (e.g. Sort) can use before spilling to disk, the joins
+   * are planned as grace hash joins below the maximum
+   * @param spill_directory: the directory of the spill files, the system temporary directory if empty
+   */
+  QueryPlanner(int64_t memory_limit, std::string spill_directory)
+      : memory_limit_{ memory_limit },
+        spill_directory_{ std::move(spill_directory) } { }
+
+  /**
+   * @brief Set the number of threads running the pipelines of the plan.
+   *
+   * Above one, the pipelines from a scan up to a partial aggregation are planned as that many instances sharing the
+   * morsels of the scan, run on a thread pool created for the query.
+   *
+   * @param parallelism: the degree of parallelism of the plan
+   */
+  void SetParallelism(int parallelism) { parallelism_ = parallelism; }
+
+  /**
+   * @brief Set the number of batches prefetched on a background thread above each scan of the plan.
+   *
+   * @param prefetch_depth: the number of batches read ahead of the consumer, 2 by default, no prefetching if zero
+   */
+  void SetPrefetchDepth(int prefetch_depth) { prefetch_depth_ = prefetch_depth; }
+
   /**
    * @brief Create a Physical Plan from the given Logical plan
    *
@@ -26,6 +59,19 @@ class QueryPlanner {
   absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> CreatePhysicalPlan(
       std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan);
 
+  /**
+   * @brief Create a Physical Plan from the given Logical plan, executed as push-based pipelines
+   *
+   * The plan is split into pipelines at its breakers (aggregations and sorts), each pushing the batches of its source
+   * through its fused streaming operators into its sink. The pipelines are pulled through the returned adapter.
+   *
+   * @param logical_plan: the given logical plan
+   * @return absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>>: the generated physical plan or error
+   * status
+   */
+  absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> CreatePipelinedPlan(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan);
+
   /**
    * @brief Create a Physical Expression from the given Logical expression
    *
@@ -39,9 +85,59 @@ class QueryPlanner {
       std::shared_ptr<toyquery::logicalplan::LogicalPlan> input_plan);
 
  private:
+  // create the physical sort keys of the logical sort.
+  absl::StatusOr<std::vector<toyquery::physicalplan::SortKey>> createSortKeys(
+      std::shared_ptr<toyquery::logicalplan::Sort> logical_sort);
+
+  // create the physical scan, prefetched if enabled.
+  std::shared_ptr<toyquery::physicalplan::PhysicalPlan> createScan(
+      std::shared_ptr<toyquery::logicalplan::Scan> logical_scan);
+
+  // check if the plan output is sorted on the left (or right) columns of the join condition, in order.
+  bool isSortedOn(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> plan,
+      const std::vector<std::pair<std::string, std::string>>& on,
+      bool left);
+
+  // attach the runtime filter on the given column of the plan output to the lowest operator able to apply it, returns
+  // false if there is none.
+  bool attachRuntimeFilter(
+      std::shared_ptr<toyquery::physicalplan::PhysicalPlan> plan,
+      int column_idx,
+      std::shared_ptr<toyquery::physicalplan::RuntimeFilter> filter);
+
   absl::StatusOr<std::shared_ptr<toyquery::physicalplan::AggregationExpression>> createAggregationExpression(
       std::shared_ptr<toyquery::logicalplan::AggregateExpression> logical_aggregation_expr,
       std::shared_ptr<toyquery::logicalplan::LogicalPlan> input_plan);
+
+  // check if the plan is a chain of scan, selections, projections and at most one aggregation which can be split into
+  // partial aggregations, so that it can run on morsels of the scan in parallel. below_aggregation is set for the input
+  // of the aggregation of the chain.
+  bool isMorselPipeline(std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan, bool below_aggregation = false);
+
+  // plan parallel instances of the pipeline up to its aggregation gathered together, followed by the final aggregation
+  // and the selections and projections above it, if any.
+  absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> createGather(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan);
+
+  // plan parallel instances of the chain of scan, selections, projections and aggregation ending at the root of the
+  // logical plan, followed by the final aggregation if the root is an aggregation.
+  absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> createParallelPipeline(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan);
+
+  // create the physical selection or projection of the logical plan on top of the given physical input.
+  absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> createStreamingOperator(
+      std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan,
+      std::shared_ptr<toyquery::physicalplan::PhysicalPlan> input);
+
+  int64_t memory_limit_{ std::numeric_limits<int64_t>::max() };
+  std::string spill_directory_;
+
+  int parallelism_{ 1 };
+  int prefetch_depth_{ 2 };
+  std::shared_ptr<ThreadPool> thread_pool_;
+  // the morsels read by the scan of the pipeline instance being planned, if any.
+  std::shared_ptr<toyquery::physicalplan::MorselQueue> morsels_;
 };
 
 }  // namespace planner
@@ -131,7 +131,7 @@ struct SqlDouble : public SqlExpression {
 };
 
 struct SqlFunction : public SqlExpression {
-  SqlFunction(absl::string_view id, std::vector<std::shared_ptr<SqlExpression>> args);
+  SqlFunction(absl::string_view id, std::vector<std::shared_ptr<SqlExpression>> args, bool distinct);
 
   /**
    * @copydoc SqlExpression::GetType
@@ -145,6 +145,8 @@ struct SqlFunction : public SqlExpression {
 
   absl::string_view id_;
   std::vector<std::shared_ptr<SqlExpression>> args_;
+  // whether the arguments are prefixed with DISTINCT, as in COUNT(DISTINCT x).
+  bool distinct_;
 };
 
 struct SqlAlias : public SqlExpression {
@@ -207,7 +209,10 @@ struct SqlSelect : public SqlRelation {
       std::vector<std::shared_ptr<SqlExpression>> group_by,
       std::vector<std::shared_ptr<SqlSort>> order_by,
       std::shared_ptr<SqlExpression> having,
-      absl::string_view table_name);
+      absl::string_view table_name,
+      int64_t limit,
+      int64_t offset,
+      bool distinct);
 
   /**
    * @copydoc SqlExpression::GetType
@@ -225,6 +230,12 @@ struct SqlSelect : public SqlRelation {
   std::vector<std::shared_ptr<SqlSort>> order_by_;
   std::shared_ptr<SqlExpression> having_;
   absl::string_view table_name_;
+  // the maximum number of rows of the result, -1 if unlimited.
+  int64_t limit_;
+  // the number of rows to skip before the result.
+  int64_t offset_;
+  // whether the duplicate rows are removed from the result, as in SELECT DISTINCT.
+  bool distinct_;
 };
 
 /**
@@ -263,13 +274,17 @@ static std::unordered_map<absl::string_view, SqlBinaryExpressionOperator> OPERAT
  *
  * Useful for switch cases.
  */
-enum class SqlFunctionType { Sum, Min, Max, Avg, Count };
-
-static std::unordered_map<absl::string_view, SqlFunctionType> FUNCTIONS = { { "SUM", SqlFunctionType::Sum },
-                                                                            { "MIN", SqlFunctionType::Min },
-                                                                            { "MAX", SqlFunctionType::Max },
-                                                                            { "AVG", SqlFunctionType::Avg },
-                                                                            { "COUNT", SqlFunctionType::Count } };
+enum class SqlFunctionType { Sum, Min, Max, Avg, Count, ApproxCountDistinct, ApproxPercentile };
+
+static std::unordered_map<absl::string_view, SqlFunctionType> FUNCTIONS = {
+  { "SUM", SqlFunctionType::Sum },
+  { "MIN", SqlFunctionType::Min },
+  { "MAX", SqlFunctionType::Max },
+  { "AVG", SqlFunctionType::Avg },
+  { "COUNT", SqlFunctionType::Count },
+  { "APPROX_COUNT_DISTINCT", SqlFunctionType::ApproxCountDistinct },
+  { "APPROX_PERCENTILE", SqlFunctionType::ApproxPercentile }
+};
 
 }  // namespace sql
 }  // namespace toyquery
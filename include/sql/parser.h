@@ -41,6 +41,8 @@ class Parser {
 
   absl::StatusOr<std::vector<std::shared_ptr<SqlSort>>> parseOrder();
 
+  absl::StatusOr<int64_t> parseRowCount(absl::string_view clause);
+
   absl::StatusOr<std::shared_ptr<SqlIdentifier>> parseIdentifier();
 
   absl::StatusOr<std::vector<std::shared_ptr<SqlExpression>>> parseExpressionList();
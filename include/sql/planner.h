@@ -44,6 +44,18 @@ class SqlPlanner {
   absl::StatusOr<int> countAggregationExpressions(
       std::vector<std::shared_ptr<toyquery::logicalplan::LogicalExpression>> projection_exprs);
 
+  // rewrite the expression to evaluate it on the output of the aggregation, made of the grouping expressions followed by
+  // the aggregate expressions. The aggregates which aren't computed yet are added to the aggregate expressions.
+  absl::StatusOr<std::shared_ptr<toyquery::logicalplan::LogicalExpression>> rewriteOnAggregation(
+      std::shared_ptr<toyquery::logicalplan::LogicalExpression> expr,
+      const std::vector<std::shared_ptr<toyquery::logicalplan::LogicalExpression>>& group_by_exprs,
+      std::vector<std::shared_ptr<toyquery::logicalplan::AggregateExpression>>& aggregate_exprs);
+
+  // check if both expressions compute the same value.
+  bool isSameExpression(
+      std::shared_ptr<toyquery::logicalplan::LogicalExpression> left,
+      std::shared_ptr<toyquery::logicalplan::LogicalExpression> right);
+
   absl::StatusOr<std::shared_ptr<toyquery::logicalplan::LogicalExpression>> createLogicalExpression(
       std::shared_ptr<SqlExpression> expr,
       std::shared_ptr<toyquery::dataframe::DataFrame> input);
@@ -74,7 +74,10 @@ enum class TokenType {
   KEYWORD_MIN,
   KEYWORD_SUM,
   KEYWORD_GROUP,
-  KEYWORD_HAVING
+  KEYWORD_HAVING,
+  KEYWORD_LIMIT,
+  KEYWORD_OFFSET,
+  KEYWORD_DISTINCT
 };
 
 static std::unordered_map<absl::string_view, TokenType> keywords = {
@@ -83,7 +86,8 @@ static std::unordered_map<absl::string_view, TokenType> keywords = {
   { "AND", TokenType::KEYWORD_AND },       { "OR", TokenType::KEYWORD_OR },     { "AS", TokenType::KEYWORD_AS },
   { "ASC", TokenType::KEYWORD_ASC },       { "DESC", TokenType::KEYWORD_DESC }, { "MAX", TokenType::KEYWORD_MAX },
   { "MIN", TokenType::KEYWORD_MIN },       { "SUM", TokenType::KEYWORD_SUM },   { "GROUP", TokenType::KEYWORD_GROUP },
-  { "HAVING", TokenType::KEYWORD_HAVING }
+  { "HAVING", TokenType::KEYWORD_HAVING }, { "LIMIT", TokenType::KEYWORD_LIMIT }, { "OFFSET", TokenType::KEYWORD_OFFSET },
+  { "DISTINCT", TokenType::KEYWORD_DISTINCT }
 };
 
 /**
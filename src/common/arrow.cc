@@ -1,9 +1,25 @@
 #include "common/arrow.h"
 
+#include "common/macros.h"
+#include "common/status.h"
 #include "fmt/core.h"
 
 namespace toyquery {
 
+using toyquery::common::GetMessageFromStatus;
+
+namespace {
+
+// reserve room for the rows of the builder, which are appended without checking for room.
+absl::Status reserve(arrow::ArrayBuilder& builder, int64_t length) {
+  auto status = builder.Reserve(length);
+  if (status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(status)); }
+  if (!status.ok()) { return absl::InternalError(GetMessageFromStatus(status)); }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 absl::StatusOr<std::shared_ptr<arrow::Schema>> FilterSchema(
     std::shared_ptr<arrow::Schema> schema,
     std::vector<std::string> projection) {
@@ -22,4 +38,255 @@ absl::StatusOr<std::shared_ptr<arrow::Schema>> FilterSchema(
   return std::make_shared<arrow::Schema>(projected_fields);
 }
 
+absl::StatusOr<std::shared_ptr<arrow::Array>> FilterArray(
+    std::shared_ptr<arrow::Array> data,
+    std::shared_ptr<arrow::BooleanArray> predicate,
+    arrow::MemoryPool* pool) {
+#define FILTER_ARROW_ARRAY_WITH_PREDICATE(array_tp, builder_tp)                              \
+  auto typed_data = std::static_pointer_cast<array_tp>(data);                                \
+  builder_tp builder(pool);                                                                  \
+  CHECK_OK_OR_RETURN(reserve(builder, predicate->true_count()));                             \
+                                                                                             \
+  for (int64_t idx = 0; idx < typed_data->length(); idx++) {                                 \
+    if (!predicate->GetView(idx)) { continue; }                                              \
+    if (typed_data->IsNull(idx)) {                                                           \
+      builder.UnsafeAppendNull();                                                            \
+    } else {                                                                                 \
+      builder.UnsafeAppend(typed_data->GetView(idx));                                        \
+    }                                                                                        \
+  }                                                                                          \
+                                                                                             \
+  auto array = builder.Finish();                                                             \
+  if (!array.ok()) { return absl::InternalError(GetMessageFromResult(array)); }              \
+  return *array;
+
+  switch (data->type_id()) {
+    case arrow::Type::BOOL: {
+      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::BooleanArray, arrow::BooleanBuilder);
+    }
+    case arrow::Type::INT64: {
+      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::Int64Array, arrow::Int64Builder);
+    }
+    case arrow::Type::DOUBLE: {
+      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::DoubleArray, arrow::DoubleBuilder);
+    }
+    case arrow::Type::STRING: {
+      // string builders also need the character data reserved before using UnsafeAppend.
+      auto typed_data = std::static_pointer_cast<arrow::StringArray>(data);
+      arrow::StringBuilder builder(pool);
+      CHECK_OK_OR_RETURN(reserve(builder, predicate->true_count()));
+      auto reserve_status = builder.ReserveData(typed_data->total_values_length());
+      if (reserve_status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(reserve_status)); }
+      if (!reserve_status.ok()) { return absl::InternalError(GetMessageFromStatus(reserve_status)); }
+
+      for (int64_t idx = 0; idx < typed_data->length(); idx++) {
+        if (!predicate->GetView(idx)) { continue; }
+        if (typed_data->IsNull(idx)) {
+          builder.UnsafeAppendNull();
+        } else {
+          builder.UnsafeAppend(typed_data->GetView(idx));
+        }
+      }
+
+      auto array = builder.Finish();
+      if (!array.ok()) { return absl::InternalError(GetMessageFromResult(array)); }
+      return *array;
+    }
+
+    default: return absl::InternalError("Unsupported type.");
+  }
+
+#undef FILTER_ARROW_ARRAY_WITH_PREDICATE
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> FilterRecordBatch(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    std::shared_ptr<arrow::BooleanArray> predicate,
+    arrow::MemoryPool* pool) {
+  std::vector<std::shared_ptr<arrow::Array>> columns_post_filtering;
+  for (auto& column : batch->columns()) {
+    ASSIGN_OR_RETURN(auto filtered_column, FilterArray(column, predicate, pool));
+    columns_post_filtering.push_back(filtered_column);
+  }
+
+  return arrow::RecordBatch::Make(batch->schema(), predicate->true_count(), columns_post_filtering);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Array>> TakeArray(
+    std::shared_ptr<arrow::Array> data,
+    const std::vector<int64_t>& indices) {
+#define TAKE_ARROW_ARRAY_ROWS(array_tp, builder_tp)                                    \
+  auto typed_data = std::static_pointer_cast<array_tp>(data);                          \
+  builder_tp builder;                                                                  \
+  builder.Reserve(indices.size());                                                     \
+                                                                                       \
+  for (auto idx : indices) {                                                           \
+    if (typed_data->IsNull(idx)) {                                                     \
+      builder.UnsafeAppendNull();                                                      \
+    } else {                                                                           \
+      builder.UnsafeAppend(typed_data->GetView(idx));                                  \
+    }                                                                                  \
+  }                                                                                    \
+                                                                                       \
+  auto array = builder.Finish();                                                       \
+  if (!array.ok()) { return absl::InternalError(GetMessageFromResult(array)); }        \
+  return *array;
+
+  switch (data->type_id()) {
+    case arrow::Type::BOOL: {
+      TAKE_ARROW_ARRAY_ROWS(arrow::BooleanArray, arrow::BooleanBuilder);
+    }
+    case arrow::Type::INT64: {
+      TAKE_ARROW_ARRAY_ROWS(arrow::Int64Array, arrow::Int64Builder);
+    }
+    case arrow::Type::DOUBLE: {
+      TAKE_ARROW_ARRAY_ROWS(arrow::DoubleArray, arrow::DoubleBuilder);
+    }
+    case arrow::Type::STRING: {
+      auto typed_data = std::static_pointer_cast<arrow::StringArray>(data);
+      arrow::StringBuilder builder;
+      builder.Reserve(indices.size());
+
+      for (auto idx : indices) {
+        if (typed_data->IsNull(idx)) {
+          builder.UnsafeAppendNull();
+        } else {
+          builder.Append(typed_data->GetView(idx));
+        }
+      }
+
+      auto array = builder.Finish();
+      if (!array.ok()) { return absl::InternalError(GetMessageFromResult(array)); }
+      return *array;
+    }
+
+    default: return absl::InternalError(fmt::format("Unsupported type {} for taking rows.", data->type()->ToString()));
+  }
+
+#undef TAKE_ARROW_ARRAY_ROWS
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TakeRecordBatch(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    const std::vector<int64_t>& indices) {
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (auto& column : batch->columns()) {
+    ASSIGN_OR_RETURN(auto taken, TakeArray(column, indices));
+    columns.push_back(taken);
+  }
+
+  return arrow::RecordBatch::Make(batch->schema(), static_cast<int64_t>(indices.size()), columns);
+}
+
+int CompareArrayValues(const arrow::Array& left, int64_t left_row, const arrow::Array& right, int64_t right_row) {
+#define COMPARE_ARRAY_VALUES(array_tp)                                       \
+  auto left_value = static_cast<const array_tp&>(left).GetView(left_row);    \
+  auto right_value = static_cast<const array_tp&>(right).GetView(right_row); \
+  if (left_value < right_value) { return -1; }                               \
+  return right_value < left_value ? 1 : 0;
+
+  switch (left.type_id()) {
+    case arrow::Type::BOOL: {
+      COMPARE_ARRAY_VALUES(arrow::BooleanArray);
+    }
+    case arrow::Type::INT64: {
+      COMPARE_ARRAY_VALUES(arrow::Int64Array);
+    }
+    case arrow::Type::DOUBLE: {
+      COMPARE_ARRAY_VALUES(arrow::DoubleArray);
+    }
+    case arrow::Type::STRING: {
+      COMPARE_ARRAY_VALUES(arrow::StringArray);
+    }
+    default: return 0;
+  }
+
+#undef COMPARE_ARRAY_VALUES
+}
+
+namespace {
+
+// the value of a signed integer scalar or an unsigned one fitting in 64 bits, widened to 64 bits.
+std::optional<int64_t> IntegerScalarValue(const arrow::Scalar& scalar) {
+  switch (scalar.type->id()) {
+    case arrow::Type::INT8: return static_cast<const arrow::Int8Scalar&>(scalar).value;
+    case arrow::Type::INT16: return static_cast<const arrow::Int16Scalar&>(scalar).value;
+    case arrow::Type::INT32: return static_cast<const arrow::Int32Scalar&>(scalar).value;
+    case arrow::Type::INT64: return static_cast<const arrow::Int64Scalar&>(scalar).value;
+    case arrow::Type::UINT8: return static_cast<const arrow::UInt8Scalar&>(scalar).value;
+    case arrow::Type::UINT16: return static_cast<const arrow::UInt16Scalar&>(scalar).value;
+    case arrow::Type::UINT32: return static_cast<const arrow::UInt32Scalar&>(scalar).value;
+    default: return std::nullopt;
+  }
+}
+
+// the value of a numeric scalar as a double.
+std::optional<double> NumericScalarValue(const arrow::Scalar& scalar) {
+  switch (scalar.type->id()) {
+    case arrow::Type::UINT64: return static_cast<double>(static_cast<const arrow::UInt64Scalar&>(scalar).value);
+    case arrow::Type::FLOAT: return static_cast<const arrow::FloatScalar&>(scalar).value;
+    case arrow::Type::DOUBLE: return static_cast<const arrow::DoubleScalar&>(scalar).value;
+    default: {
+      auto value = IntegerScalarValue(scalar);
+      if (!value.has_value()) { return std::nullopt; }
+      return static_cast<double>(*value);
+    }
+  }
+}
+
+}  // namespace
+
+std::optional<int> CompareScalars(const arrow::Scalar& left, const arrow::Scalar& right) {
+  if (!left.is_valid || !right.is_valid) { return std::nullopt; }
+
+  auto compare = [](const auto& left_value, const auto& right_value) {
+    if (left_value < right_value) { return -1; }
+    return right_value < left_value ? 1 : 0;
+  };
+
+  // integers are compared exactly, doubles can't represent all of them.
+  auto left_integer = IntegerScalarValue(left), right_integer = IntegerScalarValue(right);
+  if (left_integer.has_value() && right_integer.has_value()) { return compare(*left_integer, *right_integer); }
+
+  auto left_number = NumericScalarValue(left), right_number = NumericScalarValue(right);
+  if (left_number.has_value() && right_number.has_value()) { return compare(*left_number, *right_number); }
+
+  auto left_id = left.type->id(), right_id = right.type->id();
+  if (arrow::is_base_binary_like(left_id) && arrow::is_base_binary_like(right_id)) {
+    return compare(
+        static_cast<const arrow::BaseBinaryScalar&>(left).view(),
+        static_cast<const arrow::BaseBinaryScalar&>(right).view());
+  }
+  if (left_id == arrow::Type::BOOL && right_id == arrow::Type::BOOL) {
+    return compare(
+        static_cast<const arrow::BooleanScalar&>(left).value, static_cast<const arrow::BooleanScalar&>(right).value);
+  }
+  return std::nullopt;
+}
+
+absl::StatusOr<std::vector<std::shared_ptr<arrow::Array>>> ConcatenateRecordBatches(
+    std::shared_ptr<arrow::Schema> schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches,
+    arrow::MemoryPool* pool) {
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (int col_idx = 0; col_idx < schema->num_fields(); col_idx++) {
+    arrow::ArrayVector chunks;
+    for (auto& batch : batches) { chunks.push_back(batch->column(col_idx)); }
+
+    if (chunks.empty()) {
+      auto empty_or = arrow::MakeEmptyArray(schema->field(col_idx)->type());
+      if (!empty_or.ok()) { return absl::InternalError(GetMessageFromResult(empty_or)); }
+      columns.push_back(*empty_or);
+    } else {
+      auto concatenated_or = arrow::Concatenate(chunks, pool);
+      if (concatenated_or.status().IsOutOfMemory()) {
+        return absl::ResourceExhaustedError(GetMessageFromResult(concatenated_or));
+      }
+      if (!concatenated_or.ok()) { return absl::InternalError(GetMessageFromResult(concatenated_or)); }
+      columns.push_back(*concatenated_or);
+    }
+  }
+  return columns;
+}
+
 }  // namespace toyquery
@@ -0,0 +1,16 @@
+#include "common/cancellation.h"
+
+namespace toyquery {
+
+absl::Status CancellationToken::Check() const {
+  if (cancelled_) { return absl::CancelledError("the query was cancelled"); }
+
+  auto deadline = deadline_.load();
+  if (deadline != 0 && Clock::now().time_since_epoch().count() >= deadline) {
+    return absl::DeadlineExceededError("the query exceeded its deadline");
+  }
+  if (parent_ != nullptr) { return parent_->Check(); }
+  return absl::OkStatus();
+}
+
+}  // namespace toyquery
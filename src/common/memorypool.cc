@@ -0,0 +1,107 @@
+#include "common/memorypool.h"
+
+#include <algorithm>
+
+#include "fmt/core.h"
+
+namespace toyquery {
+
+TrackingMemoryPool::TrackingMemoryPool(std::string name, int64_t limit, TrackingMemoryPool* parent)
+    : name_{ std::move(name) },
+      limit_{ limit },
+      parent_{ parent } { }
+
+arrow::Status TrackingMemoryPool::Allocate(int64_t size, int64_t alignment, uint8_t** out) {
+  if (!reserve(size)) {
+    return arrow::Status::OutOfMemory(
+        fmt::format("allocating {} bytes in {} exceeds the memory limit, {} bytes available", size, name_, Available()));
+  }
+
+  auto status = arrow::default_memory_pool()->Allocate(size, alignment, out);
+  if (!status.ok()) {
+    release(size);
+    return status;
+  }
+  num_allocations_++;
+  return status;
+}
+
+arrow::Status TrackingMemoryPool::Reallocate(int64_t old_size, int64_t new_size, int64_t alignment, uint8_t** ptr) {
+  auto growth = new_size - old_size;
+  if (growth > 0 && !reserve(growth)) {
+    return arrow::Status::OutOfMemory(fmt::format(
+        "growing an allocation by {} bytes in {} exceeds the memory limit, {} bytes available",
+        growth,
+        name_,
+        Available()));
+  }
+
+  auto status = arrow::default_memory_pool()->Reallocate(old_size, new_size, alignment, ptr);
+  if (!status.ok()) {
+    if (growth > 0) { release(growth); }
+    return status;
+  }
+  if (growth < 0) { release(-growth); }
+  return status;
+}
+
+void TrackingMemoryPool::Free(uint8_t* buffer, int64_t size, int64_t alignment) {
+  arrow::default_memory_pool()->Free(buffer, size, alignment);
+  release(size);
+}
+
+int64_t TrackingMemoryPool::Available() const {
+  auto available = std::max<int64_t>(limit_ - bytes_allocated_, 0);
+  if (parent_ != nullptr) { available = std::min(available, parent_->Available()); }
+  return available;
+}
+
+std::shared_ptr<TrackingMemoryPool> TrackingMemoryPool::CreateChild(std::string name) {
+  auto child = std::make_shared<TrackingMemoryPool>(std::move(name), std::numeric_limits<int64_t>::max(), this);
+  std::lock_guard<std::mutex> lock(mutex_);
+  children_.push_back(child);
+  return child;
+}
+
+std::vector<OperatorMemoryUsage> TrackingMemoryPool::Attribution() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<OperatorMemoryUsage> usage;
+  for (auto& child : children_) {
+    usage.push_back({ child->Name(), child->bytes_allocated(), child->max_memory() });
+  }
+  return usage;
+}
+
+arrow::Status TrackingMemoryPool::Reserve(int64_t size) {
+  if (!reserve(size)) {
+    return arrow::Status::OutOfMemory(
+        fmt::format("reserving {} bytes in {} exceeds the memory limit, {} bytes available", size, name_, Available()));
+  }
+  return arrow::Status::OK();
+}
+
+void TrackingMemoryPool::Release(int64_t size) { release(size); }
+
+bool TrackingMemoryPool::reserve(int64_t size) {
+  auto allocated = bytes_allocated_.fetch_add(size) + size;
+  if (allocated > limit_) {
+    bytes_allocated_ -= size;
+    return false;
+  }
+  if (parent_ != nullptr && !parent_->reserve(size)) {
+    bytes_allocated_ -= size;
+    return false;
+  }
+
+  total_bytes_allocated_ += size;
+  auto peak = peak_bytes_allocated_.load();
+  while (allocated > peak && !peak_bytes_allocated_.compare_exchange_weak(peak, allocated)) { }
+  return true;
+}
+
+void TrackingMemoryPool::release(int64_t size) {
+  bytes_allocated_ -= size;
+  if (parent_ != nullptr) { parent_->release(size); }
+}
+
+}  // namespace toyquery
@@ -0,0 +1,89 @@
+#include "common/threadpool.h"
+
+#include <algorithm>
+
+namespace toyquery {
+
+namespace {
+
+// the pool and the index of the worker running on the current thread, if any.
+thread_local ThreadPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+  num_threads = std::max(num_threads, 1);
+  for (int i = 0; i < num_threads; i++) { workers_.push_back(std::make_unique<Worker>()); }
+  for (int i = 0; i < num_threads; i++) {
+    workers_[i]->thread = std::thread([this, i]() { run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  task_available_.notify_all();
+  for (auto& worker : workers_) { worker->thread.join(); }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  int worker_idx = current_pool == this ? current_worker : next_worker_++ % workers_.size();
+  {
+    std::lock_guard<std::mutex> lock(workers_[worker_idx]->mutex);
+    workers_[worker_idx]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_tasks_++;
+  }
+  task_available_.notify_one();
+}
+
+void ThreadPool::run(int worker_idx) {
+  current_pool = this;
+  current_worker = worker_idx;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_available_.wait(lock, [this]() { return queued_tasks_ > 0 || stopping_; });
+      if (queued_tasks_ == 0) { return; }  // stopping with nothing left to run.
+    }
+
+    std::function<void()> task;
+    if (!popTask(worker_idx, task)) { continue; }  // another worker got the task first.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued_tasks_--;
+    }
+    task();
+  }
+}
+
+bool ThreadPool::popTask(int worker_idx, std::function<void()>& task) {
+  {
+    auto& own = *workers_[worker_idx];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (int i = 1; i < workers_.size(); i++) {
+    auto& victim = *workers_[(worker_idx + i) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace toyquery
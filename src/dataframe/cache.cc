@@ -0,0 +1,249 @@
+#include "dataframe/cache.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "arrow/io/api.h"
+#include "arrow/ipc/api.h"
+#include "arrow/util/byte_size.h"
+#include "arrow/util/compression.h"
+#include "common/arrow.h"
+#include "common/status.h"
+#include "optimization/optimizer.h"
+#include "planner/planner.h"
+
+namespace toyquery {
+namespace dataframe {
+
+namespace {
+
+using ::toyquery::datasource::ColumnPredicate;
+using ::toyquery::datasource::ScanContext;
+using ::toyquery::optimization::Optimizer;
+using ::toyquery::planner::QueryPlanner;
+
+static constexpr int64_t DEFAULT_CACHE_BUDGET = int64_t{ 1 } << 30;
+
+/**
+ * @brief Decompress the batches of a cached arrow ipc stream one at a time, keeping the projected columns only.
+ */
+class CompressedResultReader : public arrow::RecordBatchReader {
+ public:
+  CompressedResultReader(std::shared_ptr<arrow::RecordBatchReader> stream, std::shared_ptr<arrow::Schema> schema)
+      : stream_{ std::move(stream) },
+        schema_{ std::move(schema) } { }
+
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+    std::shared_ptr<arrow::RecordBatch> stream_batch;
+    ARROW_RETURN_NOT_OK(stream_->ReadNext(&stream_batch));
+    if (stream_batch == nullptr) {
+      *batch = nullptr;  // end of stream.
+      return arrow::Status::OK();
+    }
+
+    // the batch holds the included fields in stream order, they are put in projection order.
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    for (const auto& field : schema_->fields()) { columns.push_back(stream_batch->GetColumnByName(field->name())); }
+    *batch = arrow::RecordBatch::Make(schema_, stream_batch->num_rows(), columns);
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::shared_ptr<arrow::RecordBatchReader> stream_;
+  std::shared_ptr<arrow::Schema> schema_;
+};
+
+// serialize the batches into an arrow ipc stream with lz4 compressed buffers.
+arrow::Result<std::shared_ptr<arrow::Buffer>> CompressBatches(
+    const std::shared_ptr<arrow::Schema>& schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches) {
+  auto write_options = arrow::ipc::IpcWriteOptions::Defaults();
+  ARROW_ASSIGN_OR_RAISE(write_options.codec, arrow::util::Codec::Create(arrow::Compression::LZ4_FRAME));
+
+  ARROW_ASSIGN_OR_RAISE(auto output, arrow::io::BufferOutputStream::Create());
+  ARROW_ASSIGN_OR_RAISE(auto writer, arrow::ipc::MakeStreamWriter(output, schema, write_options));
+  for (const auto& batch : batches) { ARROW_RETURN_NOT_OK(writer->WriteRecordBatch(*batch)); }
+  ARROW_RETURN_NOT_OK(writer->Close());
+  return output->Finish();
+}
+
+}  // namespace
+
+BatchCache::BatchCache(int64_t budget) : budget_{ budget } { }
+
+BatchCache::~BatchCache() { }
+
+std::shared_ptr<BatchCache> BatchCache::Default() {
+  static auto cache = std::make_shared<BatchCache>(DEFAULT_CACHE_BUDGET);
+  return cache;
+}
+
+int64_t BatchCache::NextKey() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return next_key_++;
+}
+
+std::shared_ptr<CachedResult> BatchCache::Get(int64_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = results_.find(key);
+  if (it == results_.end()) { return nullptr; }
+
+  lru_.splice(lru_.begin(), lru_, it->second.second);
+  return it->second.first;
+}
+
+void BatchCache::Put(int64_t key, std::shared_ptr<CachedResult> result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (result->bytes > budget_) { return; }
+
+  auto it = results_.find(key);
+  if (it != results_.end()) {
+    bytes_ -= it->second.first->bytes;
+    lru_.erase(it->second.second);
+    results_.erase(it);
+  }
+
+  bytes_ += result->bytes;
+  lru_.push_front(key);
+  results_[key] = { std::move(result), lru_.begin() };
+  evict();
+}
+
+void BatchCache::Evict(int64_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = results_.find(key);
+  if (it == results_.end()) { return; }
+
+  bytes_ -= it->second.first->bytes;
+  lru_.erase(it->second.second);
+  results_.erase(it);
+}
+
+void BatchCache::SetBudget(int64_t budget) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = budget;
+  evict();
+}
+
+int64_t BatchCache::Bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+size_t BatchCache::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return results_.size();
+}
+
+void BatchCache::evict() {
+  // the scans of an evicted result keep it alive until they are done.
+  while (bytes_ > budget_ && !lru_.empty()) {
+    auto it = results_.find(lru_.back());
+    bytes_ -= it->second.first->bytes;
+    results_.erase(it);
+    lru_.pop_back();
+  }
+}
+
+CachedDataSource::CachedDataSource(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> plan,
+    std::shared_ptr<BatchCache> cache,
+    bool compressed)
+    : DataSource(),
+      plan_{ std::move(plan) },
+      cache_{ std::move(cache) },
+      compressed_{ compressed },
+      key_{ cache_->NextKey() } {
+  SetSortedBy(plan_->SortedBy());
+}
+
+CachedDataSource::~CachedDataSource() { cache_->Evict(key_); }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> CachedDataSource::Schema() { return plan_->Schema(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> CachedDataSource::Scan(std::vector<std::string> projection) {
+  return Scan(projection, {}, ScanContext());
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> CachedDataSource::Scan(
+    std::vector<std::string> projection,
+    const std::vector<ColumnPredicate>& filter,
+    const ScanContext& context) {
+  auto result = cache_->Get(key_);
+  if (result == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    result = cache_->Get(key_);
+    if (result == nullptr) {
+      ASSIGN_OR_RETURN(result, execute(context));
+      cache_->Put(key_, result);
+    }
+  }
+
+  if (result->table != nullptr) {
+    toyquery::datasource::InMemoryDataSource source(result->table);
+    return source.Scan(projection);
+  }
+
+  auto schema = result->schema;
+  auto read_options = arrow::ipc::IpcReadOptions::Defaults();
+  if (!projection.empty()) {
+    ASSIGN_OR_RETURN(schema, FilterSchema(result->schema, projection));
+    auto& included_fields = read_options.included_fields;
+    for (const auto& name : projection) { included_fields.push_back(result->schema->GetFieldIndex(name)); }
+    std::sort(included_fields.begin(), included_fields.end());
+    included_fields.erase(std::unique(included_fields.begin(), included_fields.end()), included_fields.end());
+  }
+
+  auto maybe_stream = arrow::ipc::RecordBatchStreamReader::Open(
+      std::make_shared<arrow::io::BufferReader>(result->compressed), read_options);
+  if (!maybe_stream.ok()) { return absl::InternalError(GetMessageFromResult(maybe_stream)); }
+  return std::make_shared<CompressedResultReader>(*maybe_stream, schema);
+}
+
+void CachedDataSource::Unpersist() { cache_->Evict(key_); }
+
+absl::StatusOr<std::shared_ptr<CachedResult>> CachedDataSource::execute(const ScanContext& context) {
+  Optimizer optimizer;
+  ASSIGN_OR_RETURN(auto logical_plan, optimizer.Optimize(plan_));
+
+  // the blocking operators spill below the memory limit of the scanning query, like those of the query itself.
+  QueryPlanner planner(context.pool != nullptr ? context.pool->Limit() : std::numeric_limits<int64_t>::max(), "");
+  planner.SetParallelism(context.parallelism);
+  planner.SetPrefetchDepth(context.prefetch_depth);
+  ASSIGN_OR_RETURN(auto physical_plan, planner.CreatePhysicalPlan(logical_plan));
+  if (context.token != nullptr) { physical_plan->SetCancellationToken(context.token); }
+  if (context.pool != nullptr) { physical_plan->SetMemoryPool(context.pool); }
+  CHECK_OK_OR_RETURN(physical_plan->Prepare());
+
+  auto result = std::make_shared<CachedResult>();
+  ASSIGN_OR_RETURN(result->schema, physical_plan->Schema());
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, physical_plan->Next());
+    if (batch == nullptr) { break; }
+    batches.push_back(batch);
+  }
+
+  if (compressed_ && arrow::util::Codec::IsAvailable(arrow::Compression::LZ4_FRAME)) {
+    auto maybe_compressed = CompressBatches(result->schema, batches);
+    if (!maybe_compressed.ok()) { return absl::InternalError(GetMessageFromResult(maybe_compressed)); }
+    result->compressed = *maybe_compressed;
+    result->bytes = result->compressed->size();
+    return result;
+  }
+  LOG_IF(WARNING, compressed_) << "lz4 isn't available, the cached result isn't compressed.";
+
+  auto maybe_table = arrow::Table::FromRecordBatches(result->schema, batches);
+  if (!maybe_table.ok()) { return absl::InternalError(GetMessageFromResult(maybe_table)); }
+  result->table = *maybe_table;
+  result->bytes = arrow::util::TotalBufferSize(*result->table);
+  result->pool = context.pool;
+  return result;
+}
+
+}  // namespace dataframe
+}  // namespace toyquery
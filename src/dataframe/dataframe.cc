@@ -23,6 +23,40 @@ std::shared_ptr<DataFrame> DataFrameImpl::Aggregate(
   return std::make_shared<DataFrameImpl>(std::make_shared<Aggregation>(plan_, group_by, aggregate_expr));
 }
 
+std::shared_ptr<DataFrame> DataFrameImpl::Join(
+    std::shared_ptr<DataFrame> right,
+    std::vector<std::pair<std::string, std::string>> on) {
+  return std::make_shared<DataFrameImpl>(
+      std::make_shared<toyquery::logicalplan::Join>(plan_, right->GetLogicalPlan(), std::move(on)));
+}
+
+std::shared_ptr<DataFrame> DataFrameImpl::Sort(std::vector<SortKey> sort_keys) {
+  return std::make_shared<DataFrameImpl>(std::make_shared<toyquery::logicalplan::Sort>(plan_, std::move(sort_keys)));
+}
+
+std::shared_ptr<DataFrame> DataFrameImpl::Limit(int64_t limit, int64_t offset) {
+  return std::make_shared<DataFrameImpl>(std::make_shared<toyquery::logicalplan::Limit>(plan_, limit, offset));
+}
+
+std::shared_ptr<DataFrame> DataFrameImpl::Distinct() {
+  return std::make_shared<DataFrameImpl>(std::make_shared<toyquery::logicalplan::Distinct>(plan_));
+}
+
+std::shared_ptr<DataFrame> DataFrameImpl::Window(
+    std::vector<std::shared_ptr<LogicalExpression>> partition_by,
+    std::vector<SortKey> order_by,
+    std::vector<WindowFunction> functions) {
+  return std::make_shared<DataFrameImpl>(std::make_shared<toyquery::logicalplan::Window>(
+      plan_, std::move(partition_by), std::move(order_by), std::move(functions)));
+}
+
+std::shared_ptr<DataFrame> DataFrameImpl::Cache(bool compressed, std::shared_ptr<BatchCache> cache) {
+  // the later queries scan the cached result in place of the plan of the dataframe.
+  auto source = std::make_shared<CachedDataSource>(plan_, std::move(cache), compressed);
+  return std::make_shared<DataFrameImpl>(
+      std::make_shared<toyquery::logicalplan::Scan>("cache", source, std::vector<std::string>{}));
+}
+
 absl::StatusOr<std::shared_ptr<arrow::Schema>> DataFrameImpl::GetSchema() { return plan_->Schema(); }
 
 std::shared_ptr<LogicalPlan> DataFrameImpl::GetLogicalPlan() { return plan_; }
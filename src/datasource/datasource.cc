@@ -2,44 +2,1342 @@
 
 #include <glog/logging.h>
 
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "arrow/csv/api.h"
 #include "arrow/io/api.h"
+#include "arrow/ipc/api.h"
+#include "arrow/util/compression.h"
+#include "common/arrow.h"
+#include "common/macros.h"
 #include "common/status.h"
+#include "common/threadpool.h"
+#include "fmt/core.h"
+#include "parquet/arrow/reader.h"
+#include "parquet/arrow/schema.h"
+#include "parquet/properties.h"
+#include "parquet/statistics.h"
 
 namespace toyquery {
 namespace datasource {
 
-absl::StatusOr<std::shared_ptr<arrow::Schema>> CsvDataSource::Schema() {
-  if (schema_ != nullptr) { return schema_; }
+namespace {
+
+// The number of batches of a dataset file read by each task of the dataset reader.
+static constexpr size_t DATASET_BATCHES_PER_TASK = 4;
+// The largest block of a csv file parsed at once, the block size of the arrow reader being an int32 including a byte
+// of padding.
+static constexpr int64_t MAX_CSV_BLOCK_SIZE = std::numeric_limits<int32_t>::max() - 1;
+
+/**
+ * @brief Cut the batches of the input reader into batches of batch_size rows, the last one being smaller.
+ *
+ * The batches of a block are zero-copy slices, only the rows of a batch straddling two blocks are copied.
+ */
+class BatchSizeReader : public arrow::RecordBatchReader {
+ public:
+  BatchSizeReader(std::shared_ptr<arrow::RecordBatchReader> input, int64_t batch_size)
+      : input_{ std::move(input) },
+        batch_size_{ std::max<int64_t>(batch_size, 1) } { }
+
+  std::shared_ptr<arrow::Schema> schema() const override { return input_->schema(); }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> pieces;
+    int64_t num_rows = 0;
+    while (num_rows < batch_size_) {
+      if (block_ == nullptr || offset_ >= block_->num_rows()) {
+        ARROW_RETURN_NOT_OK(input_->ReadNext(&block_));
+        offset_ = 0;
+        if (block_ == nullptr) { break; }  // end of stream.
+        continue;
+      }
+
+      auto piece = block_->Slice(offset_, batch_size_ - num_rows);
+      offset_ += piece->num_rows();
+      num_rows += piece->num_rows();
+      pieces.push_back(piece);
+    }
+
+    if (pieces.size() <= 1) {
+      *batch = pieces.empty() ? nullptr : pieces[0];
+      return arrow::Status::OK();
+    }
+
+    auto columns = ConcatenateRecordBatches(schema(), pieces);
+    if (!columns.ok()) { return arrow::Status::Invalid(columns.status().message()); }
+    *batch = arrow::RecordBatch::Make(schema(), num_rows, *columns);
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::shared_ptr<arrow::RecordBatchReader> input_;
+  int64_t batch_size_;
+
+  // the block of the file being cut into batches.
+  std::shared_ptr<arrow::RecordBatch> block_;
+  int64_t offset_{ 0 };
+};
+
+/**
+ * @brief The conversion options of a csv file with the given schema, so that the types of its columns aren't inferred.
+ */
+arrow::csv::ConvertOptions CsvConvertOptions(
+    const std::shared_ptr<arrow::Schema>& schema,
+    const std::vector<std::string>& projection) {
+  auto convert_options = arrow::csv::ConvertOptions::Defaults();
+  for (auto& field : schema->fields()) { convert_options.column_types[field->name()] = field->type(); }
+  if (!projection.empty()) { convert_options.include_columns = projection; }
+  return convert_options;
+}
+
+/**
+ * @brief Find the first or the last newline of a csv text ending a record, npos if none does.
+ *
+ * The text must start at the start of a record. The newlines within a quoted value don't end the record, a value being
+ * quoted if it starts with a quote, up to the next quote not doubled.
+ */
+size_t FindRecordEnd(std::string_view data, bool last) {
+  if (data.find('"') == std::string_view::npos) { return last ? data.rfind('\n') : data.find('\n'); }
+
+  size_t record_end = std::string_view::npos;
+  bool value_start = true;
+  bool quoted = false;
+  for (size_t i = 0; i < data.size(); i++) {
+    if (quoted) {
+      if (data[i] != '"') { continue; }
+      if (i + 1 < data.size() && data[i + 1] == '"') {
+        i++;  // an escaped quote.
+      } else {
+        quoted = false;
+      }
+      continue;
+    }
+
+    if (data[i] == '"' && value_start) {
+      quoted = true;
+      value_start = false;
+      continue;
+    }
+    value_start = data[i] == ',' || data[i] == '\n';
+    if (data[i] == '\n') {
+      if (!last) { return i; }
+      record_end = i;
+    }
+  }
+  return record_end;
+}
+
+/**
+ * @brief Read at least size bytes of the file from offset, cut after the end of the last record, or the rest of the
+ * file.
+ *
+ * More is read if no record ends within size bytes, up to MAX_CSV_BLOCK_SIZE.
+ */
+arrow::Result<std::shared_ptr<arrow::Buffer>> ReadWholeLines(
+    const std::shared_ptr<arrow::io::RandomAccessFile>& file,
+    int64_t offset,
+    int64_t size,
+    int64_t file_size) {
+  size = std::min(size, MAX_CSV_BLOCK_SIZE);
+  while (true) {
+    ARROW_ASSIGN_OR_RAISE(auto buffer, file->ReadAt(offset, std::min(size, file_size - offset)));
+    if (offset + buffer->size() >= file_size) { return buffer; }
+
+    auto data = std::string_view(reinterpret_cast<const char*>(buffer->data()), buffer->size());
+    auto record_end = FindRecordEnd(data, true);
+    if (record_end != std::string_view::npos) { return arrow::SliceBuffer(buffer, 0, record_end + 1); }
+    if (size == MAX_CSV_BLOCK_SIZE) {
+      return arrow::Status::CapacityError(fmt::format("no csv record ends within {} bytes", MAX_CSV_BLOCK_SIZE));
+    }
+    size = std::min(size * 2, MAX_CSV_BLOCK_SIZE);
+  }
+}
+
+/**
+ * @brief The parse options of the csv files, whose quoted values can contain newlines.
+ */
+arrow::csv::ParseOptions CsvParseOptions() {
+  auto parse_options = arrow::csv::ParseOptions::Defaults();
+  parse_options.newlines_in_values = true;
+  return parse_options;
+}
+
+/**
+ * @brief Parse a block of a csv file, made of whole records without the header, of at most MAX_CSV_BLOCK_SIZE bytes.
+ *
+ * @return arrow::Result<std::shared_ptr<arrow::RecordBatch>>: the rows of the block, nullptr if it has none.
+ */
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> ParseCsvBlock(
+    std::shared_ptr<arrow::Buffer> block,
+    std::shared_ptr<arrow::Schema> file_schema,
+    std::vector<std::string> projection,
+    std::shared_ptr<arrow::Schema> schema) {
+  // the names and types of the columns come from the file schema so that all the blocks agree on them.
+  auto read_options = arrow::csv::ReadOptions::Defaults();
+  read_options.use_threads = false;
+  read_options.column_names = file_schema->field_names();
+  if (block->size() > MAX_CSV_BLOCK_SIZE) {
+    return arrow::Status::CapacityError(fmt::format("csv block of {} bytes is too large", block->size()));
+  }
+  read_options.block_size = static_cast<int32_t>(block->size() + 1);
+
+  auto convert_options = CsvConvertOptions(file_schema, projection);
+
+  ARROW_ASSIGN_OR_RAISE(
+      auto reader,
+      arrow::csv::StreamingReader::Make(
+          arrow::io::default_io_context(),
+          std::make_shared<arrow::io::BufferReader>(block),
+          read_options,
+          CsvParseOptions(),
+          convert_options));
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  int64_t num_rows = 0;
+  while (true) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    ARROW_RETURN_NOT_OK(reader->ReadNext(&batch));
+    if (batch == nullptr) { break; }
+    num_rows += batch->num_rows();
+    batches.push_back(batch);
+  }
+
+  if (num_rows == 0) { return nullptr; }
+  if (batches.size() == 1) { return batches[0]; }
+  auto columns = ConcatenateRecordBatches(schema, batches);
+  if (!columns.ok()) { return arrow::Status::Invalid(columns.status().message()); }
+  return arrow::RecordBatch::Make(schema, num_rows, *columns);
+}
+
+/**
+ * @brief Read at least size bytes from the start of the stream, cut after the end of the last record, or the whole
+ * stream.
+ *
+ * More is read if no record ends within size bytes, up to MAX_CSV_BLOCK_SIZE.
+ */
+arrow::Result<std::shared_ptr<arrow::Buffer>> ReadLeadingLines(
+    const std::shared_ptr<arrow::io::InputStream>& input,
+    int64_t size) {
+  arrow::BufferVector chunks;
+  while (true) {
+    ARROW_ASSIGN_OR_RAISE(auto chunk, input->Read(size));
+    chunks.push_back(chunk);
+    ARROW_ASSIGN_OR_RAISE(auto buffer, arrow::ConcatenateBuffers(chunks));
+    if (chunk->size() < size) { return buffer; }
+
+    auto data = std::string_view(reinterpret_cast<const char*>(buffer->data()), buffer->size());
+    auto record_end = FindRecordEnd(data, true);
+    if (record_end != std::string_view::npos) { return arrow::SliceBuffer(buffer, 0, record_end + 1); }
+    if (buffer->size() >= MAX_CSV_BLOCK_SIZE) {
+      return arrow::Status::CapacityError(fmt::format("no csv record ends within {} bytes", MAX_CSV_BLOCK_SIZE));
+    }
+  }
+}
+
+/**
+ * @brief An input stream over the chunks produced by tasks on a thread pool, at most read_ahead tasks in flight.
+ *
+ * The tasks are created on the consuming thread. Each of them returns its chunk with the position of the chunk in the
+ * stream, so that tasks reading a shared source in turn can number their chunks in the order they read them rather
+ * than the order they were created in. A null chunk ends the stream.
+ */
+class ReadaheadInputStream : public arrow::io::InputStream {
+ public:
+  using Chunk = std::pair<int64_t, arrow::Result<std::shared_ptr<arrow::Buffer>>>;
+  // A task producing a chunk of the stream. It can outlive the stream so it must not refer to it.
+  using Task = std::function<Chunk()>;
+  // Create the task producing the chunk of the given position, an empty task at the end of the input.
+  using TaskFactory = std::function<arrow::Result<Task>(int64_t)>;
+
+  ReadaheadInputStream(TaskFactory next_task, int num_threads, int read_ahead)
+      : next_task_{ std::move(next_task) },
+        read_ahead_{ std::max(read_ahead, 1) },
+        state_{ std::make_shared<State>() },
+        thread_pool_{ std::make_shared<ThreadPool>(std::max(num_threads, 1)) } { }
+
+  arrow::Status Close() override {
+    closed_ = true;
+    return arrow::Status::OK();
+  }
+
+  bool closed() const override { return closed_; }
+
+  arrow::Result<int64_t> Tell() const override { return position_; }
+
+  arrow::Result<int64_t> Read(int64_t nbytes, void* out) override {
+    int64_t copied = 0;
+    while (copied < nbytes) {
+      if (chunk_ == nullptr || chunk_offset_ == chunk_->size()) {
+        ARROW_ASSIGN_OR_RAISE(chunk_, nextChunk());
+        chunk_offset_ = 0;
+        if (chunk_ == nullptr) { break; }
+        continue;
+      }
+
+      auto size = std::min(nbytes - copied, chunk_->size() - chunk_offset_);
+      std::memcpy(static_cast<uint8_t*>(out) + copied, chunk_->data() + chunk_offset_, size);
+      chunk_offset_ += size;
+      copied += size;
+    }
+    position_ += copied;
+    return copied;
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override {
+    // the bytes are sliced out of the current chunk when it holds them all, else copied.
+    if (chunk_ != nullptr && chunk_->size() - chunk_offset_ >= nbytes) {
+      auto buffer = arrow::SliceBuffer(chunk_, chunk_offset_, nbytes);
+      chunk_offset_ += nbytes;
+      position_ += nbytes;
+      return buffer;
+    }
+
+    ARROW_ASSIGN_OR_RAISE(auto buffer, arrow::AllocateResizableBuffer(nbytes));
+    ARROW_ASSIGN_OR_RAISE(auto size, Read(nbytes, buffer->mutable_data()));
+    ARROW_RETURN_NOT_OK(buffer->Resize(size));
+    return std::shared_ptr<arrow::Buffer>(std::move(buffer));
+  }
+
+ private:
+  // The chunks produced by the thread pool, by position in the stream. Shared with the tasks.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<int64_t, arrow::Result<std::shared_ptr<arrow::Buffer>>> produced;
+  };
+
+  // wait for the next chunk of the stream, nullptr at its end.
+  arrow::Result<std::shared_ptr<arrow::Buffer>> nextChunk() {
+    if (ended_) { return nullptr; }
+
+    ARROW_RETURN_NOT_OK(scheduleTasks());
+    if (consumed_ == scheduled_) {
+      ended_ = true;
+      return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->changed.wait(lock, [this]() { return state_->produced.count(consumed_) > 0; });
+    auto it = state_->produced.find(consumed_);
+    auto result = std::move(it->second);
+    state_->produced.erase(it);
+    lock.unlock();
+    consumed_++;
+
+    ARROW_ASSIGN_OR_RAISE(auto chunk, std::move(result));
+    ended_ = chunk == nullptr;
+    return chunk;
+  }
+
+  // create the next tasks and submit them to the thread pool, until read_ahead tasks are in flight.
+  arrow::Status scheduleTasks() {
+    while (!exhausted_ && scheduled_ - consumed_ < read_ahead_) {
+      ARROW_ASSIGN_OR_RAISE(auto task, next_task_(scheduled_));
+      if (!task) {
+        exhausted_ = true;
+        break;
+      }
+
+      scheduled_++;
+      auto state = state_;
+      thread_pool_->Submit([state, task = std::move(task)]() {
+        auto chunk = task();
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->produced.emplace(chunk.first, std::move(chunk.second));
+        state->changed.notify_all();
+      });
+    }
+    return arrow::Status::OK();
+  }
+
+  TaskFactory next_task_;
+  int64_t read_ahead_;
+  bool exhausted_{ false };
+  bool ended_{ false };
+  bool closed_{ false };
+
+  // the number of tasks submitted to the thread pool and of chunks taken by the consumer.
+  int64_t scheduled_{ 0 };
+  int64_t consumed_{ 0 };
+  // the chunk being read, and the position of the next byte in it and in the stream.
+  std::shared_ptr<arrow::Buffer> chunk_;
+  int64_t chunk_offset_{ 0 };
+  int64_t position_{ 0 };
+
+  std::shared_ptr<State> state_;
+  // declared last so that it is destroyed first, running the pending tasks before the rest of the stream goes away.
+  std::shared_ptr<ThreadPool> thread_pool_;
+};
+
+// the size of the header of a bgzf block, a gzip member with the size of the block in an extra field.
+constexpr int64_t BGZF_HEADER_SIZE = 18;
+
+/**
+ * @brief Detect the compression of a file from the magic bytes at its start.
+ */
+arrow::Compression::type DetectCompression(const std::shared_ptr<arrow::Buffer>& magic) {
+  auto starts_with = [&magic](std::initializer_list<uint8_t> bytes) {
+    return magic->size() >= static_cast<int64_t>(bytes.size()) && std::equal(bytes.begin(), bytes.end(), magic->data());
+  };
+  if (starts_with({ 0x1f, 0x8b })) { return arrow::Compression::GZIP; }
+  if (starts_with({ 0x28, 0xb5, 0x2f, 0xfd })) { return arrow::Compression::ZSTD; }
+  if (starts_with({ 0x04, 0x22, 0x4d, 0x18 })) { return arrow::Compression::LZ4_FRAME; }
+  return arrow::Compression::UNCOMPRESSED;
+}
+
+/**
+ * @brief Get the size of the bgzf block from its header, an error if it isn't the header of a bgzf block.
+ */
+arrow::Result<int64_t> BgzfBlockSize(const std::shared_ptr<arrow::Buffer>& header) {
+  const uint8_t* data = header->data();
+  // the FEXTRA flag is set and the first extra subfield is BC, holding the size of the block minus one.
+  if (header->size() < BGZF_HEADER_SIZE || data[0] != 0x1f || data[1] != 0x8b || (data[3] & 0x04) == 0 ||
+      data[12] != 'B' || data[13] != 'C' || data[14] != 2 || data[15] != 0) {
+    return arrow::Status::Invalid("not a bgzf block");
+  }
+  return (static_cast<int64_t>(data[16]) | static_cast<int64_t>(data[17]) << 8) + 1;
+}
+
+/**
+ * @brief Decompress a bgzf block, whose uncompressed size is stored in its last four bytes.
+ */
+arrow::Result<std::shared_ptr<arrow::Buffer>> DecompressBgzfBlock(const std::shared_ptr<arrow::Buffer>& block) {
+  const uint8_t* footer = block->data() + block->size() - 4;
+  int64_t size = static_cast<int64_t>(footer[0]) | static_cast<int64_t>(footer[1]) << 8 |
+                 static_cast<int64_t>(footer[2]) << 16 | static_cast<int64_t>(footer[3]) << 24;
+
+  // a codec decompresses one buffer at a time, each block gets its own.
+  ARROW_ASSIGN_OR_RAISE(auto codec, arrow::util::Codec::Create(arrow::Compression::GZIP));
+  ARROW_ASSIGN_OR_RAISE(auto output, arrow::AllocateResizableBuffer(size));
+  ARROW_ASSIGN_OR_RAISE(
+      auto decompressed_size, codec->Decompress(block->size(), block->data(), size, output->mutable_data()));
+  ARROW_RETURN_NOT_OK(output->Resize(decompressed_size));
+  return std::shared_ptr<arrow::Buffer>(std::move(output));
+}
+
+/**
+ * @brief Create the tasks decompressing the blocks of a bgzf file in parallel.
+ *
+ * The blocks are read on the consuming thread, which only has to parse their headers to find the next one.
+ */
+ReadaheadInputStream::TaskFactory BgzfTasks(std::shared_ptr<arrow::io::RandomAccessFile> file, int64_t file_size) {
+  return [file, file_size, offset = int64_t{ 0 }](int64_t chunk_idx) mutable -> arrow::Result<ReadaheadInputStream::Task> {
+    if (offset >= file_size) { return ReadaheadInputStream::Task(); }
+
+    ARROW_ASSIGN_OR_RAISE(auto header, file->ReadAt(offset, std::min(BGZF_HEADER_SIZE, file_size - offset)));
+    ARROW_ASSIGN_OR_RAISE(auto block_size, BgzfBlockSize(header));
+    ARROW_ASSIGN_OR_RAISE(auto block, file->ReadAt(offset, block_size));
+    if (block->size() < block_size) { return arrow::Status::IOError("truncated bgzf block"); }
+    offset += block_size;
+
+    return ReadaheadInputStream::Task([chunk_idx, block]() -> ReadaheadInputStream::Chunk {
+      return { chunk_idx, DecompressBgzfBlock(block) };
+    });
+  };
+}
+
+/**
+ * @brief Create the tasks decompressing a compressed stream one chunk after the other.
+ *
+ * The tasks read the stream in turn, numbering the chunks in the order they are read.
+ */
+ReadaheadInputStream::TaskFactory StreamTasks(
+    std::shared_ptr<arrow::util::Codec> codec,
+    std::shared_ptr<arrow::io::InputStream> raw,
+    int64_t chunk_size) {
+  struct Stream {
+    std::mutex mutex;
+    // the codec must outlive the stream decompressed with it.
+    std::shared_ptr<arrow::util::Codec> codec;
+    std::shared_ptr<arrow::io::CompressedInputStream> input;
+    arrow::Status status;
+    int64_t next_chunk{ 0 };
+  };
+  auto stream = std::make_shared<Stream>();
+  stream->codec = std::move(codec);
+  auto input = arrow::io::CompressedInputStream::Make(stream->codec.get(), raw);
+  if (input.ok()) {
+    stream->input = *input;
+  } else {
+    stream->status = input.status();
+  }
+
+  return [stream, chunk_size](int64_t) -> arrow::Result<ReadaheadInputStream::Task> {
+    ARROW_RETURN_NOT_OK(stream->status);
+    return ReadaheadInputStream::Task([stream, chunk_size]() -> ReadaheadInputStream::Chunk {
+      std::lock_guard<std::mutex> lock(stream->mutex);
+      auto chunk_idx = stream->next_chunk++;
+      auto chunk = stream->input->Read(chunk_size);
+      if (chunk.ok() && (*chunk)->size() == 0) { return { chunk_idx, std::shared_ptr<arrow::Buffer>() }; }
+      return { chunk_idx, std::move(chunk) };
+    });
+  };
+}
+
+/**
+ * @brief Produce the batches of a reader on a thread pool, at most read_ahead tasks in flight.
+ *
+ * The tasks producing the batches are created on the consuming thread, in the order of the input. The batches of the
+ * tasks are returned either in that order or as soon as they are ready.
+ *
+ * The input can be made of several streams read concurrently, e.g. the files of a dataset. The order is then the one of
+ * the tasks within each stream and the one of the streams, the batches of a task ending with a nullptr end its stream.
+ */
+class ParallelBatchReader : public arrow::RecordBatchReader {
+ public:
+  ParallelBatchReader(std::shared_ptr<arrow::Schema> schema, int num_threads, int read_ahead, bool preserve_order)
+      : schema_{ std::move(schema) },
+        read_ahead_{ read_ahead > 0 ? read_ahead : 2 * std::max(num_threads, 1) },
+        preserve_order_{ preserve_order },
+        state_{ std::make_shared<State>() },
+        thread_pool_{ std::make_shared<ThreadPool>(std::max(num_threads, 1)) } { }
+
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+    while (true) {
+      if (!ready_.empty()) {
+        *batch = std::move(ready_.front());
+        ready_.pop_front();
+        return arrow::Status::OK();
+      }
+
+      ARROW_RETURN_NOT_OK(scheduleTasks());
+      if (consumed_ == scheduled_) {
+        *batch = nullptr;  // end of stream.
+        return arrow::Status::OK();
+      }
+
+      std::unique_lock<std::mutex> lock(state_->mutex);
+      state_->changed.wait(lock, [this]() { return nextProduced() != state_->produced.end(); });
+      auto it = nextProduced();
+      bool passed = it->first.first < stream_;
+      auto result = std::move(it->second);
+      state_->produced.erase(it);
+      lock.unlock();
+      consumed_++;
+
+      // the tasks scheduled past the end of a stream have nothing to return.
+      if (preserve_order_ && passed) { continue; }
+      position_++;
+
+      ARROW_ASSIGN_OR_RAISE(auto batches, std::move(result));
+      if (preserve_order_ && !batches.empty() && batches.back() == nullptr) {
+        stream_++;
+        position_ = 0;
+      }
+      for (auto& produced_batch : batches) {
+        if (produced_batch == nullptr || produced_batch->num_rows() == 0) { continue; }
+        ready_.push_back(std::move(produced_batch));
+      }
+    }
+  }
+
+ protected:
+  // A task producing the next batches of the input. It can outlive the reader so it must not refer to it.
+  using Task = std::function<arrow::Result<arrow::RecordBatchVector>()>;
+
+  // create the task producing the next batches of the input, an empty task at the end of the input.
+  virtual arrow::Result<Task> nextTask() = 0;
+
+  // get the stream of the task just created by nextTask, the streams are numbered from 0 in their order without gaps.
+  // The input is a single stream by default.
+  virtual int64_t taskStream() { return 0; }
+
+  // get the maximum number of tasks in flight.
+  int64_t readAhead() const { return read_ahead_; }
+
+ private:
+  // The place of a task in the input, its stream and its position within the stream.
+  using Rank = std::pair<int64_t, int64_t>;
+
+  // The batches produced by the thread pool, by rank in the input. Shared with the tasks.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<Rank, arrow::Result<arrow::RecordBatchVector>> produced;
+  };
+
+  // get the produced batches to return next, the end of the produced batches if they aren't produced yet. When the
+  // order is preserved, those of the task at the current rank or of a task past the end of a stream already returned.
+  // Called with the state mutex held.
+  std::map<Rank, arrow::Result<arrow::RecordBatchVector>>::iterator nextProduced() {
+    auto it = state_->produced.begin();
+    if (!preserve_order_ || it == state_->produced.end() || it->first.first < stream_) { return it; }
+    return state_->produced.find({ stream_, position_ });
+  }
+
+  // create the next tasks and submit them to the thread pool, until read_ahead tasks are in flight.
+  arrow::Status scheduleTasks() {
+    while (!exhausted_ && scheduled_ - consumed_ < read_ahead_) {
+      ARROW_ASSIGN_OR_RAISE(auto task, nextTask());
+      if (!task) {
+        exhausted_ = true;
+        break;
+      }
+
+      auto stream = taskStream();
+      Rank rank(stream, stream_tasks_[stream]++);
+      scheduled_++;
+      auto state = state_;
+      thread_pool_->Submit([state, rank, task = std::move(task)]() {
+        auto result = task();
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->produced.emplace(rank, std::move(result));
+        state->changed.notify_all();
+      });
+    }
+    return arrow::Status::OK();
+  }
+
+  std::shared_ptr<arrow::Schema> schema_;
+  int64_t read_ahead_;
+  bool preserve_order_;
+  bool exhausted_{ false };
+
+  // the number of tasks submitted to the thread pool and of those whose batches were taken by the consumer.
+  int64_t scheduled_{ 0 };
+  int64_t consumed_{ 0 };
+  // the number of tasks submitted for each stream.
+  std::map<int64_t, int64_t> stream_tasks_;
+  // the rank of the next task whose batches are returned when the order is preserved.
+  int64_t stream_{ 0 };
+  int64_t position_{ 0 };
+  // the batches of the last task taken, not returned yet.
+  std::deque<std::shared_ptr<arrow::RecordBatch>> ready_;
+
+  std::shared_ptr<State> state_;
+  // declared last so that it is destroyed first, running the pending tasks before the rest of the reader goes away.
+  std::shared_ptr<ThreadPool> thread_pool_;
+};
+
+/**
+ * @brief Parse the blocks of a csv file in parallel on a thread pool.
+ *
+ * The file is read sequentially on the consuming thread, cut into blocks ending at the end of their last record, which
+ * the thread pool parses. The newlines within quoted values don't end a record, so a block never starts within a
+ * quoted value. The blocks are extended up to MAX_CSV_BLOCK_SIZE bytes to hold a whole record.
+ */
+class ParallelCsvReader : public ParallelBatchReader {
+ public:
+  ParallelCsvReader(
+      std::shared_ptr<arrow::io::RandomAccessFile> file,
+      int64_t offset,
+      int64_t file_size,
+      std::shared_ptr<arrow::Schema> file_schema,
+      std::vector<std::string> projection,
+      std::shared_ptr<arrow::Schema> schema,
+      CsvReadOptions options)
+      : ParallelBatchReader(schema, options.num_threads, options.read_ahead, options.preserve_order),
+        file_{ std::move(file) },
+        offset_{ offset },
+        file_size_{ file_size },
+        file_schema_{ std::move(file_schema) },
+        projection_{ std::move(projection) },
+        schema_{ std::move(schema) },
+        block_size_{ options.block_size } { }
+
+ protected:
+  arrow::Result<Task> nextTask() override {
+    while (offset_ < file_size_) {
+      ARROW_ASSIGN_OR_RAISE(auto block, ReadWholeLines(file_, offset_, block_size_, file_size_));
+      offset_ += block->size();
+
+      auto data = std::string_view(reinterpret_cast<const char*>(block->data()), block->size());
+      if (data.find_first_not_of("\r\n") == std::string_view::npos) { continue; }  // blank lines only.
+
+      return Task([block, file_schema = file_schema_, projection = projection_, schema = schema_]()
+                      -> arrow::Result<arrow::RecordBatchVector> {
+        ARROW_ASSIGN_OR_RAISE(auto batch, ParseCsvBlock(block, file_schema, projection, schema));
+        return arrow::RecordBatchVector{ batch };
+      });
+    }
+    return Task();
+  }
+
+ private:
+  std::shared_ptr<arrow::io::RandomAccessFile> file_;
+  int64_t offset_;
+  int64_t file_size_;
+  std::shared_ptr<arrow::Schema> file_schema_;
+  std::vector<std::string> projection_;
+  std::shared_ptr<arrow::Schema> schema_;
+  int64_t block_size_;
+};
+
+/**
+ * @brief Collect the indices of the leaf columns of a field of a parquet file.
+ */
+void CollectColumnIndices(const parquet::arrow::SchemaField& field, std::vector<int>& column_indices) {
+  if (field.column_index >= 0) { column_indices.push_back(field.column_index); }
+  for (const auto& child : field.children) { CollectColumnIndices(child, column_indices); }
+}
+
+/**
+ * @brief Open a reader over a parquet file, reusing its footer if it was already read.
+ */
+arrow::Result<std::unique_ptr<parquet::arrow::FileReader>> OpenParquetReader(
+    std::shared_ptr<arrow::io::RandomAccessFile> file,
+    std::shared_ptr<parquet::FileMetaData> metadata) {
+  parquet::arrow::FileReaderBuilder builder;
+  ARROW_RETURN_NOT_OK(builder.Open(file, parquet::default_reader_properties(), metadata));
+
+  std::unique_ptr<parquet::arrow::FileReader> reader;
+  ARROW_RETURN_NOT_OK(builder.Build(&reader));
+  return reader;
+}
+
+/**
+ * @brief Select the rows of a column satisfying a predicate, clearing the others in the selection.
+ *
+ * A null value never satisfies the predicate. The rows whose value can't be compared with the literal stay selected.
+ */
+void SelectRows(const ColumnPredicate& predicate, const arrow::Array& column, std::vector<bool>& selection) {
+  auto satisfies = [&predicate](int comparison) {
+    switch (predicate.op) {
+      case ColumnPredicate::Op::Eq: return comparison == 0;
+      case ColumnPredicate::Op::Neq: return comparison != 0;
+      case ColumnPredicate::Op::Lt: return comparison < 0;
+      case ColumnPredicate::Op::LtEq: return comparison <= 0;
+      case ColumnPredicate::Op::Gt: return comparison > 0;
+      case ColumnPredicate::Op::GtEq: return comparison >= 0;
+    }
+    return true;
+  };
+
+  // the values are compared in place when the literal has the type of the column, else boxed into scalars.
+  std::shared_ptr<arrow::Array> literal;
+  if (predicate.value->is_valid && predicate.value->type->Equals(column.type())) {
+    auto maybe_literal = arrow::MakeArrayFromScalar(*predicate.value, 1);
+    if (maybe_literal.ok()) { literal = *maybe_literal; }
+  }
+  bool comparable_in_place = literal != nullptr && (column.type_id() == arrow::Type::BOOL ||
+                                                    column.type_id() == arrow::Type::INT64 ||
+                                                    column.type_id() == arrow::Type::DOUBLE ||
+                                                    column.type_id() == arrow::Type::STRING);
+
+  for (int64_t row = 0; row < column.length(); row++) {
+    if (!selection[row]) { continue; }
+    if (column.IsNull(row)) {
+      selection[row] = false;
+      continue;
+    }
+
+    if (comparable_in_place) {
+      selection[row] = satisfies(CompareArrayValues(column, row, *literal, 0));
+      continue;
+    }
+    auto value = column.GetScalar(row);
+    if (!value.ok()) { continue; }
+    auto comparison = CompareScalars(**value, *predicate.value);
+    if (comparison.has_value()) { selection[row] = satisfies(*comparison); }
+  }
+}
+
+/**
+ * @brief Decode the given row groups of a parquet file in parallel on a thread pool, one batch per row group.
+ *
+ * Each task opens its own reader over the shared file and footer, reading the column chunks of the projected columns
+ * of its row group only. With late materialization, the columns of the filter are decoded first. The other columns are
+ * then decoded in slices of slice_size rows up to the last row satisfying the filter, and only the rows satisfying it
+ * are returned, one batch per slice holding some.
+ */
+class ParquetRowGroupReader : public ParallelBatchReader {
+ public:
+  ParquetRowGroupReader(
+      std::shared_ptr<arrow::io::RandomAccessFile> file,
+      std::shared_ptr<parquet::FileMetaData> metadata,
+      std::vector<int> row_groups,
+      std::vector<int> column_indices,
+      std::vector<ColumnPredicate> filter,
+      std::vector<int> filter_column_indices,
+      std::shared_ptr<arrow::Schema> schema,
+      int num_threads,
+      ParquetReadOptions options)
+      : ParallelBatchReader(schema, num_threads, options.read_ahead, options.preserve_order),
+        file_{ std::move(file) },
+        metadata_{ std::move(metadata) },
+        row_groups_{ std::move(row_groups) },
+        column_indices_{ std::move(column_indices) },
+        filter_{ std::move(filter) },
+        filter_column_indices_{ std::move(filter_column_indices) },
+        schema_{ std::move(schema) },
+        slice_size_{ std::max<int64_t>(options.slice_size, 1) } { }
+
+ protected:
+  arrow::Result<Task> nextTask() override {
+    if (next_row_group_ >= row_groups_.size()) { return Task(); }
+
+    auto row_group = row_groups_[next_row_group_++];
+    return Task([file = file_,
+                 metadata = metadata_,
+                 column_indices = column_indices_,
+                 filter = filter_,
+                 filter_column_indices = filter_column_indices_,
+                 schema = schema_,
+                 slice_size = slice_size_,
+                 row_group]() -> arrow::Result<arrow::RecordBatchVector> {
+      ARROW_ASSIGN_OR_RAISE(auto reader, OpenParquetReader(file, metadata));
+
+      if (filter.empty()) {
+        std::shared_ptr<arrow::Table> table;
+        ARROW_RETURN_NOT_OK(reader->ReadRowGroup(row_group, column_indices, &table));
+        if (table->num_rows() == 0) { return arrow::RecordBatchVector{}; }
+        ARROW_ASSIGN_OR_RAISE(table, table->CombineChunks());
+
+        // the columns are read in file order, they are returned in projection order.
+        std::vector<std::shared_ptr<arrow::Array>> columns;
+        for (const auto& field : schema->fields()) { columns.push_back(table->GetColumnByName(field->name())->chunk(0)); }
+        return arrow::RecordBatchVector{ arrow::RecordBatch::Make(schema, table->num_rows(), columns) };
+      }
+
+      // select the rows satisfying the filter from its columns.
+      std::shared_ptr<arrow::Table> filter_table;
+      ARROW_RETURN_NOT_OK(reader->ReadRowGroup(row_group, filter_column_indices, &filter_table));
+      if (filter_table->num_rows() == 0) { return arrow::RecordBatchVector{}; }
+      ARROW_ASSIGN_OR_RAISE(filter_table, filter_table->CombineChunks());
+
+      std::vector<bool> selection(filter_table->num_rows(), true);
+      for (const auto& predicate : filter) {
+        SelectRows(predicate, *filter_table->GetColumnByName(predicate.column)->chunk(0), selection);
+      }
+      std::vector<int64_t> selected_rows;
+      for (int64_t row = 0; row < static_cast<int64_t>(selection.size()); row++) {
+        if (selection[row]) { selected_rows.push_back(row); }
+      }
+      if (selected_rows.empty()) { return arrow::RecordBatchVector{}; }
+
+      // the columns of the filter aren't decoded twice.
+      std::vector<int> remaining_column_indices;
+      for (auto column_idx : column_indices) {
+        if (std::find(filter_column_indices.begin(), filter_column_indices.end(), column_idx) ==
+            filter_column_indices.end()) {
+          remaining_column_indices.push_back(column_idx);
+        }
+      }
+
+      // the batch of the given rows of the slice [offset, offset + length) of the row group, in projection order.
+      auto make_batch = [&schema, &filter_table](
+                            const std::shared_ptr<arrow::RecordBatch>& slice,
+                            int64_t offset,
+                            int64_t length,
+                            const std::vector<int64_t>& rows) -> arrow::Result<std::shared_ptr<arrow::RecordBatch>> {
+        std::vector<std::shared_ptr<arrow::Array>> columns;
+        for (const auto& field : schema->fields()) {
+          auto column = slice != nullptr ? slice->GetColumnByName(field->name()) : nullptr;
+          if (column == nullptr) { column = filter_table->GetColumnByName(field->name())->chunk(0)->Slice(offset, length); }
+          columns.push_back(column);
+        }
+        auto batch = arrow::RecordBatch::Make(schema, length, columns);
+        if (static_cast<int64_t>(rows.size()) == length) { return batch; }
+
+        auto selected_batch = TakeRecordBatch(batch, rows);
+        if (!selected_batch.ok()) { return arrow::Status::Invalid(selected_batch.status().message()); }
+        return *selected_batch;
+      };
+
+      if (remaining_column_indices.empty()) {
+        ARROW_ASSIGN_OR_RAISE(auto batch, make_batch(nullptr, 0, filter_table->num_rows(), selected_rows));
+        return arrow::RecordBatchVector{ batch };
+      }
+
+      // the other columns are decoded a slice at a time, the slices without selected rows being dropped as soon as
+      // they are decoded. The slices after the last selected row aren't decoded.
+      reader->set_batch_size(slice_size);
+      std::unique_ptr<arrow::RecordBatchReader> slices;
+      ARROW_RETURN_NOT_OK(reader->GetRecordBatchReader({ row_group }, remaining_column_indices, &slices));
+
+      arrow::RecordBatchVector batches;
+      int64_t offset = 0;
+      auto next_selected_row = selected_rows.begin();
+      while (next_selected_row != selected_rows.end()) {
+        std::shared_ptr<arrow::RecordBatch> slice;
+        ARROW_RETURN_NOT_OK(slices->ReadNext(&slice));
+        if (slice == nullptr) { break; }
+
+        std::vector<int64_t> rows;
+        for (; next_selected_row != selected_rows.end() && *next_selected_row < offset + slice->num_rows();
+             next_selected_row++) {
+          rows.push_back(*next_selected_row - offset);
+        }
+        if (!rows.empty()) {
+          ARROW_ASSIGN_OR_RAISE(auto batch, make_batch(slice, offset, slice->num_rows(), rows));
+          batches.push_back(batch);
+        }
+        offset += slice->num_rows();
+      }
+      return batches;
+    });
+  }
+
+ private:
+  std::shared_ptr<arrow::io::RandomAccessFile> file_;
+  std::shared_ptr<parquet::FileMetaData> metadata_;
+  // the row groups to read, in file order.
+  std::vector<int> row_groups_;
+  std::vector<int> column_indices_;
+  // the filter evaluated on the rows with late materialization, empty otherwise, and the columns it reads.
+  std::vector<ColumnPredicate> filter_;
+  std::vector<int> filter_column_indices_;
+  std::shared_ptr<arrow::Schema> schema_;
+  int64_t slice_size_;
+  size_t next_row_group_{ 0 };
+};
+
+/**
+ * @brief Read the record batches of an arrow ipc file one at a time, keeping the projected columns only.
+ */
+class IpcBatchReader : public arrow::RecordBatchReader {
+ public:
+  IpcBatchReader(std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader, std::shared_ptr<arrow::Schema> schema)
+      : reader_{ std::move(reader) },
+        schema_{ std::move(schema) } { }
+
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch>* batch) override {
+    if (next_batch_ >= reader_->num_record_batches()) {
+      *batch = nullptr;  // end of stream.
+      return arrow::Status::OK();
+    }
+
+    // the batch holds the included fields in file order, the columns are slices of the mapping put in projection order.
+    ARROW_ASSIGN_OR_RAISE(auto file_batch, reader_->ReadRecordBatch(next_batch_++));
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    for (const auto& field : schema_->fields()) { columns.push_back(file_batch->GetColumnByName(field->name())); }
+    *batch = arrow::RecordBatch::Make(schema_, file_batch->num_rows(), columns);
+    return arrow::Status::OK();
+  }
+
+ private:
+  std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader_;
+  std::shared_ptr<arrow::Schema> schema_;
+  int next_batch_{ 0 };
+};
+
+// the value of a partition directory holding the rows with a null partition value.
+const std::string HIVE_DEFAULT_PARTITION = "__HIVE_DEFAULT_PARTITION__";
+
+/**
+ * @brief Create the data source reading a file of a dataset, from the extension of the file.
+ *
+ * @param file_schema: the schema of the files of the dataset, applied to the csv files. Inferred if null.
+ */
+absl::StatusOr<std::shared_ptr<DataSource>> OpenDatasetFile(
+    const std::string& path,
+    int batch_size,
+    std::shared_ptr<arrow::Schema> file_schema) {
+  // the csv files can be compressed, e.g. part-0.csv.gz.
+  std::filesystem::path file_path(path);
+  auto extension = file_path.extension().string();
+  if (extension == ".gz" || extension == ".zst" || extension == ".lz4") {
+    extension = file_path.stem().extension().string();
+  }
+  if (extension == ".csv") { return std::make_shared<CsvDataSource>(path, batch_size, file_schema); }
+  if (extension == ".parquet") {
+    // the files are already read concurrently, their row groups are decoded one at a time.
+    ParquetReadOptions options;
+    options.num_threads = 1;
+    return std::make_shared<ParquetDataSource>(path, batch_size, options);
+  }
+  if (extension == ".arrow" || extension == ".feather" || extension == ".ipc") {
+    return std::make_shared<IpcDataSource>(path);
+  }
+  return absl::InvalidArgumentError(fmt::format("The format of the dataset file {} isn't supported.", path));
+}
+
+/**
+ * @brief Read the files of a dataset concurrently on a thread pool, adding the partition columns to their batches.
+ *
+ * Up to max_files_in_flight files are open at once. Each task reads the next few batches of one of them, so that the
+ * memory of the scan is bounded by the tasks in flight rather than by the size of the files. If the order of the files
+ * is preserved, each file is a stream of the reader whose batches are returned once the files before it are.
+ */
+class DatasetReader : public ParallelBatchReader {
+ public:
+  DatasetReader(
+      std::vector<DatasetFile> files,
+      std::shared_ptr<arrow::Schema> file_schema,
+      std::shared_ptr<arrow::Schema> partition_schema,
+      std::vector<std::string> file_projection,
+      std::vector<ColumnPredicate> file_filter,
+      std::shared_ptr<arrow::Schema> schema,
+      int batch_size,
+      DatasetOptions options)
+      : ParallelBatchReader(schema, options.max_files_in_flight, options.max_files_in_flight, options.preserve_order),
+        files_{ std::move(files) },
+        file_schema_{ std::move(file_schema) },
+        partition_schema_{ std::move(partition_schema) },
+        file_projection_{ std::move(file_projection) },
+        file_filter_{ std::move(file_filter) },
+        schema_{ std::move(schema) },
+        batch_size_{ batch_size },
+        max_open_files_{ static_cast<size_t>(std::max(options.max_files_in_flight, 1)) },
+        preserve_order_{ options.preserve_order } { }
+
+ protected:
+  arrow::Result<Task> nextTask() override {
+    // the files read to the end give their slot to the next files. When the order is preserved, only once the files
+    // before them are read to the end as well since their batches are held until then.
+    auto finished_end = open_files_.end();
+    if (preserve_order_) {
+      finished_end = std::find_if(
+          open_files_.begin(), open_files_.end(), [](const auto& open_file) { return !open_file->finished.load(); });
+    }
+    open_files_.erase(
+        std::remove_if(
+            open_files_.begin(), finished_end, [](const auto& open_file) { return open_file->finished.load(); }),
+        finished_end);
+    while (open_files_.size() < max_open_files_ && next_file_ < files_.size()) {
+      auto open_file = std::make_shared<OpenFile>();
+      open_file->index = next_file_;
+      open_file->file = files_[next_file_++];
+      open_files_.push_back(std::move(open_file));
+    }
+    if (open_files_.empty()) { return Task(); }
+
+    // the held tasks of the files after the first one take all the tasks in flight but one at most, so that the first
+    // file always gets to make progress.
+    auto open_file = open_files_[next_open_file_++ % open_files_.size()];
+    if (preserve_order_ && open_file != open_files_[0]) {
+      int64_t held_tasks = 0;
+      for (size_t i = 1; i < open_files_.size(); i++) { held_tasks += open_files_[i]->next_group; }
+      if (held_tasks >= readAhead() - 1) { open_file = open_files_[0]; }
+    }
+    task_stream_ = open_file->index;
+
+    return Task([open_file,
+                 group = open_file->next_group++,
+                 file_schema = file_schema_,
+                 partition_schema = partition_schema_,
+                 file_projection = file_projection_,
+                 file_filter = file_filter_,
+                 schema = schema_,
+                 batch_size = batch_size_]() -> arrow::Result<arrow::RecordBatchVector> {
+      std::lock_guard<std::mutex> lock(open_file->mutex);
+      if (open_file->reader == nullptr && !open_file->finished) {
+        auto source = OpenDatasetFile(open_file->file.path, batch_size, file_schema);
+        if (!source.ok()) {
+          open_file->finished = true;
+          return arrow::Status::Invalid(std::string(source.status().message()));
+        }
+        auto reader = (*source)->Scan(file_projection, file_filter);
+        if (!reader.ok()) {
+          open_file->finished = true;
+          return arrow::Status::IOError(std::string(reader.status().message()));
+        }
+        open_file->reader = *reader;
+      }
+
+      // the tasks of a file can run in any order, each of them takes the group of batches of its rank in the file. The
+      // groups of the tasks which haven't run yet are kept for them.
+      while (open_file->groups_read <= group && !open_file->finished) {
+        arrow::RecordBatchVector batches;
+        while (batches.size() < DATASET_BATCHES_PER_TASK) {
+          std::shared_ptr<arrow::RecordBatch> file_batch;
+          auto status = open_file->reader->ReadNext(&file_batch);
+          if (!status.ok()) {
+            open_file->finished = true;
+            return status;
+          }
+          if (file_batch == nullptr) {
+            open_file->finished = true;
+            open_file->at_end = true;
+            open_file->reader = nullptr;
+            break;
+          }
+
+          // the partition columns are constant over the file.
+          std::vector<std::shared_ptr<arrow::Array>> columns;
+          for (const auto& field : schema->fields()) {
+            auto partition_idx = partition_schema->GetFieldIndex(field->name());
+            if (partition_idx < 0) {
+              columns.push_back(file_batch->GetColumnByName(field->name()));
+              continue;
+            }
+            ARROW_ASSIGN_OR_RAISE(
+                auto column,
+                arrow::MakeArrayFromScalar(*open_file->file.partition_values[partition_idx], file_batch->num_rows()));
+            columns.push_back(column);
+          }
+          batches.push_back(arrow::RecordBatch::Make(schema, file_batch->num_rows(), columns));
+        }
+        open_file->groups.emplace(open_file->groups_read++, std::move(batches));
+      }
+
+      // the tasks past the end of the file have nothing to return, the one of the last group ends the file.
+      auto it = open_file->groups.find(group);
+      if (it == open_file->groups.end()) { return arrow::RecordBatchVector{}; }
+      auto batches = std::move(it->second);
+      open_file->groups.erase(it);
+      if (open_file->at_end && group == open_file->groups_read - 1) { batches.push_back(nullptr); }
+      return batches;
+    });
+  }
+
+  int64_t taskStream() override { return task_stream_; }
+
+ private:
+  // A file being read by the tasks, shared with them.
+  struct OpenFile {
+    // the index of the file in the dataset, the stream of its tasks.
+    size_t index{ 0 };
+    DatasetFile file;
+    // the number of tasks created for the file, on the consuming thread.
+    int64_t next_group{ 0 };
+    // set once the file is read to the end or failed, no more tasks are created for it.
+    std::atomic<bool> finished{ false };
 
-  ASSIGN_OR_RETURN(auto table, ReadFile({}));
-  schema_ = table->schema();
+    std::mutex mutex;
+    // opened by the first task running, closed at the end of the file.
+    std::shared_ptr<arrow::RecordBatchReader> reader;
+    int64_t groups_read{ 0 };
+    // set once the file is read to the end without failing.
+    bool at_end{ false };
+    // the groups of batches read but not taken yet by their task.
+    std::map<int64_t, arrow::RecordBatchVector> groups;
+  };
+
+  std::vector<DatasetFile> files_;
+  std::shared_ptr<arrow::Schema> file_schema_;
+  std::shared_ptr<arrow::Schema> partition_schema_;
+  std::vector<std::string> file_projection_;
+  std::vector<ColumnPredicate> file_filter_;
+  std::shared_ptr<arrow::Schema> schema_;
+  int batch_size_;
+  size_t max_open_files_;
+  bool preserve_order_;
+  size_t next_file_{ 0 };
+
+  std::vector<std::shared_ptr<OpenFile>> open_files_;
+  size_t next_open_file_{ 0 };
+  int64_t task_stream_{ 0 };
+};
+
+/**
+ * @brief Get the type of a partition column from its values: int64 or double if they all parse as such, else string.
+ */
+std::shared_ptr<arrow::DataType> PartitionType(const std::vector<std::optional<std::string>>& values) {
+  bool all_integers = true, all_numbers = true;
+  for (const auto& value : values) {
+    if (!value.has_value()) { continue; }
+
+    int64_t integer;
+    auto [integer_end, ec] = std::from_chars(value->data(), value->data() + value->size(), integer);
+    all_integers &= !value->empty() && ec == std::errc() && integer_end == value->data() + value->size();
+
+    char* number_end = nullptr;
+    std::strtod(value->c_str(), &number_end);
+    all_numbers &= !value->empty() && number_end == value->c_str() + value->size();
+  }
+
+  if (all_integers) { return arrow::int64(); }
+  if (all_numbers) { return arrow::float64(); }
+  return arrow::utf8();
+}
+
+/**
+ * @brief Get the scalar of a partition value of the given type, null for a missing value.
+ */
+std::shared_ptr<arrow::Scalar> PartitionValue(
+    const std::optional<std::string>& value,
+    const std::shared_ptr<arrow::DataType>& type) {
+  if (!value.has_value()) { return arrow::MakeNullScalar(type); }
+  switch (type->id()) {
+    case arrow::Type::INT64: return std::make_shared<arrow::Int64Scalar>(std::stoll(*value));
+    case arrow::Type::DOUBLE: return std::make_shared<arrow::DoubleScalar>(std::strtod(value->c_str(), nullptr));
+    default: return std::make_shared<arrow::StringScalar>(*value);
+  }
+}
+
+}  // namespace
+
+bool ColumnPredicate::MayMatch(const std::shared_ptr<arrow::Scalar>& min, const std::shared_ptr<arrow::Scalar>& max)
+    const {
+  // unknown bounds and values which aren't comparable with them can't prune anything.
+  std::optional<int> min_cmp, max_cmp;
+  if (min != nullptr) { min_cmp = CompareScalars(*min, *value); }
+  if (max != nullptr) { max_cmp = CompareScalars(*max, *value); }
+
+  switch (op) {
+    case Op::Eq: return (!min_cmp.has_value() || *min_cmp <= 0) && (!max_cmp.has_value() || *max_cmp >= 0);
+    case Op::Neq: return !min_cmp.has_value() || !max_cmp.has_value() || *min_cmp != 0 || *max_cmp != 0;
+    case Op::Lt: return !min_cmp.has_value() || *min_cmp < 0;
+    case Op::LtEq: return !min_cmp.has_value() || *min_cmp <= 0;
+    case Op::Gt: return !max_cmp.has_value() || *max_cmp > 0;
+    case Op::GtEq: return !max_cmp.has_value() || *max_cmp >= 0;
+  }
+  return true;
+}
+
+std::string ColumnPredicate::ToString() const {
+  static const char* ops[] = { "=", "!=", "<", "<=", ">", ">=" };
+  return column + " " + ops[static_cast<int>(op)] + " " + value->ToString();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> CsvDataSource::Schema() {
+  if (schema_ == nullptr) { ASSIGN_OR_RETURN(schema_, inferSchema()); }
   return schema_;
 }
 
-absl::StatusOr<std::shared_ptr<arrow::TableBatchReader>> CsvDataSource::Scan(std::vector<std::string> projection) {
-  ASSIGN_OR_RETURN(auto table, ReadFile(projection));
-  return std::make_shared<arrow::TableBatchReader>(table.operator*());
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> CsvDataSource::Scan(std::vector<std::string> projection) {
+  std::shared_ptr<arrow::RecordBatchReader> reader;
+  if (options_.num_threads > 1) {
+    ASSIGN_OR_RETURN(reader, openParallelReader(projection));
+  } else {
+    ASSIGN_OR_RETURN(reader, openReader(projection));
+  }
+  return std::make_shared<BatchSizeReader>(reader, batch_size_);
 }
 
-absl::StatusOr<std::shared_ptr<arrow::Table>> CsvDataSource::ReadFile(std::vector<std::string> projection) {
-  std::cout << "readFile start for filename_" << filename_ << std::endl;
+absl::StatusOr<std::shared_ptr<arrow::Schema>> CsvDataSource::inferSchema() {
+  ASSIGN_OR_RETURN(auto input, openInput());
+
+  // only the sample is read and parsed, whatever the size of the file.
+  auto maybe_sample = ReadLeadingLines(input, options_.schema_sample_size);
+  if (!maybe_sample.ok()) { return absl::InternalError(GetMessageFromResult(maybe_sample)); }
 
+  auto read_options = arrow::csv::ReadOptions::Defaults();
+  read_options.use_threads = false;
+  // the sample is at most MAX_CSV_BLOCK_SIZE bytes, it is parsed as a single block.
+  read_options.block_size = static_cast<int32_t>((*maybe_sample)->size() + 1);
+
+  auto maybe_reader = arrow::csv::StreamingReader::Make(
+      arrow::io::default_io_context(),
+      std::make_shared<arrow::io::BufferReader>(*maybe_sample),
+      read_options,
+      CsvParseOptions(),
+      arrow::csv::ConvertOptions::Defaults());
+  if (!maybe_reader.ok()) { return absl::InternalError(GetMessageFromResult(maybe_reader)); }
+  return (*maybe_reader)->schema();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> CsvDataSource::openReader(
+    std::vector<std::string> projection) {
   arrow::io::IOContext io_context = arrow::io::default_io_context();
+  ASSIGN_OR_RETURN(auto input, openInput());
+
+  ASSIGN_OR_RETURN(auto schema, Schema());
+
+  auto read_options = arrow::csv::ReadOptions::Defaults();
+  read_options.use_threads = false;
+  read_options.block_size = options_.block_size;
+  auto parse_options = CsvParseOptions();
+  auto convert_options = CsvConvertOptions(schema, projection);
+
+  // unlike the table reader, the streaming reader only parses the next block of the file when a batch is pulled. The
+  // consumer can stop the scan at any point, e.g. once a LIMIT is satisfied, without paying for the rest of the file,
+  // and the memory of the scan is bounded by a few blocks whatever the size of the file.
+  auto maybe_reader =
+      arrow::csv::StreamingReader::Make(io_context, input, read_options, parse_options, convert_options);
+  if (!maybe_reader.ok()) { return absl::InternalError(GetMessageFromResult(maybe_reader)); }
+  return std::static_pointer_cast<arrow::RecordBatchReader>(*maybe_reader);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> CsvDataSource::openParallelReader(
+    std::vector<std::string> projection) {
+  ASSIGN_OR_RETURN(auto file_schema, Schema());
+  auto schema = file_schema;
+  if (!projection.empty()) { ASSIGN_OR_RETURN(schema, FilterSchema(file_schema, projection)); }
+
   auto maybe_input = arrow::io::ReadableFile::Open(filename_);
   if (!maybe_input.ok()) { return absl::InternalError(GetMessageFromResult(maybe_input)); }
+  auto maybe_size = (*maybe_input)->GetSize();
+  if (!maybe_size.ok()) { return absl::InternalError(GetMessageFromResult(maybe_size)); }
+
+  // the blocks of a compressed file can't be cut without decompressing it, it is parsed by the streaming reader.
+  auto maybe_magic = (*maybe_input)->ReadAt(0, std::min(BGZF_HEADER_SIZE, *maybe_size));
+  if (!maybe_magic.ok()) { return absl::InternalError(GetMessageFromResult(maybe_magic)); }
+  if (DetectCompression(*maybe_magic) != arrow::Compression::UNCOMPRESSED) { return openReader(projection); }
+
+  // the blocks start after the header line.
+  int64_t header_size = options_.block_size;
+  int64_t offset = -1;
+  while (offset < 0) {
+    auto maybe_header = (*maybe_input)->ReadAt(0, std::min(header_size, *maybe_size));
+    if (!maybe_header.ok()) { return absl::InternalError(GetMessageFromResult(maybe_header)); }
+
+    auto header = std::string_view(reinterpret_cast<const char*>((*maybe_header)->data()), (*maybe_header)->size());
+    auto header_end = FindRecordEnd(header, false);
+    if (header_end != std::string_view::npos) {
+      offset = static_cast<int64_t>(header_end) + 1;
+    } else if ((*maybe_header)->size() == *maybe_size) {
+      offset = *maybe_size;  // the file has no row.
+    }
+    header_size *= 2;
+  }
+
+  return std::make_shared<ParallelCsvReader>(
+      *maybe_input, offset, *maybe_size, file_schema, projection, schema, options_);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::io::InputStream>> CsvDataSource::openInput() {
+  auto maybe_file = arrow::io::ReadableFile::Open(filename_);
+  if (!maybe_file.ok()) { return absl::InternalError(GetMessageFromResult(maybe_file)); }
+  std::shared_ptr<arrow::io::RandomAccessFile> file = *maybe_file;
+  auto maybe_size = file->GetSize();
+  if (!maybe_size.ok()) { return absl::InternalError(GetMessageFromResult(maybe_size)); }
+
+  auto maybe_magic = file->ReadAt(0, std::min(BGZF_HEADER_SIZE, *maybe_size));
+  if (!maybe_magic.ok()) { return absl::InternalError(GetMessageFromResult(maybe_magic)); }
+  auto compression = DetectCompression(*maybe_magic);
+  if (compression == arrow::Compression::UNCOMPRESSED) { return std::static_pointer_cast<arrow::io::InputStream>(file); }
+  if (!arrow::util::Codec::IsAvailable(compression)) {
+    return absl::InvalidArgumentError(fmt::format(
+        "The csv file {} is {} compressed, which arrow was built without.",
+        filename_,
+        arrow::util::Codec::GetCodecAsString(compression)));
+  }
+
+  // the blocks of a bgzf file are independent gzip members, decompressed in parallel.
+  if (compression == arrow::Compression::GZIP && BgzfBlockSize(*maybe_magic).ok()) {
+    int num_threads = options_.decompression_threads > 0 ? options_.decompression_threads
+                                                         : static_cast<int>(std::thread::hardware_concurrency());
+    return std::make_shared<ReadaheadInputStream>(BgzfTasks(file, *maybe_size), num_threads, 2 * num_threads);
+  }
+
+  // the other files are decompressed on a thread of their own, a block ahead of the parser.
+  auto maybe_codec = arrow::util::Codec::Create(compression);
+  if (!maybe_codec.ok()) { return absl::InternalError(GetMessageFromResult(maybe_codec)); }
+  return std::make_shared<ReadaheadInputStream>(
+      StreamTasks(std::move(*maybe_codec), file, options_.block_size), 1, 2);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Table>> CsvDataSource::ReadFile(std::vector<std::string> projection) {
+  std::cout << "readFile start for filename_" << filename_ << std::endl;
+
+  arrow::io::IOContext io_context = arrow::io::default_io_context();
+  ASSIGN_OR_RETURN(auto input, openInput());
 
   auto read_options = arrow::csv::ReadOptions::Defaults();
-  auto parse_options = arrow::csv::ParseOptions::Defaults();
+  auto parse_options = CsvParseOptions();
 
-  // Apply projection if required.
-  auto convert_options = arrow::csv::ConvertOptions::Defaults();
-  if (!projection.empty()) { convert_options.include_columns = projection; }
+  // Apply projection if required. The types of the provided schema are applied rather than inferred.
+  auto convert_options = CsvConvertOptions(schema_ != nullptr ? schema_ : arrow::schema({}), projection);
 
   // Instantiate TableReader from input stream and options
-  auto maybe_reader = arrow::csv::TableReader::Make(io_context, *maybe_input, read_options, parse_options, convert_options);
+  auto maybe_reader = arrow::csv::TableReader::Make(io_context, input, read_options, parse_options, convert_options);
   if (!maybe_reader.ok()) { return absl::InternalError(GetMessageFromResult(maybe_reader)); }
 
   std::cout << "readFile: reading table from csv file..." << std::endl;
@@ -56,13 +1354,407 @@ absl::StatusOr<std::shared_ptr<arrow::Table>> CsvDataSource::ReadFile(std::vecto
 CsvDataSource::CsvDataSource(std::string filename, int batch_size) : CsvDataSource(filename, batch_size, nullptr) { }
 
 CsvDataSource::CsvDataSource(std::string filename, int batch_size, std::shared_ptr<arrow::Schema> schema)
+    : CsvDataSource(filename, batch_size, schema, CsvReadOptions()) { }
+
+CsvDataSource::CsvDataSource(
+    std::string filename,
+    int batch_size,
+    std::shared_ptr<arrow::Schema> schema,
+    CsvReadOptions options)
     : DataSource(),
       filename_{ filename },
       batch_size_{ batch_size },
-      schema_{ schema } { }
+      schema_{ schema },
+      options_{ options } { }
 
 CsvDataSource::~CsvDataSource() { }
 
+absl::StatusOr<std::shared_ptr<arrow::Schema>> ParquetDataSource::Schema() {
+  CHECK_OK_OR_RETURN(open());
+  return schema_;
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> ParquetDataSource::Scan(std::vector<std::string> projection) {
+  return Scan(projection, {});
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> ParquetDataSource::Scan(
+    std::vector<std::string> projection,
+    const std::vector<ColumnPredicate>& filter) {
+  CHECK_OK_OR_RETURN(open());
+
+  std::vector<int> row_groups;
+  for (int row_group = 0; row_group < metadata_->num_row_groups(); row_group++) {
+    if (!pruneRowGroup(row_group, filter)) { row_groups.push_back(row_group); }
+  }
+
+  auto schema = schema_;
+  std::vector<int> column_indices;
+  if (projection.empty()) {
+    for (const auto& field_column_indices : column_indices_) {
+      column_indices.insert(column_indices.end(), field_column_indices.begin(), field_column_indices.end());
+    }
+  } else {
+    ASSIGN_OR_RETURN(schema, FilterSchema(schema_, projection));
+    for (const auto& name : projection) {
+      const auto& field_column_indices = column_indices_[schema_->GetFieldIndex(name)];
+      column_indices.insert(column_indices.end(), field_column_indices.begin(), field_column_indices.end());
+    }
+  }
+
+  // the predicates on the top level columns are evaluated on their decoded values with late materialization.
+  std::vector<ColumnPredicate> late_filter;
+  std::vector<int> filter_column_indices;
+  if (options_.late_materialization) {
+    for (const auto& predicate : filter) {
+      auto field_idx = schema_->GetFieldIndex(predicate.column);
+      if (field_idx < 0 || schema_->field(field_idx)->type()->num_fields() > 0 || predicate.value == nullptr) {
+        continue;
+      }
+      late_filter.push_back(predicate);
+      for (auto column_idx : column_indices_[field_idx]) {
+        if (std::find(filter_column_indices.begin(), filter_column_indices.end(), column_idx) ==
+            filter_column_indices.end()) {
+          filter_column_indices.push_back(column_idx);
+        }
+      }
+    }
+  }
+
+  int num_threads =
+      options_.num_threads > 0 ? options_.num_threads : static_cast<int>(std::thread::hardware_concurrency());
+  auto reader = std::make_shared<ParquetRowGroupReader>(
+      file_, metadata_, row_groups, column_indices, late_filter, filter_column_indices, schema, num_threads, options_);
+  return std::make_shared<BatchSizeReader>(reader, batch_size_);
+}
+
+bool ParquetDataSource::pruneRowGroup(int row_group, const std::vector<ColumnPredicate>& filter) {
+  auto row_group_metadata = metadata_->RowGroup(row_group);
+  for (const auto& predicate : filter) {
+    // only the statistics of the leaf columns are known, those of nested fields can't prune.
+    auto field_idx = schema_->GetFieldIndex(predicate.column);
+    if (field_idx < 0 || column_indices_[field_idx].size() != 1) { continue; }
+
+    auto column_chunk = row_group_metadata->ColumnChunk(column_indices_[field_idx][0]);
+    auto statistics = column_chunk->statistics();
+    if (statistics == nullptr || !statistics->HasMinMax()) { continue; }
+
+    std::shared_ptr<arrow::Scalar> min, max;
+    if (!parquet::arrow::StatisticsAsScalars(*statistics, &min, &max).ok()) { continue; }
+    if (!predicate.MayMatch(min, max)) { return true; }
+  }
+  return false;
+}
+
+absl::Status ParquetDataSource::open() {
+  if (file_ != nullptr) { return absl::OkStatus(); }
+
+  auto maybe_input = arrow::io::ReadableFile::Open(filename_);
+  if (!maybe_input.ok()) { return absl::InternalError(GetMessageFromResult(maybe_input)); }
+  auto maybe_reader = OpenParquetReader(*maybe_input, nullptr);
+  if (!maybe_reader.ok()) { return absl::InternalError(GetMessageFromResult(maybe_reader)); }
+
+  std::shared_ptr<arrow::Schema> schema;
+  auto status = (*maybe_reader)->GetSchema(&schema);
+  if (!status.ok()) { return absl::InternalError(status.message()); }
+
+  // a field maps to several leaf columns of the file when it is nested.
+  std::vector<std::vector<int>> column_indices;
+  for (const auto& field : (*maybe_reader)->manifest().schema_fields) {
+    column_indices.emplace_back();
+    CollectColumnIndices(field, column_indices.back());
+  }
+
+  metadata_ = (*maybe_reader)->parquet_reader()->metadata();
+  schema_ = schema;
+  column_indices_ = std::move(column_indices);
+  file_ = *maybe_input;
+  return absl::OkStatus();
+}
+
+ParquetDataSource::ParquetDataSource(std::string filename, int batch_size)
+    : ParquetDataSource(filename, batch_size, ParquetReadOptions()) { }
+
+ParquetDataSource::ParquetDataSource(std::string filename, int batch_size, ParquetReadOptions options)
+    : DataSource(),
+      filename_{ filename },
+      batch_size_{ batch_size },
+      options_{ options } { }
+
+ParquetDataSource::~ParquetDataSource() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> IpcDataSource::Schema() {
+  CHECK_OK_OR_RETURN(open());
+  return schema_;
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> IpcDataSource::Scan(std::vector<std::string> projection) {
+  CHECK_OK_OR_RETURN(open());
+
+  // only the buffers of the included fields are sliced out of the mapping, the others are never paged in.
+  auto schema = schema_;
+  auto read_options = arrow::ipc::IpcReadOptions::Defaults();
+  read_options.use_threads = false;
+  if (!projection.empty()) {
+    ASSIGN_OR_RETURN(schema, FilterSchema(schema_, projection));
+    auto& included_fields = read_options.included_fields;
+    for (const auto& name : projection) { included_fields.push_back(schema_->GetFieldIndex(name)); }
+    std::sort(included_fields.begin(), included_fields.end());
+    included_fields.erase(std::unique(included_fields.begin(), included_fields.end()), included_fields.end());
+  }
+
+  auto maybe_reader = arrow::ipc::RecordBatchFileReader::Open(file_, read_options);
+  if (!maybe_reader.ok()) { return absl::InternalError(GetMessageFromResult(maybe_reader)); }
+  return std::make_shared<IpcBatchReader>(*maybe_reader, schema);
+}
+
+absl::Status IpcDataSource::open() {
+  if (file_ != nullptr) { return absl::OkStatus(); }
+
+  // the mapping is shared by the scans, the pages of the hot columns stay resident across the queries.
+  auto maybe_file = arrow::io::MemoryMappedFile::Open(filename_, arrow::io::FileMode::READ);
+  if (!maybe_file.ok()) { return absl::InternalError(GetMessageFromResult(maybe_file)); }
+  auto maybe_reader = arrow::ipc::RecordBatchFileReader::Open(*maybe_file);
+  if (!maybe_reader.ok()) { return absl::InternalError(GetMessageFromResult(maybe_reader)); }
+
+  schema_ = (*maybe_reader)->schema();
+  file_ = *maybe_file;
+  return absl::OkStatus();
+}
+
+IpcDataSource::IpcDataSource(std::string filename) : DataSource(), filename_{ filename } { }
+
+IpcDataSource::~IpcDataSource() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> InMemoryDataSource::Schema() { return schema_; }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> InMemoryDataSource::Scan(std::vector<std::string> projection) {
+  auto schema = schema_;
+  std::vector<int> indices;
+  if (!projection.empty()) {
+    ASSIGN_OR_RETURN(schema, FilterSchema(schema_, projection));
+    for (const auto& name : projection) { indices.push_back(schema_->GetFieldIndex(name)); }
+  }
+
+  // the tables are only concatenated chunk lists, the arrays are shared with the source.
+  std::vector<std::shared_ptr<arrow::Table>> tables;
+  for (const auto& table : tables_) {
+    if (projection.empty()) {
+      tables.push_back(table);
+      continue;
+    }
+    auto maybe_table = table->SelectColumns(indices);
+    if (!maybe_table.ok()) { return absl::InternalError(GetMessageFromResult(maybe_table)); }
+    tables.push_back(*maybe_table);
+  }
+
+  std::shared_ptr<arrow::Table> table;
+  if (tables.empty()) {
+    auto maybe_table = arrow::Table::MakeEmpty(schema);
+    if (!maybe_table.ok()) { return absl::InternalError(GetMessageFromResult(maybe_table)); }
+    table = *maybe_table;
+  } else {
+    auto maybe_table = arrow::ConcatenateTables(tables);
+    if (!maybe_table.ok()) { return absl::InternalError(GetMessageFromResult(maybe_table)); }
+    table = *maybe_table;
+  }
+  return std::make_shared<arrow::TableBatchReader>(table);
+}
+
+InMemoryDataSource::InMemoryDataSource(std::shared_ptr<arrow::Table> table)
+    : InMemoryDataSource(table->schema(), { table }) { }
+
+InMemoryDataSource::InMemoryDataSource(
+    std::shared_ptr<arrow::Schema> schema,
+    std::vector<std::shared_ptr<arrow::Table>> tables)
+    : DataSource(),
+      schema_{ std::move(schema) },
+      tables_{ std::move(tables) } { }
+
+InMemoryDataSource::~InMemoryDataSource() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> DatasetDataSource::Schema() {
+  CHECK_OK_OR_RETURN(open());
+  return schema_;
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> DatasetDataSource::Scan(std::vector<std::string> projection) {
+  return Scan(projection, {});
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatchReader>> DatasetDataSource::Scan(
+    std::vector<std::string> projection,
+    const std::vector<ColumnPredicate>& filter) {
+  CHECK_OK_OR_RETURN(open());
+
+  auto schema = schema_;
+  std::vector<std::string> file_projection;
+  if (!projection.empty()) {
+    ASSIGN_OR_RETURN(schema, FilterSchema(schema_, projection));
+    for (const auto& name : projection) {
+      if (file_schema_->GetFieldIndex(name) < 0) { continue; }
+      if (std::find(file_projection.begin(), file_projection.end(), name) != file_projection.end()) { continue; }
+      file_projection.push_back(name);
+    }
+    // a file column is still read to count the rows when only partition columns are projected.
+    if (file_projection.empty()) { file_projection.push_back(file_schema_->field(0)->name()); }
+  }
+
+  std::vector<ColumnPredicate> partition_filter, file_filter;
+  for (const auto& predicate : filter) {
+    if (partition_schema_->GetFieldIndex(predicate.column) >= 0) {
+      partition_filter.push_back(predicate);
+    } else {
+      file_filter.push_back(predicate);
+    }
+  }
+
+  // a partition value is the min and the max of its file. Null values never satisfy a comparison.
+  std::vector<DatasetFile> files;
+  for (const auto& file : files_) {
+    bool pruned = false;
+    for (const auto& predicate : partition_filter) {
+      const auto& value = file.partition_values[partition_schema_->GetFieldIndex(predicate.column)];
+      pruned |= !value->is_valid || !predicate.MayMatch(value, value);
+    }
+    if (!pruned) { files.push_back(file); }
+  }
+
+  return std::make_shared<DatasetReader>(
+      files, file_schema_, partition_schema_, file_projection, file_filter, schema, batch_size_, options_);
+}
+
+absl::Status DatasetDataSource::open() {
+  if (schema_ != nullptr) { return absl::OkStatus(); }
+
+  ASSIGN_OR_RETURN(auto relative_paths, listFiles());
+  if (relative_paths.empty()) {
+    return absl::InvalidArgumentError(fmt::format("No file of the dataset {} was found.", path_));
+  }
+
+  // the partitions are the key=value directories between the root and the files, the same keys for all of them.
+  std::vector<std::string> keys;
+  std::vector<std::vector<std::optional<std::string>>> values;
+  for (size_t file_idx = 0; file_idx < relative_paths.size(); file_idx++) {
+    std::vector<std::string> file_keys;
+    std::vector<std::optional<std::string>> file_values;
+    for (const auto& component : std::filesystem::path(relative_paths[file_idx]).parent_path()) {
+      auto directory = component.string();
+      auto separator = directory.find('=');
+      if (separator == std::string::npos) { continue; }
+
+      file_keys.push_back(directory.substr(0, separator));
+      auto value = directory.substr(separator + 1);
+      file_values.push_back(value == HIVE_DEFAULT_PARTITION ? std::nullopt : std::make_optional(value));
+    }
+
+    if (file_idx == 0) { keys = file_keys; }
+    if (file_keys != keys) {
+      return absl::InvalidArgumentError(
+          fmt::format("The partitions of the dataset file {} don't match the other files.", relative_paths[file_idx]));
+    }
+    values.push_back(file_values);
+  }
+
+  arrow::FieldVector partition_fields;
+  for (size_t key_idx = 0; key_idx < keys.size(); key_idx++) {
+    std::vector<std::optional<std::string>> key_values;
+    for (const auto& file_values : values) { key_values.push_back(file_values[key_idx]); }
+    partition_fields.push_back(arrow::field(keys[key_idx], PartitionType(key_values)));
+  }
+  auto partition_schema = arrow::schema(partition_fields);
+
+  std::vector<DatasetFile> files;
+  for (size_t file_idx = 0; file_idx < relative_paths.size(); file_idx++) {
+    DatasetFile file{ (std::filesystem::path(root_) / relative_paths[file_idx]).string(), {} };
+    for (size_t key_idx = 0; key_idx < keys.size(); key_idx++) {
+      file.partition_values.push_back(PartitionValue(values[file_idx][key_idx], partition_fields[key_idx]->type()));
+    }
+    files.push_back(std::move(file));
+  }
+
+  // the files share the schema of the first one.
+  ASSIGN_OR_RETURN(auto first_file, OpenDatasetFile(files[0].path, batch_size_, nullptr));
+  ASSIGN_OR_RETURN(auto file_schema, first_file->Schema());
+  for (const auto& field : partition_fields) {
+    if (file_schema->GetFieldIndex(field->name()) >= 0) {
+      return absl::InvalidArgumentError(
+          fmt::format("The partition column {} of the dataset {} is also a column of its files.", field->name(), path_));
+    }
+  }
+
+  auto fields = file_schema->fields();
+  fields.insert(fields.end(), partition_fields.begin(), partition_fields.end());
+  files_ = std::move(files);
+  file_schema_ = file_schema;
+  partition_schema_ = partition_schema;
+  schema_ = arrow::schema(fields);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>> DatasetDataSource::listFiles() {
+  namespace fs = std::filesystem;
+
+  // the root is the directory above the first component with a wildcard, the rest of the path is the glob pattern.
+  root_.clear();
+  pattern_.clear();
+  fs::path path(path_);
+  if (path_.find_first_of("*?[") == std::string::npos) {
+    if (fs::is_regular_file(path)) {
+      root_ = path.parent_path().string();
+      return std::vector<std::string>{ path.filename().string() };
+    }
+    root_ = path_;
+  } else {
+    fs::path root, pattern;
+    for (const auto& component : path) {
+      if (pattern.empty() && component.string().find_first_of("*?[") == std::string::npos) {
+        root /= component;
+      } else {
+        pattern /= component;
+      }
+    }
+    root_ = root.empty() ? "." : root.string();
+    pattern_ = pattern.generic_string();
+  }
+
+  // the hidden files and the ones starting with an underscore, e.g. _SUCCESS, aren't part of the dataset.
+  std::vector<std::string> relative_paths;
+  std::error_code ec;
+  for (fs::recursive_directory_iterator it(root_, ec), end; !ec && it != end; it.increment(ec)) {
+    auto name = it->path().filename().string();
+    if (name.empty() || name[0] == '.' || name[0] == '_') {
+      if (it->is_directory()) { it.disable_recursion_pending(); }
+      continue;
+    }
+    if (!it->is_regular_file()) { continue; }
+
+    // a file matches if the pattern matches it or one of the directories above it, as a glob expands to them.
+    auto relative_path = it->path().lexically_relative(root_).generic_string();
+    bool matches = pattern_.empty();
+    for (size_t end = relative_path.find('/'); !matches; end = relative_path.find('/', end + 1)) {
+      matches = fnmatch(pattern_.c_str(), relative_path.substr(0, end).c_str(), FNM_PATHNAME) == 0;
+      if (end == std::string::npos) { break; }
+    }
+    if (matches) { relative_paths.push_back(relative_path); }
+  }
+  if (ec) { return absl::InternalError(fmt::format("Failed to list the dataset {}: {}", path_, ec.message())); }
+
+  std::sort(relative_paths.begin(), relative_paths.end());
+  return relative_paths;
+}
+
+DatasetDataSource::DatasetDataSource(std::string path, int batch_size)
+    : DatasetDataSource(path, batch_size, DatasetOptions()) { }
+
+DatasetDataSource::DatasetDataSource(std::string path, int batch_size, DatasetOptions options)
+    : DataSource(),
+      path_{ path },
+      batch_size_{ batch_size },
+      options_{ options } { }
+
+DatasetDataSource::~DatasetDataSource() { }
+
 DataSource::DataSource() { }
 
 DataSource::~DataSource() { }
@@ -1,17 +1,110 @@
 #include "execution/execution_context.h"
 
+#include "common/macros.h"
 #include "dataframe/dataframe.h"
+#include "datasource/datasource.h"
+#include "optimization/optimizer.h"
+#include "planner/planner.h"
 
 namespace toyquery {
 namespace execution {
 
 using ::toyquery::dataframe::DataFrameImpl;
+using ::toyquery::datasource::CsvDataSource;
+using ::toyquery::datasource::DatasetDataSource;
+using ::toyquery::datasource::IpcDataSource;
+using ::toyquery::datasource::ParquetDataSource;
 using ::toyquery::logicalplan::Scan;
+using ::toyquery::optimization::Optimizer;
+using ::toyquery::planner::QueryPlanner;
 
-absl::StatusOr<std::shared_ptr<DataFrame>> ExecutionContext::CSV(const std::string& filename) { return absl::OkStatus(); }
+absl::StatusOr<std::shared_ptr<DataFrame>> ExecutionContext::CSV(const std::string& filename) {
+  auto source = std::make_shared<CsvDataSource>(filename, batch_size_);
+  CHECK_OK_OR_RETURN(source->Schema().status());
+
+  std::shared_ptr<DataFrame> df =
+      std::make_shared<DataFrameImpl>(std::make_shared<Scan>(filename, source, std::vector<std::string>{}));
+  return df;
+}
 
 absl::StatusOr<std::shared_ptr<DataFrame>> ExecutionContext::Parquet(const std::string& filename) {
-  return absl::OkStatus();
+  auto source = std::make_shared<ParquetDataSource>(filename, batch_size_);
+  CHECK_OK_OR_RETURN(source->Schema().status());
+
+  std::shared_ptr<DataFrame> df =
+      std::make_shared<DataFrameImpl>(std::make_shared<Scan>(filename, source, std::vector<std::string>{}));
+  return df;
+}
+
+absl::StatusOr<std::shared_ptr<DataFrame>> ExecutionContext::Ipc(const std::string& filename) {
+  auto source = std::make_shared<IpcDataSource>(filename);
+  CHECK_OK_OR_RETURN(source->Schema().status());
+
+  std::shared_ptr<DataFrame> df =
+      std::make_shared<DataFrameImpl>(std::make_shared<Scan>(filename, source, std::vector<std::string>{}));
+  return df;
+}
+
+absl::StatusOr<std::shared_ptr<DataFrame>> ExecutionContext::Dataset(const std::string& path) {
+  auto source = std::make_shared<DatasetDataSource>(path, batch_size_);
+  CHECK_OK_OR_RETURN(source->Schema().status());
+
+  std::shared_ptr<DataFrame> df =
+      std::make_shared<DataFrameImpl>(std::make_shared<Scan>(path, source, std::vector<std::string>{}));
+  return df;
+}
+
+absl::StatusOr<std::shared_ptr<PhysicalPlan>> ExecutionContext::CreatePhysicalPlan(std::shared_ptr<DataFrame> df) {
+  Optimizer optimizer;
+  ASSIGN_OR_RETURN(auto logical_plan, optimizer.Optimize(df->GetLogicalPlan()));
+
+  // the thread pool of the query is shared by its gathers, it lives as long as the physical plan. The blocking
+  // operators spill to the system temporary directory before reaching the memory limit.
+  QueryPlanner planner(memory_limit_, "");
+  planner.SetParallelism(parallelism_);
+  planner.SetPrefetchDepth(prefetch_depth_);
+  std::shared_ptr<PhysicalPlan> plan;
+  if (push_based_) {
+    ASSIGN_OR_RETURN(plan, planner.CreatePipelinedPlan(logical_plan));
+  } else {
+    ASSIGN_OR_RETURN(plan, planner.CreatePhysicalPlan(logical_plan));
+  }
+
+  auto query_token = std::make_shared<CancellationToken>(Token());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timeout_.has_value()) { query_token->SetTimeout(*timeout_); }
+  }
+  plan->SetCancellationToken(query_token);
+  plan->SetMemoryPool(std::make_shared<TrackingMemoryPool>("query", memory_limit_));
+  return plan;
+}
+
+void ExecutionContext::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  token_->Cancel();
+  // the queries planned from now on are linked to a fresh token.
+  token_ = std::make_shared<CancellationToken>();
+}
+
+void ExecutionContext::SetDeadline(CancellationToken::Clock::time_point deadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  token_->SetDeadline(deadline);
+}
+
+void ExecutionContext::SetTimeout(CancellationToken::Clock::duration timeout) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  timeout_ = timeout;
+}
+
+void ExecutionContext::SetCancellationToken(std::shared_ptr<CancellationToken> token) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  token_ = std::move(token);
+}
+
+std::shared_ptr<CancellationToken> ExecutionContext::Token() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return token_;
 }
 
 }  // namespace execution
@@ -1,11 +1,15 @@
 #include "logicalplan/logicalplan.h"
 
+#include <algorithm>
+
 #include "common/arrow.h"
 #include "common/macros.h"
 
 namespace toyquery {
 namespace logicalplan {
 
+std::vector<std::string> LogicalPlan::SortedBy() { return {}; }
+
 absl::StatusOr<std::shared_ptr<arrow::Schema>> Scan::Schema() {
   ASSIGN_OR_RETURN(auto schema, source_->Schema());
   if (projection_.empty()) { return schema; }
@@ -16,6 +20,18 @@ std::vector<std::shared_ptr<LogicalPlan>> Scan::Children() { return {}; }
 
 LogicalPlanType Scan::Type() { return LogicalPlanType::Scan; }
 
+std::vector<std::string> Scan::SortedBy() {
+  if (projection_.empty()) { return source_->SortedBy(); }
+
+  // the order is only known up to the first sort column which is projected out.
+  std::vector<std::string> sorted_by;
+  for (auto& column : source_->SortedBy()) {
+    if (std::find(projection_.begin(), projection_.end(), column) == projection_.end()) { break; }
+    sorted_by.push_back(column);
+  }
+  return sorted_by;
+}
+
 std::string Scan::ToString() { return "todo"; }
 
 absl::StatusOr<std::shared_ptr<arrow::Schema>> Projection::Schema() {
@@ -33,6 +49,20 @@ std::vector<std::shared_ptr<LogicalPlan>> Projection::Children() { return {}; }
 
 LogicalPlanType Projection::Type() { return LogicalPlanType::Projection; }
 
+std::vector<std::string> Projection::SortedBy() {
+  // the order is only known up to the first sort column which isn't projected as is.
+  std::vector<std::string> sorted_by;
+  for (auto& column : input_->SortedBy()) {
+    bool projected = std::any_of(expr_.begin(), expr_.end(), [&column](auto& expr) {
+      return expr->type() == LogicalExpressionType::Column &&
+             std::static_pointer_cast<toyquery::logicalplan::Column>(expr)->name_ == column;
+    });
+    if (!projected) { break; }
+    sorted_by.push_back(column);
+  }
+  return sorted_by;
+}
+
 std::string Projection::ToString() { return "todo"; }
 
 absl::StatusOr<std::shared_ptr<arrow::Schema>> Selection::Schema() { return input_->Schema(); }
@@ -41,6 +71,8 @@ std::vector<std::shared_ptr<LogicalPlan>> Selection::Children() { return { input
 
 LogicalPlanType Selection::Type() { return LogicalPlanType::Selection; }
 
+std::vector<std::string> Selection::SortedBy() { return input_->SortedBy(); }
+
 std::string Selection::ToString() { return "todo"; }
 
 absl::StatusOr<std::shared_ptr<arrow::Schema>> Aggregation::Schema() {
@@ -65,5 +97,111 @@ LogicalPlanType Aggregation::Type() { return LogicalPlanType::Aggregation; }
 
 std::string Aggregation::ToString() { return "todo"; }
 
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Join::Schema() {
+  ASSIGN_OR_RETURN(auto left_schema, left_->Schema());
+  ASSIGN_OR_RETURN(auto right_schema, right_->Schema());
+
+  std::vector<std::shared_ptr<arrow::Field>> output_fields = left_schema->fields();
+  for (auto& field : right_schema->fields()) { output_fields.push_back(field); }
+
+  return std::make_shared<arrow::Schema>(output_fields, left_schema->endianness());
+}
+
+std::vector<std::shared_ptr<LogicalPlan>> Join::Children() { return { left_, right_ }; }
+
+LogicalPlanType Join::Type() { return LogicalPlanType::Join; }
+
+std::string Join::ToString() { return "todo"; }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Sort::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<LogicalPlan>> Sort::Children() { return { input_ }; }
+
+LogicalPlanType Sort::Type() { return LogicalPlanType::Sort; }
+
+std::vector<std::string> Sort::SortedBy() {
+  // only the leading ascending column keys can be used by the consumers of the sort order.
+  std::vector<std::string> sorted_by;
+  for (auto& sort_key : sort_keys_) {
+    if (!sort_key.ascending_ || sort_key.expr_->type() != LogicalExpressionType::Column) { break; }
+    sorted_by.emplace_back(std::static_pointer_cast<toyquery::logicalplan::Column>(sort_key.expr_)->name_);
+  }
+  return sorted_by;
+}
+
+std::string Sort::ToString() { return "todo"; }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Limit::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<LogicalPlan>> Limit::Children() { return { input_ }; }
+
+LogicalPlanType Limit::Type() { return LogicalPlanType::Limit; }
+
+std::vector<std::string> Limit::SortedBy() { return input_->SortedBy(); }
+
+std::string Limit::ToString() { return "todo"; }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Distinct::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<LogicalPlan>> Distinct::Children() { return { input_ }; }
+
+LogicalPlanType Distinct::Type() { return LogicalPlanType::Distinct; }
+
+std::vector<std::string> Distinct::SortedBy() { return input_->SortedBy(); }
+
+std::string Distinct::ToString() { return "todo"; }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Window::Schema() {
+  ASSIGN_OR_RETURN(auto input_schema, input_->Schema());
+
+  auto fields = input_schema->fields();
+  for (auto& function : functions_) {
+    switch (function.type_) {
+      case WindowFunctionType::RowNumber:
+      case WindowFunctionType::Rank:
+      case WindowFunctionType::DenseRank:
+      case WindowFunctionType::Count: {
+        fields.push_back(arrow::field(function.name_, arrow::int64()));
+        break;
+      }
+      case WindowFunctionType::Avg: {
+        fields.push_back(arrow::field(function.name_, arrow::float64()));
+        break;
+      }
+      case WindowFunctionType::Sum:
+      case WindowFunctionType::Min:
+      case WindowFunctionType::Max: {
+        if (function.expr_ == nullptr) { return absl::InvalidArgumentError("window aggregate without an input"); }
+        ASSIGN_OR_RETURN(auto field, function.expr_->ToField(input_));
+        fields.push_back(arrow::field(function.name_, field->type()));
+        break;
+      }
+    }
+  }
+  return arrow::schema(fields);
+}
+
+std::vector<std::shared_ptr<LogicalPlan>> Window::Children() { return { input_ }; }
+
+LogicalPlanType Window::Type() { return LogicalPlanType::Window; }
+
+std::vector<std::string> Window::SortedBy() {
+  // the output is sorted on the partition keys first, the order keys can only be used if there is no partition key.
+  std::vector<std::string> sorted_by;
+  for (auto& expr : partition_by_) {
+    if (expr->type() != LogicalExpressionType::Column) { return sorted_by; }
+    sorted_by.emplace_back(std::static_pointer_cast<toyquery::logicalplan::Column>(expr)->name_);
+  }
+  if (!partition_by_.empty()) { return sorted_by; }
+
+  for (auto& order_key : order_by_) {
+    if (!order_key.ascending_ || order_key.expr_->type() != LogicalExpressionType::Column) { break; }
+    sorted_by.emplace_back(std::static_pointer_cast<toyquery::logicalplan::Column>(order_key.expr_)->name_);
+  }
+  return sorted_by;
+}
+
+std::string Window::ToString() { return "todo"; }
+
 }  // namespace logicalplan
 }  // namespace toyquery
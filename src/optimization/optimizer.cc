@@ -7,15 +7,77 @@ namespace optimization {
 
 namespace {
 
+using ::toyquery::datasource::ColumnPredicate;
 using ::toyquery::logicalplan::Aggregation;
+using ::toyquery::logicalplan::BinaryExpression;
+using ::toyquery::logicalplan::Column;
+using ::toyquery::logicalplan::Distinct;
+using ::toyquery::logicalplan::Join;
+using ::toyquery::logicalplan::Limit;
+using ::toyquery::logicalplan::LiteralDouble;
+using ::toyquery::logicalplan::LiteralLong;
+using ::toyquery::logicalplan::LiteralString;
+using ::toyquery::logicalplan::LogicalExpression;
+using ::toyquery::logicalplan::LogicalExpressionType;
 using ::toyquery::logicalplan::LogicalPlan;
 using ::toyquery::logicalplan::LogicalPlanType;
 using ::toyquery::logicalplan::Projection;
+using ::toyquery::logicalplan::Scan;
 using ::toyquery::logicalplan::Selection;
+using ::toyquery::logicalplan::Sort;
+using ::toyquery::logicalplan::Window;
+
+// get the value of a literal expression, nullptr if the expression isn't a literal.
+std::shared_ptr<arrow::Scalar> LiteralValue(const std::shared_ptr<LogicalExpression>& expr) {
+  switch (expr->type()) {
+    case LogicalExpressionType::LiteralLong:
+      return std::make_shared<arrow::Int64Scalar>(std::static_pointer_cast<LiteralLong>(expr)->value_);
+    case LogicalExpressionType::LiteralDouble:
+      return std::make_shared<arrow::DoubleScalar>(std::static_pointer_cast<LiteralDouble>(expr)->value_);
+    case LogicalExpressionType::LiteralString:
+      return std::make_shared<arrow::StringScalar>(std::string(std::static_pointer_cast<LiteralString>(expr)->value_));
+    default: return nullptr;
+  }
+}
+
+// collect the comparisons of a column with a literal of the conjunction, the other terms are left to the selection.
+void ExtractPredicates(const std::shared_ptr<LogicalExpression>& expr, std::vector<ColumnPredicate>& filter) {
+  ColumnPredicate::Op op, flipped_op;
+  switch (expr->type()) {
+    case LogicalExpressionType::And: {
+      auto and_expr = std::static_pointer_cast<BinaryExpression>(expr);
+      ExtractPredicates(and_expr->left_, filter);
+      ExtractPredicates(and_expr->right_, filter);
+      return;
+    }
+    case LogicalExpressionType::Eq: op = flipped_op = ColumnPredicate::Op::Eq; break;
+    case LogicalExpressionType::Neq: op = flipped_op = ColumnPredicate::Op::Neq; break;
+    case LogicalExpressionType::Lt: op = ColumnPredicate::Op::Lt, flipped_op = ColumnPredicate::Op::Gt; break;
+    case LogicalExpressionType::LtEq: op = ColumnPredicate::Op::LtEq, flipped_op = ColumnPredicate::Op::GtEq; break;
+    case LogicalExpressionType::Gt: op = ColumnPredicate::Op::Gt, flipped_op = ColumnPredicate::Op::Lt; break;
+    case LogicalExpressionType::GtEq: op = ColumnPredicate::Op::GtEq, flipped_op = ColumnPredicate::Op::LtEq; break;
+    default: return;
+  }
+
+  // the literal can be on either side of the comparison, e.g. 10 < age is age > 10.
+  auto comparison = std::static_pointer_cast<BinaryExpression>(expr);
+  if (comparison->left_->type() == LogicalExpressionType::Column) {
+    auto value = LiteralValue(comparison->right_);
+    if (value == nullptr) { return; }
+    filter.push_back({ std::string(std::static_pointer_cast<Column>(comparison->left_)->name_), op, value });
+  } else if (comparison->right_->type() == LogicalExpressionType::Column) {
+    auto value = LiteralValue(comparison->left_);
+    if (value == nullptr) { return; }
+    filter.push_back({ std::string(std::static_pointer_cast<Column>(comparison->right_)->name_), flipped_op, value });
+  }
+}
 
 }  // namespace
 
-Optimizer::Optimizer() { rules_.push_back(std::make_unique<ProjectionPushDownRule>()); }
+Optimizer::Optimizer() {
+  rules_.push_back(std::make_unique<PredicatePushDownRule>());
+  rules_.push_back(std::make_unique<ProjectionPushDownRule>());
+}
 
 absl::StatusOr<std::shared_ptr<LogicalPlan>> Optimizer::Optimize(std::shared_ptr<LogicalPlan> logical_plan) {
   std::shared_ptr<LogicalPlan> optimized_plan = logical_plan;
@@ -33,10 +95,24 @@ absl::StatusOr<std::shared_ptr<LogicalPlan>> ProjectionPushDownRule::pushDown(
     std::unordered_set<std::string> column_names) {
   switch (logical_plan->Type()) {
     case LogicalPlanType::Scan: {
-      break;
+      // an empty set means that all the columns are needed. The names produced above the scan, e.g. by an aggregation,
+      // aren't read from its source and are ignored.
+      auto scan_plan = std::static_pointer_cast<Scan>(logical_plan);
+      ASSIGN_OR_RETURN(auto schema, scan_plan->Schema());
+      std::vector<std::string> projection;
+      for (auto& field : schema->fields()) {
+        if (column_names.count(field->name()) > 0) { projection.push_back(field->name()); }
+      }
+      if (projection.empty() || projection.size() == schema->fields().size()) { return logical_plan; }
+
+      // the scan keeps its pushed down filter.
+      return std::make_shared<Scan>(scan_plan->path_, scan_plan->source_, projection, scan_plan->filter_);
     }
     case LogicalPlanType::Projection: {
       auto projection_plan = std::static_pointer_cast<Projection>(logical_plan);
+
+      // the columns referenced above the projection are its outputs, only its expressions are computed on the input.
+      column_names.clear();
       CHECK_OK_OR_RETURN(ExtractColumns(projection_plan->expr_, projection_plan->input_, column_names));
       ASSIGN_OR_RETURN(auto new_input, pushDown(projection_plan->input_, column_names));
       return std::make_shared<Projection>(new_input, projection_plan->expr_);
@@ -50,6 +126,8 @@ absl::StatusOr<std::shared_ptr<LogicalPlan>> ProjectionPushDownRule::pushDown(
     case LogicalPlanType::Aggregation: {
       auto aggregation_plan = std::static_pointer_cast<Aggregation>(logical_plan);
 
+      // the columns referenced above the aggregation are its outputs, only its expressions are computed on the input.
+      column_names.clear();
       CHECK_OK_OR_RETURN(ExtractColumns(aggregation_plan->grouping_expr_, aggregation_plan->input_, column_names));
       for (auto& a : aggregation_plan->aggregation_expr_) {
         CHECK_OK_OR_RETURN(ExtractColumns(a->expr_, aggregation_plan->input_, column_names));
@@ -58,11 +136,138 @@ absl::StatusOr<std::shared_ptr<LogicalPlan>> ProjectionPushDownRule::pushDown(
       ASSIGN_OR_RETURN(auto new_input, pushDown(aggregation_plan->input_, column_names));
       return std::make_shared<Aggregation>(new_input, aggregation_plan->grouping_expr_, aggregation_plan->aggregation_expr_);
     }
+    case LogicalPlanType::Join: {
+      auto join_plan = std::static_pointer_cast<Join>(logical_plan);
+
+      // the join keys are needed in addition to the columns referenced above the join. An empty set means that all
+      // the columns are needed and is kept as is.
+      auto left_column_names = column_names, right_column_names = column_names;
+      if (!column_names.empty()) {
+        for (auto& [left_name, right_name] : join_plan->on_) {
+          left_column_names.insert(left_name);
+          right_column_names.insert(right_name);
+        }
+      }
+
+      ASSIGN_OR_RETURN(auto new_left, pushDown(join_plan->left_, left_column_names));
+      ASSIGN_OR_RETURN(auto new_right, pushDown(join_plan->right_, right_column_names));
+      return std::make_shared<Join>(new_left, new_right, join_plan->on_);
+    }
+    case LogicalPlanType::Sort: {
+      auto sort_plan = std::static_pointer_cast<Sort>(logical_plan);
+
+      // the sort keys are needed in addition to the columns referenced above the sort, unless all of them are needed.
+      if (!column_names.empty()) {
+        for (auto& sort_key : sort_plan->sort_keys_) {
+          CHECK_OK_OR_RETURN(ExtractColumns(sort_key.expr_, sort_plan->input_, column_names));
+        }
+      }
+      ASSIGN_OR_RETURN(auto new_input, pushDown(sort_plan->input_, column_names));
+      return std::make_shared<Sort>(new_input, sort_plan->sort_keys_);
+    }
+    case LogicalPlanType::Limit: {
+      auto limit_plan = std::static_pointer_cast<Limit>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(limit_plan->input_, column_names));
+      return std::make_shared<Limit>(new_input, limit_plan->limit_, limit_plan->offset_);
+    }
+    case LogicalPlanType::Distinct: {
+      auto distinct_plan = std::static_pointer_cast<Distinct>(logical_plan);
+
+      // the rows are compared on all the columns of the input, none of them can be pruned below.
+      ASSIGN_OR_RETURN(auto new_input, pushDown(distinct_plan->input_, {}));
+      return std::make_shared<Distinct>(new_input);
+    }
+    case LogicalPlanType::Window: {
+      auto window_plan = std::static_pointer_cast<Window>(logical_plan);
+
+      // the partition keys, order keys and function inputs are needed in addition to the input columns referenced above
+      // the window, the function outputs aren't produced by the input.
+      if (!column_names.empty()) {
+        CHECK_OK_OR_RETURN(ExtractColumns(window_plan->partition_by_, window_plan->input_, column_names));
+        for (auto& order_key : window_plan->order_by_) {
+          CHECK_OK_OR_RETURN(ExtractColumns(order_key.expr_, window_plan->input_, column_names));
+        }
+        for (auto& function : window_plan->functions_) {
+          if (function.expr_ != nullptr) {
+            CHECK_OK_OR_RETURN(ExtractColumns(function.expr_, window_plan->input_, column_names));
+          }
+          column_names.erase(function.name_);
+        }
+      }
+      ASSIGN_OR_RETURN(auto new_input, pushDown(window_plan->input_, column_names));
+      return std::make_shared<Window>(
+          new_input, window_plan->partition_by_, window_plan->order_by_, window_plan->functions_);
+    }
     default: return absl::InternalError("Unsupported logical plan for projection push down optimization");
   }
 
   return absl::InternalError("Unreachable code");
 }
 
+absl::StatusOr<std::shared_ptr<LogicalPlan>> PredicatePushDownRule::Optimize(std::shared_ptr<LogicalPlan> logical_plan) {
+  return pushDown(logical_plan, {});
+}
+
+absl::StatusOr<std::shared_ptr<LogicalPlan>> PredicatePushDownRule::pushDown(
+    std::shared_ptr<LogicalPlan> logical_plan,
+    std::vector<ColumnPredicate> filter) {
+  // the predicates only reach a scan through selections, the other operators can rename, produce or drop rows. Their
+  // inputs are optimized on their own.
+  switch (logical_plan->Type()) {
+    case LogicalPlanType::Scan: {
+      if (filter.empty()) { return logical_plan; }
+
+      auto scan_plan = std::static_pointer_cast<Scan>(logical_plan);
+      auto scan_filter = scan_plan->filter_;
+      scan_filter.insert(scan_filter.end(), filter.begin(), filter.end());
+      return std::make_shared<Scan>(scan_plan->path_, scan_plan->source_, scan_plan->projection_, scan_filter);
+    }
+    case LogicalPlanType::Selection: {
+      auto selection_plan = std::static_pointer_cast<Selection>(logical_plan);
+      ExtractPredicates(selection_plan->filter_expr_, filter);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(selection_plan->input_, filter));
+      return std::make_shared<Selection>(new_input, selection_plan->filter_expr_);
+    }
+    case LogicalPlanType::Projection: {
+      auto projection_plan = std::static_pointer_cast<Projection>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(projection_plan->input_, {}));
+      return std::make_shared<Projection>(new_input, projection_plan->expr_);
+    }
+    case LogicalPlanType::Aggregation: {
+      auto aggregation_plan = std::static_pointer_cast<Aggregation>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(aggregation_plan->input_, {}));
+      return std::make_shared<Aggregation>(new_input, aggregation_plan->grouping_expr_, aggregation_plan->aggregation_expr_);
+    }
+    case LogicalPlanType::Join: {
+      auto join_plan = std::static_pointer_cast<Join>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_left, pushDown(join_plan->left_, {}));
+      ASSIGN_OR_RETURN(auto new_right, pushDown(join_plan->right_, {}));
+      return std::make_shared<Join>(new_left, new_right, join_plan->on_);
+    }
+    case LogicalPlanType::Sort: {
+      auto sort_plan = std::static_pointer_cast<Sort>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(sort_plan->input_, {}));
+      return std::make_shared<Sort>(new_input, sort_plan->sort_keys_);
+    }
+    case LogicalPlanType::Limit: {
+      auto limit_plan = std::static_pointer_cast<Limit>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(limit_plan->input_, {}));
+      return std::make_shared<Limit>(new_input, limit_plan->limit_, limit_plan->offset_);
+    }
+    case LogicalPlanType::Distinct: {
+      auto distinct_plan = std::static_pointer_cast<Distinct>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(distinct_plan->input_, {}));
+      return std::make_shared<Distinct>(new_input);
+    }
+    case LogicalPlanType::Window: {
+      auto window_plan = std::static_pointer_cast<Window>(logical_plan);
+      ASSIGN_OR_RETURN(auto new_input, pushDown(window_plan->input_, {}));
+      return std::make_shared<Window>(
+          new_input, window_plan->partition_by_, window_plan->order_by_, window_plan->functions_);
+    }
+    default: return absl::InternalError("Unsupported logical plan for predicate push down optimization");
+  }
+}
+
 }  // namespace optimization
 }  // namespace toyquery
@@ -3,6 +3,12 @@
 namespace toyquery {
 namespace physicalplan {
 
+absl::Status Accumulator::Merge(Accumulator& other) {
+  ASSIGN_OR_RETURN(auto value, other.FinalValue());
+  if (value == nullptr) { return absl::OkStatus(); }  // nothing was accumulated.
+  return Accumulate(value);
+}
+
 absl::Status MaxAccumulator::Accumulate(std::shared_ptr<arrow::Scalar> value) {
 #define COMPUTE_MAX_ARROW_SCALER(tp)                                  \
   CAST_ARROW_SCALER_TO_TYPE_OR_RETURN(auto val, tp, value);           \
@@ -114,5 +120,105 @@ absl::Status SumAccumulator::Accumulate(std::shared_ptr<arrow::Scalar> value) {
 
 absl::StatusOr<std::shared_ptr<arrow::Scalar>> SumAccumulator::FinalValue() { return value_; }
 
+absl::Status CountAccumulator::Accumulate(std::shared_ptr<arrow::Scalar> value) {
+  if (value->is_valid) { count_++; }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Scalar>> CountAccumulator::FinalValue() {
+  return std::make_shared<arrow::Int64Scalar>(count_);
+}
+
+absl::Status CountAccumulator::Merge(Accumulator& other) {
+  auto other_count = dynamic_cast<CountAccumulator*>(&other);
+  if (other_count == nullptr) { return absl::InvalidArgumentError("Count accumulator can only be merged with another."); }
+  count_ += other_count->count_;
+  return absl::OkStatus();
+}
+
+absl::Status CountDistinctAccumulator::Accumulate(std::shared_ptr<arrow::Scalar> value) {
+  if (!value->is_valid) { return absl::OkStatus(); }
+
+  switch (value->type->id()) {
+    case arrow::Type::BOOL: {
+      integer_values_.Add(std::static_pointer_cast<arrow::BooleanScalar>(value)->value ? 1 : 0);
+      break;
+    }
+    case arrow::Type::INT64: {
+      integer_values_.Add(static_cast<uint64_t>(std::static_pointer_cast<arrow::Int64Scalar>(value)->value));
+      break;
+    }
+    default: {
+      values_.insert(toyquery::Key({ value }));
+      break;
+    }
+  }
+
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Scalar>> CountDistinctAccumulator::FinalValue() {
+  return std::make_shared<arrow::Int64Scalar>(integer_values_.Cardinality() + values_.size());
+}
+
+absl::Status CountDistinctAccumulator::Merge(Accumulator& other) {
+  auto other_distinct = dynamic_cast<CountDistinctAccumulator*>(&other);
+  if (other_distinct == nullptr) {
+    return absl::InvalidArgumentError("Count distinct accumulator can only be merged with another.");
+  }
+  integer_values_.Merge(other_distinct->integer_values_);
+  values_.insert(other_distinct->values_.begin(), other_distinct->values_.end());
+  return absl::OkStatus();
+}
+
+absl::Status ApproxCountDistinctAccumulator::Accumulate(std::shared_ptr<arrow::Scalar> value) {
+  if (value->is_valid) { sketch_.Add(HashScalarValue(*value)); }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Scalar>> ApproxCountDistinctAccumulator::FinalValue() {
+  return std::make_shared<arrow::Int64Scalar>(sketch_.Estimate());
+}
+
+absl::Status ApproxCountDistinctAccumulator::Merge(Accumulator& other) {
+  auto other_approx = dynamic_cast<ApproxCountDistinctAccumulator*>(&other);
+  if (other_approx == nullptr || !sketch_.Merge(other_approx->sketch_)) {
+    return absl::InvalidArgumentError("Approx count distinct accumulator can only be merged with another.");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ApproxPercentileAccumulator::Accumulate(std::shared_ptr<arrow::Scalar> value) {
+  if (!value->is_valid) { return absl::OkStatus(); }
+
+  switch (value->type->id()) {
+    case arrow::Type::INT64: {
+      sketch_.Add(std::static_pointer_cast<arrow::Int64Scalar>(value)->value);
+      break;
+    }
+    case arrow::Type::DOUBLE: {
+      sketch_.Add(std::static_pointer_cast<arrow::DoubleScalar>(value)->value);
+      break;
+    }
+    default: return absl::InternalError("Unsupported value type for Approx percentile accumulator.");
+  }
+
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Scalar>> ApproxPercentileAccumulator::FinalValue() {
+  if (sketch_.Count() == 0) { return arrow::MakeNullScalar(arrow::float64()); }
+  return std::make_shared<arrow::DoubleScalar>(sketch_.Quantile(percentile_));
+}
+
+absl::Status ApproxPercentileAccumulator::Merge(Accumulator& other) {
+  auto other_approx = dynamic_cast<ApproxPercentileAccumulator*>(&other);
+  if (other_approx == nullptr) {
+    return absl::InvalidArgumentError("Approx percentile accumulator can only be merged with another.");
+  }
+  sketch_.Merge(other_approx->sketch_);
+  return absl::OkStatus();
+}
+
 }  // namespace physicalplan
 }  // namespace toyquery
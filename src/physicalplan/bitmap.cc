@@ -0,0 +1,93 @@
+#include "physicalplan/bitmap.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace toyquery {
+namespace physicalplan {
+
+namespace {
+
+// An array container holding more values than this takes more space than the 8KB bit set.
+static constexpr int64_t ARRAY_CONTAINER_MAX_SIZE = 4096;
+
+// The number of 64 bit words of a bit set container.
+static constexpr int64_t BITSET_CONTAINER_WORDS = (1 << 16) / 64;
+
+}  // namespace
+
+bool RoaringBitmap::Container::Add(uint16_t low) {
+  if (!bitset_.empty()) {
+    auto& word = bitset_[low / 64];
+    auto mask = 1ULL << (low % 64);
+    if ((word & mask) != 0) { return false; }
+    word |= mask;
+    cardinality_++;
+    return true;
+  }
+
+  auto it = std::lower_bound(array_.begin(), array_.end(), low);
+  if (it != array_.end() && *it == low) { return false; }
+  array_.insert(it, low);
+  cardinality_++;
+  if (cardinality_ > ARRAY_CONTAINER_MAX_SIZE) { toBitset(); }
+  return true;
+}
+
+bool RoaringBitmap::Container::Contains(uint16_t low) const {
+  if (!bitset_.empty()) { return (bitset_[low / 64] & (1ULL << (low % 64))) != 0; }
+  return std::binary_search(array_.begin(), array_.end(), low);
+}
+
+void RoaringBitmap::Container::Merge(const Container& other) {
+  if (other.bitset_.empty()) {
+    for (auto low : other.array_) { Add(low); }
+    return;
+  }
+
+  // the union of a bit set is a bit set, OR the words and count the bits again.
+  if (bitset_.empty()) { toBitset(); }
+  cardinality_ = 0;
+  for (int64_t i = 0; i < BITSET_CONTAINER_WORDS; i++) {
+    bitset_[i] |= other.bitset_[i];
+    cardinality_ += std::bitset<64>(bitset_[i]).count();
+  }
+}
+
+void RoaringBitmap::Container::toBitset() {
+  bitset_.assign(BITSET_CONTAINER_WORDS, 0);
+  for (auto low : array_) { bitset_[low / 64] |= 1ULL << (low % 64); }
+  array_.clear();
+  array_.shrink_to_fit();
+}
+
+bool RoaringBitmap::Add(uint64_t value) {
+  if (!containers_[value >> 16].Add(static_cast<uint16_t>(value))) { return false; }
+  cardinality_++;
+  return true;
+}
+
+bool RoaringBitmap::Contains(uint64_t value) const {
+  auto it = containers_.find(value >> 16);
+  return it != containers_.end() && it->second.Contains(static_cast<uint16_t>(value));
+}
+
+void RoaringBitmap::Merge(const RoaringBitmap& other) {
+  for (auto& [high, other_container] : other.containers_) {
+    auto& container = containers_[high];
+    cardinality_ -= container.cardinality_;
+    container.Merge(other_container);
+    cardinality_ += container.cardinality_;
+  }
+}
+
+int64_t RoaringBitmap::SizeInBytes() const {
+  int64_t size = 0;
+  for (auto& [high, container] : containers_) {
+    size += container.array_.capacity() * sizeof(uint16_t) + container.bitset_.capacity() * sizeof(uint64_t);
+  }
+  return size;
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
@@ -9,6 +9,14 @@ namespace {
 
 using ::toyquery::common::GetMessageFromStatus;
 
+// reserve room for the values appended without checking, failing with ResourceExhausted over the limit of the pool.
+absl::Status reserve(arrow::ArrayBuilder& builder, int64_t length) {
+  auto reserve_status = builder.Reserve(length);
+  if (reserve_status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(reserve_status)); }
+  if (!reserve_status.ok()) { return absl::InternalError(GetMessageFromStatus(reserve_status)); }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 PhysicalExpression::~PhysicalExpression() { }
@@ -17,7 +25,9 @@ Column::Column(int idx) : idx_{ idx } { }
 
 Column::~Column() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> Column::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
+absl::StatusOr<std::shared_ptr<arrow::Array>> Column::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
   if (idx_ < 0 || idx_ >= input->num_columns()) { return absl::OutOfRangeError("index out of range"); }
   return input->column(idx_);
 }
@@ -28,9 +38,11 @@ LiteralLong::LiteralLong(long val) : val_{ val } { }
 
 LiteralLong::~LiteralLong() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralLong::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
-  arrow::Int64Builder builder;
-  builder.Reserve(input->num_rows());
+absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralLong::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
+  arrow::Int64Builder builder(pool);
+  CHECK_OK_OR_RETURN(reserve(builder, input->num_rows()));
   for (int i = 0; i < input->num_rows(); i++) { builder.UnsafeAppend(val_); }
 
   auto array = builder.Finish();
@@ -44,9 +56,11 @@ LiteralDouble::LiteralDouble(double val) : val_{ val } { }
 
 LiteralDouble::~LiteralDouble() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralDouble::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
-  arrow::DoubleBuilder builder;
-  builder.Reserve(input->num_rows());
+absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralDouble::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
+  arrow::DoubleBuilder builder(pool);
+  CHECK_OK_OR_RETURN(reserve(builder, input->num_rows()));
   for (int i = 0; i < input->num_rows(); i++) { builder.UnsafeAppend(val_); }
 
   auto array = builder.Finish();
@@ -60,8 +74,10 @@ LiteralString::LiteralString(absl::string_view val) : val_{ val } { }
 
 LiteralString::~LiteralString() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralString::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
-  arrow::StringBuilder builder;
+absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralString::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
+  arrow::StringBuilder builder(pool);
   for (int i = 0; i < input->num_rows(); i++) { builder.Append(std::string(val_)); }
 
   auto array = builder.Finish();
@@ -75,8 +91,10 @@ LiteralBoolean::LiteralBoolean(bool val) : val_{ val } { }
 
 LiteralBoolean::~LiteralBoolean() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralBoolean::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
-  arrow::BooleanBuilder builder;
+absl::StatusOr<std::shared_ptr<arrow::Array>> LiteralBoolean::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
+  arrow::BooleanBuilder builder(pool);
   for (int i = 0; i < input->num_rows(); i++) { builder.Append(val_); }
 
   auto array = builder.Finish();
@@ -96,9 +114,11 @@ BooleanExpression::BooleanExpression(
 
 BooleanExpression::~BooleanExpression() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> BooleanExpression::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
-  ASSIGN_OR_RETURN(auto ll, left_->Evaluate(input));
-  ASSIGN_OR_RETURN(auto rr, right_->Evaluate(input));
+absl::StatusOr<std::shared_ptr<arrow::Array>> BooleanExpression::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
+  ASSIGN_OR_RETURN(auto ll, left_->Evaluate(input, pool));
+  ASSIGN_OR_RETURN(auto rr, right_->Evaluate(input, pool));
 
   if (ll->length() != rr->length()) {
     return absl::InternalError("Boolean expression operands do not have the same number of columns");
@@ -107,14 +127,15 @@ absl::StatusOr<std::shared_ptr<arrow::Array>> BooleanExpression::Evaluate(const
     return absl::InternalError("Boolean expression operands do not have the same type");
   }
 
-  return Compare(ll, rr);
+  return Compare(ll, rr, pool);
 }
 
 absl::StatusOr<std::shared_ptr<arrow::Array>> BooleanExpression::Compare(
     const std::shared_ptr<arrow::Array> left,
-    const std::shared_ptr<arrow::Array> right) {
-  arrow::BooleanBuilder builder;
-  builder.Reserve(left->length());
+    const std::shared_ptr<arrow::Array> right,
+    arrow::MemoryPool* pool) {
+  arrow::BooleanBuilder builder(pool);
+  CHECK_OK_OR_RETURN(reserve(builder, left->length()));
 
   for (int i = 0; i < left->length(); i++) {
     auto ls = left->GetScalar(i);
@@ -318,9 +339,11 @@ BinaryExpression::BinaryExpression(std::shared_ptr<PhysicalExpression> left, std
     : left_{ left },
       right_{ right } { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> BinaryExpression::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) {
-  ASSIGN_OR_RETURN(auto ll, left_->Evaluate(input));
-  ASSIGN_OR_RETURN(auto rr, right_->Evaluate(input));
+absl::StatusOr<std::shared_ptr<arrow::Array>> BinaryExpression::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) {
+  ASSIGN_OR_RETURN(auto ll, left_->Evaluate(input, pool));
+  ASSIGN_OR_RETURN(auto rr, right_->Evaluate(input, pool));
 
   if (ll->length() != rr->length()) {
     return absl::InternalError("Binary expression operands do not have the same number of columns");
@@ -329,7 +352,7 @@ absl::StatusOr<std::shared_ptr<arrow::Array>> BinaryExpression::Evaluate(const s
     return absl::InternalError("Binary expression operands do not have the same type");
   }
 
-  return EvaluateBinaryExpression(ll, rr);
+  return EvaluateBinaryExpression(ll, rr, pool);
 }
 
 MathExpression::MathExpression(std::shared_ptr<PhysicalExpression> left, std::shared_ptr<PhysicalExpression> right)
@@ -337,10 +360,11 @@ MathExpression::MathExpression(std::shared_ptr<PhysicalExpression> left, std::sh
 
 absl::StatusOr<std::shared_ptr<arrow::Array>> MathExpression::EvaluateBinaryExpression(
     const std::shared_ptr<arrow::Array> left,
-    const std::shared_ptr<arrow::Array> right) {
+    const std::shared_ptr<arrow::Array> right,
+    arrow::MemoryPool* pool) {
 #define EVALUATE_BINARY_EXPRESSION(builder_type, scaler_type)                                           \
-  builder_type builder;                                                                                 \
-  builder.Reserve(left->length());                                                                      \
+  builder_type builder(pool);                                                                           \
+  CHECK_OK_OR_RETURN(reserve(builder, left->length()));                                                 \
                                                                                                         \
   for (int i = 0; i < left->length(); i++) {                                                            \
     auto ls = left->GetScalar(i);                                                                       \
@@ -496,7 +520,9 @@ Cast::Cast(std::shared_ptr<PhysicalExpression> expr, std::shared_ptr<arrow::Data
 
 Cast::~Cast() { }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> Cast::Evaluate(const std::shared_ptr<arrow::RecordBatch> input) { }
+absl::StatusOr<std::shared_ptr<arrow::Array>> Cast::Evaluate(
+    const std::shared_ptr<arrow::RecordBatch> input,
+    arrow::MemoryPool* pool) { }
 
 std::string Cast::ToString() { return "todo"; }
 
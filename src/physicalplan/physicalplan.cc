@@ -1,21 +1,198 @@
 #include "physicalplan/physicalplan.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <typeinfo>
 #include <unordered_map>
 
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
 #include "common/arrow.h"
 #include "common/key.h"
+#include "arrow/util/byte_size.h"
 #include "common/status.h"
+#include "fmt/core.h"
 
 namespace toyquery {
 namespace physicalplan {
 
 using toyquery::common::GetMessageFromStatus;
 
+namespace {
+
+// The number of levels a grace hash join can recursively repartition the spilled partitions, the partitions are joined
+// in memory past that.
+static constexpr int MAX_GRACE_HASH_JOIN_LEVEL = 4;
+
+// The number of rows in each output batch of the sort.
+static constexpr int64_t SORT_BATCH_SIZE = 4096;
+
+// The maximum number of rows of the morsels handed out to the pipeline instances running in parallel.
+static constexpr int64_t MORSEL_SIZE = 100000;
+
+// The number of output batches buffered by a gather per pipeline instance, before the instances are parked.
+static constexpr int GATHER_BATCHES_PER_PIPELINE = 2;
+
+// The compression of the sorted runs spilled to disk.
+static constexpr arrow::Compression::type SORT_SPILL_COMPRESSION = arrow::Compression::LZ4_FRAME;
+
+// The number of rows after which the sort-merge join emits its output batch.
+static constexpr int64_t SORT_MERGE_JOIN_BATCH_SIZE = 4096;
+
+// The estimated memory of a group of the hash aggregation (its hash table entry), charged to the pool of the operator.
+static constexpr int64_t GROUP_BYTES = 64;
+
+// The estimated memory of each grouping key value and accumulator of a group of the hash aggregation.
+static constexpr int64_t GROUP_COLUMN_BYTES = 64;
+
+// Get the join key of the row. The key is empty if any of its values is null since null keys never match.
+absl::StatusOr<arrow::ScalarVector> getJoinKey(
+    const std::vector<std::shared_ptr<arrow::Array>>& columns,
+    const std::vector<int>& keys,
+    int64_t row_idx) {
+  arrow::ScalarVector row_key_vector;
+  for (auto& key : keys) {
+    auto row_key_or = columns[key]->GetScalar(row_idx);
+    if (!row_key_or.ok()) { return absl::InternalError(GetMessageFromResult(row_key_or)); }
+    if (!(*row_key_or)->is_valid) { return arrow::ScalarVector{}; }
+    row_key_vector.push_back(*row_key_or);
+  }
+  return row_key_vector;
+}
+
+// Build the hash table from the join key to the build rows having that key.
+absl::StatusOr<JoinHashTable> buildJoinHashTable(
+    const std::vector<std::shared_ptr<arrow::Array>>& build_columns,
+    const std::vector<int>& build_keys) {
+  JoinHashTable hash_table;
+  int64_t num_rows = build_columns.empty() ? 0 : build_columns[0]->length();
+  for (int64_t row_idx = 0; row_idx < num_rows; row_idx++) {
+    ASSIGN_OR_RETURN(auto row_key_vector, getJoinKey(build_columns, build_keys, row_idx));
+    if (row_key_vector.empty()) { continue; }
+
+    hash_table[toyquery::Key(row_key_vector)].push_back(row_idx);
+  }
+  return hash_table;
+}
+
+// Probe the hash table with each row of the batch and gather the joined rows. Returns nullptr if no row matches.
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> probeJoinHashTable(
+    const JoinHashTable& hash_table,
+    const std::vector<std::shared_ptr<arrow::Array>>& build_columns,
+    std::shared_ptr<arrow::RecordBatch> batch,
+    const std::vector<int>& probe_keys,
+    std::shared_ptr<arrow::Schema> schema) {
+  if (hash_table.empty()) { return nullptr; }
+
+  // find the matching build rows for each probe row.
+  std::vector<int64_t> probe_indices, build_indices;
+  for (int64_t row_idx = 0; row_idx < batch->num_rows(); row_idx++) {
+    ASSIGN_OR_RETURN(auto row_key_vector, getJoinKey(batch->columns(), probe_keys, row_idx));
+    if (row_key_vector.empty()) { continue; }
+
+    auto it = hash_table.find(toyquery::Key(row_key_vector));
+    if (it == hash_table.end()) { continue; }
+    for (auto build_row : it->second) {
+      probe_indices.push_back(row_idx);
+      build_indices.push_back(build_row);
+    }
+  }
+  if (probe_indices.empty()) { return nullptr; }
+
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (auto& column : batch->columns()) {
+    ASSIGN_OR_RETURN(auto taken, TakeArray(column, probe_indices));
+    columns.push_back(taken);
+  }
+  for (auto& column : build_columns) {
+    ASSIGN_OR_RETURN(auto taken, TakeArray(column, build_indices));
+    columns.push_back(taken);
+  }
+
+  return arrow::RecordBatch::Make(schema, static_cast<int64_t>(probe_indices.size()), columns);
+}
+
+// reserve room for the rows of the builder, which are appended without checking for room.
+absl::Status reserve(arrow::ArrayBuilder& builder, int64_t length) {
+  auto status = builder.Reserve(length);
+  if (status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(status)); }
+  if (!status.ok()) { return absl::InternalError(GetMessageFromStatus(status)); }
+  return absl::OkStatus();
+}
+
+// append the value of a string scalar, or a null if it isn't valid. Unlike the slots, the bytes of the strings aren't
+// reserved, so the append is checked.
+absl::Status appendString(arrow::StringBuilder& builder, const std::shared_ptr<arrow::Scalar>& value) {
+  auto status = value != nullptr && value->is_valid
+                    ? builder.Append(static_cast<const arrow::StringScalar&>(*value).view())
+                    : builder.AppendNull();
+  if (status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(status)); }
+  if (!status.ok()) { return absl::InternalError(GetMessageFromStatus(status)); }
+  return absl::OkStatus();
+}
+
+// the name of the operator class, used to attribute its memory.
+std::string OperatorName(PhysicalPlan& plan) {
+  const char* name = typeid(plan).name();
+#if defined(__GNUG__)
+  int status = 0;
+  std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+  if (status == 0) { return demangled.get(); }
+#endif
+  return name;
+}
+
+}  // namespace
+
 PhysicalPlan::~PhysicalPlan() { }
 
-Scan::Scan(std::shared_ptr<DataSource> data_source, std::vector<std::string> projection)
+void PhysicalPlan::Cancel() {
+  for (auto& child : Children()) { child->Cancel(); }
+}
+
+void PhysicalPlan::SetCancellationToken(std::shared_ptr<CancellationToken> token) {
+  token_ = token;
+  for (auto& child : Children()) { child->SetCancellationToken(token); }
+}
+
+void PhysicalPlan::SetMemoryPool(std::shared_ptr<TrackingMemoryPool> query_pool) {
+  query_pool_ = query_pool;
+  pool_ = query_pool->CreateChild(OperatorName(*this));
+  for (auto& child : Children()) { child->SetMemoryPool(query_pool); }
+}
+
+arrow::MemoryPool* PhysicalPlan::memoryPool() {
+  if (pool_ == nullptr) { return arrow::default_memory_pool(); }
+  return pool_.get();
+}
+
+int64_t PhysicalPlan::memoryAvailable() {
+  if (pool_ == nullptr) { return std::numeric_limits<int64_t>::max(); }
+  return pool_->Available();
+}
+
+absl::Status PhysicalPlan::reserveMemory(int64_t size) {
+  if (pool_ == nullptr) { return absl::OkStatus(); }
+  auto status = pool_->Reserve(size);
+  if (!status.ok()) { return absl::ResourceExhaustedError(GetMessageFromStatus(status)); }
+  return absl::OkStatus();
+}
+
+void PhysicalPlan::releaseMemory(int64_t size) {
+  if (pool_ != nullptr) { pool_->Release(size); }
+}
+
+Scan::Scan(
+    std::shared_ptr<DataSource> data_source,
+    std::vector<std::string> projection,
+    std::vector<ColumnPredicate> filter)
     : data_source_{ std::move(data_source) },
-      projection_{ projection } { }
+      projection_{ projection },
+      filter_{ std::move(filter) } { }
 
 Scan::~Scan() { }
 
@@ -28,18 +205,44 @@ absl::StatusOr<std::shared_ptr<arrow::Schema>> Scan::Schema() {
 std::vector<std::shared_ptr<PhysicalPlan>> Scan::Children() { return {}; }
 
 absl::Status Scan::Prepare() {
-  ASSIGN_OR_RETURN(batch_reader_, data_source_->Scan(projection_));
+  // a source executing a query of its own runs it under the token and the memory pool of this one.
+  ScanContext context{ QueryCancellationToken(), QueryMemoryPool(), parallelism_, prefetch_depth_ };
+  ASSIGN_OR_RETURN(batch_reader_, data_source_->Scan(projection_, filter_, context));
   return absl::OkStatus();
 }
 
 absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Scan::Next() {
-  auto maybe_batch = batch_reader_->Next();
-  if (!maybe_batch.ok()) { return absl::InternalError(GetMessageFromResult(maybe_batch)); }
-  return *maybe_batch;
+  while (!cancelled_) {
+    // the batches dropped by the runtime filters can make this loop long.
+    CHECK_OK_OR_RETURN(checkCancelled());
+    auto maybe_batch = batch_reader_->Next();
+    if (!maybe_batch.ok()) { return absl::InternalError(GetMessageFromResult(maybe_batch)); }
+    if (*maybe_batch == nullptr || runtime_filters_.empty()) { return *maybe_batch; }
+
+    // skip the batches which can't produce any match on the join side.
+    ASSIGN_OR_RETURN(auto batch, ApplyRuntimeFilters(*maybe_batch, runtime_filters_));
+    if (batch != nullptr) { return batch; }
+  }
+  return nullptr;
+}
+
+void Scan::Cancel() {
+  // dropping the reader stops reading and parsing the rest of the data source.
+  cancelled_ = true;
+  batch_reader_ = nullptr;
 }
 
 std::string Scan::ToString() { return "todo"; }
 
+void Scan::AddRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter) {
+  runtime_filters_.emplace_back(column_idx, std::move(filter));
+}
+
+void Scan::SetQueryOptions(int parallelism, int prefetch_depth) {
+  parallelism_ = parallelism;
+  prefetch_depth_ = prefetch_depth;
+}
+
 Projection::Projection(
     std::shared_ptr<PhysicalPlan> input,
     std::shared_ptr<arrow::Schema> schema,
@@ -57,20 +260,31 @@ std::vector<std::shared_ptr<PhysicalPlan>> Projection::Children() { return { inp
 absl::Status Projection::Prepare() { return input_->Prepare(); }
 
 absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Projection::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
   ASSIGN_OR_RETURN(auto batch, input_->Next());
   if (batch == nullptr) return nullptr;  // end of stream.
 
+  return Process(batch);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Projection::Process(std::shared_ptr<arrow::RecordBatch> batch) {
   std::vector<std::shared_ptr<arrow::Array>> columns;
   for (auto& expr : projection_) {
-    ASSIGN_OR_RETURN(auto col, expr->Evaluate(batch));
+    ASSIGN_OR_RETURN(auto col, expr->Evaluate(batch, memoryPool()));
     columns.push_back(col);
   }
 
-  return arrow::RecordBatch::Make(schema_, static_cast<int64_t>(projection_.size()), columns);
+  return arrow::RecordBatch::Make(schema_, batch->num_rows(), columns);
 }
 
 std::string Projection::ToString() { return "todo"; }
 
+int Projection::PassedThroughColumn(int column_idx) {
+  if (column_idx < 0 || column_idx >= projection_.size()) { return -1; }
+  auto column = std::dynamic_pointer_cast<Column>(projection_[column_idx]);
+  return column == nullptr ? -1 : column->Index();
+}
+
 Selection::Selection(std::shared_ptr<PhysicalPlan> input, std::shared_ptr<PhysicalExpression> predicate)
     : input_{ input },
       predicate_{ predicate } { }
@@ -84,61 +298,32 @@ std::vector<std::shared_ptr<PhysicalPlan>> Selection::Children() { return { inpu
 absl::Status Selection::Prepare() { return input_->Prepare(); }
 
 absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Selection::Next() {
-  ASSIGN_OR_RETURN(auto batch, input_->Next());
-  if (batch == nullptr) return nullptr;  // end of stream.
-
-  ASSIGN_OR_RETURN(auto schema, input_->Schema());
-
-  ASSIGN_OR_RETURN(auto filtering_result, predicate_->Evaluate(batch));
-  auto filter = std::static_pointer_cast<arrow::BooleanArray>(filtering_result);
+  CHECK_OK_OR_RETURN(checkCancelled());
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, input_->Next());
+    if (batch == nullptr) return nullptr;  // end of stream.
 
-  std::vector<std::shared_ptr<arrow::Array>> columns_post_filtering;
-  for (auto& column : batch->columns()) {
-    ASSIGN_OR_RETURN(auto filtered_column, filterColumn(column, filter));
-    columns_post_filtering.push_back(filtered_column);
+    ASSIGN_OR_RETURN(batch, Process(batch));
+    if (batch != nullptr) { return batch; }
   }
-
-  return arrow::RecordBatch::Make(schema, filter->true_count(), columns_post_filtering);
 }
 
-absl::StatusOr<std::shared_ptr<arrow::Array>> Selection::filterColumn(
-    std::shared_ptr<arrow::Array> data,
-    std::shared_ptr<arrow::BooleanArray> predicate) {
-#define FILTER_ARROW_ARRAY_WITH_PREDICATE(array_tp, builder_tp)                      \
-  auto typed_data = std::static_pointer_cast<array_tp>(data);                        \
-  builder_tp builder;                                                                \
-  builder.Reserve(predicate->true_count());                                          \
-                                                                                     \
-  for (int idx = 0; idx < typed_data->length(); idx++) {                             \
-    if (predicate->GetView(idx)) { builder.UnsafeAppend(typed_data->GetView(idx)); } \
-  }                                                                                  \
-                                                                                     \
-  auto array = builder.Finish();                                                     \
-  if (!array.ok()) { return absl::InternalError(GetMessageFromResult(array)); }      \
-  return *array;
-
-  switch (data->type_id()) {
-    case arrow::Type::BOOL: {
-      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::BooleanArray, arrow::BooleanBuilder);
-    }
-    case arrow::Type::INT64: {
-      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::Int64Array, arrow::Int64Builder);
-    }
-    case arrow::Type::DOUBLE: {
-      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::DoubleArray, arrow::DoubleBuilder);
-    }
-    case arrow::Type::STRING: {
-      FILTER_ARROW_ARRAY_WITH_PREDICATE(arrow::StringArray, arrow::StringBuilder);
-    }
-
-    default: return absl::InternalError("Unsupported type.");
-  }
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Selection::Process(std::shared_ptr<arrow::RecordBatch> batch) {
+  ASSIGN_OR_RETURN(auto filtering_result, predicate_->Evaluate(batch, memoryPool()));
+  auto filter = std::static_pointer_cast<arrow::BooleanArray>(filtering_result);
+  ASSIGN_OR_RETURN(batch, FilterRecordBatch(batch, filter, memoryPool()));
+  if (runtime_filters_.empty()) { return batch; }
 
-#undef FILTER_ARROW_ARRAY_WITH_PREDICATE
+  // drop the batches which can't produce any match on the join side.
+  return ApplyRuntimeFilters(batch, runtime_filters_);
 }
 
 std::string Selection::ToString() { return "todo"; }
 
+void Selection::AddRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter) {
+  runtime_filters_.emplace_back(column_idx, std::move(filter));
+}
+
 HashAggregation::HashAggregation(
     std::shared_ptr<PhysicalPlan> input,
     std::shared_ptr<arrow::Schema> schema,
@@ -149,7 +334,17 @@ HashAggregation::HashAggregation(
       grouping_expressions_{ grouping_expressions },
       aggregation_expressions_{ aggregation_expressions } { }
 
-HashAggregation::~HashAggregation() { }
+HashAggregation::HashAggregation(
+    std::shared_ptr<PhysicalPlan> input,
+    std::shared_ptr<arrow::Schema> schema,
+    std::vector<std::shared_ptr<HashAggregation>> partials)
+    : input_{ input },
+      schema_{ schema },
+      partials_{ partials } {
+  for (auto& partial : partials_) { partial->partial_ = true; }
+}
+
+HashAggregation::~HashAggregation() { releaseGroups(); }
 
 absl::StatusOr<std::shared_ptr<arrow::Schema>> HashAggregation::Schema() { return schema_; }
 
@@ -158,72 +353,91 @@ std::vector<std::shared_ptr<PhysicalPlan>> HashAggregation::Children() { return
 absl::Status HashAggregation::Prepare() { return input_->Prepare(); }
 
 absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregation::Next() {
-  if (batch_reader_ != nullptr) {
-    auto next_batch_or = batch_reader_->Next();
-    if (!next_batch_or.ok()) { return absl::InternalError(GetMessageFromResult(next_batch_or)); }
-    return *next_batch_or;
-  }
-
-  ASSIGN_OR_RETURN(auto all_batches, getAllInputBatches());
-
-  // map from the tuple of grouping keys to list of accumulators
-  // <gk1, gk2, gk3 .. gkx> -> [ac1, ac2, .. acy]
-  std::unordered_map<toyquery::Key, std::vector<std::shared_ptr<Accumulator>>> m;
-
-  for (auto& batch : all_batches) {
-    // calculate the grouping keys for this batch
-    std::vector<std::shared_ptr<arrow::Array>> grouping_keys;
-    for (auto& gk : grouping_expressions_) {
-      ASSIGN_OR_RETURN(auto gki, gk->Evaluate(batch));
-      grouping_keys.push_back(gki);
-    }
-
-    // calculate the input to the aggregate expressions.
-    // Eg: SUM (4 * Col_1) => 4 * Col_1 is the input.
-    std::vector<std::shared_ptr<arrow::Array>> aggregation_inputs;
-    for (auto& ai : aggregation_expressions_) {
-      ASSIGN_OR_RETURN(auto aii, ai->GetInputExpression()->Evaluate(batch));
-      aggregation_inputs.push_back(aii);
-    }
-
-    // process each row of the batch
-    for (int row_idx = 0; row_idx < batch->num_rows(); row_idx++) {
-      // get the row key for the hash map
-      std::vector<std::shared_ptr<arrow::Scalar>> row_key_vector;
-      for (auto& gk : grouping_keys) {
-        auto row_key_or = gk->GetScalar(row_idx);
-        if (!row_key_or.ok()) { return absl::InternalError(GetMessageFromResult(row_key_or)); }
-        row_key_vector.push_back(*row_key_or);
-      }
-      toyquery::Key row_key(row_key_vector);
-
-      // create accumulator for this row key if it doesn't exist.
-      if (m.find(row_key) == m.end()) {
-        std::vector<std::shared_ptr<Accumulator>> row_accumulators;
-        for (auto& ai : aggregation_expressions_) {
-          ASSIGN_OR_RETURN(auto accum, ai->CreateAccumulator());
-          row_accumulators.push_back(accum);
-        }
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (partial_) {
+    // the groups are left for the final aggregation to merge.
+    if (!consumed_) { CHECK_OK_OR_RETURN(consumeInput()); }
+    consumed_ = true;
+    return nullptr;
+  }
 
-        m[row_key] = row_accumulators;
-      }
+  if (batch_reader_ == nullptr) {
+    CHECK_OK_OR_RETURN(consumeInput());
+    CHECK_OK_OR_RETURN(Finish());
+  }
+
+  auto next_batch_or = batch_reader_->Next();
+  if (!next_batch_or.ok()) { return absl::InternalError(GetMessageFromResult(next_batch_or)); }
+  return *next_batch_or;
+}
+
+absl::Status HashAggregation::Consume(std::shared_ptr<arrow::RecordBatch> batch) {
+  // calculate the grouping keys for this batch
+  std::vector<std::shared_ptr<arrow::Array>> grouping_keys;
+  for (auto& gk : grouping_expressions_) {
+    ASSIGN_OR_RETURN(auto gki, gk->Evaluate(batch, memoryPool()));
+    grouping_keys.push_back(gki);
+  }
 
-      // perform the accumulation.
-      auto row_accumulators = m[row_key];
-      for (int accumulator_index = 0; accumulator_index < row_accumulators.size(); accumulator_index++) {
-        auto accumulator_input_or = aggregation_inputs.at(accumulator_index)->GetScalar(row_idx);
-        if (!accumulator_input_or.ok()) { return absl::InternalError(GetMessageFromResult(accumulator_input_or)); }
+  // calculate the input to the aggregate expressions.
+  // Eg: SUM (4 * Col_1) => 4 * Col_1 is the input.
+  std::vector<std::shared_ptr<arrow::Array>> aggregation_inputs;
+  for (auto& ai : aggregation_expressions_) {
+    ASSIGN_OR_RETURN(auto aii, ai->GetInputExpression()->Evaluate(batch, memoryPool()));
+    aggregation_inputs.push_back(aii);
+  }
 
-        CHECK_OK_OR_RETURN(row_accumulators.at(accumulator_index)->Accumulate(*accumulator_input_or));
+  // process each row of the batch
+  for (int row_idx = 0; row_idx < batch->num_rows(); row_idx++) {
+    // get the row key for the hash map
+    std::vector<std::shared_ptr<arrow::Scalar>> row_key_vector;
+    for (auto& gk : grouping_keys) {
+      auto row_key_or = gk->GetScalar(row_idx);
+      if (!row_key_or.ok()) { return absl::InternalError(GetMessageFromResult(row_key_or)); }
+      row_key_vector.push_back(*row_key_or);
+    }
+    toyquery::Key row_key(row_key_vector);
+
+    // create accumulator for this row key if it doesn't exist.
+    if (groups_.find(row_key) == groups_.end()) {
+      std::vector<std::shared_ptr<Accumulator>> row_accumulators;
+      for (auto& ai : aggregation_expressions_) {
+        ASSIGN_OR_RETURN(auto accum, ai->CreateAccumulator());
+        row_accumulators.push_back(accum);
       }
+
+      CHECK_OK_OR_RETURN(reserveGroup());
+      groups_[row_key] = row_accumulators;
+    }
+
+    // perform the accumulation.
+    auto& row_accumulators = groups_[row_key];
+    for (int accumulator_index = 0; accumulator_index < row_accumulators.size(); accumulator_index++) {
+      auto accumulator_input_or = aggregation_inputs.at(accumulator_index)->GetScalar(row_idx);
+      if (!accumulator_input_or.ok()) { return absl::InternalError(GetMessageFromResult(accumulator_input_or)); }
+
+      CHECK_OK_OR_RETURN(row_accumulators.at(accumulator_index)->Accumulate(*accumulator_input_or));
     }
   }
 
+  return absl::OkStatus();
+}
+
+absl::Status HashAggregation::Finish() {
+  CHECK_OK_OR_RETURN(mergePartials());
+
+  auto& m = groups_;
   std::vector<std::shared_ptr<arrow::Array>> aggregated_data(schema_->num_fields());
   int num_rows = m.size();
 
-  std::vector<std::shared_ptr<arrow::ArrayBuilder>> builders(schema_->num_fields());
-  for (auto& b : builders) { b->Reserve(num_rows); }
+  std::vector<std::shared_ptr<arrow::ArrayBuilder>> builders;
+  for (auto& field : schema_->fields()) {
+    auto builder_or = arrow::MakeBuilder(field->type(), memoryPool());
+    if (!builder_or.ok()) { return absl::InternalError(GetMessageFromResult(builder_or)); }
+    builders.push_back(std::move(*builder_or));
+
+    CHECK_OK_OR_RETURN(reserve(*builders.back(), num_rows));
+  }
 
   for (auto& it : m) {
     auto& gk = it.first;
@@ -249,7 +463,8 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregation::Next() {
           break;
         }
         case arrow::Type::STRING: {
-          // TODO
+          auto typed_builder = std::static_pointer_cast<arrow::StringBuilder>(builders.at(col_idx));
+          CHECK_OK_OR_RETURN(appendString(*typed_builder, gk.scalars_[col_idx]));
           break;
         }
         default: return absl::InternalError("Unsupported type");
@@ -259,10 +474,14 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregation::Next() {
 
     // insert the accumulated values for the row key.
     for (int col_idx = gk.scalars_.size(); col_idx < gk.scalars_.size() + accum.size(); col_idx++) {
-#define APPEND_ACCUMULATED_SCALAR(builder_type, scaler_type)                         \
-  auto typed_builder = std::static_pointer_cast<builder_type>(builders.at(col_idx)); \
-  ASSIGN_OR_RETURN(auto accum_value, accum[accum_idx]->FinalValue());                \
-  typed_builder->UnsafeAppend(std::static_pointer_cast<scaler_type>(accum_value)->value);
+#define APPEND_ACCUMULATED_SCALAR(builder_type, scaler_type)                                \
+  auto typed_builder = std::static_pointer_cast<builder_type>(builders.at(col_idx));        \
+  ASSIGN_OR_RETURN(auto accum_value, accum[accum_idx]->FinalValue());                       \
+  if (accum_value == nullptr || !accum_value->is_valid) {                                   \
+    typed_builder->UnsafeAppendNull();                                                      \
+  } else {                                                                                  \
+    typed_builder->UnsafeAppend(std::static_pointer_cast<scaler_type>(accum_value)->value); \
+  }
 
       auto accum_idx = col_idx - gk.scalars_.size();
       switch (schema_->field(col_idx)->type()->id()) {
@@ -279,7 +498,9 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregation::Next() {
           break;
         }
         case arrow::Type::STRING: {
-          // TODO
+          auto typed_builder = std::static_pointer_cast<arrow::StringBuilder>(builders.at(col_idx));
+          ASSIGN_OR_RETURN(auto accum_value, accum[accum_idx]->FinalValue());
+          CHECK_OK_OR_RETURN(appendString(*typed_builder, accum_value));
           break;
         }
         default: return absl::InternalError("Unsupported type");
@@ -297,32 +518,1329 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregation::Next() {
 
   processed_table_ = arrow::Table::Make(schema_, aggregated_data);
   batch_reader_ = std::make_unique<arrow::TableBatchReader>(processed_table_.operator*());
-
-  auto first_batch_or = batch_reader_->Next();
-  if (!first_batch_or.ok()) { return absl::InternalError(GetMessageFromResult(first_batch_or)); }
-  return *first_batch_or;
+  m.clear();
+  releaseGroups();
+  return absl::OkStatus();
 }
 
-absl::StatusOr<std::vector<std::shared_ptr<arrow::RecordBatch>>> HashAggregation::getAllInputBatches() {
-  std::vector<std::shared_ptr<arrow::RecordBatch>> all_batches;
-
+absl::Status HashAggregation::consumeInput() {
   while (true) {
     auto maybe_batch = input_->Next();
     if (!maybe_batch.ok()) {
       if (absl::IsNotFound(maybe_batch.status())) {
-        return all_batches;
+        return absl::OkStatus();
       } else {
         return maybe_batch.status();
       }
     }
+    if (*maybe_batch == nullptr) { return absl::OkStatus(); }  // end of stream.
+
+    CHECK_OK_OR_RETURN(Consume(*maybe_batch));
+  }
+}
+
+absl::Status HashAggregation::mergePartials() {
+  // the input drained, the partial aggregations are done with their groups.
+  for (auto& partial : partials_) {
+    for (auto& it : partial->groups_) {
+      auto group = groups_.find(it.first);
+      if (group == groups_.end()) {
+        CHECK_OK_OR_RETURN(reserveGroup());
+        groups_.emplace(it.first, std::move(it.second));
+        continue;
+      }
 
-    all_batches.push_back(*maybe_batch);
+      for (int accumulator_index = 0; accumulator_index < group->second.size(); accumulator_index++) {
+        CHECK_OK_OR_RETURN(group->second[accumulator_index]->Merge(*it.second[accumulator_index]));
+      }
+    }
+    partial->groups_.clear();
+    partial->releaseGroups();
   }
+  partials_.clear();
+  return absl::OkStatus();
+}
 
-  return all_batches;
+absl::Status HashAggregation::reserveGroup() {
+  auto size = GROUP_BYTES + schema_->num_fields() * GROUP_COLUMN_BYTES;
+  CHECK_OK_OR_RETURN(reserveMemory(size));
+  reserved_bytes_ += size;
+  return absl::OkStatus();
+}
+
+void HashAggregation::releaseGroups() {
+  releaseMemory(reserved_bytes_);
+  reserved_bytes_ = 0;
 }
 
 std::string HashAggregation::ToString() { return "todo"; }
 
+HashJoin::HashJoin(
+    std::shared_ptr<PhysicalPlan> probe,
+    std::shared_ptr<PhysicalPlan> build,
+    std::shared_ptr<arrow::Schema> schema,
+    std::vector<int> probe_keys,
+    std::vector<int> build_keys)
+    : probe_{ probe },
+      build_{ build },
+      schema_{ schema },
+      probe_keys_{ probe_keys },
+      build_keys_{ build_keys } {
+  for (int i = 0; i < probe_keys_.size(); i++) {
+    runtime_filters_.push_back(std::make_shared<RuntimeFilter>(fmt::format("join_key_{}", i)));
+  }
+}
+
+HashJoin::~HashJoin() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> HashJoin::Schema() { return schema_; }
+
+std::vector<std::shared_ptr<PhysicalPlan>> HashJoin::Children() { return { probe_, build_ }; }
+
+absl::Status HashJoin::Prepare() {
+  CHECK_OK_OR_RETURN(probe_->Prepare());
+  return build_->Prepare();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashJoin::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (!built_) { CHECK_OK_OR_RETURN(build()); }
+
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, probe_->Next());
+    if (batch == nullptr) return nullptr;  // end of stream.
+
+    if (!probe_filters_.empty()) {
+      ASSIGN_OR_RETURN(batch, ApplyRuntimeFilters(batch, probe_filters_));
+      if (batch == nullptr) { continue; }
+    }
+
+    ASSIGN_OR_RETURN(auto joined, probeJoinHashTable(hash_table_, build_columns_, batch, probe_keys_, schema_));
+    if (joined != nullptr) { return joined; }
+  }
+}
+
+std::string HashJoin::ToString() { return "todo"; }
+
+std::vector<std::shared_ptr<RuntimeFilter>> HashJoin::RuntimeFilters() { return runtime_filters_; }
+
+void HashJoin::AddProbeRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter) {
+  probe_filters_.emplace_back(column_idx, std::move(filter));
+}
+
+absl::Status HashJoin::build() {
+  ASSIGN_OR_RETURN(auto build_schema, build_->Schema());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> build_batches;
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, build_->Next());
+    if (batch == nullptr) { break; }
+    build_batches.push_back(batch);
+  }
+
+  ASSIGN_OR_RETURN(build_columns_, ConcatenateRecordBatches(build_schema, build_batches, memoryPool()));
+  ASSIGN_OR_RETURN(hash_table_, buildJoinHashTable(build_columns_, build_keys_));
+
+  // publish the runtime filters for the probe side.
+  for (int i = 0; i < build_keys_.size(); i++) {
+    CHECK_OK_OR_RETURN(runtime_filters_[i]->Publish({ build_columns_[build_keys_[i]] }));
+  }
+
+  built_ = true;
+  return absl::OkStatus();
+}
+
+SpillScan::SpillScan(std::string path, std::shared_ptr<arrow::Schema> schema)
+    : path_{ std::move(path) },
+      schema_{ schema } { }
+
+SpillScan::~SpillScan() {
+  // the reader deletes the file once done, it has to be done here if the scan was never prepared.
+  if (reader_ == nullptr) {
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+  }
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> SpillScan::Schema() { return schema_; }
+
+std::vector<std::shared_ptr<PhysicalPlan>> SpillScan::Children() { return {}; }
+
+absl::Status SpillScan::Prepare() {
+  ASSIGN_OR_RETURN(reader_, SpillFileReader::Open(path_));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> SpillScan::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  return reader_->Next();
+}
+
+std::string SpillScan::ToString() { return "todo"; }
+
+GraceHashJoin::GraceHashJoin(
+    std::shared_ptr<PhysicalPlan> probe,
+    std::shared_ptr<PhysicalPlan> build,
+    std::shared_ptr<arrow::Schema> schema,
+    std::vector<int> probe_keys,
+    std::vector<int> build_keys,
+    int64_t memory_limit,
+    int num_partitions,
+    std::string spill_directory,
+    int level)
+    : probe_{ probe },
+      build_{ build },
+      schema_{ schema },
+      probe_keys_{ probe_keys },
+      build_keys_{ build_keys },
+      memory_limit_{ memory_limit },
+      num_partitions_{ std::max(num_partitions, 1) },
+      spill_directory_{ std::move(spill_directory) },
+      level_{ level },
+      partitions_(num_partitions_) {
+  for (int i = 0; i < probe_keys_.size(); i++) {
+    runtime_filters_.push_back(std::make_shared<RuntimeFilter>(fmt::format("join_key_{}", i)));
+  }
+}
+
+GraceHashJoin::~GraceHashJoin() {
+  // remove the spill files which weren't consumed, in case the join didn't run until the end.
+  std::error_code ec;
+  for (auto& partition : partitions_) {
+    if (partition.build_file != nullptr) { std::filesystem::remove(partition.build_file->Path(), ec); }
+    if (partition.probe_file != nullptr) { std::filesystem::remove(partition.probe_file->Path(), ec); }
+  }
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> GraceHashJoin::Schema() { return schema_; }
+
+std::vector<std::shared_ptr<PhysicalPlan>> GraceHashJoin::Children() { return { probe_, build_ }; }
+
+absl::Status GraceHashJoin::Prepare() {
+  CHECK_OK_OR_RETURN(probe_->Prepare());
+  return build_->Prepare();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> GraceHashJoin::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (!built_) { CHECK_OK_OR_RETURN(build()); }
+
+  while (!probe_done_) {
+    ASSIGN_OR_RETURN(auto batch, probe_->Next());
+    if (batch == nullptr) {
+      probe_done_ = true;
+      for (auto& partition : partitions_) {
+        if (partition.probe_file == nullptr) { continue; }
+        CHECK_OK_OR_RETURN(partition.probe_file->Close());
+        metrics_.spilled_rows += partition.probe_file->NumRows();
+        metrics_.spilled_bytes += partition.probe_file->NumBytes();
+      }
+      break;
+    }
+
+    // the rows dropped here are neither spilled nor probed.
+    if (!probe_filters_.empty()) {
+      ASSIGN_OR_RETURN(batch, ApplyRuntimeFilters(batch, probe_filters_));
+      if (batch == nullptr) { continue; }
+    }
+
+    // the probe rows of the spilled partitions are spilled as well, they are joined once the probe side is exhausted.
+    if (metrics_.spilled_partitions > 0) {
+      ASSIGN_OR_RETURN(auto probe_schema, probe_->Schema());
+      ASSIGN_OR_RETURN(auto partitioned, partitionBatch(batch, probe_keys_));
+      for (int partition_idx = 0; partition_idx < num_partitions_; partition_idx++) {
+        auto& partition = partitions_[partition_idx];
+        if (partition.build_file == nullptr || partitioned[partition_idx] == nullptr) { continue; }
+        if (partition.probe_file == nullptr) {
+          ASSIGN_OR_RETURN(
+              partition.probe_file,
+              SpillFileWriter::Open(MakeSpillPath(spill_directory_, "hashjoin_probe"), probe_schema));
+          metrics_.spill_files++;
+        }
+        CHECK_OK_OR_RETURN(partition.probe_file->Write(partitioned[partition_idx]));
+      }
+    }
+
+    // the keys of the spilled partitions are not in the hash table so only the rows of the in-memory partitions match.
+    ASSIGN_OR_RETURN(auto joined, probeJoinHashTable(hash_table_, build_columns_, batch, probe_keys_, schema_));
+    if (joined != nullptr) { return joined; }
+  }
+
+  return nextFromSpilledPartitions();
+}
+
+std::string GraceHashJoin::ToString() { return "todo"; }
+
+std::vector<std::shared_ptr<RuntimeFilter>> GraceHashJoin::RuntimeFilters() { return runtime_filters_; }
+
+void GraceHashJoin::AddProbeRuntimeFilter(int column_idx, std::shared_ptr<RuntimeFilter> filter) {
+  probe_filters_.emplace_back(column_idx, std::move(filter));
+}
+
+absl::Status GraceHashJoin::build() {
+  ASSIGN_OR_RETURN(auto build_schema, build_->Schema());
+
+  // the keys of the spilled partitions can match as well, the key columns of all the build batches are kept until the
+  // runtime filters are published. The nested joins read both sides from spill files, nothing filters on their keys.
+  std::vector<std::vector<std::shared_ptr<arrow::Array>>> build_keys(build_keys_.size());
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, build_->Next());
+    if (batch == nullptr) { break; }
+    if (level_ == 0) {
+      for (int i = 0; i < build_keys_.size(); i++) { build_keys[i].push_back(batch->column(build_keys_[i])); }
+    }
+
+    ASSIGN_OR_RETURN(auto partitioned, partitionBatch(batch, build_keys_));
+    for (int partition_idx = 0; partition_idx < num_partitions_; partition_idx++) {
+      auto& partition = partitions_[partition_idx];
+      auto& partition_batch = partitioned[partition_idx];
+      if (partition_batch == nullptr) { continue; }
+
+      if (partition.build_file != nullptr) {
+        CHECK_OK_OR_RETURN(partition.build_file->Write(partition_batch));
+        continue;
+      }
+
+      auto batch_bytes = arrow::util::TotalBufferSize(*partition_batch);
+      partition.build_batches.push_back(partition_batch);
+      partition.build_bytes += batch_bytes;
+      memory_used_ += batch_bytes;
+
+      // spill the largest in-memory partitions until the build side fits in the memory limit.
+      while (memory_used_ > std::min(memory_limit_, memoryAvailable())) {
+        int largest = -1;
+        for (int idx = 0; idx < num_partitions_; idx++) {
+          if (partitions_[idx].build_file != nullptr || partitions_[idx].build_bytes == 0) { continue; }
+          if (largest == -1 || partitions_[idx].build_bytes > partitions_[largest].build_bytes) { largest = idx; }
+        }
+        if (largest == -1) { break; }
+
+        CHECK_OK_OR_RETURN(spillPartition(largest));
+      }
+    }
+  }
+
+  // the in-memory partitions are joined using a single hash table since their keys are disjoint.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> in_memory_batches;
+  for (auto& partition : partitions_) {
+    if (partition.build_file != nullptr) {
+      CHECK_OK_OR_RETURN(partition.build_file->Close());
+      metrics_.spilled_rows += partition.build_file->NumRows();
+      metrics_.spilled_bytes += partition.build_file->NumBytes();
+      continue;
+    }
+
+    for (auto& batch : partition.build_batches) { in_memory_batches.push_back(batch); }
+    partition.build_batches.clear();
+  }
+
+  ASSIGN_OR_RETURN(build_columns_, ConcatenateRecordBatches(build_schema, in_memory_batches, memoryPool()));
+  ASSIGN_OR_RETURN(hash_table_, buildJoinHashTable(build_columns_, build_keys_));
+
+  // publish the runtime filters for the probe side.
+  if (level_ == 0) {
+    for (int i = 0; i < build_keys_.size(); i++) { CHECK_OK_OR_RETURN(runtime_filters_[i]->Publish(build_keys[i])); }
+  }
+
+  built_ = true;
+  return absl::OkStatus();
+}
+
+absl::Status GraceHashJoin::spillPartition(int partition_idx) {
+  auto& partition = partitions_[partition_idx];
+
+  ASSIGN_OR_RETURN(auto build_schema, build_->Schema());
+  ASSIGN_OR_RETURN(
+      partition.build_file, SpillFileWriter::Open(MakeSpillPath(spill_directory_, "hashjoin_build"), build_schema));
+  for (auto& batch : partition.build_batches) { CHECK_OK_OR_RETURN(partition.build_file->Write(batch)); }
+
+  memory_used_ -= partition.build_bytes;
+  partition.build_batches.clear();
+  partition.build_bytes = 0;
+
+  metrics_.spilled_partitions++;
+  metrics_.spill_files++;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> GraceHashJoin::nextFromSpilledPartitions() {
+  while (true) {
+    if (current_join_ != nullptr) {
+      ASSIGN_OR_RETURN(auto batch, current_join_->Next());
+      if (batch != nullptr) { return batch; }
+
+      auto nested_metrics = current_join_->Metrics();
+      metrics_.spilled_partitions += nested_metrics.spilled_partitions;
+      metrics_.spilled_rows += nested_metrics.spilled_rows;
+      metrics_.spilled_bytes += nested_metrics.spilled_bytes;
+      metrics_.spill_files += nested_metrics.spill_files;
+      metrics_.max_recursion_depth = std::max(metrics_.max_recursion_depth, nested_metrics.max_recursion_depth);
+      current_join_ = nullptr;
+    }
+
+    current_partition_++;
+    if (current_partition_ >= num_partitions_) { return nullptr; }  // end of stream.
+
+    auto& partition = partitions_[current_partition_];
+    if (partition.build_file == nullptr) { continue; }
+    if (partition.probe_file == nullptr) {
+      // no probe row fell in this partition so none of its build rows can match.
+      std::error_code ec;
+      std::filesystem::remove(partition.build_file->Path(), ec);
+      continue;
+    }
+
+    ASSIGN_OR_RETURN(auto probe_schema, probe_->Schema());
+    ASSIGN_OR_RETURN(auto build_schema, build_->Schema());
+    auto probe = std::make_shared<SpillScan>(partition.probe_file->Path(), probe_schema);
+    auto build = std::make_shared<SpillScan>(partition.build_file->Path(), build_schema);
+
+    // the nested join repartitions using other hash bits. Past the maximum level, the partition is joined in memory
+    // since repartitioning doesn't help when most of the rows share the same key.
+    int64_t memory_limit = level_ + 1 >= MAX_GRACE_HASH_JOIN_LEVEL ? std::numeric_limits<int64_t>::max() : memory_limit_;
+    current_join_ = std::make_shared<GraceHashJoin>(
+        probe, build, schema_, probe_keys_, build_keys_, memory_limit, num_partitions_, spill_directory_, level_ + 1);
+    metrics_.max_recursion_depth = std::max(metrics_.max_recursion_depth, level_ + 1);
+
+    // the nested join is part of the same query, it's cancelled with it and its memory counts against its limit.
+    current_join_->SetCancellationToken(QueryCancellationToken());
+    if (QueryMemoryPool() != nullptr) { current_join_->SetMemoryPool(QueryMemoryPool()); }
+    CHECK_OK_OR_RETURN(current_join_->Prepare());
+  }
+}
+
+absl::StatusOr<std::vector<std::shared_ptr<arrow::RecordBatch>>> GraceHashJoin::partitionBatch(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    const std::vector<int>& keys) {
+  std::vector<std::vector<int64_t>> partition_rows(num_partitions_);
+  for (int64_t row_idx = 0; row_idx < batch->num_rows(); row_idx++) {
+    uint64_t hash = 0;
+    bool has_null = false;
+    for (auto& key : keys) {
+      auto& column = *batch->column(key);
+      has_null |= column.IsNull(row_idx);
+      hash = hash * 31 + HashArrayValue(column, row_idx);
+    }
+    if (has_null) { continue; }
+
+    // each level uses different bits of the hash so that a spilled partition gets split by the nested join.
+    partition_rows[(hash >> (8 * level_)) % num_partitions_].push_back(row_idx);
+  }
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> partitioned(num_partitions_);
+  for (int partition_idx = 0; partition_idx < num_partitions_; partition_idx++) {
+    if (partition_rows[partition_idx].empty()) { continue; }
+    ASSIGN_OR_RETURN(partitioned[partition_idx], TakeRecordBatch(batch, partition_rows[partition_idx]));
+  }
+  return partitioned;
+}
+
+SortMergeJoin::SortMergeJoin(
+    std::shared_ptr<PhysicalPlan> left,
+    std::shared_ptr<PhysicalPlan> right,
+    std::shared_ptr<arrow::Schema> schema,
+    std::vector<int> left_keys,
+    std::vector<int> right_keys)
+    : left_{ left },
+      right_{ right },
+      schema_{ schema },
+      left_keys_{ left_keys },
+      right_keys_{ right_keys } { }
+
+SortMergeJoin::~SortMergeJoin() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> SortMergeJoin::Schema() { return schema_; }
+
+std::vector<std::shared_ptr<PhysicalPlan>> SortMergeJoin::Children() { return { left_, right_ }; }
+
+absl::Status SortMergeJoin::Prepare() {
+  ASSIGN_OR_RETURN(auto left_schema, left_->Schema());
+  ASSIGN_OR_RETURN(auto right_schema, right_->Schema());
+  if (left_keys_.size() != right_keys_.size()) { return absl::InvalidArgumentError("join keys count mismatch"); }
+  for (int i = 0; i < left_keys_.size(); i++) {
+    if (!left_schema->field(left_keys_[i])->type()->Equals(right_schema->field(right_keys_[i])->type())) {
+      return absl::InvalidArgumentError("join keys have different types");
+    }
+  }
+
+  CHECK_OK_OR_RETURN(left_->Prepare());
+  return right_->Prepare();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> SortMergeJoin::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (!started_) {
+    // position both cursors on the first row.
+    started_ = true;
+    left_cursor_.row = -1;
+    right_cursor_.row = -1;
+    CHECK_OK_OR_RETURN(advance(left_cursor_, left_));
+    CHECK_OK_OR_RETURN(advance(right_cursor_, right_));
+  }
+
+  while (output_rows_ < SORT_MERGE_JOIN_BATCH_SIZE) {
+    if (!right_run_.empty()) {
+      // join every left row having the key of the run with all the rows of the run.
+      CHECK_OK_OR_RETURN(skipNullKeys(left_cursor_, left_, left_keys_));
+      RowRef left_row{ left_cursor_.batch, left_cursor_.row };
+      if (!left_cursor_.done && compareKeys(left_row, left_keys_, right_run_[0], right_keys_) == 0) {
+        for (auto& right_row : right_run_) {
+          appendOutputRow(left_output_, left_row);
+          appendOutputRow(right_output_, right_row);
+        }
+        output_rows_ += right_run_.size();
+        CHECK_OK_OR_RETURN(advance(left_cursor_, left_));
+        continue;
+      }
+
+      right_run_.clear();
+    }
+
+    CHECK_OK_OR_RETURN(skipNullKeys(left_cursor_, left_, left_keys_));
+    CHECK_OK_OR_RETURN(skipNullKeys(right_cursor_, right_, right_keys_));
+    if (left_cursor_.done || right_cursor_.done) { break; }  // no more matches are possible.
+
+    RowRef left_row{ left_cursor_.batch, left_cursor_.row };
+    RowRef right_row{ right_cursor_.batch, right_cursor_.row };
+    auto cmp = compareKeys(left_row, left_keys_, right_row, right_keys_);
+    if (cmp < 0) {
+      CHECK_OK_OR_RETURN(advance(left_cursor_, left_));
+    } else if (cmp > 0) {
+      CHECK_OK_OR_RETURN(advance(right_cursor_, right_));
+    } else {
+      // collect the run of right rows sharing this key, it may span several batches.
+      while (true) {
+        right_run_.emplace_back(right_cursor_.batch, right_cursor_.row);
+        CHECK_OK_OR_RETURN(advance(right_cursor_, right_));
+        CHECK_OK_OR_RETURN(skipNullKeys(right_cursor_, right_, right_keys_));
+        if (right_cursor_.done) { break; }
+
+        RowRef next_row{ right_cursor_.batch, right_cursor_.row };
+        if (compareKeys(next_row, right_keys_, right_run_[0], right_keys_) != 0) { break; }
+      }
+    }
+  }
+
+  if (output_rows_ == 0) { return nullptr; }  // end of stream.
+  return flushOutput();
+}
+
+std::string SortMergeJoin::ToString() { return "todo"; }
+
+absl::Status SortMergeJoin::advance(Cursor& cursor, std::shared_ptr<PhysicalPlan>& input) {
+  cursor.row++;
+  while (!cursor.done && (cursor.batch == nullptr || cursor.row >= cursor.batch->num_rows())) {
+    ASSIGN_OR_RETURN(cursor.batch, input->Next());
+    cursor.row = 0;
+    cursor.done = cursor.batch == nullptr;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SortMergeJoin::skipNullKeys(
+    Cursor& cursor,
+    std::shared_ptr<PhysicalPlan>& input,
+    const std::vector<int>& keys) {
+  while (!cursor.done) {
+    bool has_null = false;
+    for (auto& key : keys) { has_null |= cursor.batch->column(key)->IsNull(cursor.row); }
+    if (!has_null) { break; }
+
+    CHECK_OK_OR_RETURN(advance(cursor, input));
+  }
+  return absl::OkStatus();
+}
+
+int SortMergeJoin::compareKeys(
+    const RowRef& left,
+    const std::vector<int>& left_keys,
+    const RowRef& right,
+    const std::vector<int>& right_keys) {
+  for (int i = 0; i < left_keys.size(); i++) {
+    auto cmp = CompareArrayValues(
+        *left.first->column(left_keys[i]), left.second, *right.first->column(right_keys[i]), right.second);
+    if (cmp != 0) { return cmp; }
+  }
+  return 0;
+}
+
+void SortMergeJoin::appendOutputRow(std::vector<OutputPiece>& pieces, const RowRef& row) {
+  if (pieces.empty() || pieces.back().batch != row.first) { pieces.push_back({ row.first, {} }); }
+  pieces.back().indices.push_back(row.second);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> SortMergeJoin::flushOutput() {
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (auto* pieces : { &left_output_, &right_output_ }) {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> taken_pieces;
+    for (auto& piece : *pieces) {
+      ASSIGN_OR_RETURN(auto taken, TakeRecordBatch(piece.batch, piece.indices));
+      taken_pieces.push_back(taken);
+    }
+
+    ASSIGN_OR_RETURN(
+        auto side_columns, ConcatenateRecordBatches(pieces->front().batch->schema(), taken_pieces, memoryPool()));
+    for (auto& column : side_columns) { columns.push_back(column); }
+    pieces->clear();
+  }
+
+  auto num_rows = output_rows_;
+  output_rows_ = 0;
+  return arrow::RecordBatch::Make(schema_, num_rows, columns);
+}
+
+Sort::Sort(
+    std::shared_ptr<PhysicalPlan> input,
+    std::vector<SortKey> sort_keys,
+    int64_t memory_limit,
+    std::string spill_directory)
+    : input_{ input },
+      sort_keys_{ sort_keys },
+      memory_limit_{ memory_limit },
+      spill_directory_{ spill_directory } { }
+
+Sort::~Sort() {
+  // the readers delete the runs being merged, the remaining ones were never read back.
+  runs_.clear();
+  for (auto& path : run_paths_) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+  }
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Sort::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> Sort::Children() { return { input_ }; }
+
+absl::Status Sort::Prepare() { return input_->Prepare(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Sort::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (!sorted_input_) {
+    CHECK_OK_OR_RETURN(consumeInput());
+    CHECK_OK_OR_RETURN(Finish());
+  }
+  if (merge_tree_ != nullptr) { return mergeRuns(); }
+  if (offset_ >= sorted_->num_rows()) { return nullptr; }  // end of stream.
+
+  auto batch = sorted_->Slice(offset_, SORT_BATCH_SIZE);
+  offset_ += batch->num_rows();
+  return batch;
+}
+
+std::string Sort::ToString() { return "todo"; }
+
+absl::Status Sort::consumeInput() {
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, input_->Next());
+    if (batch == nullptr) { return absl::OkStatus(); }
+    CHECK_OK_OR_RETURN(Consume(batch));
+  }
+}
+
+absl::Status Sort::Consume(std::shared_ptr<arrow::RecordBatch> batch) {
+  buffered_.push_back(batch);
+  buffered_bytes_ += arrow::util::TotalBufferSize(*batch);
+  // the sorted run is allocated from the query pool, the buffered batches have to fit in what's left of it.
+  if (buffered_bytes_ <= std::min(memory_limit_, memoryAvailable())) { return absl::OkStatus(); }
+
+  ASSIGN_OR_RETURN(auto schema, input_->Schema());
+  CHECK_OK_OR_RETURN(spillRun(schema, buffered_));
+  buffered_.clear();
+  buffered_bytes_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status Sort::Finish() {
+  sorted_input_ = true;
+  ASSIGN_OR_RETURN(auto schema, input_->Schema());
+  ASSIGN_OR_RETURN(sorted_, sortBatches(schema, buffered_));
+  buffered_.clear();
+  if (run_paths_.empty()) { return absl::OkStatus(); }  // everything fits in memory.
+
+  // merge the spilled runs along with the rows left in memory, which form the last run.
+  for (int i = 0; i < run_paths_.size(); i++) {
+    runs_.emplace_back();
+    ASSIGN_OR_RETURN(runs_.back().reader, SpillFileReader::Open(run_paths_[i]));
+  }
+  runs_.emplace_back();
+  runs_.back().batch = sorted_;
+  ASSIGN_OR_RETURN(runs_.back().keys, EvaluateSortKeys(sorted_, sort_keys_, memoryPool()));
+  sorted_ = nullptr;
+
+  for (auto& run : runs_) {
+    run.row = -1;
+    CHECK_OK_OR_RETURN(advanceRun(run));
+  }
+
+  merge_tree_ = std::make_unique<LoserTree>(runs_.size(), [this](int a, int b) { return runLess(a, b); });
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Sort::sortBatches(
+    std::shared_ptr<arrow::Schema> schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches) {
+  ASSIGN_OR_RETURN(auto columns, ConcatenateRecordBatches(schema, batches, memoryPool()));
+  auto num_rows = columns.empty() ? 0 : columns[0]->length();
+  auto input = arrow::RecordBatch::Make(schema, num_rows, columns);
+
+  ASSIGN_OR_RETURN(auto keys, EvaluateSortKeys(input, sort_keys_, memoryPool()));
+  return TakeRecordBatch(input, SortIndices(keys, sort_keys_));
+}
+
+absl::Status Sort::spillRun(
+    std::shared_ptr<arrow::Schema> schema,
+    const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches) {
+  ASSIGN_OR_RETURN(auto sorted, sortBatches(schema, batches));
+  ASSIGN_OR_RETURN(
+      auto writer, SpillFileWriter::Open(MakeSpillPath(spill_directory_, "sort"), schema, SORT_SPILL_COMPRESSION));
+  run_paths_.push_back(writer->Path());
+
+  // the run is read back one batch at a time while merging.
+  for (int64_t offset = 0; offset < sorted->num_rows(); offset += SORT_BATCH_SIZE) {
+    CHECK_OK_OR_RETURN(writer->Write(sorted->Slice(offset, SORT_BATCH_SIZE)));
+  }
+  CHECK_OK_OR_RETURN(writer->Close());
+
+  metrics_.spilled_partitions++;
+  metrics_.spill_files++;
+  metrics_.spilled_rows += writer->NumRows();
+  metrics_.spilled_bytes += writer->NumBytes();
+  return absl::OkStatus();
+}
+
+absl::Status Sort::advanceRun(Run& run) {
+  run.row++;
+  while (run.batch == nullptr || run.row >= run.batch->num_rows()) {
+    run.batch = nullptr;
+    run.keys.clear();
+    if (run.reader == nullptr) { return absl::OkStatus(); }  // the run is exhausted.
+
+    ASSIGN_OR_RETURN(run.batch, run.reader->Next());
+    if (run.batch == nullptr) {
+      run.reader = nullptr;
+      return absl::OkStatus();
+    }
+    ASSIGN_OR_RETURN(run.keys, EvaluateSortKeys(run.batch, sort_keys_, memoryPool()));
+    run.row = 0;
+  }
+  return absl::OkStatus();
+}
+
+bool Sort::runLess(int a, int b) {
+  // the exhausted runs lose against every other run.
+  bool a_done = runs_[a].batch == nullptr, b_done = runs_[b].batch == nullptr;
+  if (a_done != b_done) { return b_done; }
+  if (a_done) { return a < b; }
+
+  auto cmp = CompareSortKeys(runs_[a].keys, runs_[a].row, runs_[b].keys, runs_[b].row, sort_keys_);
+  return cmp != 0 ? cmp < 0 : a < b;  // ties are broken on the run index to keep the sort stable.
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Sort::mergeRuns() {
+  ASSIGN_OR_RETURN(auto schema, input_->Schema());
+
+  // consecutive rows of the same run batch are gathered together.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> pieces;
+  std::shared_ptr<arrow::RecordBatch> piece_batch;
+  std::vector<int64_t> piece_indices;
+  auto flushPiece = [&]() -> absl::Status {
+    if (piece_indices.empty()) { return absl::OkStatus(); }
+    ASSIGN_OR_RETURN(auto piece, TakeRecordBatch(piece_batch, piece_indices));
+    pieces.push_back(piece);
+    piece_indices.clear();
+    return absl::OkStatus();
+  };
+
+  int64_t num_rows = 0;
+  while (num_rows < SORT_BATCH_SIZE) {
+    auto& run = runs_[merge_tree_->Winner()];
+    if (run.batch == nullptr) { break; }  // all the runs are exhausted.
+
+    if (run.batch != piece_batch) {
+      CHECK_OK_OR_RETURN(flushPiece());
+      piece_batch = run.batch;
+    }
+    piece_indices.push_back(run.row);
+    num_rows++;
+
+    CHECK_OK_OR_RETURN(advanceRun(run));
+    merge_tree_->Update();
+  }
+  CHECK_OK_OR_RETURN(flushPiece());
+
+  if (num_rows == 0) { return nullptr; }  // end of stream.
+  ASSIGN_OR_RETURN(auto columns, ConcatenateRecordBatches(schema, pieces, memoryPool()));
+  return arrow::RecordBatch::Make(schema, num_rows, columns);
+}
+
+TopK::TopK(std::shared_ptr<PhysicalPlan> input, std::vector<SortKey> sort_keys, int64_t k)
+    : input_{ input },
+      sort_keys_{ sort_keys },
+      k_{ k },
+      filter_{ std::make_shared<RuntimeFilter>("topk") } { }
+
+TopK::~TopK() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> TopK::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> TopK::Children() { return { input_ }; }
+
+absl::Status TopK::Prepare() {
+  if (k_ < 0) { return absl::InvalidArgumentError("the number of rows of a top-k can't be negative"); }
+  return input_->Prepare();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TopK::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (!consumed_input_) {
+    CHECK_OK_OR_RETURN(consumeInput());
+    consumed_input_ = true;
+  }
+  if (offset_ >= result_->num_rows()) { return nullptr; }  // end of stream.
+
+  auto batch = result_->Slice(offset_, SORT_BATCH_SIZE);
+  offset_ += batch->num_rows();
+  return batch;
+}
+
+std::string TopK::ToString() { return "todo"; }
+
+absl::Status TopK::consumeInput() {
+  ASSIGN_OR_RETURN(auto schema, input_->Schema());
+
+  // no row is needed, the input doesn't have to be read at all.
+  while (k_ > 0) {
+    ASSIGN_OR_RETURN(auto batch, input_->Next());
+    if (batch == nullptr) { break; }
+
+    ASSIGN_OR_RETURN(batch, filterBatch(batch));
+    if (batch->num_rows() == 0) { continue; }
+
+    buffer_.push_back(batch);
+    buffered_rows_ += batch->num_rows();
+    if (buffered_rows_ >= 2 * k_) { CHECK_OK_OR_RETURN(compact(schema)); }
+  }
+
+  CHECK_OK_OR_RETURN(compact(schema));
+  result_ = buffer_.front();
+  return absl::OkStatus();
+}
+
+absl::Status TopK::compact(std::shared_ptr<arrow::Schema> schema) {
+  ASSIGN_OR_RETURN(auto columns, ConcatenateRecordBatches(schema, buffer_, memoryPool()));
+  auto buffered = arrow::RecordBatch::Make(schema, buffered_rows_, columns);
+
+  // the buffer keeps the arrival order, the stable sort keeps the earliest rows among the equal ones.
+  ASSIGN_OR_RETURN(auto keys, EvaluateSortKeys(buffered, sort_keys_, memoryPool()));
+  auto indices = SortIndices(keys, sort_keys_);
+  if (indices.size() > k_) { indices.resize(k_); }
+
+  ASSIGN_OR_RETURN(auto best, TakeRecordBatch(buffered, indices));
+  buffer_ = { best };
+  buffered_rows_ = best->num_rows();
+  if (buffered_rows_ < k_ || k_ == 0 || sort_keys_.empty()) { return absl::OkStatus(); }
+
+  ASSIGN_OR_RETURN(threshold_keys_, EvaluateSortKeys(best->Slice(k_ - 1, 1), sort_keys_, memoryPool()));
+  if (threshold_keys_[0]->IsNull(0)) { return absl::OkStatus(); }  // every non null value still qualifies.
+
+  // the rows whose first key sorts after the k-th value can't qualify anymore.
+  auto unbounded = arrow::MakeArrayOfNull(threshold_keys_[0]->type(), 1);
+  if (!unbounded.ok()) { return absl::InternalError(GetMessageFromResult(unbounded)); }
+  auto bounds = sort_keys_[0].ascending ? arrow::Concatenate({ *unbounded, threshold_keys_[0] })
+                                        : arrow::Concatenate({ threshold_keys_[0], *unbounded });
+  if (!bounds.ok()) { return absl::InternalError(GetMessageFromResult(bounds)); }
+  return filter_->PublishRange(*bounds, sort_keys_[0].nulls_first);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TopK::filterBatch(std::shared_ptr<arrow::RecordBatch> batch) {
+  if (threshold_keys_.empty()) { return batch; }
+
+  ASSIGN_OR_RETURN(auto keys, EvaluateSortKeys(batch, sort_keys_, memoryPool()));
+  arrow::BooleanBuilder builder(memoryPool());
+  CHECK_OK_OR_RETURN(reserve(builder, batch->num_rows()));
+  for (int64_t row = 0; row < batch->num_rows(); row++) {
+    builder.UnsafeAppend(CompareSortKeys(keys, row, threshold_keys_, 0, sort_keys_) < 0);
+  }
+
+  std::shared_ptr<arrow::BooleanArray> mask;
+  auto finish_status = builder.Finish(&mask);
+  if (!finish_status.ok()) { return absl::InternalError(GetMessageFromStatus(finish_status)); }
+  return FilterRecordBatch(batch, mask, memoryPool());
+}
+
+Limit::Limit(std::shared_ptr<PhysicalPlan> input, int64_t limit, int64_t offset)
+    : input_{ std::move(input) },
+      limit_{ limit },
+      offset_{ offset } { }
+
+Limit::~Limit() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Limit::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> Limit::Children() { return { input_ }; }
+
+absl::Status Limit::Prepare() { return input_->Prepare(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Limit::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  while (returned_ < limit_) {
+    ASSIGN_OR_RETURN(auto batch, input_->Next());
+    if (batch == nullptr) { return nullptr; }  // end of stream.
+
+    if (skipped_ < offset_) {
+      auto skip = std::min(offset_ - skipped_, batch->num_rows());
+      skipped_ += skip;
+      if (skip == batch->num_rows()) { continue; }
+      batch = batch->Slice(skip);
+    }
+
+    auto take = std::min(limit_ - returned_, batch->num_rows());
+    returned_ += take;
+
+    // the limit is satisfied, nothing below has to produce any more rows.
+    if (returned_ == limit_) { input_->Cancel(); }
+    return take < batch->num_rows() ? batch->Slice(0, take) : batch;
+  }
+
+  input_->Cancel();
+  return nullptr;
+}
+
+std::string Limit::ToString() { return "todo"; }
+
+Distinct::Distinct(std::shared_ptr<PhysicalPlan> input) : input_{ std::move(input) } { }
+
+Distinct::~Distinct() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Distinct::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> Distinct::Children() { return { input_ }; }
+
+absl::Status Distinct::Prepare() { return input_->Prepare(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Distinct::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, input_->Next());
+    if (batch == nullptr) { return nullptr; }  // end of stream.
+
+    ASSIGN_OR_RETURN(auto mask, firstOccurrences(batch));
+    if (mask->true_count() == 0) { continue; }
+    if (mask->true_count() == batch->num_rows()) { return batch; }
+    return FilterRecordBatch(batch, mask, memoryPool());
+  }
+}
+
+absl::StatusOr<std::shared_ptr<arrow::BooleanArray>> Distinct::firstOccurrences(
+    std::shared_ptr<arrow::RecordBatch> batch) {
+  arrow::BooleanBuilder builder(memoryPool());
+  CHECK_OK_OR_RETURN(reserve(builder, batch->num_rows()));
+
+  if (batch->num_columns() == 1 && batch->column(0)->type_id() == arrow::Type::INT64) {
+    // a single integer column, the values go straight into the bitmap. The null is kept apart from the values.
+    auto column = std::static_pointer_cast<arrow::Int64Array>(batch->column(0));
+    for (int64_t row = 0; row < column->length(); row++) {
+      if (column->IsNull(row)) {
+        builder.UnsafeAppend(seen_rows_.insert(toyquery::Key({ std::make_shared<arrow::NullScalar>() })).second);
+      } else {
+        builder.UnsafeAppend(seen_integers_.Add(static_cast<uint64_t>(column->Value(row))));
+      }
+    }
+  } else {
+    for (int64_t row = 0; row < batch->num_rows(); row++) {
+      arrow::ScalarVector row_values;
+      for (auto& column : batch->columns()) {
+        auto value_or = column->GetScalar(row);
+        if (!value_or.ok()) { return absl::InternalError(GetMessageFromResult(value_or)); }
+        row_values.push_back(*value_or);
+      }
+      builder.UnsafeAppend(seen_rows_.insert(toyquery::Key(std::move(row_values))).second);
+    }
+  }
+
+  std::shared_ptr<arrow::BooleanArray> mask;
+  auto finish_status = builder.Finish(&mask);
+  if (!finish_status.ok()) { return absl::InternalError(GetMessageFromStatus(finish_status)); }
+  return mask;
+}
+
+std::string Distinct::ToString() { return "todo"; }
+
+Window::Window(
+    std::shared_ptr<PhysicalPlan> input,
+    std::shared_ptr<arrow::Schema> schema,
+    std::vector<std::shared_ptr<PhysicalExpression>> partition_by,
+    std::vector<SortKey> order_by,
+    std::vector<WindowFunction> functions)
+    : input_{ std::move(input) },
+      schema_{ std::move(schema) },
+      partition_by_{ std::move(partition_by) },
+      order_by_{ std::move(order_by) },
+      functions_{ std::move(functions) } { }
+
+Window::~Window() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Window::Schema() { return schema_; }
+
+std::vector<std::shared_ptr<PhysicalPlan>> Window::Children() { return { input_ }; }
+
+absl::Status Window::Prepare() { return input_->Prepare(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Window::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (!evaluated_input_) {
+    CHECK_OK_OR_RETURN(evaluateInput());
+    evaluated_input_ = true;
+  }
+  if (offset_ >= result_->num_rows()) { return nullptr; }  // end of stream.
+
+  auto batch = result_->Slice(offset_, SORT_BATCH_SIZE);
+  offset_ += batch->num_rows();
+  return batch;
+}
+
+std::string Window::ToString() { return "todo"; }
+
+absl::Status Window::evaluateInput() {
+  ASSIGN_OR_RETURN(auto input_schema, input_->Schema());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, input_->Next());
+    if (batch == nullptr) { break; }
+    batches.push_back(batch);
+  }
+  ASSIGN_OR_RETURN(auto columns, ConcatenateRecordBatches(input_schema, batches, memoryPool()));
+  auto num_rows = columns.empty() ? 0 : columns[0]->length();
+  auto input = arrow::RecordBatch::Make(input_schema, num_rows, columns);
+
+  // the rows of a partition are made contiguous by sorting on the partition keys first, in any direction.
+  std::vector<SortKey> sort_keys;
+  for (auto& expr : partition_by_) { sort_keys.push_back(SortKey{ expr }); }
+  sort_keys.insert(sort_keys.end(), order_by_.begin(), order_by_.end());
+  if (!sort_keys.empty()) {
+    ASSIGN_OR_RETURN(auto keys, EvaluateSortKeys(input, sort_keys, memoryPool()));
+    ASSIGN_OR_RETURN(input, TakeRecordBatch(input, SortIndices(keys, sort_keys)));
+  }
+
+  ASSIGN_OR_RETURN(auto keys, EvaluateSortKeys(input, sort_keys, memoryPool()));
+  std::vector<std::shared_ptr<arrow::Array>> partition_keys(keys.begin(), keys.begin() + partition_by_.size());
+  std::vector<std::shared_ptr<arrow::Array>> order_keys(keys.begin() + partition_by_.size(), keys.end());
+  std::vector<SortKey> partition_sort_keys(sort_keys.begin(), sort_keys.begin() + partition_by_.size());
+
+  std::vector<int64_t> partitions;
+  for (int64_t row = 0; row < num_rows; row++) {
+    if (row == 0 || CompareSortKeys(partition_keys, row - 1, partition_keys, row, partition_sort_keys) != 0) {
+      partitions.push_back(row);
+    }
+  }
+  partitions.push_back(num_rows);
+
+  auto output_columns = input->columns();
+  for (auto& function : functions_) {
+    ASSIGN_OR_RETURN(auto column, EvaluateWindowFunction(function, input, partitions, order_keys, order_by_, memoryPool()));
+    output_columns.push_back(column);
+  }
+
+  result_ = arrow::RecordBatch::Make(schema_, num_rows, output_columns);
+  return absl::OkStatus();
+}
+
+Prefetch::Prefetch(std::shared_ptr<PhysicalPlan> input, int depth)
+    : input_{ std::move(input) },
+      depth_{ std::max(depth, 1) } { }
+
+Prefetch::~Prefetch() { stop(); }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Prefetch::Schema() { return input_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> Prefetch::Children() { return { input_ }; }
+
+absl::Status Prefetch::Prepare() { return input_->Prepare(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Prefetch::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!started_ && !cancelled_) {
+    started_ = true;
+    thread_ = std::thread([this]() { prefetch(); });
+  }
+
+  changed_.wait(lock, [this]() { return !ready_.empty() || done_ || cancelled_; });
+  if (ready_.empty()) {
+    if (!status_.ok()) { return status_; }
+    return nullptr;  // end of stream.
+  }
+
+  auto batch = ready_.front();
+  ready_.pop_front();
+  changed_.notify_all();
+  return batch;
+}
+
+void Prefetch::Cancel() {
+  stop();
+  // the input is only touched by the background thread until it is joined.
+  input_->Cancel();
+}
+
+std::string Prefetch::ToString() { return "todo"; }
+
+void Prefetch::prefetch() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this]() { return ready_.size() < static_cast<size_t>(depth_) || cancelled_; });
+      if (cancelled_) { return; }
+    }
+
+    auto batch = input_->Next();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!batch.ok()) {
+      status_ = batch.status();
+      done_ = true;
+    } else if (*batch == nullptr) {
+      done_ = true;
+    } else {
+      ready_.push_back(*batch);
+    }
+    changed_.notify_all();
+    if (done_) { return; }
+  }
+}
+
+void Prefetch::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    ready_.clear();
+  }
+  changed_.notify_all();
+  if (thread_.joinable()) { thread_.join(); }
+}
+
+MorselQueue::MorselQueue(std::shared_ptr<PhysicalPlan> source) : source_{ std::move(source) } { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> MorselQueue::Schema() { return source_->Schema(); }
+
+absl::Status MorselQueue::Prepare() {
+  std::lock_guard<std::mutex> lock(source_mutex_);
+  if (prepared_) { return absl::OkStatus(); }
+  prepared_ = true;
+  return source_->Prepare();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> MorselQueue::Next(arrow::MemoryPool* pool) {
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!morsels_.empty()) {
+        auto morsel = morsels_.front();
+        morsels_.pop_front();
+        return morsel;
+      }
+      if (exhausted_) { return nullptr; }  // end of stream.
+    }
+
+    // another instance may have queued morsels while this one waited to pull the source.
+    std::lock_guard<std::mutex> source_lock(source_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!morsels_.empty() || exhausted_) { continue; }
+    }
+    CHECK_OK_OR_RETURN(fetch(pool));
+  }
+}
+
+void MorselQueue::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exhausted_ = true;
+    morsels_.clear();
+  }
+
+  // the instance pulling the source, if any, stops on the cancellation token of the query.
+  std::lock_guard<std::mutex> source_lock(source_mutex_);
+  rest_ = nullptr;
+  source_->Cancel();
+}
+
+void MorselQueue::SetCancellationToken(std::shared_ptr<CancellationToken> token) {
+  std::lock_guard<std::mutex> source_lock(source_mutex_);
+  source_->SetCancellationToken(token);
+}
+
+void MorselQueue::SetMemoryPool(std::shared_ptr<TrackingMemoryPool> query_pool) {
+  std::lock_guard<std::mutex> source_lock(source_mutex_);
+  if (has_memory_pool_) { return; }
+  has_memory_pool_ = true;
+  source_->SetMemoryPool(query_pool);
+}
+
+absl::Status MorselQueue::fetch(arrow::MemoryPool* pool) {
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  int64_t num_rows = 0;
+  if (rest_ != nullptr) {
+    batches.push_back(rest_);
+    num_rows += rest_->num_rows();
+    rest_ = nullptr;
+  }
+
+  bool exhausted = false;
+  while (num_rows < MORSEL_SIZE) {
+    ASSIGN_OR_RETURN(auto batch, source_->Next());
+    if (batch == nullptr) {
+      exhausted = true;
+      break;
+    }
+    if (batch->num_rows() == 0) { continue; }
+    batches.push_back(batch);
+    num_rows += batch->num_rows();
+  }
+
+  // the small batches of the source are copied into a single one, a large one is only sliced.
+  std::shared_ptr<arrow::RecordBatch> coalesced;
+  if (batches.size() == 1) {
+    coalesced = batches[0];
+  } else if (batches.size() > 1) {
+    ASSIGN_OR_RETURN(auto schema, source_->Schema());
+    ASSIGN_OR_RETURN(auto columns, ConcatenateRecordBatches(schema, batches, pool));
+    coalesced = arrow::RecordBatch::Make(schema, num_rows, columns);
+  }
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> morsels;
+  for (int64_t offset = 0; offset < num_rows; offset += MORSEL_SIZE) {
+    if (!exhausted && num_rows - offset < MORSEL_SIZE) {
+      rest_ = coalesced->Slice(offset);
+      break;
+    }
+    morsels.push_back(coalesced->Slice(offset, MORSEL_SIZE));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (exhausted_) { return absl::OkStatus(); }  // cancelled meanwhile.
+  morsels_.insert(morsels_.end(), morsels.begin(), morsels.end());
+  exhausted_ = exhausted;
+  return absl::OkStatus();
+}
+
+MorselScan::MorselScan(std::shared_ptr<MorselQueue> morsels) : morsels_{ std::move(morsels) } { }
+
+MorselScan::~MorselScan() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> MorselScan::Schema() { return morsels_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> MorselScan::Children() { return {}; }
+
+absl::Status MorselScan::Prepare() { return morsels_->Prepare(); }
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> MorselScan::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  return morsels_->Next(memoryPool());
+}
+
+void MorselScan::Cancel() { morsels_->Cancel(); }
+
+std::string MorselScan::ToString() { return "todo"; }
+
+void MorselScan::SetCancellationToken(std::shared_ptr<CancellationToken> token) {
+  PhysicalPlan::SetCancellationToken(token);
+  morsels_->SetCancellationToken(token);
+}
+
+void MorselScan::SetMemoryPool(std::shared_ptr<TrackingMemoryPool> query_pool) {
+  PhysicalPlan::SetMemoryPool(query_pool);
+  morsels_->SetMemoryPool(query_pool);
+}
+
+Gather::Gather(std::vector<std::shared_ptr<PhysicalPlan>> pipelines, std::shared_ptr<ThreadPool> thread_pool)
+    : pipelines_{ std::move(pipelines) },
+      thread_pool_{ std::move(thread_pool) },
+      state_{ std::make_shared<State>() } {
+  state_->max_ready = GATHER_BATCHES_PER_PIPELINE * pipelines_.size();
+}
+
+Gather::~Gather() {
+  // the tasks still running reference the thread pool, wait for them before it can be released.
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->cancelled = true;
+  state_->changed.wait(lock, [this]() { return state_->running == 0; });
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> Gather::Schema() {
+  if (pipelines_.empty()) { return absl::InvalidArgumentError("gather without any pipeline"); }
+  return pipelines_[0]->Schema();
+}
+
+std::vector<std::shared_ptr<PhysicalPlan>> Gather::Children() { return pipelines_; }
+
+absl::Status Gather::Prepare() {
+  for (auto& pipeline : pipelines_) { CHECK_OK_OR_RETURN(pipeline->Prepare()); }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Gather::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  if (!started_) {
+    started_ = true;
+    state_->active = pipelines_.size();
+    for (auto& pipeline : pipelines_) { schedule(state_, thread_pool_.get(), pipeline); }
+  }
+
+  state_->changed.wait(lock, [this]() {
+    return !state_->ready.empty() || !state_->status.ok() || state_->active == 0 || state_->cancelled;
+  });
+  if (!state_->status.ok()) { return state_->status; }
+  if (state_->ready.empty()) { return nullptr; }  // end of stream.
+
+  auto batch = state_->ready.front();
+  state_->ready.pop_front();
+  if (!state_->parked.empty() && !state_->cancelled) {
+    schedule(state_, thread_pool_.get(), state_->parked.back());
+    state_->parked.pop_back();
+  }
+  return batch;
+}
+
+void Gather::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->cancelled = true;
+    state_->ready.clear();
+    state_->parked.clear();
+  }
+  state_->changed.notify_all();
+  PhysicalPlan::Cancel();
+}
+
+std::string Gather::ToString() { return "todo"; }
+
+void Gather::schedule(std::shared_ptr<State> state, ThreadPool* thread_pool, std::shared_ptr<PhysicalPlan> pipeline) {
+  state->running++;
+  thread_pool->Submit([state, thread_pool, pipeline]() {
+    auto batch = pipeline->Next();
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->running--;
+    if (!batch.ok()) {
+      if (state->status.ok()) { state->status = batch.status(); }
+      state->active--;
+    } else if (*batch == nullptr || state->cancelled || !state->status.ok()) {
+      state->active--;
+    } else {
+      state->ready.push_back(*batch);
+      if (state->ready.size() < state->max_ready) {
+        schedule(state, thread_pool, pipeline);
+      } else {
+        state->parked.push_back(pipeline);
+      }
+    }
+    state->changed.notify_all();
+  });
+}
+
 }  // namespace physicalplan
 }  // namespace toyquery
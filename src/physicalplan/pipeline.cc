@@ -0,0 +1,100 @@
+#include "physicalplan/pipeline.h"
+
+#include <algorithm>
+
+namespace toyquery {
+namespace physicalplan {
+
+namespace {
+
+// add the pipelines ending at the given sink, starting from the plan feeding it, after the ones they depend on.
+void buildPipelines(
+    std::shared_ptr<PhysicalPlan> plan,
+    std::shared_ptr<PipelineBreaker> sink,
+    std::vector<std::shared_ptr<Pipeline>>& pipelines) {
+  // fuse the streaming operators down to the first operator that isn't one, the source of the pipeline.
+  std::vector<std::shared_ptr<StreamingOperator>> operators;
+  while (auto op = std::dynamic_pointer_cast<StreamingOperator>(plan)) {
+    operators.push_back(op);
+    plan = plan->Children()[0];
+  }
+  std::reverse(operators.begin(), operators.end());
+
+  // a breaker source has to consume its own input before the pipeline can run.
+  auto breaker = std::dynamic_pointer_cast<PipelineBreaker>(plan);
+  if (breaker != nullptr && !breaker->Finished()) { buildPipelines(plan->Children()[0], breaker, pipelines); }
+
+  pipelines.push_back(std::make_shared<Pipeline>(plan, operators, sink));
+}
+
+}  // namespace
+
+Pipeline::Pipeline(
+    std::shared_ptr<PhysicalPlan> source,
+    std::vector<std::shared_ptr<StreamingOperator>> operators,
+    std::shared_ptr<PipelineBreaker> sink)
+    : source_{ std::move(source) },
+      operators_{ std::move(operators) },
+      sink_{ std::move(sink) } { }
+
+absl::Status Pipeline::Run() {
+  if (sink_ == nullptr) { return absl::InvalidArgumentError("the pipeline has no sink to run into"); }
+
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, Next());
+    if (batch == nullptr) { break; }  // end of stream.
+    CHECK_OK_OR_RETURN(sink_->Consume(batch));
+  }
+  return sink_->Finish();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Pipeline::Next() {
+  while (true) {
+    ASSIGN_OR_RETURN(auto batch, source_->Next());
+    if (batch == nullptr) { return nullptr; }  // end of stream.
+
+    for (auto& op : operators_) {
+      ASSIGN_OR_RETURN(batch, op->Process(batch));
+      if (batch == nullptr) { break; }  // no row left to push further.
+    }
+    if (batch != nullptr) { return batch; }
+  }
+}
+
+absl::StatusOr<std::vector<std::shared_ptr<Pipeline>>> BuildPipelines(std::shared_ptr<PhysicalPlan> plan) {
+  if (plan == nullptr) { return absl::InvalidArgumentError("can't build the pipelines of an empty plan"); }
+
+  std::vector<std::shared_ptr<Pipeline>> pipelines;
+  buildPipelines(plan, nullptr, pipelines);
+  return pipelines;
+}
+
+PipelineExecution::PipelineExecution(std::shared_ptr<PhysicalPlan> plan) : plan_{ std::move(plan) } { }
+
+PipelineExecution::~PipelineExecution() { }
+
+absl::StatusOr<std::shared_ptr<arrow::Schema>> PipelineExecution::Schema() { return plan_->Schema(); }
+
+std::vector<std::shared_ptr<PhysicalPlan>> PipelineExecution::Children() { return { plan_ }; }
+
+absl::Status PipelineExecution::Prepare() {
+  CHECK_OK_OR_RETURN(plan_->Prepare());
+  ASSIGN_OR_RETURN(pipelines_, BuildPipelines(plan_));
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> PipelineExecution::Next() {
+  CHECK_OK_OR_RETURN(checkCancelled());
+  if (pipelines_.empty()) { return absl::FailedPreconditionError("the plan must be prepared before it runs"); }
+
+  if (!ran_breakers_) {
+    for (int i = 0; i + 1 < pipelines_.size(); i++) { CHECK_OK_OR_RETURN(pipelines_[i]->Run()); }
+    ran_breakers_ = true;
+  }
+  return pipelines_.back()->Next();
+}
+
+std::string PipelineExecution::ToString() { return "todo"; }
+
+}  // namespace physicalplan
+}  // namespace toyquery
@@ -0,0 +1,295 @@
+#include "physicalplan/runtimefilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+#include "arrow/compute/api.h"
+#include "common/arrow.h"
+#include "common/status.h"
+#include "fmt/core.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+namespace {
+
+// The targeted false positive rate of the bloom filters published by the runtime filters.
+static constexpr double RUNTIME_FILTER_FALSE_POSITIVE_RATE = 0.01;
+
+// splitmix64 finalizer, spreads the bits of the input over the whole 64 bit word.
+uint64_t mixHash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+}  // namespace
+
+BloomFilter::BloomFilter(int64_t expected_items, double false_positive_rate) {
+  expected_items = std::max<int64_t>(expected_items, 1);
+
+  // m = -n * ln(p) / ln(2)^2 and k = m / n * ln(2)
+  double bits = -static_cast<double>(expected_items) * std::log(false_positive_rate) / (std::log(2) * std::log(2));
+  num_bits_ = std::max<uint64_t>(64, static_cast<uint64_t>(bits));
+  num_hashes_ = std::clamp(static_cast<int>(std::round(bits / expected_items * std::log(2))), 1, 8);
+  bits_.assign((num_bits_ + 63) / 64, 0);
+}
+
+void BloomFilter::Insert(uint64_t hash) {
+  uint64_t h1 = hash;
+  uint64_t h2 = (hash >> 32) | 1;
+  for (int i = 0; i < num_hashes_; i++) {
+    uint64_t bit = (h1 + i * h2) % num_bits_;
+    bits_[bit / 64] |= (1ULL << (bit % 64));
+  }
+}
+
+bool BloomFilter::MightContain(uint64_t hash) const {
+  uint64_t h1 = hash;
+  uint64_t h2 = (hash >> 32) | 1;
+  for (int i = 0; i < num_hashes_; i++) {
+    uint64_t bit = (h1 + i * h2) % num_bits_;
+    if ((bits_[bit / 64] & (1ULL << (bit % 64))) == 0) { return false; }
+  }
+  return true;
+}
+
+int64_t BloomFilter::SizeInBytes() const { return bits_.size() * sizeof(uint64_t); }
+
+uint64_t HashArrayValue(const arrow::Array& array, int64_t row) {
+  switch (array.type_id()) {
+    case arrow::Type::BOOL: {
+      return mixHash(static_cast<const arrow::BooleanArray&>(array).Value(row) ? 1 : 0);
+    }
+    case arrow::Type::INT64: {
+      return mixHash(static_cast<uint64_t>(static_cast<const arrow::Int64Array&>(array).Value(row)));
+    }
+    case arrow::Type::DOUBLE: {
+      double value = static_cast<const arrow::DoubleArray&>(array).Value(row);
+      if (value == 0) { value = 0; }  // -0.0 and 0.0 are equal and should hash the same.
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return mixHash(bits);
+    }
+    case arrow::Type::STRING: {
+      auto view = static_cast<const arrow::StringArray&>(array).GetView(row);
+      return mixHash(std::hash<std::string_view>{}(std::string_view(view.data(), view.size())));
+    }
+    default: {
+      auto scalar_or = array.GetScalar(row);
+      return scalar_or.ok() ? mixHash((*scalar_or)->hash()) : 0;
+    }
+  }
+}
+
+RuntimeFilter::RuntimeFilter(std::string name) : name_{ std::move(name) } { }
+
+absl::Status RuntimeFilter::Publish(const std::vector<std::shared_ptr<arrow::Array>>& build_keys) {
+  int64_t num_values = 0;
+  for (auto& keys : build_keys) { num_values += keys->length() - keys->null_count(); }
+
+  auto published = std::make_shared<Published>();
+  published->bloom_filter = std::make_shared<BloomFilter>(num_values, RUNTIME_FILTER_FALSE_POSITIVE_RATE);
+  published->empty = num_values == 0;
+
+#define COMPUTE_BUILD_MIN_MAX(array_tp, builder_tp, value_tp)                          \
+  bool initialized = false;                                                           \
+  value_tp lo{}, hi{};                                                                \
+  for (auto& keys : build_keys) {                                                     \
+    auto typed_keys = std::static_pointer_cast<array_tp>(keys);                       \
+    for (int64_t row = 0; row < typed_keys->length(); row++) {                        \
+      if (typed_keys->IsNull(row)) { continue; }                                      \
+      value_tp value(typed_keys->GetView(row));                                       \
+      if (!initialized || value < lo) { lo = value; }                                 \
+      if (!initialized || hi < value) { hi = value; }                                 \
+      initialized = true;                                                             \
+    }                                                                                 \
+  }                                                                                   \
+  if (initialized) {                                                                  \
+    builder_tp builder;                                                               \
+    builder.Append(lo);                                                               \
+    builder.Append(hi);                                                               \
+    auto finish_status = builder.Finish(&published->bounds);                          \
+    if (!finish_status.ok()) { return absl::InternalError(finish_status.message()); } \
+  }
+
+  if (!build_keys.empty()) {
+    switch (build_keys[0]->type_id()) {
+      case arrow::Type::INT64: {
+        COMPUTE_BUILD_MIN_MAX(arrow::Int64Array, arrow::Int64Builder, int64_t);
+        break;
+      }
+      case arrow::Type::DOUBLE: {
+        COMPUTE_BUILD_MIN_MAX(arrow::DoubleArray, arrow::DoubleBuilder, double);
+        break;
+      }
+      case arrow::Type::STRING: {
+        COMPUTE_BUILD_MIN_MAX(arrow::StringArray, arrow::StringBuilder, std::string);
+        break;
+      }
+      default: break;  // only the bloom filter is used for the other types.
+    }
+  }
+
+#undef COMPUTE_BUILD_MIN_MAX
+
+  for (auto& keys : build_keys) {
+    for (int64_t row = 0; row < keys->length(); row++) {
+      if (!keys->IsNull(row)) { published->bloom_filter->Insert(HashArrayValue(*keys, row)); }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  published_ = std::move(published);
+  return absl::OkStatus();
+}
+
+absl::Status RuntimeFilter::PublishRange(std::shared_ptr<arrow::Array> bounds, bool keep_nulls) {
+  if (bounds->length() != 2) { return absl::InvalidArgumentError("the range should have a lower and an upper bound"); }
+
+  auto published = std::make_shared<Published>();
+  published->bounds = std::move(bounds);
+  published->empty = false;
+  published->keep_nulls = keep_nulls;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  published_ = std::move(published);
+  return absl::OkStatus();
+}
+
+bool RuntimeFilter::IsReady() const { return published() != nullptr; }
+
+std::shared_ptr<const RuntimeFilter::Published> RuntimeFilter::published() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return published_;
+}
+
+bool RuntimeFilter::inRange(const Published& published, const arrow::Array& column, int64_t row) {
+  if (published.bounds == nullptr || !published.bounds->type()->Equals(column.type())) { return true; }
+
+#define CHECK_VALUE_IN_RANGE(array_tp)                                 \
+  auto& bounds = static_cast<const array_tp&>(*published.bounds);      \
+  auto value = static_cast<const array_tp&>(column).GetView(row);      \
+  return (bounds.IsNull(0) || !(value < bounds.GetView(0))) &&         \
+         (bounds.IsNull(1) || !(bounds.GetView(1) < value));
+
+  switch (column.type_id()) {
+    case arrow::Type::INT64: {
+      CHECK_VALUE_IN_RANGE(arrow::Int64Array);
+    }
+    case arrow::Type::DOUBLE: {
+      CHECK_VALUE_IN_RANGE(arrow::DoubleArray);
+    }
+    case arrow::Type::STRING: {
+      CHECK_VALUE_IN_RANGE(arrow::StringArray);
+    }
+    default: return true;
+  }
+
+#undef CHECK_VALUE_IN_RANGE
+}
+
+absl::StatusOr<bool> RuntimeFilter::overlapsRange(
+    const Published& published,
+    const std::shared_ptr<arrow::Array>& column) {
+  if (column->null_count() == column->length()) { return false; }
+  auto& bounds = published.bounds;
+  if (bounds == nullptr || !bounds->type()->Equals(column->type())) { return true; }
+
+  // the batch can't match if its max is below the lower bound or its min above the upper bound. A null bound doesn't
+  // compare, leaving that side unbounded.
+  auto min_max_or = arrow::compute::MinMax(column);
+  if (!min_max_or.ok()) { return absl::InternalError(GetMessageFromResult(min_max_or)); }
+  auto& min_max = min_max_or->scalar_as<arrow::StructScalar>();
+  auto lower_or = bounds->GetScalar(0), upper_or = bounds->GetScalar(1);
+  if (!lower_or.ok() || !upper_or.ok()) { return absl::InternalError(GetMessageFromResultLeftOrRight(lower_or, upper_or)); }
+
+  auto max_to_lower = CompareScalars(*min_max.value[1], **lower_or);
+  auto min_to_upper = CompareScalars(*min_max.value[0], **upper_or);
+  return !(max_to_lower.has_value() && *max_to_lower < 0) && !(min_to_upper.has_value() && *min_to_upper > 0);
+}
+
+absl::StatusOr<bool> RuntimeFilter::MightMatch(const std::shared_ptr<arrow::Array>& column) {
+  auto published = this->published();
+  if (published == nullptr) { return true; }
+
+  bool might_match = false;
+  if (!published->empty) {
+    might_match = published->keep_nulls && column->null_count() > 0;
+    if (!might_match) { ASSIGN_OR_RETURN(might_match, overlapsRange(*published, column)); }
+  }
+
+  if (!might_match) {
+    batches_skipped_++;
+    rows_filtered_ += column->length();
+  }
+  return might_match;
+}
+
+absl::StatusOr<std::shared_ptr<arrow::BooleanArray>> RuntimeFilter::Evaluate(const std::shared_ptr<arrow::Array>& column) {
+  // the same publication is used for all the rows, even if the filter gets published again meanwhile.
+  auto published = this->published();
+  arrow::BooleanBuilder builder;
+  builder.Reserve(column->length());
+
+  int64_t rows_filtered = 0;
+  for (int64_t row = 0; row < column->length(); row++) {
+    bool keep = true;
+    if (published != nullptr && column->IsNull(row)) {
+      keep = published->keep_nulls;
+    } else if (published != nullptr) {
+      auto& bloom_filter = published->bloom_filter;
+      keep = !published->empty && inRange(*published, *column, row) &&
+             (bloom_filter == nullptr || bloom_filter->MightContain(HashArrayValue(*column, row)));
+    }
+    if (!keep) { rows_filtered++; }
+    builder.UnsafeAppend(keep);
+  }
+  rows_filtered_ += rows_filtered;
+
+  std::shared_ptr<arrow::BooleanArray> mask;
+  auto finish_status = builder.Finish(&mask);
+  if (!finish_status.ok()) { return absl::InternalError(finish_status.message()); }
+  return mask;
+}
+
+std::string RuntimeFilter::ToString() {
+  auto published = this->published();
+  return fmt::format(
+      "RuntimeFilter[name={}, ready={}, bounds={}, rows_filtered={}, batches_skipped={}]",
+      name_,
+      published != nullptr,
+      published == nullptr || published->bounds == nullptr ? "null" : published->bounds->ToString(),
+      rows_filtered_.load(),
+      batches_skipped_.load());
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> ApplyRuntimeFilters(
+    std::shared_ptr<arrow::RecordBatch> batch,
+    const std::vector<RuntimeFilterTarget>& filters) {
+  for (auto& [column_idx, filter] : filters) {
+    if (!filter->IsReady()) { continue; }
+    if (column_idx < 0 || column_idx >= batch->num_columns()) {
+      return absl::OutOfRangeError("runtime filter column index out of range");
+    }
+
+    // cheap check on the range first, the whole batch is dropped if no row can match.
+    ASSIGN_OR_RETURN(auto might_match, filter->MightMatch(batch->column(column_idx)));
+    if (!might_match) { return nullptr; }
+
+    ASSIGN_OR_RETURN(auto mask, filter->Evaluate(batch->column(column_idx)));
+    if (mask->true_count() == 0) { return nullptr; }
+    if (mask->true_count() == batch->num_rows()) { continue; }
+
+    ASSIGN_OR_RETURN(batch, FilterRecordBatch(batch, mask));
+  }
+
+  return batch;
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
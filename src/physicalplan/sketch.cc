@@ -0,0 +1,185 @@
+#include "physicalplan/sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string_view>
+
+namespace toyquery {
+namespace physicalplan {
+
+namespace {
+
+// The number of values buffered by the t-digest, relative to its compression, before they are merged into the centroids.
+static constexpr double TDIGEST_BUFFER_FACTOR = 4;
+
+// splitmix64 finalizer, spreads the bits of the input over the whole 64 bit word.
+uint64_t mixHash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// the scale function of the t-digest, maps a quantile to the index of its centroid. Its slope is steep at the tails so
+// that the centroids there hold few values.
+double scale(double quantile, double compression) { return compression / (2 * M_PI) * std::asin(2 * quantile - 1); }
+
+double inverseScale(double k, double compression) { return (std::sin(k * 2 * M_PI / compression) + 1) / 2; }
+
+}  // namespace
+
+uint64_t HashScalarValue(const arrow::Scalar& value) {
+  switch (value.type->id()) {
+    case arrow::Type::BOOL: {
+      return mixHash(static_cast<const arrow::BooleanScalar&>(value).value ? 1 : 0);
+    }
+    case arrow::Type::INT64: {
+      return mixHash(static_cast<uint64_t>(static_cast<const arrow::Int64Scalar&>(value).value));
+    }
+    case arrow::Type::DOUBLE: {
+      double double_value = static_cast<const arrow::DoubleScalar&>(value).value;
+      if (double_value == 0) { double_value = 0; }  // -0.0 and 0.0 are equal and should hash the same.
+      uint64_t bits;
+      std::memcpy(&bits, &double_value, sizeof(bits));
+      return mixHash(bits);
+    }
+    case arrow::Type::STRING: {
+      auto view = static_cast<const arrow::StringScalar&>(value).view();
+      return mixHash(std::hash<std::string_view>{}(std::string_view(view.data(), view.size())));
+    }
+    default: return mixHash(value.hash());
+  }
+}
+
+HyperLogLog::HyperLogLog(int precision)
+    : precision_{ std::clamp(precision, 4, 16) },
+      registers_(1 << precision_, 0) { }
+
+void HyperLogLog::Add(uint64_t hash) {
+  auto index = hash >> (64 - precision_);
+  // the sentinel bit bounds the run of zeros when all the remaining bits are zeros.
+  auto remaining = (hash << precision_) | (1ULL << (precision_ - 1));
+  auto rank = static_cast<uint8_t>(__builtin_clzll(remaining) + 1);
+  registers_[index] = std::max(registers_[index], rank);
+}
+
+bool HyperLogLog::Merge(const HyperLogLog& other) {
+  if (other.precision_ != precision_) { return false; }
+  for (size_t i = 0; i < registers_.size(); i++) { registers_[i] = std::max(registers_[i], other.registers_[i]); }
+  return true;
+}
+
+int64_t HyperLogLog::Estimate() const {
+  double m = registers_.size();
+  double sum = 0;
+  int64_t zeros = 0;
+  for (auto rank : registers_) {
+    sum += std::ldexp(1.0, -rank);
+    if (rank == 0) { zeros++; }
+  }
+
+  double alpha = 0.7213 / (1 + 1.079 / m);
+  double estimate = alpha * m * m / sum;
+
+  // the raw estimate is biased for small cardinalities, count the empty registers instead (linear counting).
+  if (estimate <= 2.5 * m && zeros > 0) { estimate = m * std::log(m / zeros); }
+  return std::llround(estimate);
+}
+
+TDigest::TDigest(double compression)
+    : compression_{ compression },
+      min_{ std::numeric_limits<double>::infinity() },
+      max_{ -std::numeric_limits<double>::infinity() } { }
+
+void TDigest::Add(double value) {
+  if (std::isnan(value)) { return; }
+
+  buffer_.push_back({ value, 1 });
+  buffered_weight_ += 1;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  if (buffer_.size() >= TDIGEST_BUFFER_FACTOR * compression_) { compress(); }
+}
+
+void TDigest::Merge(const TDigest& other) {
+  for (auto& centroids : { &other.centroids_, &other.buffer_ }) {
+    for (auto& centroid : *centroids) {
+      buffer_.push_back(centroid);
+      buffered_weight_ += centroid.weight_;
+    }
+  }
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  compress();
+}
+
+void TDigest::compress() {
+  if (buffer_.empty()) { return; }
+
+  buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+  std::sort(buffer_.begin(), buffer_.end(), [](const Centroid& a, const Centroid& b) { return a.mean_ < b.mean_; });
+  total_weight_ += buffered_weight_;
+  buffered_weight_ = 0;
+
+  // greedily merge the neighbouring centroids as long as the merged one covers less than one unit of the scale.
+  centroids_.clear();
+  auto current = buffer_[0];
+  double weight_so_far = 0;
+  double quantile_limit = inverseScale(scale(0, compression_) + 1, compression_);
+  for (size_t i = 1; i < buffer_.size(); i++) {
+    auto& next = buffer_[i];
+    double quantile = (weight_so_far + current.weight_ + next.weight_) / total_weight_;
+    if (quantile <= quantile_limit) {
+      current.weight_ += next.weight_;
+      current.mean_ += (next.mean_ - current.mean_) * next.weight_ / current.weight_;
+    } else {
+      weight_so_far += current.weight_;
+      centroids_.push_back(current);
+      quantile_limit = inverseScale(scale(weight_so_far / total_weight_, compression_) + 1, compression_);
+      current = next;
+    }
+  }
+  centroids_.push_back(current);
+  buffer_.clear();
+}
+
+double TDigest::Quantile(double quantile) {
+  compress();
+  if (centroids_.empty()) { return std::numeric_limits<double>::quiet_NaN(); }
+  if (centroids_.size() == 1) { return centroids_[0].mean_; }
+
+  quantile = std::clamp(quantile, 0.0, 1.0);
+  double target = quantile * total_weight_;
+
+  // the values are assumed to be spread evenly around the mean of each centroid, interpolate between the centers of the
+  // centroids surrounding the target, and with the min and max at the ends.
+  auto& first = centroids_.front();
+  if (target < first.weight_ / 2) { return min_ + (first.mean_ - min_) * target / (first.weight_ / 2); }
+
+  double weight_so_far = 0;
+  for (size_t i = 0; i + 1 < centroids_.size(); i++) {
+    auto& left = centroids_[i];
+    auto& right = centroids_[i + 1];
+    double left_center = weight_so_far + left.weight_ / 2;
+    double right_center = weight_so_far + left.weight_ + right.weight_ / 2;
+    if (target <= right_center) {
+      return left.mean_ + (right.mean_ - left.mean_) * (target - left_center) / (right_center - left_center);
+    }
+    weight_so_far += left.weight_;
+  }
+
+  auto& last = centroids_.back();
+  double last_center = total_weight_ - last.weight_ / 2;
+  return last.mean_ + (max_ - last.mean_) * (target - last_center) / (last.weight_ / 2);
+}
+
+int64_t TDigest::NumCentroids() {
+  compress();
+  return centroids_.size();
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
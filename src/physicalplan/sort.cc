@@ -0,0 +1,173 @@
+#include "physicalplan/sort.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+#include "common/arrow.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+namespace {
+
+// The number of bits sorted by each pass of the radix sort.
+static constexpr int RADIX_BITS = 8;
+static constexpr int RADIX_BUCKETS = 1 << RADIX_BITS;
+static constexpr int RADIX_PASSES = 64 / RADIX_BITS;
+
+// check if the radix sort can be used for the key column.
+bool isFixedWidthKey(const arrow::Array& key) {
+  switch (key.type_id()) {
+    case arrow::Type::BOOL:
+    case arrow::Type::INT64:
+    case arrow::Type::DOUBLE: return true;
+    default: return false;
+  }
+}
+
+// map the value at row to an unsigned integer having the same ordering.
+uint64_t encodeKey(const arrow::Array& key, int64_t row) {
+  switch (key.type_id()) {
+    case arrow::Type::BOOL: {
+      return static_cast<const arrow::BooleanArray&>(key).Value(row) ? 1 : 0;
+    }
+    case arrow::Type::INT64: {
+      // flipping the sign bit moves the negative values below the positive ones.
+      return static_cast<uint64_t>(static_cast<const arrow::Int64Array&>(key).Value(row)) ^ (1ULL << 63);
+    }
+    case arrow::Type::DOUBLE: {
+      double value = static_cast<const arrow::DoubleArray&>(key).Value(row);
+      if (value == 0) { value = 0; }  // -0.0 and 0.0 are equal.
+      uint64_t bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      // negative values have their order reversed by the sign magnitude representation.
+      return (bits & (1ULL << 63)) ? ~bits : bits | (1ULL << 63);
+    }
+    default: return 0;
+  }
+}
+
+// stable sort of the indices on a single fixed width key.
+void radixSortOnKey(std::vector<int64_t>& indices, const arrow::Array& key, const SortKey& sort_key) {
+  std::vector<int64_t> nulls;
+  std::vector<std::pair<uint64_t, int64_t>> values, buffer;
+  values.reserve(indices.size());
+  for (auto& row : indices) {
+    if (key.IsNull(row)) {
+      nulls.push_back(row);
+    } else {
+      auto encoded = encodeKey(key, row);
+      values.emplace_back(sort_key.ascending ? encoded : ~encoded, row);
+    }
+  }
+
+  // count the digits of all the passes at once.
+  std::vector<std::array<int64_t, RADIX_BUCKETS>> counts(RADIX_PASSES);
+  for (auto& count : counts) { count.fill(0); }
+  for (auto& [encoded, row] : values) {
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+      counts[pass][(encoded >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+    }
+  }
+
+  buffer.resize(values.size());
+  for (int pass = 0; pass < RADIX_PASSES; pass++) {
+    auto& count = counts[pass];
+
+    // all the values share the same digit, the pass wouldn't change the order.
+    if (std::any_of(count.begin(), count.end(), [&values](int64_t c) { return c == values.size(); })) { continue; }
+
+    std::array<int64_t, RADIX_BUCKETS> offsets;
+    std::exclusive_scan(count.begin(), count.end(), offsets.begin(), int64_t{ 0 });
+    for (auto& value : values) { buffer[offsets[(value.first >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++] = value; }
+    values.swap(buffer);
+  }
+
+  indices.clear();
+  if (sort_key.nulls_first) { indices.insert(indices.end(), nulls.begin(), nulls.end()); }
+  for (auto& [encoded, row] : values) { indices.push_back(row); }
+  if (!sort_key.nulls_first) { indices.insert(indices.end(), nulls.begin(), nulls.end()); }
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<std::shared_ptr<arrow::Array>>> EvaluateSortKeys(
+    const std::shared_ptr<arrow::RecordBatch>& batch,
+    const std::vector<SortKey>& sort_keys,
+    arrow::MemoryPool* pool) {
+  std::vector<std::shared_ptr<arrow::Array>> keys;
+  for (auto& sort_key : sort_keys) {
+    ASSIGN_OR_RETURN(auto key, sort_key.expr->Evaluate(batch, pool));
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+int CompareSortKeys(
+    const std::vector<std::shared_ptr<arrow::Array>>& left_keys,
+    int64_t left_row,
+    const std::vector<std::shared_ptr<arrow::Array>>& right_keys,
+    int64_t right_row,
+    const std::vector<SortKey>& sort_keys) {
+  for (int i = 0; i < sort_keys.size(); i++) {
+    bool left_null = left_keys[i]->IsNull(left_row);
+    bool right_null = right_keys[i]->IsNull(right_row);
+    if (left_null || right_null) {
+      if (left_null && right_null) { continue; }
+      return left_null == sort_keys[i].nulls_first ? -1 : 1;
+    }
+
+    auto cmp = CompareArrayValues(*left_keys[i], left_row, *right_keys[i], right_row);
+    if (cmp != 0) { return sort_keys[i].ascending ? cmp : -cmp; }
+  }
+  return 0;
+}
+
+std::vector<int64_t> SortIndices(
+    const std::vector<std::shared_ptr<arrow::Array>>& keys,
+    const std::vector<SortKey>& sort_keys) {
+  std::vector<int64_t> indices(keys.empty() ? 0 : keys[0]->length());
+  std::iota(indices.begin(), indices.end(), 0);
+
+  if (std::all_of(keys.begin(), keys.end(), [](auto& key) { return isFixedWidthKey(*key); })) {
+    // LSD: the keys are sorted from the least significant one, each stable pass keeps the order of the previous ones.
+    for (int i = static_cast<int>(keys.size()) - 1; i >= 0; i--) { radixSortOnKey(indices, *keys[i], sort_keys[i]); }
+    return indices;
+  }
+
+  std::sort(indices.begin(), indices.end(), [&keys, &sort_keys](int64_t left, int64_t right) {
+    auto cmp = CompareSortKeys(keys, left, keys, right, sort_keys);
+    return cmp != 0 ? cmp < 0 : left < right;  // ties are broken on the row index to keep the sort stable.
+  });
+  return indices;
+}
+
+LoserTree::LoserTree(int num_sources, std::function<bool(int, int)> less)
+    : num_sources_{ num_sources },
+      less_{ std::move(less) },
+      nodes_(num_sources, 0) {
+  // the leaf of the source i is at position k + i, the children of the node n are 2n and 2n + 1.
+  std::vector<int> winners(2 * num_sources);
+  for (int i = 0; i < num_sources; i++) { winners[num_sources + i] = i; }
+  for (int node = num_sources - 1; node >= 1; node--) {
+    auto left = winners[2 * node], right = winners[2 * node + 1];
+    bool right_wins = less_(right, left);
+    winners[node] = right_wins ? right : left;
+    nodes_[node] = right_wins ? left : right;
+  }
+  nodes_[0] = num_sources > 1 ? winners[1] : 0;
+}
+
+void LoserTree::Update() {
+  auto winner = nodes_[0];
+  for (int node = (num_sources_ + winner) / 2; node >= 1; node /= 2) {
+    if (less_(nodes_[node], winner)) { std::swap(nodes_[node], winner); }
+  }
+  nodes_[0] = winner;
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
@@ -0,0 +1,119 @@
+#include "physicalplan/spill.h"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+
+#include "arrow/util/byte_size.h"
+#include "common/status.h"
+#include "fmt/core.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+using toyquery::common::GetMessageFromStatus;
+
+std::string MakeSpillPath(const std::string& directory, const std::string& prefix) {
+  static std::atomic<int64_t> spill_file_id{ 0 };
+
+  std::error_code ec;
+  std::filesystem::path spill_directory =
+      directory.empty() ? std::filesystem::temp_directory_path(ec) : std::filesystem::path(directory);
+  auto file_name = fmt::format("toyquery_{}_{}_{}.arrow", prefix, getpid(), spill_file_id++);
+  return (spill_directory / file_name).string();
+}
+
+SpillFileWriter::SpillFileWriter(
+    std::string path,
+    std::shared_ptr<arrow::io::OutputStream> sink,
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer)
+    : path_{ std::move(path) },
+      sink_{ std::move(sink) },
+      writer_{ std::move(writer) } { }
+
+SpillFileWriter::~SpillFileWriter() {
+  if (!closed_) {
+    // the file was never finished so it can't be read back.
+    Close().IgnoreError();
+    std::error_code ec;
+    std::filesystem::remove(path_, ec);
+  }
+}
+
+absl::StatusOr<std::unique_ptr<SpillFileWriter>> SpillFileWriter::Open(
+    std::string path,
+    std::shared_ptr<arrow::Schema> schema,
+    arrow::Compression::type compression) {
+  auto options = arrow::ipc::IpcWriteOptions::Defaults();
+  if (compression != arrow::Compression::UNCOMPRESSED && arrow::util::Codec::IsAvailable(compression)) {
+    auto codec_or = arrow::util::Codec::Create(compression);
+    if (!codec_or.ok()) { return absl::InternalError(GetMessageFromResult(codec_or)); }
+    options.codec = std::move(*codec_or);
+  }
+
+  auto sink_or = arrow::io::FileOutputStream::Open(path);
+  if (!sink_or.ok()) { return absl::InternalError(GetMessageFromResult(sink_or)); }
+
+  auto writer_or = arrow::ipc::MakeFileWriter(*sink_or, schema, options);
+  if (!writer_or.ok()) { return absl::InternalError(GetMessageFromResult(writer_or)); }
+
+  return std::unique_ptr<SpillFileWriter>(new SpillFileWriter(std::move(path), *sink_or, *writer_or));
+}
+
+absl::Status SpillFileWriter::Write(std::shared_ptr<arrow::RecordBatch> batch) {
+  auto write_status = writer_->WriteRecordBatch(*batch);
+  if (!write_status.ok()) { return absl::InternalError(GetMessageFromStatus(write_status)); }
+
+  num_rows_ += batch->num_rows();
+  num_bytes_ += arrow::util::TotalBufferSize(*batch);
+  return absl::OkStatus();
+}
+
+absl::Status SpillFileWriter::Close() {
+  if (closed_) { return absl::OkStatus(); }
+  closed_ = true;
+
+  auto writer_status = writer_->Close();
+  if (!writer_status.ok()) { return absl::InternalError(GetMessageFromStatus(writer_status)); }
+
+  // closing the writer doesn't close the underlying file.
+  auto sink_status = sink_->Close();
+  if (!sink_status.ok()) { return absl::InternalError(GetMessageFromStatus(sink_status)); }
+  return absl::OkStatus();
+}
+
+SpillFileReader::SpillFileReader(
+    std::string path,
+    std::shared_ptr<arrow::io::RandomAccessFile> file,
+    std::shared_ptr<arrow::ipc::RecordBatchFileReader> reader)
+    : path_{ std::move(path) },
+      file_{ std::move(file) },
+      reader_{ std::move(reader) } { }
+
+SpillFileReader::~SpillFileReader() {
+  ARROW_UNUSED(file_->Close());
+  std::error_code ec;
+  std::filesystem::remove(path_, ec);
+}
+
+absl::StatusOr<std::unique_ptr<SpillFileReader>> SpillFileReader::Open(std::string path) {
+  auto file_or = arrow::io::ReadableFile::Open(path);
+  if (!file_or.ok()) { return absl::InternalError(GetMessageFromResult(file_or)); }
+
+  auto reader_or = arrow::ipc::RecordBatchFileReader::Open(*file_or);
+  if (!reader_or.ok()) { return absl::InternalError(GetMessageFromResult(reader_or)); }
+
+  return std::unique_ptr<SpillFileReader>(new SpillFileReader(std::move(path), *file_or, *reader_or));
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> SpillFileReader::Next() {
+  if (next_batch_ >= reader_->num_record_batches()) { return nullptr; }  // end of file.
+
+  auto batch_or = reader_->ReadRecordBatch(next_batch_++);
+  if (!batch_or.ok()) { return absl::InternalError(GetMessageFromResult(batch_or)); }
+  return *batch_or;
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
@@ -0,0 +1,293 @@
+#include "physicalplan/window.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "common/macros.h"
+#include "common/status.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+using toyquery::common::GetMessageFromStatus;
+using ::toyquery::logicalplan::WINDOW_FRAME_UNBOUNDED_FOLLOWING;
+using ::toyquery::logicalplan::WINDOW_FRAME_UNBOUNDED_PRECEDING;
+
+namespace {
+
+// The [lo, hi) row range of the frame of each row.
+struct FrameBounds {
+  std::vector<int64_t> lo;
+  std::vector<int64_t> hi;
+};
+
+// Get the first and one past the last peer of each row, i.e. the rows of the partition with equal order keys.
+void computePeers(
+    const std::vector<int64_t>& partitions,
+    const std::vector<std::shared_ptr<arrow::Array>>& order_keys,
+    const std::vector<SortKey>& order_by,
+    std::vector<int64_t>& peer_start,
+    std::vector<int64_t>& peer_end) {
+  auto num_rows = partitions.back();
+  peer_start.resize(num_rows);
+  peer_end.resize(num_rows);
+
+  for (size_t p = 0; p + 1 < partitions.size(); p++) {
+    auto begin = partitions[p], end = partitions[p + 1];
+    for (int64_t row = begin; row < end; row++) {
+      bool is_peer = row > begin && CompareSortKeys(order_keys, row - 1, order_keys, row, order_by) == 0;
+      peer_start[row] = is_peer ? peer_start[row - 1] : row;
+    }
+    for (int64_t row = end - 1; row >= begin; row--) {
+      bool is_peer = row + 1 < end && peer_start[row + 1] == peer_start[row];
+      peer_end[row] = is_peer ? peer_end[row + 1] : row + 1;
+    }
+  }
+}
+
+// Compute the frame of each row. The bounds never move backwards within a partition, which the incremental evaluation
+// relies on.
+absl::StatusOr<FrameBounds> computeFrames(
+    const WindowFrame& frame,
+    const std::vector<int64_t>& partitions,
+    const std::vector<std::shared_ptr<arrow::Array>>& order_keys,
+    const std::vector<SortKey>& order_by) {
+  auto num_rows = partitions.back();
+  FrameBounds bounds{ std::vector<int64_t>(num_rows), std::vector<int64_t>(num_rows) };
+
+  if (frame.units_ == WindowFrameUnits::Rows) {
+    for (size_t p = 0; p + 1 < partitions.size(); p++) {
+      auto begin = partitions[p], end = partitions[p + 1];
+      for (int64_t row = begin; row < end; row++) {
+        auto lo = frame.start_ == WINDOW_FRAME_UNBOUNDED_PRECEDING ? begin : std::clamp(row + frame.start_, begin, end);
+        auto hi = frame.end_ == WINDOW_FRAME_UNBOUNDED_FOLLOWING ? end : std::clamp(row + frame.end_ + 1, begin, end);
+        bounds.lo[row] = lo;
+        bounds.hi[row] = std::max(lo, hi);
+      }
+    }
+    return bounds;
+  }
+
+  std::vector<int64_t> peer_start, peer_end;
+  computePeers(partitions, order_keys, order_by, peer_start, peer_end);
+
+  // RANGE offsets other than CURRENT ROW are distances on the value of the single numeric order key.
+  bool has_offsets = (frame.start_ != WINDOW_FRAME_UNBOUNDED_PRECEDING && frame.start_ != 0) ||
+                     (frame.end_ != WINDOW_FRAME_UNBOUNDED_FOLLOWING && frame.end_ != 0);
+  std::shared_ptr<arrow::Array> key;
+  if (has_offsets) {
+    if (order_keys.size() != 1 ||
+        (order_keys[0]->type_id() != arrow::Type::INT64 && order_keys[0]->type_id() != arrow::Type::DOUBLE)) {
+      return absl::InvalidArgumentError("RANGE frame offsets require a single numeric order key");
+    }
+    key = order_keys[0];
+  }
+  auto value = [&key](int64_t row) {
+    if (key->type_id() == arrow::Type::INT64) {
+      return static_cast<double>(std::static_pointer_cast<arrow::Int64Array>(key)->Value(row));
+    }
+    return std::static_pointer_cast<arrow::DoubleArray>(key)->Value(row);
+  };
+
+  for (size_t p = 0; p + 1 < partitions.size(); p++) {
+    auto begin = partitions[p], end = partitions[p + 1];
+
+    // the null keys are sorted together at one end of the partition and are only peers of each other.
+    auto non_null_begin = begin, non_null_end = end;
+    if (has_offsets) {
+      while (non_null_begin < end && key->IsNull(non_null_begin)) { non_null_begin++; }
+      while (non_null_end > non_null_begin && key->IsNull(non_null_end - 1)) { non_null_end--; }
+    }
+
+    int64_t lo_row = non_null_begin, hi_row = non_null_begin;
+    for (int64_t row = begin; row < end; row++) {
+      bool offsets_apply = has_offsets && !key->IsNull(row);
+      // the distance from the current row in the direction of the sort.
+      auto distance = [&](int64_t other) {
+        return order_by[0].ascending ? value(other) - value(row) : value(row) - value(other);
+      };
+
+      int64_t lo;
+      if (frame.start_ == WINDOW_FRAME_UNBOUNDED_PRECEDING) {
+        lo = begin;
+      } else if (frame.start_ == 0 || !offsets_apply) {
+        lo = peer_start[row];
+      } else {
+        while (lo_row < non_null_end && distance(lo_row) < frame.start_) { lo_row++; }
+        lo = lo_row;
+      }
+
+      int64_t hi;
+      if (frame.end_ == WINDOW_FRAME_UNBOUNDED_FOLLOWING) {
+        hi = end;
+      } else if (frame.end_ == 0 || !offsets_apply) {
+        hi = peer_end[row];
+      } else {
+        hi_row = std::max(hi_row, lo_row);
+        while (hi_row < non_null_end && distance(hi_row) <= frame.end_) { hi_row++; }
+        hi = hi_row;
+      }
+
+      bounds.lo[row] = lo;
+      bounds.hi[row] = std::max(lo, hi);
+    }
+  }
+
+  return bounds;
+}
+
+// Evaluate the ranking functions, which only depend on the position of the row among its peers.
+absl::StatusOr<std::shared_ptr<arrow::Array>> evaluateRanking(
+    WindowFunctionType type,
+    const std::vector<int64_t>& partitions,
+    const std::vector<std::shared_ptr<arrow::Array>>& order_keys,
+    const std::vector<SortKey>& order_by,
+    arrow::MemoryPool* pool) {
+  arrow::Int64Builder builder(pool);
+  // the ranks are appended without checking for room, the reservation has to succeed.
+  auto reserve_status = builder.Reserve(partitions.back());
+  if (reserve_status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(reserve_status)); }
+  if (!reserve_status.ok()) { return absl::InternalError(GetMessageFromStatus(reserve_status)); }
+
+  for (size_t p = 0; p + 1 < partitions.size(); p++) {
+    auto begin = partitions[p], end = partitions[p + 1];
+    int64_t rank = 0, dense_rank = 0;
+    for (int64_t row = begin; row < end; row++) {
+      bool is_peer = row > begin && CompareSortKeys(order_keys, row - 1, order_keys, row, order_by) == 0;
+      if (!is_peer) {
+        rank = row - begin + 1;
+        dense_rank++;
+      }
+
+      switch (type) {
+        case WindowFunctionType::RowNumber: builder.UnsafeAppend(row - begin + 1); break;
+        case WindowFunctionType::Rank: builder.UnsafeAppend(rank); break;
+        default: builder.UnsafeAppend(dense_rank); break;
+      }
+    }
+  }
+
+  std::shared_ptr<arrow::Array> result;
+  auto finish_status = builder.Finish(&result);
+  if (finish_status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(finish_status)); }
+  if (!finish_status.ok()) { return absl::InternalError(GetMessageFromStatus(finish_status)); }
+  return result;
+}
+
+// Evaluate an aggregate over the frame of each row, sliding the frame along the rows of each partition.
+template<typename ArrayType, typename BuilderType>
+absl::StatusOr<std::shared_ptr<arrow::Array>> evaluateSlidingAggregate(
+    WindowFunctionType type,
+    const ArrayType& values,
+    const std::vector<int64_t>& partitions,
+    const FrameBounds& bounds,
+    arrow::MemoryPool* pool) {
+  using ValueType = typename ArrayType::value_type;
+  auto num_rows = partitions.back();
+
+  std::vector<ValueType> results(num_rows);
+  std::vector<double> averages(num_rows);
+  std::vector<int64_t> counts(num_rows);
+  std::vector<bool> is_valid(num_rows);
+
+  // the candidates for the min (max) of the frame: increasing (decreasing) values, in row order.
+  auto dominates = [type](ValueType a, ValueType b) { return type == WindowFunctionType::Min ? a <= b : a >= b; };
+  bool track_extremes = type == WindowFunctionType::Min || type == WindowFunctionType::Max;
+
+  for (size_t p = 0; p + 1 < partitions.size(); p++) {
+    auto begin = partitions[p], end = partitions[p + 1];
+
+    ValueType sum{};
+    int64_t count = 0;
+    std::deque<int64_t> extremes;
+    int64_t added = begin, removed = begin;
+
+    for (int64_t row = begin; row < end; row++) {
+      for (; added < bounds.hi[row]; added++) {
+        if (values.IsNull(added)) { continue; }
+        sum += values.Value(added);
+        count++;
+        if (track_extremes) {
+          while (!extremes.empty() && dominates(values.Value(added), values.Value(extremes.back()))) {
+            extremes.pop_back();
+          }
+          extremes.push_back(added);
+        }
+      }
+      for (; removed < bounds.lo[row]; removed++) {
+        if (values.IsNull(removed)) { continue; }
+        sum -= values.Value(removed);
+        count--;
+      }
+      while (!extremes.empty() && extremes.front() < bounds.lo[row]) { extremes.pop_front(); }
+
+      counts[row] = count;
+      is_valid[row] = count > 0;
+      if (count == 0) { continue; }
+      averages[row] = static_cast<double>(sum) / count;
+      results[row] = track_extremes ? values.Value(extremes.front()) : sum;
+    }
+  }
+
+  std::shared_ptr<arrow::Array> result;
+  arrow::Status status;
+  switch (type) {
+    case WindowFunctionType::Count: {
+      arrow::Int64Builder builder(pool);
+      status = builder.AppendValues(counts);
+      if (status.ok()) { status = builder.Finish(&result); }
+      break;
+    }
+    case WindowFunctionType::Avg: {
+      arrow::DoubleBuilder builder(pool);
+      status = builder.AppendValues(averages, is_valid);
+      if (status.ok()) { status = builder.Finish(&result); }
+      break;
+    }
+    default: {
+      BuilderType builder(pool);
+      status = builder.AppendValues(results, is_valid);
+      if (status.ok()) { status = builder.Finish(&result); }
+      break;
+    }
+  }
+  if (status.IsOutOfMemory()) { return absl::ResourceExhaustedError(GetMessageFromStatus(status)); }
+  if (!status.ok()) { return absl::InternalError(GetMessageFromStatus(status)); }
+  return result;
+}
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<arrow::Array>> EvaluateWindowFunction(
+    const WindowFunction& function,
+    const std::shared_ptr<arrow::RecordBatch>& batch,
+    const std::vector<int64_t>& partitions,
+    const std::vector<std::shared_ptr<arrow::Array>>& order_keys,
+    const std::vector<SortKey>& order_by,
+    arrow::MemoryPool* pool) {
+  switch (function.type) {
+    case WindowFunctionType::RowNumber:
+    case WindowFunctionType::Rank:
+    case WindowFunctionType::DenseRank: return evaluateRanking(function.type, partitions, order_keys, order_by, pool);
+    default: break;
+  }
+
+  if (function.input == nullptr) { return absl::InvalidArgumentError("window aggregate without an input"); }
+  ASSIGN_OR_RETURN(auto values, function.input->Evaluate(batch, pool));
+  ASSIGN_OR_RETURN(auto bounds, computeFrames(function.frame, partitions, order_keys, order_by));
+
+  switch (values->type_id()) {
+    case arrow::Type::INT64: {
+      return evaluateSlidingAggregate<arrow::Int64Array, arrow::Int64Builder>(
+          function.type, static_cast<const arrow::Int64Array&>(*values), partitions, bounds, pool);
+    }
+    case arrow::Type::DOUBLE: {
+      return evaluateSlidingAggregate<arrow::DoubleArray, arrow::DoubleBuilder>(
+          function.type, static_cast<const arrow::DoubleArray&>(*values), partitions, bounds, pool);
+    }
+    default: return absl::UnimplementedError("window aggregates are only supported on int64 and double values");
+  }
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
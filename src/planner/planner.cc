@@ -10,53 +10,67 @@ using ::toyquery::logicalplan::LogicalPlanType;
 using ::toyquery::physicalplan::AddExpression;
 using ::toyquery::physicalplan::AggregationExpression;
 using ::toyquery::physicalplan::AndExpression;
+using ::toyquery::physicalplan::ApproxCountDistinctExpression;
+using ::toyquery::physicalplan::ApproxPercentileExpression;
 using ::toyquery::physicalplan::Cast;
 using ::toyquery::physicalplan::Column;
+using ::toyquery::physicalplan::CountDistinctExpression;
+using ::toyquery::physicalplan::CountExpression;
+using ::toyquery::physicalplan::Distinct;
 using ::toyquery::physicalplan::DivideExpression;
 using ::toyquery::physicalplan::EqExpression;
+using ::toyquery::physicalplan::Gather;
+using ::toyquery::physicalplan::GraceHashJoin;
 using ::toyquery::physicalplan::GreaterThanEqualsExpression;
 using ::toyquery::physicalplan::GreaterThanExpression;
 using ::toyquery::physicalplan::HashAggregation;
+using ::toyquery::physicalplan::HashJoin;
 using ::toyquery::physicalplan::LessThanEqualsExpression;
 using ::toyquery::physicalplan::LessThanExpression;
+using ::toyquery::physicalplan::Limit;
 using ::toyquery::physicalplan::LiteralDouble;
 using ::toyquery::physicalplan::LiteralLong;
 using ::toyquery::physicalplan::LiteralString;
+using ::toyquery::physicalplan::MaxExpression;
+using ::toyquery::physicalplan::MinExpression;
+using ::toyquery::physicalplan::MorselQueue;
+using ::toyquery::physicalplan::MorselScan;
 using ::toyquery::physicalplan::MultiplyExpression;
 using ::toyquery::physicalplan::NeqExpression;
 using ::toyquery::physicalplan::OrExpression;
+using ::toyquery::physicalplan::PipelineExecution;
+using ::toyquery::physicalplan::Prefetch;
 using ::toyquery::physicalplan::PhysicalExpression;
+using ::toyquery::physicalplan::PhysicalPlan;
 using ::toyquery::physicalplan::Projection;
+using ::toyquery::physicalplan::RuntimeFilter;
 using ::toyquery::physicalplan::Scan;
 using ::toyquery::physicalplan::Selection;
+using ::toyquery::physicalplan::Sort;
+using ::toyquery::physicalplan::SortKey;
+using ::toyquery::physicalplan::SortMergeJoin;
 using ::toyquery::physicalplan::SubtractExpression;
+using ::toyquery::physicalplan::SumExpression;
+using ::toyquery::physicalplan::TopK;
+using ::toyquery::physicalplan::WindowFunction;
+
+// the number of hash partitions of the joins planned under a memory limit, each one spilled as a whole.
+static constexpr int GRACE_HASH_JOIN_PARTITIONS = 16;
 
 absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> QueryPlanner::CreatePhysicalPlan(
     std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan) {
+  if (parallelism_ > 1 && morsels_ == nullptr && isMorselPipeline(logical_plan)) { return createGather(logical_plan); }
+
   switch (logical_plan->Type()) {
     case LogicalPlanType::Scan: {
       auto logical_scan = std::static_pointer_cast<toyquery::logicalplan::Scan>(logical_plan);
-      return std::make_shared<Scan>(logical_scan->source_, logical_scan->projection_);
-    }
-    case LogicalPlanType::Selection: {
-      auto logical_selection = std::static_pointer_cast<toyquery::logicalplan::Selection>(logical_plan);
-      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_selection->input_));
-      ASSIGN_OR_RETURN(
-          auto filter_expr, CreatePhysicalExpression(logical_selection->filter_expr_, logical_selection->input_));
-      return std::make_shared<Selection>(input, filter_expr);
+      if (morsels_ != nullptr) { return std::make_shared<MorselScan>(morsels_); }
+      return createScan(logical_scan);
     }
+    case LogicalPlanType::Selection:
     case LogicalPlanType::Projection: {
-      auto logical_projection = std::static_pointer_cast<toyquery::logicalplan::Projection>(logical_plan);
-
-      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_projection->input_));
-      std::vector<std::shared_ptr<PhysicalExpression>> projection_exprs;
-      for (auto& logical_proj_expr : logical_projection->expr_) {
-        ASSIGN_OR_RETURN(auto physical_proj_expr, CreatePhysicalExpression(logical_proj_expr, logical_projection->input_));
-        projection_exprs.push_back(physical_proj_expr);
-      }
-      ASSIGN_OR_RETURN(auto schema, logical_projection->Schema());
-
-      return std::make_shared<Projection>(input, schema, projection_exprs);
+      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_plan->Children()[0]));
+      return createStreamingOperator(logical_plan, input);
     }
     case LogicalPlanType::Aggregation: {
       auto logical_aggregation = std::static_pointer_cast<toyquery::logicalplan::Aggregation>(logical_plan);
@@ -80,15 +94,312 @@ absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalPlan>> QueryPlann
       ASSIGN_OR_RETURN(auto schema, logical_aggregation->Schema());
       return std::make_shared<HashAggregation>(input, schema, group_exprs, aggregation_exprs);
     }
+    case LogicalPlanType::Join: {
+      auto logical_join = std::static_pointer_cast<toyquery::logicalplan::Join>(logical_plan);
+
+      ASSIGN_OR_RETURN(auto probe, CreatePhysicalPlan(logical_join->left_));
+      ASSIGN_OR_RETURN(auto build, CreatePhysicalPlan(logical_join->right_));
+      ASSIGN_OR_RETURN(auto left_schema, logical_join->left_->Schema());
+      ASSIGN_OR_RETURN(auto right_schema, logical_join->right_->Schema());
+
+      std::vector<int> probe_keys, build_keys;
+      for (auto& [left_name, right_name] : logical_join->on_) {
+        auto probe_key = left_schema->GetFieldIndex(left_name);
+        auto build_key = right_schema->GetFieldIndex(right_name);
+        if (probe_key == -1 || build_key == -1) { return absl::InvalidArgumentError("join column not found"); }
+        probe_keys.push_back(probe_key);
+        build_keys.push_back(build_key);
+      }
+
+      ASSIGN_OR_RETURN(auto schema, logical_join->Schema());
+
+      // both inputs are already sorted on the join keys, merge them instead of building a hash table.
+      if (isSortedOn(logical_join->left_, logical_join->on_, true) &&
+          isSortedOn(logical_join->right_, logical_join->on_, false)) {
+        return std::make_shared<SortMergeJoin>(probe, build, schema, probe_keys, build_keys);
+      }
+
+      // under a memory limit the build side may not fit in memory, both sides are partitioned so that the build
+      // partitions can spill.
+      // push the runtime filters of the build side down into the probe side. The join applies the ones which no operator
+      // of the probe side could take on its probe batches itself.
+      auto push_runtime_filters = [&](auto join) -> std::shared_ptr<PhysicalPlan> {
+        auto runtime_filters = join->RuntimeFilters();
+        for (int i = 0; i < probe_keys.size(); i++) {
+          if (!attachRuntimeFilter(probe, probe_keys[i], runtime_filters[i])) {
+            join->AddProbeRuntimeFilter(probe_keys[i], runtime_filters[i]);
+          }
+        }
+        return join;
+      };
+
+      if (memory_limit_ != std::numeric_limits<int64_t>::max()) {
+        return push_runtime_filters(std::make_shared<GraceHashJoin>(
+            probe, build, schema, probe_keys, build_keys, memory_limit_, GRACE_HASH_JOIN_PARTITIONS, spill_directory_));
+      }
+      return push_runtime_filters(std::make_shared<HashJoin>(probe, build, schema, probe_keys, build_keys));
+    }
+    case LogicalPlanType::Sort: {
+      auto logical_sort = std::static_pointer_cast<toyquery::logicalplan::Sort>(logical_plan);
+
+      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_sort->input_));
+      ASSIGN_OR_RETURN(auto sort_keys, createSortKeys(logical_sort));
+      return std::make_shared<Sort>(input, sort_keys, memory_limit_, spill_directory_);
+    }
+    case LogicalPlanType::Limit: {
+      auto logical_limit = std::static_pointer_cast<toyquery::logicalplan::Limit>(logical_plan);
+      auto limit = logical_limit->limit_ < 0 ? std::numeric_limits<int64_t>::max() : logical_limit->limit_;
+      auto offset = logical_limit->offset_;
+      if (logical_limit->input_->Type() != LogicalPlanType::Sort || limit > std::numeric_limits<int64_t>::max() - offset) {
+        ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_limit->input_));
+        return std::make_shared<Limit>(input, limit, offset);
+      }
+
+      // only the best rows are needed, a top-k keeps them without sorting the whole input.
+      auto logical_sort = std::static_pointer_cast<toyquery::logicalplan::Sort>(logical_limit->input_);
+      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_sort->input_));
+      ASSIGN_OR_RETURN(auto sort_keys, createSortKeys(logical_sort));
+      auto top_k = std::make_shared<TopK>(input, sort_keys, limit + offset);
+
+      // push the k-th value down to the scan when the first sort key is an input column. The top-k compares every row
+      // with its k-th value anyway, when nothing below takes the filter the rows are simply dropped by the top-k.
+      if (!logical_sort->sort_keys_.empty() &&
+          logical_sort->sort_keys_[0].expr_->type() == LogicalExpressionType::Column) {
+        auto column = std::static_pointer_cast<toyquery::logicalplan::Column>(logical_sort->sort_keys_[0].expr_);
+        ASSIGN_OR_RETURN(auto input_schema, logical_sort->input_->Schema());
+        auto column_idx = input_schema->GetFieldIndex(std::string(column->name_));
+        if (column_idx != -1) { attachRuntimeFilter(input, column_idx, top_k->Filter()); }
+      }
+
+      if (offset == 0) { return top_k; }
+      return std::make_shared<Limit>(top_k, limit, offset);
+    }
+    case LogicalPlanType::Distinct: {
+      auto logical_distinct = std::static_pointer_cast<toyquery::logicalplan::Distinct>(logical_plan);
+
+      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_distinct->input_));
+      return std::make_shared<Distinct>(input);
+    }
+    case LogicalPlanType::Window: {
+      auto logical_window = std::static_pointer_cast<toyquery::logicalplan::Window>(logical_plan);
+
+      ASSIGN_OR_RETURN(auto input, CreatePhysicalPlan(logical_window->input_));
+      std::vector<std::shared_ptr<PhysicalExpression>> partition_by;
+      for (auto& logical_partition_expr : logical_window->partition_by_) {
+        ASSIGN_OR_RETURN(auto partition_expr, CreatePhysicalExpression(logical_partition_expr, logical_window->input_));
+        partition_by.push_back(partition_expr);
+      }
+
+      std::vector<SortKey> order_by;
+      for (auto& logical_order_key : logical_window->order_by_) {
+        ASSIGN_OR_RETURN(auto order_expr, CreatePhysicalExpression(logical_order_key.expr_, logical_window->input_));
+        order_by.push_back({ order_expr, logical_order_key.ascending_, logical_order_key.nulls_first_ });
+      }
+
+      std::vector<WindowFunction> functions;
+      for (auto& logical_function : logical_window->functions_) {
+        std::shared_ptr<PhysicalExpression> function_input;
+        if (logical_function.expr_ != nullptr) {
+          ASSIGN_OR_RETURN(function_input, CreatePhysicalExpression(logical_function.expr_, logical_window->input_));
+        }
+        functions.push_back({ logical_function.type_, function_input, logical_function.frame_ });
+      }
+
+      ASSIGN_OR_RETURN(auto schema, logical_window->Schema());
+      return std::make_shared<toyquery::physicalplan::Window>(input, schema, partition_by, order_by, functions);
+    }
     default: return absl::InvalidArgumentError("invalid type of logical plan");
   }
 
   return absl::InternalError("unreachable code");
 }
 
+absl::StatusOr<std::shared_ptr<PhysicalPlan>> QueryPlanner::createStreamingOperator(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan,
+    std::shared_ptr<PhysicalPlan> input) {
+  if (logical_plan->Type() == LogicalPlanType::Selection) {
+    auto logical_selection = std::static_pointer_cast<toyquery::logicalplan::Selection>(logical_plan);
+    ASSIGN_OR_RETURN(
+        auto filter_expr, CreatePhysicalExpression(logical_selection->filter_expr_, logical_selection->input_));
+    return std::make_shared<Selection>(input, filter_expr);
+  }
+
+  auto logical_projection = std::static_pointer_cast<toyquery::logicalplan::Projection>(logical_plan);
+  std::vector<std::shared_ptr<PhysicalExpression>> projection_exprs;
+  for (auto& logical_proj_expr : logical_projection->expr_) {
+    ASSIGN_OR_RETURN(auto physical_proj_expr, CreatePhysicalExpression(logical_proj_expr, logical_projection->input_));
+    projection_exprs.push_back(physical_proj_expr);
+  }
+  ASSIGN_OR_RETURN(auto schema, logical_projection->Schema());
+
+  return std::make_shared<Projection>(input, schema, projection_exprs);
+}
+
+absl::StatusOr<std::vector<SortKey>> QueryPlanner::createSortKeys(
+    std::shared_ptr<toyquery::logicalplan::Sort> logical_sort) {
+  std::vector<SortKey> sort_keys;
+  for (auto& logical_sort_key : logical_sort->sort_keys_) {
+    ASSIGN_OR_RETURN(auto sort_expr, CreatePhysicalExpression(logical_sort_key.expr_, logical_sort->input_));
+    sort_keys.push_back({ sort_expr, logical_sort_key.ascending_, logical_sort_key.nulls_first_ });
+  }
+  return sort_keys;
+}
+
+bool QueryPlanner::isSortedOn(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> plan,
+    const std::vector<std::pair<std::string, std::string>>& on,
+    bool left) {
+  auto sorted_by = plan->SortedBy();
+  if (sorted_by.size() < on.size()) { return false; }
+
+  for (int i = 0; i < on.size(); i++) {
+    if (sorted_by[i] != (left ? on[i].first : on[i].second)) { return false; }
+  }
+  return true;
+}
+
+std::shared_ptr<PhysicalPlan> QueryPlanner::createScan(std::shared_ptr<toyquery::logicalplan::Scan> logical_scan) {
+  auto scan = std::make_shared<Scan>(logical_scan->source_, logical_scan->projection_, logical_scan->filter_);
+  scan->SetQueryOptions(parallelism_, prefetch_depth_);
+  if (prefetch_depth_ <= 0) { return scan; }
+  return std::make_shared<Prefetch>(scan, prefetch_depth_);
+}
+
+bool QueryPlanner::attachRuntimeFilter(
+    std::shared_ptr<PhysicalPlan> plan,
+    int column_idx,
+    std::shared_ptr<RuntimeFilter> filter) {
+  // the filter is attached once, to the lowest operator down to the scan whose output still contains the column at the
+  // same index, so that the rows are dropped as early as possible and the operators above don't check them again.
+  if (auto selection = std::dynamic_pointer_cast<Selection>(plan)) {
+    if (!attachRuntimeFilter(selection->Children()[0], column_idx, filter)) {
+      selection->AddRuntimeFilter(column_idx, filter);
+    }
+    return true;
+  }
+  if (auto scan = std::dynamic_pointer_cast<Scan>(plan)) {
+    scan->AddRuntimeFilter(column_idx, filter);
+    return true;
+  }
+  if (auto prefetch = std::dynamic_pointer_cast<Prefetch>(plan)) {
+    // the scan below runs on the prefetch thread, the batches read ahead before the filter is published aren't filtered.
+    return attachRuntimeFilter(prefetch->Children()[0], column_idx, filter);
+  }
+  if (auto projection = std::dynamic_pointer_cast<Projection>(plan)) {
+    // only followed when the column is passed through, it can be at another index of the projection input.
+    auto input_idx = projection->PassedThroughColumn(column_idx);
+    return input_idx != -1 && attachRuntimeFilter(projection->Children()[0], input_idx, filter);
+  }
+  return false;
+}
+
 absl::StatusOr<std::shared_ptr<AggregationExpression>> QueryPlanner::createAggregationExpression(
     std::shared_ptr<toyquery::logicalplan::AggregateExpression> logical_aggregation_expr,
-    std::shared_ptr<toyquery::logicalplan::LogicalPlan> input_plan) { }
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> input_plan) {
+  ASSIGN_OR_RETURN(auto input, CreatePhysicalExpression(logical_aggregation_expr->expr_, input_plan));
+
+  switch (logical_aggregation_expr->type()) {
+    case LogicalExpressionType::Max: return std::make_shared<MaxExpression>(input);
+    case LogicalExpressionType::Min: return std::make_shared<MinExpression>(input);
+    case LogicalExpressionType::Sum: return std::make_shared<SumExpression>(input);
+    case LogicalExpressionType::Count: {
+      auto count = std::static_pointer_cast<toyquery::logicalplan::Count>(logical_aggregation_expr);
+      if (count->distinct_) { return std::make_shared<CountDistinctExpression>(input); }
+      return std::make_shared<CountExpression>(input);
+    }
+    case LogicalExpressionType::ApproxCountDistinct: return std::make_shared<ApproxCountDistinctExpression>(input);
+    case LogicalExpressionType::ApproxPercentile: {
+      auto percentile = std::static_pointer_cast<toyquery::logicalplan::ApproxPercentile>(logical_aggregation_expr);
+      return std::make_shared<ApproxPercentileExpression>(input, percentile->percentile_);
+    }
+    default: return absl::UnimplementedError("unsupported aggregate expression");
+  }
+}
+
+bool QueryPlanner::isMorselPipeline(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan,
+    bool below_aggregation) {
+  switch (logical_plan->Type()) {
+    case LogicalPlanType::Scan: return true;
+    case LogicalPlanType::Selection:
+    case LogicalPlanType::Projection: return isMorselPipeline(logical_plan->Children()[0], below_aggregation);
+    case LogicalPlanType::Aggregation: {
+      // a single aggregation can be split into partial and final ones.
+      if (below_aggregation) { return false; }
+      auto logical_aggregation = std::static_pointer_cast<toyquery::logicalplan::Aggregation>(logical_plan);
+      for (auto& aggregation_expr : logical_aggregation->aggregation_expr_) {
+        switch (aggregation_expr->type()) {
+          // the accumulators of the partial aggregations are merged, including the distinct values of a count and the
+          // sketches of the approximate aggregations.
+          case LogicalExpressionType::Max:
+          case LogicalExpressionType::Min:
+          case LogicalExpressionType::Sum:
+          case LogicalExpressionType::Count:
+          case LogicalExpressionType::ApproxCountDistinct:
+          case LogicalExpressionType::ApproxPercentile: break;
+          default: return false;
+        }
+      }
+      return isMorselPipeline(logical_aggregation->input_, true);
+    }
+    default: return false;
+  }
+}
+
+absl::StatusOr<std::shared_ptr<PhysicalPlan>> QueryPlanner::createGather(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan) {
+  // the aggregation ends the parallel pipeline, the selections (e.g. HAVING) and projections above it run once on the
+  // merged groups.
+  std::vector<std::shared_ptr<LogicalPlan>> logical_above;
+  for (auto plan = logical_plan; plan->Type() != LogicalPlanType::Scan; plan = plan->Children()[0]) {
+    if (plan->Type() != LogicalPlanType::Aggregation) {
+      logical_above.push_back(plan);
+      continue;
+    }
+
+    ASSIGN_OR_RETURN(auto merged, createParallelPipeline(plan));
+    for (auto it = logical_above.rbegin(); it != logical_above.rend(); it++) {
+      ASSIGN_OR_RETURN(merged, createStreamingOperator(*it, merged));
+    }
+    return merged;
+  }
+  return createParallelPipeline(logical_plan);
+}
+
+absl::StatusOr<std::shared_ptr<PhysicalPlan>> QueryPlanner::createParallelPipeline(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan) {
+  auto logical_input = logical_plan;
+  while (logical_input->Type() != LogicalPlanType::Scan) { logical_input = logical_input->Children()[0]; }
+  auto source = createScan(std::static_pointer_cast<toyquery::logicalplan::Scan>(logical_input));
+  if (thread_pool_ == nullptr) { thread_pool_ = std::make_shared<ThreadPool>(parallelism_); }
+
+  // plan one instance of the pipeline per thread, all of them sharing the morsels of the scan.
+  morsels_ = std::make_shared<MorselQueue>(source);
+  std::vector<std::shared_ptr<PhysicalPlan>> pipelines;
+  for (int i = 0; i < parallelism_; i++) {
+    auto pipeline = CreatePhysicalPlan(logical_plan);
+    if (!pipeline.ok()) {
+      morsels_ = nullptr;
+      return pipeline.status();
+    }
+    pipelines.push_back(*pipeline);
+  }
+  morsels_ = nullptr;
+  auto gather = std::make_shared<Gather>(pipelines, thread_pool_);
+  if (logical_plan->Type() != LogicalPlanType::Aggregation) { return gather; }
+
+  // each instance only aggregates its own morsels, their groups are merged once the gather is drained.
+  std::vector<std::shared_ptr<HashAggregation>> partials;
+  for (auto& pipeline : pipelines) { partials.push_back(std::static_pointer_cast<HashAggregation>(pipeline)); }
+  ASSIGN_OR_RETURN(auto schema, logical_plan->Schema());
+  return std::make_shared<HashAggregation>(gather, schema, partials);
+}
+
+absl::StatusOr<std::shared_ptr<PhysicalPlan>> QueryPlanner::CreatePipelinedPlan(
+    std::shared_ptr<toyquery::logicalplan::LogicalPlan> logical_plan) {
+  ASSIGN_OR_RETURN(auto plan, CreatePhysicalPlan(logical_plan));
+  return std::make_shared<PipelineExecution>(plan);
+}
 
 absl::StatusOr<std::shared_ptr<toyquery::physicalplan::PhysicalExpression>> QueryPlanner::CreatePhysicalExpression(
     std::shared_ptr<LogicalExpression> logical_expr,
@@ -39,9 +39,10 @@ SqlExpressionType SqlDouble::GetType() { return SqlExpressionType::SqlDouble; }
 
 std::string SqlDouble::ToString() { return "todo"; }
 
-SqlFunction::SqlFunction(absl::string_view id, std::vector<std::shared_ptr<SqlExpression>> args)
+SqlFunction::SqlFunction(absl::string_view id, std::vector<std::shared_ptr<SqlExpression>> args, bool distinct)
     : id_{ id },
-      args_{ args } { }
+      args_{ args },
+      distinct_{ distinct } { }
 
 SqlExpressionType SqlFunction::GetType() { return SqlExpressionType::SqlFunction; }
 
@@ -75,13 +76,19 @@ SqlSelect::SqlSelect(
     std::vector<std::shared_ptr<SqlExpression>> group_by,
     std::vector<std::shared_ptr<SqlSort>> order_by,
     std::shared_ptr<SqlExpression> having,
-    absl::string_view table_name)
+    absl::string_view table_name,
+    int64_t limit,
+    int64_t offset,
+    bool distinct)
     : projection_{ projection },
       selection_{ selection },
       group_by_{ group_by },
       order_by_{ order_by },
       having_{ having },
-      table_name_{ table_name } { }
+      table_name_{ table_name },
+      limit_{ limit },
+      offset_{ offset },
+      distinct_{ distinct } { }
 
 SqlExpressionType SqlSelect::GetType() { return SqlExpressionType::SqlSelect; }
 
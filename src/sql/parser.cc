@@ -111,8 +111,9 @@ absl::StatusOr<std::shared_ptr<SqlExpression>> Parser::parseInfix(std::shared_pt
     case TokenType::SYMBOL_LEFT_PAREN: {
       if (left->GetType() == SqlExpressionType::SqlIdentifier) {
         advance();  // consume token
+        auto distinct = match(TokenType::KEYWORD_DISTINCT);
         ASSIGN_OR_RETURN(auto args, parseExpressionList());
-        return std::make_shared<SqlFunction>(std::static_pointer_cast<SqlIdentifier>(left)->id_, args);
+        return std::make_shared<SqlFunction>(std::static_pointer_cast<SqlIdentifier>(left)->id_, args, distinct);
       } else {
         return absl::InvalidArgumentError("unexpected left paren");
       }
@@ -123,6 +124,7 @@ absl::StatusOr<std::shared_ptr<SqlExpression>> Parser::parseInfix(std::shared_pt
 }
 
 absl::StatusOr<std::shared_ptr<SqlExpression>> Parser::parseSelect() {
+  auto distinct = match(TokenType::KEYWORD_DISTINCT);
   ASSIGN_OR_RETURN(auto projection, parseExpressionList());
 
   if (match(TokenType::KEYWORD_FROM)) {
@@ -142,8 +144,22 @@ absl::StatusOr<std::shared_ptr<SqlExpression>> Parser::parseSelect() {
     std::vector<std::shared_ptr<SqlSort>> order_by{};
     if (matchMultiple({ TokenType::KEYWORD_ORDER, TokenType::KEYWORD_BY })) { ASSIGN_OR_RETURN(order_by, parseOrder()); }
 
+    int64_t limit = -1;
+    if (match(TokenType::KEYWORD_LIMIT)) { ASSIGN_OR_RETURN(limit, parseRowCount("LIMIT")); }
+
+    int64_t offset = 0;
+    if (match(TokenType::KEYWORD_OFFSET)) { ASSIGN_OR_RETURN(offset, parseRowCount("OFFSET")); }
+
     return std::make_shared<SqlSelect>(
-        projection, filter_expr, group_by, order_by, having, std::static_pointer_cast<SqlIdentifier>(table)->id_);
+        projection,
+        filter_expr,
+        group_by,
+        order_by,
+        having,
+        std::static_pointer_cast<SqlIdentifier>(table)->id_,
+        limit,
+        offset,
+        distinct);
   } else {
     return absl::InvalidArgumentError(absl::StrCat(current().text_, " found, expected FROM"));
   }
@@ -184,6 +200,17 @@ absl::StatusOr<std::vector<std::shared_ptr<SqlSort>>> Parser::parseOrder() {
   return sort_list;
 }
 
+absl::StatusOr<int64_t> Parser::parseRowCount(absl::string_view clause) {
+  if (isAtEnd() || current().type_ != TokenType::LITERAL_LONG) {
+    return absl::InvalidArgumentError(absl::StrCat("expected the number of rows after ", clause));
+  }
+
+  auto token = current();
+  advance();
+  ASSIGN_OR_RETURN(auto row_count, ToLong(token.text_));
+  return row_count;
+}
+
 absl::StatusOr<std::shared_ptr<SqlIdentifier>> Parser::parseIdentifier() {
   if (isAtEnd()) { return absl::InvalidArgumentError("end of token stream, expected an identifier"); }
 
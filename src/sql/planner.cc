@@ -1,5 +1,6 @@
 #include "sql/planner.h"
 
+#include "fmt/core.h"
 #include "logicalplan/utils.h"
 
 namespace toyquery {
@@ -9,10 +10,13 @@ using ::toyquery::logicalplan::Add;
 using ::toyquery::logicalplan::AggregateExpression;
 using ::toyquery::logicalplan::Alias;
 using ::toyquery::logicalplan::And;
+using ::toyquery::logicalplan::ApproxCountDistinct;
+using ::toyquery::logicalplan::ApproxPercentile;
 using ::toyquery::logicalplan::Avg;
 using ::toyquery::logicalplan::BinaryExpression;
 using ::toyquery::logicalplan::Cast;
 using ::toyquery::logicalplan::Column;
+using ::toyquery::logicalplan::ColumnIndex;
 using ::toyquery::logicalplan::Count;
 using ::toyquery::logicalplan::Divide;
 using ::toyquery::logicalplan::Eq;
@@ -32,6 +36,7 @@ using ::toyquery::logicalplan::Modulus;
 using ::toyquery::logicalplan::Multiply;
 using ::toyquery::logicalplan::Neq;
 using ::toyquery::logicalplan::Or;
+using ::toyquery::logicalplan::SortKey;
 using ::toyquery::logicalplan::Subtract;
 using ::toyquery::logicalplan::Sum;
 
@@ -50,19 +55,205 @@ absl::StatusOr<std::shared_ptr<toyquery::dataframe::DataFrame>> SqlPlanner::Crea
     projection_exprs.push_back(std::move(proj_logical_expr));
   }
 
-  // get all the columns referenced in the projection
-  ASSIGN_OR_RETURN(auto referenced_columns_in_projection, getReferencedColumns(projection_exprs));
-
   ASSIGN_OR_RETURN(auto aggregation_expr_count, countAggregationExpressions(projection_exprs));
   if (aggregation_expr_count == 0 && !select->group_by_.empty()) {
     return absl::InvalidArgumentError("GROUP BY without aggregate expressions are not supported");
   }
+  if (aggregation_expr_count == 0 && select->having_ != nullptr) {
+    return absl::InvalidArgumentError("HAVING without aggregate expressions is not supported");
+  }
 
-  ASSIGN_OR_RETURN(auto referenced_columns_in_selection, getReferencedColumnsBySelection(select, table));
-
+  // the rows are filtered before the projection, the WHERE clause can reference the columns which aren't selected.
   auto plan = table;
+  if (select->selection_ != nullptr) {
+    ASSIGN_OR_RETURN(auto filter_expr, createLogicalExpression(select->selection_, table));
+    if (IsAggregateExpression(filter_expr)) {
+      return absl::InvalidArgumentError("aggregate expressions are not allowed in the WHERE clause");
+    }
+    plan = plan->Filter(filter_expr);
+  }
+
   if (aggregation_expr_count == 0) {
+    plan = plan->Project(projection_exprs);
   } else {
+    std::vector<std::shared_ptr<LogicalExpression>> group_by_exprs;
+    for (auto& group_by : select->group_by_) {
+      ASSIGN_OR_RETURN(auto group_by_expr, createLogicalExpression(group_by, table));
+      group_by_exprs.push_back(std::move(group_by_expr));
+    }
+
+    // the projection and the HAVING clause are evaluated on the output of the aggregation, the grouping columns
+    // followed by the aggregates they use.
+    std::vector<std::shared_ptr<AggregateExpression>> aggregate_exprs;
+    std::vector<std::shared_ptr<LogicalExpression>> aggregated_projection_exprs;
+    for (auto& proj_expr : projection_exprs) {
+      ASSIGN_OR_RETURN(auto aggregated_expr, rewriteOnAggregation(proj_expr, group_by_exprs, aggregate_exprs));
+      aggregated_projection_exprs.push_back(std::move(aggregated_expr));
+    }
+    std::shared_ptr<LogicalExpression> having_expr;
+    if (select->having_ != nullptr) {
+      ASSIGN_OR_RETURN(auto having_input_expr, createLogicalExpression(select->having_, table));
+      ASSIGN_OR_RETURN(having_expr, rewriteOnAggregation(having_input_expr, group_by_exprs, aggregate_exprs));
+    }
+
+    plan = plan->Aggregate(group_by_exprs, aggregate_exprs);
+    if (having_expr != nullptr) { plan = plan->Filter(having_expr); }
+    plan = plan->Project(aggregated_projection_exprs);
+  }
+
+  if (select->distinct_) { plan = plan->Distinct(); }
+
+  if (!select->order_by_.empty()) {
+    std::vector<SortKey> sort_keys;
+    for (auto& order_by : select->order_by_) {
+      ASSIGN_OR_RETURN(auto sort_expr, createLogicalExpression(order_by->expr_, plan));
+      // nulls are considered larger than any value, as in PostgreSQL.
+      sort_keys.push_back({ sort_expr, order_by->asc_, !order_by->asc_ });
+    }
+    plan = plan->Sort(sort_keys);
+  }
+
+  if (select->limit_ >= 0 || select->offset_ > 0) { plan = plan->Limit(select->limit_, select->offset_); }
+
+  return plan;
+}
+
+absl::StatusOr<std::shared_ptr<toyquery::logicalplan::LogicalExpression>> SqlPlanner::rewriteOnAggregation(
+    std::shared_ptr<toyquery::logicalplan::LogicalExpression> expr,
+    const std::vector<std::shared_ptr<toyquery::logicalplan::LogicalExpression>>& group_by_exprs,
+    std::vector<std::shared_ptr<toyquery::logicalplan::AggregateExpression>>& aggregate_exprs) {
+  int num_groups = group_by_exprs.size();
+  for (int i = 0; i < num_groups; i++) {
+    if (isSameExpression(expr, group_by_exprs[i])) { return std::make_shared<ColumnIndex>(i); }
+  }
+
+  switch (expr->type()) {
+    case LogicalExpressionType::Column:
+      return absl::InvalidArgumentError(fmt::format(
+          "column {} must appear in the GROUP BY clause or be used in an aggregate function",
+          std::static_pointer_cast<Column>(expr)->name_));
+    case LogicalExpressionType::Alias: {
+      auto alias_expr = std::static_pointer_cast<Alias>(expr);
+      ASSIGN_OR_RETURN(auto aliased_expr, rewriteOnAggregation(alias_expr->expr_, group_by_exprs, aggregate_exprs));
+      return std::make_shared<Alias>(aliased_expr, alias_expr->alias_);
+    }
+    case LogicalExpressionType::Cast: {
+      auto cast_expr = std::static_pointer_cast<Cast>(expr);
+      ASSIGN_OR_RETURN(auto cast_input, rewriteOnAggregation(cast_expr->expr_, group_by_exprs, aggregate_exprs));
+      return std::make_shared<Cast>(cast_input, cast_expr->type_);
+    }
+
+    // binary expressions, created by the planner for this query only, so their operands are replaced in place.
+    case LogicalExpressionType::And:
+    case LogicalExpressionType::Or:
+    case LogicalExpressionType::Eq:
+    case LogicalExpressionType::Neq:
+    case LogicalExpressionType::Gt:
+    case LogicalExpressionType::GtEq:
+    case LogicalExpressionType::Lt:
+    case LogicalExpressionType::LtEq:
+    case LogicalExpressionType::Add:
+    case LogicalExpressionType::Subtract:
+    case LogicalExpressionType::Multiply:
+    case LogicalExpressionType::Divide:
+    case LogicalExpressionType::Modulus: {
+      auto binary_expr = std::static_pointer_cast<BinaryExpression>(expr);
+      ASSIGN_OR_RETURN(binary_expr->left_, rewriteOnAggregation(binary_expr->left_, group_by_exprs, aggregate_exprs));
+      ASSIGN_OR_RETURN(binary_expr->right_, rewriteOnAggregation(binary_expr->right_, group_by_exprs, aggregate_exprs));
+      return expr;
+    }
+
+    // aggregation expressions, the same aggregate is computed once however many times it's used.
+    case LogicalExpressionType::Sum:
+    case LogicalExpressionType::Avg:
+    case LogicalExpressionType::Max:
+    case LogicalExpressionType::Min:
+    case LogicalExpressionType::Count:
+    case LogicalExpressionType::ApproxCountDistinct:
+    case LogicalExpressionType::ApproxPercentile: {
+      auto aggr_expr = std::static_pointer_cast<AggregateExpression>(expr);
+      if (IsAggregateExpression(aggr_expr->expr_)) {
+        return absl::InvalidArgumentError("aggregate expressions can't be nested");
+      }
+      for (int i = 0; i < aggregate_exprs.size(); i++) {
+        if (isSameExpression(aggr_expr, aggregate_exprs[i])) { return std::make_shared<ColumnIndex>(num_groups + i); }
+      }
+      aggregate_exprs.push_back(aggr_expr);
+      return std::make_shared<ColumnIndex>(num_groups + aggregate_exprs.size() - 1);
+    }
+
+    default: return expr;
+  }
+}
+
+bool SqlPlanner::isSameExpression(
+    std::shared_ptr<toyquery::logicalplan::LogicalExpression> left,
+    std::shared_ptr<toyquery::logicalplan::LogicalExpression> right) {
+  if (left->type() != right->type()) { return false; }
+
+  switch (left->type()) {
+    case LogicalExpressionType::Column:
+      return std::static_pointer_cast<Column>(left)->name_ == std::static_pointer_cast<Column>(right)->name_;
+    case LogicalExpressionType::LiteralString:
+      return std::static_pointer_cast<LiteralString>(left)->value_ ==
+             std::static_pointer_cast<LiteralString>(right)->value_;
+    case LogicalExpressionType::LiteralLong:
+      return std::static_pointer_cast<LiteralLong>(left)->value_ == std::static_pointer_cast<LiteralLong>(right)->value_;
+    case LogicalExpressionType::LiteralDouble:
+      return std::static_pointer_cast<LiteralDouble>(left)->value_ ==
+             std::static_pointer_cast<LiteralDouble>(right)->value_;
+    case LogicalExpressionType::Alias:
+      return isSameExpression(std::static_pointer_cast<Alias>(left)->expr_, std::static_pointer_cast<Alias>(right)->expr_);
+    case LogicalExpressionType::Cast: {
+      auto left_cast = std::static_pointer_cast<Cast>(left);
+      auto right_cast = std::static_pointer_cast<Cast>(right);
+      return left_cast->type_->Equals(right_cast->type_) && isSameExpression(left_cast->expr_, right_cast->expr_);
+    }
+
+    // binary expressions
+    case LogicalExpressionType::And:
+    case LogicalExpressionType::Or:
+    case LogicalExpressionType::Eq:
+    case LogicalExpressionType::Neq:
+    case LogicalExpressionType::Gt:
+    case LogicalExpressionType::GtEq:
+    case LogicalExpressionType::Lt:
+    case LogicalExpressionType::LtEq:
+    case LogicalExpressionType::Add:
+    case LogicalExpressionType::Subtract:
+    case LogicalExpressionType::Multiply:
+    case LogicalExpressionType::Divide:
+    case LogicalExpressionType::Modulus: {
+      auto left_binary = std::static_pointer_cast<BinaryExpression>(left);
+      auto right_binary = std::static_pointer_cast<BinaryExpression>(right);
+      return isSameExpression(left_binary->left_, right_binary->left_) &&
+             isSameExpression(left_binary->right_, right_binary->right_);
+    }
+
+    // aggregation expressions
+    case LogicalExpressionType::Count: {
+      if (std::static_pointer_cast<Count>(left)->distinct_ != std::static_pointer_cast<Count>(right)->distinct_) {
+        return false;
+      }
+      return isSameExpression(
+          std::static_pointer_cast<Count>(left)->expr_, std::static_pointer_cast<Count>(right)->expr_);
+    }
+    case LogicalExpressionType::ApproxPercentile: {
+      auto left_percentile = std::static_pointer_cast<ApproxPercentile>(left);
+      auto right_percentile = std::static_pointer_cast<ApproxPercentile>(right);
+      return left_percentile->percentile_ == right_percentile->percentile_ &&
+             isSameExpression(left_percentile->expr_, right_percentile->expr_);
+    }
+    case LogicalExpressionType::Sum:
+    case LogicalExpressionType::Avg:
+    case LogicalExpressionType::Max:
+    case LogicalExpressionType::Min:
+    case LogicalExpressionType::ApproxCountDistinct:
+      return isSameExpression(
+          std::static_pointer_cast<AggregateExpression>(left)->expr_,
+          std::static_pointer_cast<AggregateExpression>(right)->expr_);
+
+    default: return false;
   }
 }
 
@@ -132,7 +323,9 @@ absl::Status SqlPlanner::getColumnFromExpr(
     case LogicalExpressionType::Avg:
     case LogicalExpressionType::Max:
     case LogicalExpressionType::Min:
-    case LogicalExpressionType::Count: {
+    case LogicalExpressionType::Count:
+    case LogicalExpressionType::ApproxCountDistinct:
+    case LogicalExpressionType::ApproxPercentile: {
       auto aggr_expr = std::static_pointer_cast<AggregateExpression>(expr);
       CHECK_OK_OR_RETURN(getColumnFromExpr(aggr_expr->expr_, accumulator));
       break;
@@ -228,7 +421,22 @@ absl::StatusOr<std::shared_ptr<toyquery::logicalplan::LogicalExpression>> SqlPla
         }
         case SqlFunctionType::Count: {
           ASSIGN_OR_RETURN(auto count_input, createLogicalExpression(func_expr->args_[0], input));
-          return std::make_shared<Count>(count_input);
+          return std::make_shared<Count>(count_input, func_expr->distinct_);
+        }
+        case SqlFunctionType::ApproxCountDistinct: {
+          ASSIGN_OR_RETURN(auto approx_input, createLogicalExpression(func_expr->args_[0], input));
+          return std::make_shared<ApproxCountDistinct>(approx_input);
+        }
+        case SqlFunctionType::ApproxPercentile: {
+          if (func_expr->args_.size() != 2 || func_expr->args_[1]->GetType() != SqlExpressionType::SqlDouble) {
+            return absl::InvalidArgumentError("APPROX_PERCENTILE expects an expression and a percentile in [0, 1]");
+          }
+          auto percentile = std::static_pointer_cast<SqlDouble>(func_expr->args_[1])->value_;
+          if (percentile < 0 || percentile > 1) {
+            return absl::InvalidArgumentError("APPROX_PERCENTILE expects an expression and a percentile in [0, 1]");
+          }
+          ASSIGN_OR_RETURN(auto approx_input, createLogicalExpression(func_expr->args_[0], input));
+          return std::make_shared<ApproxPercentile>(approx_input, percentile);
         }
         default: return absl::InvalidArgumentError("invalid function id");
       }
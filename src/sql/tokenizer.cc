@@ -82,7 +82,7 @@ absl::StatusOr<Token> Tokenizer::number() {
 }
 
 absl::StatusOr<Token> Tokenizer::identifier() {
-  while (isalnum(peek())) { advance(); }
+  while (isalnum(peek()) || peek() == '_') { advance(); }
 
   absl::string_view text = source_.substr(start_, current_ - start_);
   auto type = TokenType::LITERAL_IDENTIFIER;
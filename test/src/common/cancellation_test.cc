@@ -0,0 +1,43 @@
+#include "common/cancellation.h"
+
+#include <gtest/gtest.h>
+
+namespace toyquery {
+
+TEST(CancellationTokenTest, OkUntilCancelled) {
+  CancellationToken token;
+  EXPECT_TRUE(token.Check().ok());
+
+  token.Cancel();
+  EXPECT_TRUE(absl::IsCancelled(token.Check()));
+}
+
+TEST(CancellationTokenTest, DeadlineExceededOncePassed) {
+  CancellationToken token;
+  token.SetTimeout(std::chrono::hours(1));
+  EXPECT_TRUE(token.Check().ok());
+
+  token.SetDeadline(CancellationToken::Clock::now() - std::chrono::seconds(1));
+  EXPECT_TRUE(absl::IsDeadlineExceeded(token.Check()));
+}
+
+TEST(CancellationTokenTest, LinkedTokenStopsWithItsParent) {
+  auto parent = std::make_shared<CancellationToken>();
+  CancellationToken first(parent), second(parent);
+
+  // the deadline of a token doesn't apply to its parent nor to the other tokens linked to it.
+  first.SetDeadline(CancellationToken::Clock::now() - std::chrono::seconds(1));
+  EXPECT_TRUE(absl::IsDeadlineExceeded(first.Check()));
+  EXPECT_TRUE(parent->Check().ok());
+  EXPECT_TRUE(second.Check().ok());
+
+  parent->Cancel();
+  EXPECT_TRUE(absl::IsCancelled(second.Check()));
+}
+
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
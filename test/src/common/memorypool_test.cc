@@ -0,0 +1,68 @@
+#include "common/memorypool.h"
+
+#include <gtest/gtest.h>
+
+namespace toyquery {
+
+TEST(TrackingMemoryPoolTest, TracksAllocationsAndPeak) {
+  TrackingMemoryPool pool("query");
+  uint8_t* first;
+  uint8_t* second;
+  ASSERT_TRUE(pool.Allocate(1024, &first).ok());
+  ASSERT_TRUE(pool.Allocate(512, &second).ok());
+  EXPECT_EQ(pool.bytes_allocated(), 1536);
+
+  pool.Free(first, 1024);
+  EXPECT_EQ(pool.bytes_allocated(), 512);
+  EXPECT_EQ(pool.max_memory(), 1536);
+  EXPECT_EQ(pool.num_allocations(), 2);
+
+  pool.Free(second, 512);
+  EXPECT_EQ(pool.bytes_allocated(), 0);
+}
+
+TEST(TrackingMemoryPoolTest, AllocationOverTheLimitFails) {
+  TrackingMemoryPool pool("query", 1000);
+  uint8_t* buffer;
+  ASSERT_TRUE(pool.Allocate(600, &buffer).ok());
+
+  uint8_t* other;
+  EXPECT_TRUE(pool.Allocate(600, &other).IsOutOfMemory());
+  EXPECT_TRUE(pool.Reallocate(600, 1200, &buffer).IsOutOfMemory());
+  EXPECT_EQ(pool.bytes_allocated(), 600);
+  EXPECT_EQ(pool.Available(), 400);
+
+  pool.Free(buffer, 600);
+}
+
+TEST(TrackingMemoryPoolTest, ChildrenAreChargedToTheirParent) {
+  TrackingMemoryPool pool("query", 1000);
+  auto scan = pool.CreateChild("Scan");
+  auto sort = pool.CreateChild("Sort");
+
+  uint8_t* scan_buffer;
+  uint8_t* sort_buffer;
+  ASSERT_TRUE(scan->Allocate(700, &scan_buffer).ok());
+  EXPECT_EQ(sort->Available(), 300);
+  EXPECT_TRUE(sort->Allocate(400, &sort_buffer).IsOutOfMemory());
+  ASSERT_TRUE(sort->Allocate(300, &sort_buffer).ok());
+  EXPECT_EQ(pool.bytes_allocated(), 1000);
+
+  auto usage = pool.Attribution();
+  ASSERT_EQ(usage.size(), 2);
+  EXPECT_EQ(usage[0].name, "Scan");
+  EXPECT_EQ(usage[0].bytes_allocated, 700);
+  EXPECT_EQ(usage[1].name, "Sort");
+  EXPECT_EQ(usage[1].peak_bytes_allocated, 300);
+
+  scan->Free(scan_buffer, 700);
+  sort->Free(sort_buffer, 300);
+  EXPECT_EQ(pool.bytes_allocated(), 0);
+}
+
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,50 @@
+#include "common/threadpool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace toyquery {
+
+TEST(ThreadPoolTest, RunsAllSubmittedTasks) {
+  std::atomic<int> counter{ 0 };
+  {
+    ThreadPool thread_pool(4);
+    for (int i = 0; i < 1000; i++) {
+      thread_pool.Submit([&counter]() { counter++; });
+    }
+  }  // the destructor runs the pending tasks.
+
+  EXPECT_EQ(counter, 1000);
+}
+
+TEST(ThreadPoolTest, TasksSubmittedFromTasksRun) {
+  std::atomic<int> counter{ 0 };
+  std::mutex mutex;
+  std::condition_variable done;
+  ThreadPool thread_pool(2);
+
+  // each task reschedules itself until the counter reaches 100.
+  std::function<void()> task = [&]() {
+    if (++counter < 100) {
+      thread_pool.Submit(task);
+    } else {
+      std::lock_guard<std::mutex> lock(mutex);
+      done.notify_all();
+    }
+  };
+  thread_pool.Submit(task);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&counter]() { return counter >= 100; });
+  EXPECT_EQ(counter, 100);
+}
+
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,115 @@
+#include "dataframe/cache.h"
+
+#include <gtest/gtest.h>
+
+#include "dataframe/dataframe.h"
+#include "test_utils/test_utils.h"
+
+namespace toyquery {
+namespace dataframe {
+
+using ::toyquery::datasource::InMemoryDataSource;
+using ::toyquery::datasource::ScanContext;
+using ::toyquery::testutils::CompareArrowTableAndPrintDebugInfo;
+using ::toyquery::testutils::GetTestData;
+using ::toyquery::testutils::ID_COLUMN;
+using ::toyquery::testutils::NAME_COLUMN;
+
+namespace {
+
+std::shared_ptr<CachedResult> MakeResult(int64_t bytes) {
+  auto result = std::make_shared<CachedResult>();
+  result->bytes = bytes;
+  return result;
+}
+
+std::shared_ptr<arrow::Table> ScanAll(std::shared_ptr<DataFrame> df, std::vector<std::string> projection) {
+  auto scan = std::static_pointer_cast<toyquery::logicalplan::Scan>(df->GetLogicalPlan());
+  auto reader = *scan->source_->Scan(projection);
+  return *reader->ToTable();
+}
+
+}  // namespace
+
+TEST(BatchCacheTest, EvictsLeastRecentlyUsedResultsBeyondBudget) {
+  BatchCache cache(100);
+  cache.Put(0, MakeResult(40));
+  cache.Put(1, MakeResult(40));
+  EXPECT_NE(cache.Get(0), nullptr);
+
+  // 1 is the least recently used result.
+  cache.Put(2, MakeResult(40));
+  EXPECT_NE(cache.Get(0), nullptr);
+  EXPECT_EQ(cache.Get(1), nullptr);
+  EXPECT_NE(cache.Get(2), nullptr);
+  EXPECT_EQ(cache.Bytes(), 80);
+
+  // a result larger than the budget isn't cached.
+  cache.Put(3, MakeResult(200));
+  EXPECT_EQ(cache.Get(3), nullptr);
+  EXPECT_EQ(cache.Size(), 2);
+
+  cache.SetBudget(50);
+  EXPECT_EQ(cache.Size(), 1);
+  EXPECT_NE(cache.Get(2), nullptr);
+}
+
+TEST(BatchCacheTest, CachedDataFrameIsComputedOnce) {
+  auto cache = std::make_shared<BatchCache>(1 << 20);
+  auto source = std::make_shared<InMemoryDataSource>(GetTestData());
+  std::shared_ptr<DataFrame> df = std::make_shared<DataFrameImpl>(
+      std::make_shared<toyquery::logicalplan::Scan>("test", source, std::vector<std::string>{}));
+
+  auto cached = df->Cache(false, cache);
+  EXPECT_EQ(cache->Size(), 0);
+
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), ScanAll(cached, {})));
+  EXPECT_EQ(cache->Size(), 1);
+  auto bytes = cache->Bytes();
+  EXPECT_GT(bytes, 0);
+
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), ScanAll(cached, {})));
+  EXPECT_EQ(cache->Bytes(), bytes);
+}
+
+TEST(BatchCacheTest, CompressedResultIsProjected) {
+  auto cache = std::make_shared<BatchCache>(1 << 20);
+  auto source = std::make_shared<InMemoryDataSource>(GetTestData());
+  std::shared_ptr<DataFrame> df = std::make_shared<DataFrameImpl>(
+      std::make_shared<toyquery::logicalplan::Scan>("test", source, std::vector<std::string>{}));
+
+  auto cached = df->Cache(true, cache);
+
+  auto expected_table = *GetTestData()->SelectColumns({ NAME_COLUMN, ID_COLUMN });
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, ScanAll(cached, { "name", "id" })));
+}
+
+TEST(BatchCacheTest, CachedDataFrameIsComputedOnBehalfOfTheScanningQuery) {
+  auto cache = std::make_shared<BatchCache>(1 << 20);
+  auto source = std::make_shared<InMemoryDataSource>(GetTestData());
+  std::shared_ptr<DataFrame> df = std::make_shared<DataFrameImpl>(
+      std::make_shared<toyquery::logicalplan::Scan>("test", source, std::vector<std::string>{}));
+  auto cached = df->Cache(false, cache);
+  auto cached_source = std::static_pointer_cast<toyquery::logicalplan::Scan>(cached->GetLogicalPlan())->source_;
+
+  // the plan is cancelled with the query, nothing is cached.
+  ScanContext cancelled_context;
+  cancelled_context.token = std::make_shared<CancellationToken>();
+  cancelled_context.token->Cancel();
+  auto cancelled_or = cached_source->Scan({}, {}, cancelled_context);
+  EXPECT_EQ(cancelled_or.status().code(), absl::StatusCode::kCancelled);
+  EXPECT_EQ(cache->Size(), 0);
+
+  // the operators of the plan are attributed to the memory pool of the query.
+  ScanContext context;
+  context.token = std::make_shared<CancellationToken>();
+  context.pool = std::make_shared<TrackingMemoryPool>("query");
+  auto reader_or = cached_source->Scan({}, {}, context);
+  ASSERT_TRUE(reader_or.ok());
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), *(*reader_or)->ToTable()));
+  EXPECT_FALSE(context.pool->Attribution().empty());
+  EXPECT_EQ(cache->Size(), 1);
+}
+
+}  // namespace dataframe
+}  // namespace toyquery
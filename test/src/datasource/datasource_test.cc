@@ -3,9 +3,21 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "arrow/io/api.h"
+#include "arrow/ipc/api.h"
+#include "arrow/util/compression.h"
+#include "parquet/arrow/writer.h"
 #include "test_utils/test_utils.h"
 
 namespace toyquery {
@@ -14,6 +26,8 @@ namespace datasource {
 using ::toyquery::testutils::CompareArrowTableAndPrintDebugInfo;
 using ::toyquery::testutils::GetTestData;
 using ::toyquery::testutils::GetTestSchema;
+using ::toyquery::testutils::ID_COLUMN;
+using ::toyquery::testutils::NAME_COLUMN;
 
 class CsvDataSourceTest : public ::testing::Test {
  protected:
@@ -31,6 +45,33 @@ TEST_F(CsvDataSourceTest, ReadsDataWithCorrectSchema) {
   EXPECT_TRUE(expected_schema->Equals(*schema_or));
 }
 
+TEST_F(CsvDataSourceTest, InfersSchemaFromSample) {
+  CsvReadOptions options;
+  options.schema_sample_size = 32;
+  CsvDataSource data_source("/tmp/test.csv", 10, nullptr, options);
+
+  auto schema_or = data_source.Schema();
+
+  EXPECT_TRUE(schema_or.ok());
+  EXPECT_TRUE(GetTestSchema()->Equals(*schema_or));
+}
+
+TEST_F(CsvDataSourceTest, ScanAppliesProvidedSchema) {
+  auto schema = arrow::schema({ arrow::field("id", arrow::utf8()),
+                                arrow::field("name", arrow::utf8()),
+                                arrow::field("age", arrow::float64()),
+                                arrow::field("frequency", arrow::float64()) });
+  CsvDataSource data_source("/tmp/test.csv", 10, schema);
+
+  auto reader_or = data_source.Scan({});
+  ASSERT_TRUE(reader_or.ok());
+
+  std::shared_ptr<arrow::RecordBatch> batch;
+  ASSERT_TRUE((*reader_or)->ReadNext(&batch).ok());
+  ASSERT_NE(batch, nullptr);
+  EXPECT_TRUE(schema->Equals(batch->schema()));
+}
+
 TEST_F(CsvDataSourceTest, ReadsDataWithCorrectBatches) {
   auto expected_table = GetTestData();
 
@@ -40,6 +81,442 @@ TEST_F(CsvDataSourceTest, ReadsDataWithCorrectBatches) {
   EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, *table_or));
 }
 
+TEST_F(CsvDataSourceTest, ScanReturnsBatchesOfBatchSize) {
+  CsvDataSource data_source("/tmp/test.csv", 3);
+
+  auto reader_or = data_source.Scan({});
+  ASSERT_TRUE(reader_or.ok());
+
+  std::vector<int64_t> batch_sizes;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while ((*reader_or)->ReadNext(&batch).ok() && batch != nullptr) {
+    batch_sizes.push_back(batch->num_rows());
+    batches.push_back(batch);
+  }
+  EXPECT_EQ(batch_sizes, std::vector<int64_t>({ 3, 3, 1 }));
+
+  auto table_or = arrow::Table::FromRecordBatches(batches);
+  EXPECT_TRUE(table_or.ok());
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), *table_or));
+}
+
+TEST_F(CsvDataSourceTest, ParallelScanReturnsRowsInFileOrder) {
+  CsvReadOptions options;
+  options.num_threads = 4;
+  options.block_size = 64;
+  CsvDataSource data_source("/tmp/test.csv", 10, nullptr, options);
+
+  auto reader_or = data_source.Scan({});
+  ASSERT_TRUE(reader_or.ok());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while ((*reader_or)->ReadNext(&batch).ok() && batch != nullptr) { batches.push_back(batch); }
+
+  auto table_or = arrow::Table::FromRecordBatches(batches);
+  EXPECT_TRUE(table_or.ok());
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), *table_or));
+}
+
+TEST_F(CsvDataSourceTest, ParallelScanKeepsNewlinesWithinQuotedValues) {
+  const std::string path = "/tmp/quoted_newlines.csv";
+  {
+    std::ofstream out(path);
+    out << "id,note\n";
+    for (int i = 0; i < 20; i++) { out << i << ",\"first line\nsecond, \"\"quoted\"\" line\"\n"; }
+  }
+
+  CsvReadOptions options;
+  options.num_threads = 4;
+  options.block_size = 16;
+  CsvDataSource data_source(path, 10, nullptr, options);
+
+  auto reader_or = data_source.Scan({});
+  ASSERT_TRUE(reader_or.ok());
+
+  int64_t num_rows = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while (true) {
+    ASSERT_TRUE((*reader_or)->ReadNext(&batch).ok());
+    if (batch == nullptr) { break; }
+    auto notes = std::static_pointer_cast<arrow::StringArray>(batch->GetColumnByName("note"));
+    for (int64_t row = 0; row < batch->num_rows(); row++) {
+      EXPECT_EQ(notes->GetView(row), "first line\nsecond, \"quoted\" line");
+    }
+    num_rows += batch->num_rows();
+  }
+  EXPECT_EQ(num_rows, 20);
+
+  std::filesystem::remove(path);
+}
+
+TEST_F(CsvDataSourceTest, ScanDecompressesCompressedFiles) {
+  auto csv = *(*arrow::io::ReadableFile::Open("/tmp/test.csv"))->Read(1 << 20);
+
+  for (auto compression : { arrow::Compression::GZIP, arrow::Compression::ZSTD, arrow::Compression::LZ4_FRAME }) {
+    if (!arrow::util::Codec::IsAvailable(compression)) { continue; }
+
+    auto filename = "/tmp/test.csv." + arrow::util::Codec::GetCodecAsString(compression);
+    auto codec = *arrow::util::Codec::Create(compression);
+    auto output = *arrow::io::FileOutputStream::Open(filename);
+    auto compressed = *arrow::io::CompressedOutputStream::Make(codec.get(), output);
+    CHECK(compressed->Write(csv).ok());
+    CHECK(compressed->Close().ok());
+
+    CsvDataSource data_source(filename, 10);
+    auto schema_or = data_source.Schema();
+    ASSERT_TRUE(schema_or.ok()) << schema_or.status();
+    EXPECT_TRUE(GetTestSchema()->Equals(*schema_or));
+
+    auto reader_or = data_source.Scan({});
+    ASSERT_TRUE(reader_or.ok());
+    auto table_or = (*reader_or)->ToTable();
+    ASSERT_TRUE(table_or.ok());
+    EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), *table_or));
+  }
+}
+
+// the crc32 of the data, as stored in the footer of a gzip member.
+uint32_t Crc32(std::string_view data) {
+  uint32_t crc = 0xffffffff;
+  for (unsigned char byte : data) {
+    crc ^= byte;
+    for (int bit = 0; bit < 8; bit++) { crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1))); }
+  }
+  return ~crc;
+}
+
+// append the value as a little endian integer of the given number of bytes.
+void AppendLittleEndian(std::string& out, uint64_t value, int num_bytes) {
+  for (int i = 0; i < num_bytes; i++) { out.push_back(static_cast<char>((value >> (8 * i)) & 0xff)); }
+}
+
+// a bgzf block holding the data in a stored deflate block, so that no compression library is needed to write it.
+std::string BgzfBlock(std::string_view data) {
+  std::string deflated = { '\x01' };  // the final block, stored.
+  AppendLittleEndian(deflated, data.size(), 2);
+  AppendLittleEndian(deflated, ~data.size() & 0xffff, 2);
+  deflated.append(data);
+
+  // a gzip header with the BC extra subfield holding the size of the block minus one.
+  std::string block = {
+    '\x1f', '\x8b', '\x08', '\x04', '\0', '\0', '\0', '\0', '\0', '\xff', '\x06', '\0', 'B', 'C', '\x02', '\0'
+  };
+  AppendLittleEndian(block, 18 + deflated.size() + 8 - 1, 2);
+  block.append(deflated);
+  AppendLittleEndian(block, Crc32(data), 4);
+  AppendLittleEndian(block, data.size(), 4);
+  return block;
+}
+
+// the empty block ending a bgzf file.
+const std::string BGZF_EOF_BLOCK(
+    "\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0BC\x02\0\x1b\0\x03\0\0\0\0\0\0\0\0\0", 28);
+
+TEST_F(CsvDataSourceTest, ScanDecompressesBgzfBlocksInParallel) {
+  if (!arrow::util::Codec::IsAvailable(arrow::Compression::GZIP)) { GTEST_SKIP(); }
+  auto csv = (*(*arrow::io::ReadableFile::Open("/tmp/test.csv"))->Read(1 << 20))->ToString();
+
+  // blocks of 50 bytes, most lines spanning two of them, followed by the empty block ending the file.
+  std::string bgzf;
+  for (size_t offset = 0; offset < csv.size(); offset += 50) {
+    bgzf += BgzfBlock(std::string_view(csv).substr(offset, 50));
+  }
+  bgzf += BGZF_EOF_BLOCK;
+  std::ofstream("/tmp/test.bgzf.csv.gz", std::ios::binary) << bgzf;
+  std::ofstream("/tmp/test.truncated.bgzf.csv.gz", std::ios::binary) << bgzf.substr(0, bgzf.size() - 10);
+
+  CsvReadOptions options;
+  options.decompression_threads = 4;
+  CsvDataSource data_source("/tmp/test.bgzf.csv.gz", 10, nullptr, options);
+  auto schema_or = data_source.Schema();
+  ASSERT_TRUE(schema_or.ok()) << schema_or.status();
+  EXPECT_TRUE(GetTestSchema()->Equals(*schema_or));
+
+  auto reader_or = data_source.Scan({});
+  ASSERT_TRUE(reader_or.ok());
+  auto table_or = (*reader_or)->ToTable();
+  ASSERT_TRUE(table_or.ok());
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(GetTestData(), *table_or));
+
+  // the truncated file fails the scan rather than losing its last rows.
+  CsvDataSource truncated_source("/tmp/test.truncated.bgzf.csv.gz", 10, nullptr, options);
+  auto truncated_or = truncated_source.Scan({});
+  EXPECT_FALSE(truncated_or.ok() && (*truncated_or)->ToTable().ok());
+}
+
+class ParquetDataSourceTest : public ::testing::Test {
+ protected:
+  ParquetDataSourceTest() {
+    // three row groups of up to 3 rows.
+    auto output = *arrow::io::FileOutputStream::Open("/tmp/test.parquet");
+    auto status = parquet::arrow::WriteTable(*GetTestData(), arrow::default_memory_pool(), output, 3);
+    CHECK(status.ok()) << status.message();
+    CHECK(output->Close().ok());
+  }
+};
+
+TEST_F(ParquetDataSourceTest, ReadsSchemaFromFooter) {
+  ParquetDataSource data_source("/tmp/test.parquet", 10);
+
+  auto schema_or = data_source.Schema();
+
+  EXPECT_TRUE(schema_or.ok());
+  EXPECT_TRUE(GetTestSchema()->Equals(*schema_or));
+}
+
+TEST_F(ParquetDataSourceTest, ScanReadsProjectedColumnsOfAllRowGroups) {
+  ParquetReadOptions options;
+  options.num_threads = 2;
+  ParquetDataSource data_source("/tmp/test.parquet", 10, options);
+
+  auto reader_or = data_source.Scan({ "name", "id" });
+  ASSERT_TRUE(reader_or.ok());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while ((*reader_or)->ReadNext(&batch).ok() && batch != nullptr) { batches.push_back(batch); }
+
+  auto table_or = arrow::Table::FromRecordBatches(batches);
+  EXPECT_TRUE(table_or.ok());
+  auto expected_table = *GetTestData()->SelectColumns({ NAME_COLUMN, ID_COLUMN });
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, *table_or));
+}
+
+TEST_F(ParquetDataSourceTest, ScanSkipsRowGroupsOutsideTheFilter) {
+  ParquetReadOptions options;
+  options.late_materialization = false;
+  ParquetDataSource data_source("/tmp/test.parquet", 10, options);
+
+  // the row groups hold the ids [1, 3], [4, 6] and [7, 7], the first one can't satisfy the filter.
+  std::vector<ColumnPredicate> filter = { { "id", ColumnPredicate::Op::Gt, std::make_shared<arrow::Int64Scalar>(5) } };
+  auto reader_or = data_source.Scan({ "id" }, filter);
+  ASSERT_TRUE(reader_or.ok());
+
+  int64_t num_rows = 0;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while ((*reader_or)->ReadNext(&batch).ok() && batch != nullptr) { num_rows += batch->num_rows(); }
+  EXPECT_EQ(num_rows, 4);
+}
+
+TEST_F(ParquetDataSourceTest, LateMaterializedScanReturnsRowsSatisfyingTheFilter) {
+  ParquetDataSource data_source("/tmp/test.parquet", 10);
+
+  // the filter column isn't projected, it is decoded to select the rows only.
+  std::vector<ColumnPredicate> filter = { { "id", ColumnPredicate::Op::Gt, std::make_shared<arrow::Int64Scalar>(5) } };
+  auto reader_or = data_source.Scan({ "name" }, filter);
+  ASSERT_TRUE(reader_or.ok());
+  auto table_or = (*reader_or)->ToTable();
+  ASSERT_TRUE(table_or.ok());
+
+  auto expected_table = GetTestData()->SelectColumns({ NAME_COLUMN }).ValueOrDie()->Slice(5);
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, *table_or));
+}
+
+TEST_F(ParquetDataSourceTest, LateMaterializedScanDecodesTheOtherColumnsInSlices) {
+  ParquetReadOptions options;
+  options.slice_size = 2;
+  ParquetDataSource data_source("/tmp/test.parquet", 10, options);
+
+  // the row groups hold the ids [1, 3], [4, 6] and [7, 7], the slice of the ids [4, 5] has a single selected row.
+  std::vector<ColumnPredicate> filter = { { "id", ColumnPredicate::Op::Neq, std::make_shared<arrow::Int64Scalar>(5) } };
+  auto reader_or = data_source.Scan({ "name", "id" }, filter);
+  ASSERT_TRUE(reader_or.ok());
+  auto table_or = (*reader_or)->ToTable();
+  ASSERT_TRUE(table_or.ok());
+
+  auto table = GetTestData()->SelectColumns({ NAME_COLUMN, ID_COLUMN }).ValueOrDie();
+  auto expected_table = arrow::ConcatenateTables({ table->Slice(0, 4), table->Slice(5) }).ValueOrDie();
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, *table_or));
+}
+
+class IpcDataSourceTest : public ::testing::Test {
+ protected:
+  IpcDataSourceTest() {
+    // two record batches of 4 and 3 rows.
+    auto output = *arrow::io::FileOutputStream::Open("/tmp/test.arrow");
+    auto writer = *arrow::ipc::MakeFileWriter(output, GetTestSchema());
+    arrow::TableBatchReader batches(*GetTestData());
+    batches.set_chunksize(4);
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (batches.ReadNext(&batch).ok() && batch != nullptr) { CHECK(writer->WriteRecordBatch(*batch).ok()); }
+    CHECK(writer->Close().ok());
+    CHECK(output->Close().ok());
+  }
+};
+
+TEST_F(IpcDataSourceTest, ScanReadsProjectedColumnsOfAllBatches) {
+  IpcDataSource data_source("/tmp/test.arrow");
+
+  auto schema_or = data_source.Schema();
+  EXPECT_TRUE(schema_or.ok());
+  EXPECT_TRUE(GetTestSchema()->Equals(*schema_or));
+
+  auto reader_or = data_source.Scan({ "name", "id" });
+  ASSERT_TRUE(reader_or.ok());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while ((*reader_or)->ReadNext(&batch).ok() && batch != nullptr) { batches.push_back(batch); }
+  EXPECT_EQ(batches.size(), 2);
+
+  auto table_or = arrow::Table::FromRecordBatches(batches);
+  EXPECT_TRUE(table_or.ok());
+  auto expected_table = *GetTestData()->SelectColumns({ NAME_COLUMN, ID_COLUMN });
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, *table_or));
+}
+
+class DatasetDataSourceTest : public ::testing::Test {
+ protected:
+  DatasetDataSourceTest() {
+    // two partitions holding a copy of the test csv file each, and a marker file which isn't part of the dataset.
+    std::filesystem::remove_all("/tmp/dataset");
+    for (const auto& partition : { "/tmp/dataset/date=1", "/tmp/dataset/date=2" }) {
+      std::filesystem::create_directories(partition);
+      std::filesystem::copy_file("/tmp/test.csv", std::string(partition) + "/part-0.csv");
+    }
+    std::ofstream("/tmp/dataset/_SUCCESS").close();
+  }
+
+  // count the rows returned by the reader.
+  int64_t CountRows(std::shared_ptr<arrow::RecordBatchReader> reader) {
+    int64_t num_rows = 0;
+    std::shared_ptr<arrow::RecordBatch> batch;
+    while (reader->ReadNext(&batch).ok() && batch != nullptr) { num_rows += batch->num_rows(); }
+    return num_rows;
+  }
+
+  // the paths of the files currently open in the process.
+  std::set<std::string> OpenFiles() {
+    std::set<std::string> paths;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it("/proc/self/fd", ec), end; !ec && it != end; it.increment(ec)) {
+      auto target = std::filesystem::read_symlink(it->path(), ec);
+      if (!ec) { paths.insert(target.string()); }
+      ec.clear();
+    }
+    return paths;
+  }
+};
+
+TEST_F(DatasetDataSourceTest, SchemaEndsWithThePartitionColumns) {
+  DatasetDataSource data_source("/tmp/dataset", 10);
+
+  auto schema_or = data_source.Schema();
+
+  ASSERT_TRUE(schema_or.ok());
+  auto expected_schema = *GetTestSchema()->AddField(GetTestSchema()->num_fields(), arrow::field("date", arrow::int64()));
+  EXPECT_TRUE(expected_schema->Equals(*schema_or));
+}
+
+TEST_F(DatasetDataSourceTest, ScanSkipsFilesOutsideTheFilter) {
+  DatasetDataSource data_source("/tmp/dataset/date=*", 10);
+
+  auto all_or = data_source.Scan({ "date" });
+  ASSERT_TRUE(all_or.ok());
+  EXPECT_EQ(CountRows(*all_or), 14);
+
+  std::vector<ColumnPredicate> filter = { { "date", ColumnPredicate::Op::Eq, std::make_shared<arrow::Int64Scalar>(2) } };
+  auto reader_or = data_source.Scan({ "name", "date" }, filter);
+  ASSERT_TRUE(reader_or.ok());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  while ((*reader_or)->ReadNext(&batch).ok() && batch != nullptr) { batches.push_back(batch); }
+
+  auto table_or = arrow::Table::FromRecordBatches(batches);
+  ASSERT_TRUE(table_or.ok());
+  EXPECT_EQ((*table_or)->num_rows(), 7);
+  arrow::ChunkedArray expected_dates(*arrow::MakeArrayFromScalar(arrow::Int64Scalar(2), 7));
+  EXPECT_TRUE((*table_or)->GetColumnByName("date")->Equals(expected_dates));
+}
+
+TEST_F(DatasetDataSourceTest, ScanReadsFilesAFewBatchesAtATime) {
+  // a row per batch, the files are read by several tasks each.
+  DatasetDataSource ordered_source("/tmp/dataset", 1, DatasetOptions{ 2, true });
+  auto ordered_or = ordered_source.Scan({ "id", "date" });
+  ASSERT_TRUE(ordered_or.ok());
+  auto table_or = (*ordered_or)->ToTable();
+  ASSERT_TRUE(table_or.ok());
+
+  // the batches of the first partition come first, in the order of the file.
+  auto ids = GetTestData()->column(ID_COLUMN)->chunk(0);
+  auto expected_ids = *arrow::Concatenate({ ids, ids });
+  EXPECT_TRUE((*table_or)->GetColumnByName("id")->Equals(arrow::ChunkedArray(expected_ids)));
+  auto expected_dates = *arrow::Concatenate(
+      { *arrow::MakeArrayFromScalar(arrow::Int64Scalar(1), 7), *arrow::MakeArrayFromScalar(arrow::Int64Scalar(2), 7) });
+  EXPECT_TRUE((*table_or)->GetColumnByName("date")->Equals(arrow::ChunkedArray(expected_dates)));
+
+  DatasetDataSource unordered_source("/tmp/dataset", 1, DatasetOptions{ 2, false });
+  auto unordered_or = unordered_source.Scan({ "id", "date" });
+  ASSERT_TRUE(unordered_or.ok());
+  EXPECT_EQ(CountRows(*unordered_or), 14);
+}
+
+TEST_F(DatasetDataSourceTest, OrderedScanKeepsSeveralFilesOpen) {
+  // a row per batch, the first file stays open until its last batches are read.
+  DatasetDataSource data_source("/tmp/dataset", 1, DatasetOptions{ 2, true });
+  auto reader_or = data_source.Scan({ "id", "date" });
+  ASSERT_TRUE(reader_or.ok());
+  std::shared_ptr<arrow::RecordBatch> batch;
+  ASSERT_TRUE((*reader_or)->ReadNext(&batch).ok());
+  ASSERT_NE(batch, nullptr);
+
+  // the second file is opened while the batches of the first one are still being returned.
+  auto first_file = std::filesystem::canonical("/tmp/dataset/date=1/part-0.csv").string();
+  auto second_file = std::filesystem::canonical("/tmp/dataset/date=2/part-0.csv").string();
+  bool both_open = false;
+  for (int attempt = 0; attempt < 500 && !both_open; attempt++) {
+    auto open_files = OpenFiles();
+    both_open = open_files.count(first_file) > 0 && open_files.count(second_file) > 0;
+    if (!both_open) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
+  }
+  EXPECT_TRUE(both_open);
+
+  // the batches are still returned in the order of the files.
+  std::vector<int64_t> dates;
+  while (batch != nullptr) {
+    auto date_column = std::static_pointer_cast<arrow::Int64Array>(batch->GetColumnByName("date"));
+    for (int64_t row = 0; row < date_column->length(); row++) { dates.push_back(date_column->Value(row)); }
+    ASSERT_TRUE((*reader_or)->ReadNext(&batch).ok());
+  }
+  std::vector<int64_t> expected_dates(7, 1);
+  expected_dates.insert(expected_dates.end(), 7, 2);
+  EXPECT_EQ(dates, expected_dates);
+}
+
+TEST(InMemoryDataSourceTest, ScanReturnsProjectedChunksOfAllTables) {
+  auto table = GetTestData();
+  InMemoryDataSource data_source(table->schema(), { table, table });
+
+  auto reader_or = data_source.Scan({ "name", "id" });
+  ASSERT_TRUE(reader_or.ok());
+  auto table_or = (*reader_or)->ToTable();
+  ASSERT_TRUE(table_or.ok());
+
+  auto projected_table = *table->SelectColumns({ NAME_COLUMN, ID_COLUMN });
+  auto expected_table = *arrow::ConcatenateTables({ projected_table, projected_table });
+  EXPECT_TRUE(CompareArrowTableAndPrintDebugInfo(expected_table, *table_or));
+}
+
+TEST(ColumnPredicateTest, MayMatchComparesTheValueWithTheBounds) {
+  auto min = std::make_shared<arrow::Int64Scalar>(4), max = std::make_shared<arrow::Int64Scalar>(6);
+  auto predicate = [](ColumnPredicate::Op op, double value) {
+    return ColumnPredicate{ "id", op, std::make_shared<arrow::DoubleScalar>(value) };
+  };
+
+  EXPECT_TRUE(predicate(ColumnPredicate::Op::Eq, 5).MayMatch(min, max));
+  EXPECT_FALSE(predicate(ColumnPredicate::Op::Eq, 7).MayMatch(min, max));
+  EXPECT_FALSE(predicate(ColumnPredicate::Op::Lt, 4).MayMatch(min, max));
+  EXPECT_TRUE(predicate(ColumnPredicate::Op::LtEq, 4).MayMatch(min, max));
+  EXPECT_FALSE(predicate(ColumnPredicate::Op::Gt, 6).MayMatch(min, max));
+  EXPECT_TRUE(predicate(ColumnPredicate::Op::GtEq, 6).MayMatch(min, max));
+  EXPECT_TRUE(predicate(ColumnPredicate::Op::Neq, 4).MayMatch(min, max));
+  EXPECT_FALSE(predicate(ColumnPredicate::Op::Neq, 4).MayMatch(min, min));
+  EXPECT_TRUE(predicate(ColumnPredicate::Op::Gt, 100).MayMatch(min, nullptr));
+}
+
 }  // namespace datasource
 }  // namespace toyquery
 
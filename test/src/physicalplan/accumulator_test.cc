@@ -58,6 +58,93 @@ TEST(SumAccumulatorTest, WorksCorrectly) {
   EXPECT_EQ(GetAgeSum(), std::static_pointer_cast<arrow::Int64Scalar>(*sum_value_or)->value);
 }
 
+TEST(CountAccumulatorTest, MergesPartialCounts) {
+  auto count_accumulator = std::make_unique<CountAccumulator>();
+  auto partial_count_accumulator = std::make_unique<CountAccumulator>();
+  auto age_column = GetAgeColumn();
+
+  for (int row_idx = 0; row_idx < age_column->length(); row_idx++) {
+    EXPECT_TRUE(count_accumulator->Accumulate(age_column->GetScalar(row_idx).ValueOrDie()).ok());
+    EXPECT_TRUE(partial_count_accumulator->Accumulate(age_column->GetScalar(row_idx).ValueOrDie()).ok());
+  }
+  EXPECT_TRUE(count_accumulator->Accumulate(std::make_shared<arrow::Int64Scalar>()).ok());  // nulls aren't counted.
+  EXPECT_TRUE(count_accumulator->Merge(*partial_count_accumulator).ok());
+
+  auto count_value_or = count_accumulator->FinalValue();
+  EXPECT_TRUE(count_value_or.ok());
+  EXPECT_EQ(2 * age_column->length(), std::static_pointer_cast<arrow::Int64Scalar>(*count_value_or)->value);
+}
+
+TEST(CountDistinctAccumulatorTest, CountsDistinctIntegersAcrossPartialAggregations) {
+  auto count_distinct_accumulator = std::make_unique<CountDistinctAccumulator>();
+  auto partial_count_distinct_accumulator = std::make_unique<CountDistinctAccumulator>();
+
+  for (int64_t value = -100; value < 100; value++) {
+    EXPECT_TRUE(count_distinct_accumulator->Accumulate(std::make_shared<arrow::Int64Scalar>(value % 50)).ok());
+    EXPECT_TRUE(partial_count_distinct_accumulator->Accumulate(std::make_shared<arrow::Int64Scalar>(value)).ok());
+  }
+  EXPECT_TRUE(count_distinct_accumulator->Accumulate(std::make_shared<arrow::Int64Scalar>()).ok());
+  EXPECT_TRUE(count_distinct_accumulator->Merge(*partial_count_distinct_accumulator).ok());
+
+  auto count_value_or = count_distinct_accumulator->FinalValue();
+  EXPECT_TRUE(count_value_or.ok());
+  EXPECT_EQ(200, std::static_pointer_cast<arrow::Int64Scalar>(*count_value_or)->value);
+}
+
+TEST(CountDistinctAccumulatorTest, CountsDistinctStrings) {
+  auto count_distinct_accumulator = std::make_unique<CountDistinctAccumulator>();
+  auto partial_count_distinct_accumulator = std::make_unique<CountDistinctAccumulator>();
+
+  for (auto value : { "a", "b", "a", "c" }) {
+    EXPECT_TRUE(count_distinct_accumulator->Accumulate(std::make_shared<arrow::StringScalar>(value)).ok());
+  }
+  for (auto value : { "c", "d" }) {
+    EXPECT_TRUE(partial_count_distinct_accumulator->Accumulate(std::make_shared<arrow::StringScalar>(value)).ok());
+  }
+  EXPECT_TRUE(count_distinct_accumulator->Merge(*partial_count_distinct_accumulator).ok());
+  EXPECT_FALSE(count_distinct_accumulator->Merge(*std::make_unique<CountAccumulator>()).ok());
+
+  auto count_value_or = count_distinct_accumulator->FinalValue();
+  EXPECT_TRUE(count_value_or.ok());
+  EXPECT_EQ(4, std::static_pointer_cast<arrow::Int64Scalar>(*count_value_or)->value);
+}
+
+TEST(ApproxCountDistinctAccumulatorTest, EstimatesAcrossPartialAggregations) {
+  auto approx_accumulator = std::make_unique<ApproxCountDistinctAccumulator>();
+  auto partial_approx_accumulator = std::make_unique<ApproxCountDistinctAccumulator>();
+  auto age_column = GetAgeColumn();
+
+  for (int row_idx = 0; row_idx < age_column->length(); row_idx++) {
+    EXPECT_TRUE(approx_accumulator->Accumulate(age_column->GetScalar(row_idx).ValueOrDie()).ok());
+    EXPECT_TRUE(partial_approx_accumulator->Accumulate(age_column->GetScalar(row_idx).ValueOrDie()).ok());
+  }
+  EXPECT_TRUE(approx_accumulator->Merge(*partial_approx_accumulator).ok());
+
+  auto count_value_or = approx_accumulator->FinalValue();
+  EXPECT_TRUE(count_value_or.ok());
+  EXPECT_EQ(age_column->length(), std::static_pointer_cast<arrow::Int64Scalar>(*count_value_or)->value);
+}
+
+TEST(ApproxPercentileAccumulatorTest, EstimatesMedian) {
+  auto approx_accumulator = std::make_unique<ApproxPercentileAccumulator>(0.5);
+  auto empty_accumulator = std::make_unique<ApproxPercentileAccumulator>(0.5);
+  auto age_column = GetAgeColumn();
+
+  for (int row_idx = 0; row_idx < age_column->length(); row_idx++) {
+    EXPECT_TRUE(approx_accumulator->Accumulate(age_column->GetScalar(row_idx).ValueOrDie()).ok());
+  }
+  EXPECT_TRUE(approx_accumulator->Merge(*empty_accumulator).ok());
+
+  // few values, each one is its own centroid and the median is exact.
+  auto median_value_or = approx_accumulator->FinalValue();
+  EXPECT_TRUE(median_value_or.ok());
+  EXPECT_EQ(44, std::static_pointer_cast<arrow::DoubleScalar>(*median_value_or)->value);
+
+  auto empty_value_or = empty_accumulator->FinalValue();
+  EXPECT_TRUE(empty_value_or.ok());
+  EXPECT_FALSE((*empty_value_or)->is_valid);
+}
+
 // TODO: add more tests for other data types: float, string
 
 }  // namespace physicalplan
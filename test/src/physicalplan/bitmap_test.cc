@@ -0,0 +1,61 @@
+#include "physicalplan/bitmap.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+namespace toyquery {
+namespace physicalplan {
+
+TEST(RoaringBitmapTest, AddsValuesOnce) {
+  RoaringBitmap bitmap;
+
+  EXPECT_TRUE(bitmap.Add(3));
+  EXPECT_TRUE(bitmap.Add(1 << 20));
+  EXPECT_TRUE(bitmap.Add(std::numeric_limits<uint64_t>::max()));
+  EXPECT_FALSE(bitmap.Add(3));
+
+  EXPECT_EQ(bitmap.Cardinality(), 3);
+  EXPECT_TRUE(bitmap.Contains(1 << 20));
+  EXPECT_TRUE(bitmap.Contains(std::numeric_limits<uint64_t>::max()));
+  EXPECT_FALSE(bitmap.Contains(4));
+}
+
+TEST(RoaringBitmapTest, SwitchesToBitsetWhenDense) {
+  RoaringBitmap bitmap;
+  for (uint64_t value = 0; value < 10000; value += 2) { EXPECT_TRUE(bitmap.Add(value)); }
+
+  EXPECT_EQ(bitmap.Cardinality(), 5000);
+  EXPECT_TRUE(bitmap.Contains(9998));
+  EXPECT_FALSE(bitmap.Contains(9999));
+  EXPECT_FALSE(bitmap.Add(4000));
+
+  // a single 8KB bit set, instead of 10KB of sorted values.
+  EXPECT_EQ(bitmap.SizeInBytes(), 8192);
+}
+
+TEST(RoaringBitmapTest, MergesSparseAndDenseContainers) {
+  RoaringBitmap dense, sparse;
+  for (uint64_t value = 0; value < 5000; value++) { dense.Add(value); }
+  for (uint64_t value = 4990; value < 5010; value++) { sparse.Add(value); }
+  sparse.Add(1ULL << 40);
+
+  RoaringBitmap merged;
+  merged.Merge(sparse);
+  merged.Merge(dense);
+
+  EXPECT_EQ(merged.Cardinality(), 5011);
+  EXPECT_TRUE(merged.Contains(5009));
+  EXPECT_TRUE(merged.Contains(1ULL << 40));
+
+  dense.Merge(sparse);
+  EXPECT_EQ(dense.Cardinality(), 5011);
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
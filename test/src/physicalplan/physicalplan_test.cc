@@ -2,7 +2,11 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <set>
+#include <string>
 
 #include "absl/strings/string_view.h"
 #include "datasource/datasource.h"
@@ -13,6 +17,7 @@ namespace toyquery {
 namespace physicalplan {
 
 using ::toyquery::datasource::CsvDataSource;
+using ::toyquery::testutils::AGE_COLUMN;
 using ::toyquery::testutils::CompareArrowTableAndPrintDebugInfo;
 using ::toyquery::testutils::GetTestData;
 using ::toyquery::testutils::GetTestSchema;
@@ -117,6 +122,578 @@ TEST_F(PhysicalPlanTest, ScanReturnsCorrectData) {
 // Projection tests
 //
 
+//
+// HashJoin tests
+//
+
+std::shared_ptr<arrow::Schema> getJoinSchema() {
+  auto schema = GetTestSchema();
+  auto fields = schema->fields();
+  for (auto& field : schema->fields()) { fields.push_back(field); }
+  return std::make_shared<arrow::Schema>(fields);
+}
+
+int64_t countRows(std::shared_ptr<toyquery::physicalplan::PhysicalPlan> plan) {
+  int64_t num_rows = 0;
+  auto batch = plan->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    num_rows += (*batch)->num_rows();
+    batch = plan->Next();
+  }
+  EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+  return num_rows;
+}
+
+TEST_F(PhysicalPlanTest, HashJoinReturnsMatchingRows) {
+  auto build = std::make_shared<Selection>(
+      getScanPlan(),
+      std::make_shared<LessThanExpression>(std::make_shared<Column>(ID_COLUMN), std::make_shared<LiteralLong>(3)));
+  auto join = std::make_shared<HashJoin>(
+      getScanPlan(), build, getJoinSchema(), std::vector<int>{ ID_COLUMN }, std::vector<int>{ ID_COLUMN });
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 2);
+}
+
+TEST_F(PhysicalPlanTest, HashJoinPushesRuntimeFilterIntoProbeScan) {
+  auto probe = getScanPlan();
+  auto build = std::make_shared<Selection>(
+      getScanPlan(),
+      std::make_shared<LessThanExpression>(std::make_shared<Column>(ID_COLUMN), std::make_shared<LiteralLong>(3)));
+  auto join = std::make_shared<HashJoin>(
+      probe, build, getJoinSchema(), std::vector<int>{ ID_COLUMN }, std::vector<int>{ ID_COLUMN });
+  probe->AddRuntimeFilter(ID_COLUMN, join->RuntimeFilters()[0]);
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 2);
+
+  // the ids 3 to 7 are outside of the build side range and are dropped by the scan.
+  EXPECT_TRUE(join->RuntimeFilters()[0]->IsReady());
+  EXPECT_EQ(join->RuntimeFilters()[0]->RowsFiltered(), 5);
+}
+
+TEST_F(PhysicalPlanTest, HashJoinWithEmptyBuildSideReturnsNoRows) {
+  auto build = std::make_shared<Selection>(
+      getScanPlan(),
+      std::make_shared<LessThanExpression>(std::make_shared<Column>(ID_COLUMN), std::make_shared<LiteralLong>(0)));
+  auto join = std::make_shared<HashJoin>(
+      getScanPlan(), build, getJoinSchema(), std::vector<int>{ ID_COLUMN }, std::vector<int>{ ID_COLUMN });
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 0);
+}
+
+//
+// GraceHashJoin tests
+//
+
+TEST_F(PhysicalPlanTest, GraceHashJoinWithoutSpilling) {
+  auto join = std::make_shared<GraceHashJoin>(
+      getScanPlan(),
+      getScanPlan(),
+      getJoinSchema(),
+      std::vector<int>{ ID_COLUMN },
+      std::vector<int>{ ID_COLUMN },
+      std::numeric_limits<int64_t>::max(),
+      4,
+      "");
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 7);
+  EXPECT_EQ(join->Metrics().spilled_partitions, 0);
+  EXPECT_EQ(join->Metrics().spill_files, 0);
+}
+
+TEST_F(PhysicalPlanTest, GraceHashJoinSpillsPartitionsUnderMemoryPressure) {
+  auto join = std::make_shared<GraceHashJoin>(
+      getScanPlan(),
+      getScanPlan(),
+      getJoinSchema(),
+      std::vector<int>{ ID_COLUMN },
+      std::vector<int>{ ID_COLUMN },
+      1,
+      4,
+      "");
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 7);
+
+  auto metrics = join->Metrics();
+  EXPECT_GT(metrics.spilled_partitions, 0);
+  EXPECT_GT(metrics.spill_files, 0);
+  EXPECT_GE(metrics.spilled_rows, 14);
+  EXPECT_GE(metrics.max_recursion_depth, 1);
+}
+
+TEST_F(PhysicalPlanTest, GraceHashJoinRunsNestedJoinsInTheQuery) {
+  auto join = std::make_shared<GraceHashJoin>(
+      getScanPlan(),
+      getScanPlan(),
+      getJoinSchema(),
+      std::vector<int>{ ID_COLUMN },
+      std::vector<int>{ ID_COLUMN },
+      1,
+      4,
+      "");
+  auto pool = std::make_shared<TrackingMemoryPool>("query");
+  join->SetMemoryPool(pool);
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 7);
+
+  // the scans of the spilled partitions are attributed to the query like its own operators.
+  auto usage = pool->Attribution();
+  EXPECT_TRUE(std::any_of(usage.begin(), usage.end(), [](const OperatorMemoryUsage& operator_usage) {
+    return operator_usage.name.find("SpillScan") != std::string::npos;
+  }));
+}
+
+//
+// SortMergeJoin tests
+//
+
+TEST_F(PhysicalPlanTest, SortMergeJoinReturnsMatchingRows) {
+  auto right = std::make_shared<Selection>(
+      getScanPlan(),
+      std::make_shared<GreaterThanExpression>(std::make_shared<Column>(ID_COLUMN), std::make_shared<LiteralLong>(4)));
+  auto join = std::make_shared<SortMergeJoin>(
+      getScanPlan(), right, getJoinSchema(), std::vector<int>{ ID_COLUMN }, std::vector<int>{ ID_COLUMN });
+
+  EXPECT_TRUE(join->Prepare().ok());
+  EXPECT_EQ(countRows(join), 3);
+}
+
+TEST_F(PhysicalPlanTest, SortMergeJoinHandlesDuplicateKeysOnBothSides) {
+  // id / 3 gives the sorted keys 0, 0, 1, 1, 1, 2, 2.
+  auto getBucketPlan = [this]() {
+    auto schema = arrow::schema({ arrow::field("bucket", arrow::int64()) });
+    std::vector<std::shared_ptr<PhysicalExpression>> projection = { std::make_shared<DivideExpression>(
+        std::make_shared<Column>(ID_COLUMN), std::make_shared<LiteralLong>(3)) };
+    return std::make_shared<Projection>(getScanPlan(), schema, projection);
+  };
+  auto schema = arrow::schema({ arrow::field("bucket", arrow::int64()), arrow::field("bucket", arrow::int64()) });
+  auto join = std::make_shared<SortMergeJoin>(
+      getBucketPlan(), getBucketPlan(), schema, std::vector<int>{ 0 }, std::vector<int>{ 0 });
+
+  EXPECT_TRUE(join->Prepare().ok());
+
+  int64_t num_rows = 0;
+  auto batch = join->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    auto left = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(0));
+    auto right = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(1));
+    for (int64_t row = 0; row < (*batch)->num_rows(); row++) { EXPECT_EQ(left->Value(row), right->Value(row)); }
+    num_rows += (*batch)->num_rows();
+    batch = join->Next();
+  }
+
+  // 2 * 2 + 3 * 3 + 2 * 2
+  EXPECT_TRUE(batch.ok());
+  EXPECT_EQ(num_rows, 17);
+}
+
+//
+// Sort tests
+//
+
+TEST_F(PhysicalPlanTest, SortOrdersRowsOnMultipleKeys) {
+  // age > 10 ascending, then id descending.
+  std::vector<SortKey> sort_keys = {
+    SortKey{ std::make_shared<GreaterThanExpression>(
+        std::make_shared<Column>(AGE_COLUMN), std::make_shared<LiteralLong>(10)) },
+    SortKey{ std::make_shared<Column>(ID_COLUMN), false, true },
+  };
+  auto sort = std::make_shared<Sort>(getScanPlan(), sort_keys);
+  EXPECT_TRUE(sort->Prepare().ok());
+
+  std::vector<int64_t> ids;
+  auto batch = sort->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    auto id_column = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(ID_COLUMN));
+    for (int64_t row = 0; row < id_column->length(); row++) { ids.push_back(id_column->Value(row)); }
+    batch = sort->Next();
+  }
+
+  EXPECT_TRUE(batch.ok());
+  EXPECT_EQ(ids, std::vector<int64_t>({ 3, 2, 1, 7, 6, 5, 4 }));
+}
+
+TEST_F(PhysicalPlanTest, SortSpillsAndMergesRunsOverMemoryLimit) {
+  // write the test data as one batch per row so that each of them is spilled as a run.
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int64_t row = 0; row < batch->num_rows(); row++) { EXPECT_TRUE(writer->Write(batch->Slice(row, 1)).ok()); }
+  EXPECT_TRUE(writer->Close().ok());
+
+  std::vector<SortKey> sort_keys = { SortKey{ std::make_shared<Column>(NAME_COLUMN), false } };
+  auto sort = std::make_shared<Sort>(std::make_shared<SpillScan>(path, GetTestSchema()), sort_keys, 1, "");
+  EXPECT_TRUE(sort->Prepare().ok());
+
+  std::vector<int64_t> ids;
+  auto sorted_batch = sort->Next();
+  while (sorted_batch.ok() && (*sorted_batch) != nullptr) {
+    auto id_column = std::static_pointer_cast<arrow::Int64Array>((*sorted_batch)->column(ID_COLUMN));
+    for (int64_t row = 0; row < id_column->length(); row++) { ids.push_back(id_column->Value(row)); }
+    sorted_batch = sort->Next();
+  }
+
+  EXPECT_TRUE(sorted_batch.ok()) << sorted_batch.status().message();
+  EXPECT_EQ(ids, std::vector<int64_t>({ 7, 6, 5, 4, 3, 2, 1 }));
+  EXPECT_EQ(sort->Metrics().spilled_partitions, 7);
+  EXPECT_EQ(sort->Metrics().spilled_rows, 7);
+}
+
+//
+// TopK tests
+//
+
+std::vector<int64_t> collectIds(std::shared_ptr<toyquery::physicalplan::PhysicalPlan> plan) {
+  std::vector<int64_t> ids;
+  auto batch = plan->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    auto id_column = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(ID_COLUMN));
+    for (int64_t row = 0; row < id_column->length(); row++) { ids.push_back(id_column->Value(row)); }
+    batch = plan->Next();
+  }
+  EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+  return ids;
+}
+
+TEST_F(PhysicalPlanTest, TopKKeepsBestRowsAndPublishesKthValue) {
+  auto scan = getScanPlan();
+  std::vector<SortKey> sort_keys = { SortKey{ std::make_shared<Column>(AGE_COLUMN), false } };
+  auto top_k = std::make_shared<TopK>(scan, sort_keys, 3);
+  scan->AddRuntimeFilter(AGE_COLUMN, top_k->Filter());
+
+  EXPECT_TRUE(top_k->Prepare().ok());
+  EXPECT_EQ(collectIds(top_k), std::vector<int64_t>({ 7, 6, 5 }));
+
+  // the ages below the k-th one (55) can't make it into the result anymore.
+  EXPECT_TRUE(top_k->Filter()->IsReady());
+  auto mask_or = top_k->Filter()->Evaluate(GetTestData()->column(AGE_COLUMN)->chunk(0));
+  EXPECT_TRUE(mask_or.ok());
+  EXPECT_EQ((*mask_or)->true_count(), 3);
+}
+
+TEST_F(PhysicalPlanTest, TopKOverManyBatches) {
+  // one batch per row, in reverse order, so that the buffer is cut back several times.
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int64_t row = batch->num_rows() - 1; row >= 0; row--) { EXPECT_TRUE(writer->Write(batch->Slice(row, 1)).ok()); }
+  EXPECT_TRUE(writer->Close().ok());
+
+  std::vector<SortKey> sort_keys = { SortKey{ std::make_shared<Column>(NAME_COLUMN) } };
+  auto top_k = std::make_shared<TopK>(std::make_shared<SpillScan>(path, GetTestSchema()), sort_keys, 2);
+
+  EXPECT_TRUE(top_k->Prepare().ok());
+  EXPECT_EQ(collectIds(top_k), std::vector<int64_t>({ 1, 2 }));
+}
+
+TEST_F(PhysicalPlanTest, TopKWithZeroRows) {
+  std::vector<SortKey> sort_keys = { SortKey{ std::make_shared<Column>(AGE_COLUMN) } };
+  auto top_k = std::make_shared<TopK>(getScanPlan(), sort_keys, 0);
+
+  EXPECT_TRUE(top_k->Prepare().ok());
+  EXPECT_TRUE(collectIds(top_k).empty());
+}
+
+TEST_F(PhysicalPlanTest, LimitSkipsOffsetAndCancelsScan) {
+  auto scan = getScanPlan();
+  auto limit = std::make_shared<Limit>(scan, 2, 1);
+
+  EXPECT_TRUE(limit->Prepare().ok());
+  EXPECT_EQ(collectIds(limit), std::vector<int64_t>({ 2, 3 }));
+
+  // the limit is satisfied, the scan has been cancelled.
+  auto batch = scan->Next();
+  EXPECT_TRUE(batch.ok());
+  EXPECT_EQ(*batch, nullptr);
+}
+
+TEST_F(PhysicalPlanTest, LimitOverManyBatches) {
+  // one batch per row, in reverse order, so that the offset and the limit span several batches.
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int64_t row = batch->num_rows() - 1; row >= 0; row--) { EXPECT_TRUE(writer->Write(batch->Slice(row, 1)).ok()); }
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto limit = std::make_shared<Limit>(std::make_shared<SpillScan>(path, GetTestSchema()), 3, 2);
+
+  EXPECT_TRUE(limit->Prepare().ok());
+  EXPECT_EQ(collectIds(limit), std::vector<int64_t>({ 5, 4, 3 }));
+}
+
+TEST_F(PhysicalPlanTest, DistinctKeepsFirstOccurrenceOfEachRow) {
+  // the test data twice, in one-row batches.
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int i = 0; i < 2; i++) {
+    for (int64_t row = 0; row < batch->num_rows(); row++) { EXPECT_TRUE(writer->Write(batch->Slice(row, 1)).ok()); }
+  }
+  EXPECT_TRUE(writer->Write(batch).ok());
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto distinct = std::make_shared<Distinct>(std::make_shared<SpillScan>(path, GetTestSchema()));
+
+  EXPECT_TRUE(distinct->Prepare().ok());
+  EXPECT_EQ(collectIds(distinct), std::vector<int64_t>({ 1, 2, 3, 4, 5, 6, 7 }));
+}
+
+TEST_F(PhysicalPlanTest, DistinctOnSingleIntegerColumn) {
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  EXPECT_TRUE(writer->Write(batch).ok());
+  EXPECT_TRUE(writer->Write(batch->Slice(2, 3)).ok());
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto id_schema = arrow::schema({ GetTestSchema()->field(ID_COLUMN) });
+  std::vector<std::shared_ptr<PhysicalExpression>> projection = { std::make_shared<Column>(ID_COLUMN) };
+  auto distinct = std::make_shared<Distinct>(
+      std::make_shared<Projection>(std::make_shared<SpillScan>(path, GetTestSchema()), id_schema, projection));
+
+  EXPECT_TRUE(distinct->Prepare().ok());
+  EXPECT_EQ(collectIds(distinct), std::vector<int64_t>({ 1, 2, 3, 4, 5, 6, 7 }));
+}
+
+TEST_F(PhysicalPlanTest, CancelledScanStopsReading) {
+  auto scan = getScanPlan();
+
+  EXPECT_TRUE(scan->Prepare().ok());
+  scan->Cancel();
+
+  auto batch = scan->Next();
+  EXPECT_TRUE(batch.ok());
+  EXPECT_EQ(*batch, nullptr);
+}
+
+TEST_F(PhysicalPlanTest, CancellationTokenStopsThePlan) {
+  auto token = std::make_shared<CancellationToken>();
+  std::vector<SortKey> sort_keys = { SortKey{ std::make_shared<Column>(ID_COLUMN) } };
+  auto sort = std::make_shared<Sort>(getScanPlan(), sort_keys);
+  sort->SetCancellationToken(token);
+
+  EXPECT_TRUE(sort->Prepare().ok());
+  token->Cancel();
+
+  auto batch = sort->Next();
+  EXPECT_TRUE(absl::IsCancelled(batch.status())) << batch.status();
+}
+
+TEST_F(PhysicalPlanTest, DeadlineStopsThePlan) {
+  auto token = std::make_shared<CancellationToken>();
+  token->SetDeadline(CancellationToken::Clock::now());
+  auto scan = getScanPlan();
+  scan->SetCancellationToken(token);
+
+  EXPECT_TRUE(scan->Prepare().ok());
+  auto batch = scan->Next();
+  EXPECT_TRUE(absl::IsDeadlineExceeded(batch.status())) << batch.status();
+}
+
+std::shared_ptr<HashAggregation> getMaxAgeByIdPlan(std::shared_ptr<PhysicalPlan> input) {
+  auto schema = arrow::schema({ arrow::field("id", arrow::int64()), arrow::field("max_age", arrow::int64()) });
+  std::vector<std::shared_ptr<PhysicalExpression>> group_by = { std::make_shared<Column>(ID_COLUMN) };
+  std::vector<std::shared_ptr<AggregationExpression>> aggregations = { std::make_shared<MaxExpression>(
+      std::make_shared<Column>(AGE_COLUMN)) };
+  return std::make_shared<HashAggregation>(input, schema, group_by, aggregations);
+}
+
+TEST_F(PhysicalPlanTest, HashAggregationGroupsByStrings) {
+  auto schema = arrow::schema({ arrow::field("name", arrow::utf8()), arrow::field("max_name", arrow::utf8()) });
+  std::vector<std::shared_ptr<PhysicalExpression>> group_by = { std::make_shared<Column>(NAME_COLUMN) };
+  std::vector<std::shared_ptr<AggregationExpression>> aggregations = { std::make_shared<MaxExpression>(
+      std::make_shared<Column>(NAME_COLUMN)) };
+  auto aggregation = std::make_shared<HashAggregation>(getScanPlan(), schema, group_by, aggregations);
+  EXPECT_TRUE(aggregation->Prepare().ok());
+
+  std::set<std::string> names;
+  while (true) {
+    auto batch_or = aggregation->Next();
+    ASSERT_TRUE(batch_or.ok()) << batch_or.status();
+    if (*batch_or == nullptr) { break; }
+
+    // each group is its own max.
+    auto keys = std::static_pointer_cast<arrow::StringArray>((*batch_or)->column(0));
+    auto values = std::static_pointer_cast<arrow::StringArray>((*batch_or)->column(1));
+    for (int64_t row = 0; row < keys->length(); row++) {
+      EXPECT_EQ(keys->GetString(row), values->GetString(row));
+      names.insert(keys->GetString(row));
+    }
+  }
+
+  auto test_names = std::static_pointer_cast<arrow::StringArray>(GetTestData()->column(NAME_COLUMN)->chunk(0));
+  std::set<std::string> expected_names;
+  for (int64_t row = 0; row < test_names->length(); row++) { expected_names.insert(test_names->GetString(row)); }
+  EXPECT_EQ(names, expected_names);
+}
+
+TEST_F(PhysicalPlanTest, MemoryIsAttributedToOperators) {
+  auto pool = std::make_shared<TrackingMemoryPool>("query");
+  auto aggregation = getMaxAgeByIdPlan(getScanPlan());
+  aggregation->SetMemoryPool(pool);
+
+  EXPECT_TRUE(aggregation->Prepare().ok());
+  auto ids = collectIds(aggregation);
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(ids, std::vector<int64_t>({ 1, 2, 3, 4, 5, 6, 7 }));
+
+  // one entry per operator, the aggregation output is allocated from the query pool.
+  auto usage = pool->Attribution();
+  ASSERT_EQ(usage.size(), 2);
+  EXPECT_NE(usage[0].name.find("HashAggregation"), std::string::npos) << usage[0].name;
+  EXPECT_GT(usage[0].peak_bytes_allocated, 0);
+  EXPECT_GE(pool->max_memory(), usage[0].peak_bytes_allocated);
+}
+
+TEST_F(PhysicalPlanTest, EvaluatedColumnsAreAttributedToTheOperator) {
+  auto pool = std::make_shared<TrackingMemoryPool>("query");
+  auto selection = std::make_shared<Selection>(
+      getScanPlan(),
+      std::make_shared<LessThanExpression>(std::make_shared<Column>(ID_COLUMN), std::make_shared<LiteralLong>(3)));
+  selection->SetMemoryPool(pool);
+
+  EXPECT_TRUE(selection->Prepare().ok());
+  EXPECT_EQ(collectIds(selection), std::vector<int64_t>({ 1, 2 }));
+
+  // the literal, the mask of the predicate and the filtered columns are allocated from the pool of the selection.
+  auto usage = pool->Attribution();
+  ASSERT_EQ(usage.size(), 2);
+  EXPECT_NE(usage[0].name.find("Selection"), std::string::npos) << usage[0].name;
+  EXPECT_GT(usage[0].peak_bytes_allocated, 0);
+}
+
+TEST_F(PhysicalPlanTest, MemoryLimitFailsTheQuery) {
+  auto aggregation = getMaxAgeByIdPlan(getScanPlan());
+  aggregation->SetMemoryPool(std::make_shared<TrackingMemoryPool>("query", 1));
+
+  EXPECT_TRUE(aggregation->Prepare().ok());
+  auto batch = aggregation->Next();
+  EXPECT_TRUE(absl::IsResourceExhausted(batch.status())) << batch.status();
+}
+
+TEST_F(PhysicalPlanTest, WindowOverPartitionsSpanningBatches) {
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  EXPECT_TRUE(writer->Write(batch).ok());
+  EXPECT_TRUE(writer->Write(batch).ok());
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto fields = GetTestSchema()->fields();
+  auto row_number_column = fields.size(), sum_column = fields.size() + 1;
+  fields.push_back(arrow::field("row_number", arrow::int64()));
+  fields.push_back(arrow::field("sum", arrow::int64()));
+  auto schema = arrow::schema(fields);
+  std::vector<WindowFunction> functions = { { WindowFunctionType::RowNumber },
+                                            { WindowFunctionType::Sum, std::make_shared<Column>(AGE_COLUMN) } };
+  auto window = std::make_shared<Window>(
+      std::make_shared<SpillScan>(path, GetTestSchema()),
+      schema,
+      std::vector<std::shared_ptr<PhysicalExpression>>{ std::make_shared<Column>(ID_COLUMN) },
+      std::vector<SortKey>{ SortKey{ std::make_shared<Column>(AGE_COLUMN) } },
+      functions);
+
+  EXPECT_TRUE(window->Prepare().ok());
+  auto result = window->Next();
+  ASSERT_TRUE(result.ok());
+  ASSERT_EQ((*result)->num_rows(), 14);
+
+  // each id appears once per batch, both rows are peers on the age and share the sum of the partition.
+  auto ids = std::static_pointer_cast<arrow::Int64Array>((*result)->column(ID_COLUMN));
+  auto ages = std::static_pointer_cast<arrow::Int64Array>((*result)->column(AGE_COLUMN));
+  auto row_numbers = std::static_pointer_cast<arrow::Int64Array>((*result)->column(row_number_column));
+  auto sums = std::static_pointer_cast<arrow::Int64Array>((*result)->column(sum_column));
+  for (int64_t row = 0; row < 14; row++) {
+    EXPECT_EQ(ids->Value(row), row / 2 + 1);
+    EXPECT_EQ(row_numbers->Value(row), row % 2 + 1);
+    EXPECT_EQ(sums->Value(row), 2 * ages->Value(row));
+  }
+  EXPECT_EQ(*window->Next(), nullptr);
+}
+
+TEST_F(PhysicalPlanTest, PrefetchReturnsAllBatchesInOrder) {
+  // one-row batches so that the background thread has to wait for room in the queue.
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int64_t row = 0; row < batch->num_rows(); row++) { EXPECT_TRUE(writer->Write(batch->Slice(row, 1)).ok()); }
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto prefetch = std::make_shared<Prefetch>(std::make_shared<SpillScan>(path, GetTestSchema()), 2);
+
+  EXPECT_TRUE(prefetch->Prepare().ok());
+  EXPECT_EQ(collectIds(prefetch), std::vector<int64_t>({ 1, 2, 3, 4, 5, 6, 7 }));
+  EXPECT_EQ(*prefetch->Next(), nullptr);
+}
+
+TEST_F(PhysicalPlanTest, CancelledPrefetchStopsReading) {
+  auto prefetch = std::make_shared<Prefetch>(getScanPlan(), 1);
+
+  EXPECT_TRUE(prefetch->Prepare().ok());
+  EXPECT_TRUE(prefetch->Next().ok());
+  prefetch->Cancel();
+
+  auto batch = prefetch->Next();
+  EXPECT_TRUE(batch.ok());
+  EXPECT_EQ(*batch, nullptr);
+}
+
+TEST_F(PhysicalPlanTest, MorselQueueCoalescesSmallBatches) {
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int i = 0; i < 8; i++) { EXPECT_TRUE(writer->Write(batch).ok()); }
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto source = std::make_shared<SpillScan>(path, GetTestSchema());
+  auto morsels = std::make_shared<MorselQueue>(source);
+  auto morsel_scan = std::make_shared<MorselScan>(morsels);
+  auto token = std::make_shared<CancellationToken>();
+  auto pool = std::make_shared<TrackingMemoryPool>("query");
+  morsel_scan->SetCancellationToken(token);
+  morsel_scan->SetMemoryPool(pool);
+  EXPECT_EQ(source->QueryCancellationToken(), token);
+  EXPECT_EQ(source->QueryMemoryPool(), pool);
+
+  // the eight batches of the source make a single morsel.
+  EXPECT_TRUE(morsel_scan->Prepare().ok());
+  auto morsel = morsel_scan->Next();
+  EXPECT_TRUE(morsel.ok());
+  EXPECT_EQ((*morsel)->num_rows(), 8 * batch->num_rows());
+  EXPECT_EQ(*morsel_scan->Next(), nullptr);
+}
+
+TEST_F(PhysicalPlanTest, GatherRunsPipelinesOverSharedMorsels) {
+  // the test data eight times over, coalesced into a single morsel taken by one of the pipeline instances.
+  auto batch = arrow::TableBatchReader(*GetTestData()).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+  auto writer = std::move(SpillFileWriter::Open(path, GetTestSchema()).value());
+  for (int i = 0; i < 8; i++) { EXPECT_TRUE(writer->Write(batch).ok()); }
+  EXPECT_TRUE(writer->Close().ok());
+
+  auto morsels = std::make_shared<MorselQueue>(std::make_shared<SpillScan>(path, GetTestSchema()));
+  std::vector<std::shared_ptr<PhysicalPlan>> pipelines;
+  for (int i = 0; i < 4; i++) {
+    std::vector<std::shared_ptr<PhysicalExpression>> projection = { std::make_shared<Column>(ID_COLUMN),
+                                                                    std::make_shared<Column>(NAME_COLUMN) };
+    pipelines.push_back(std::make_shared<Projection>(
+        std::make_shared<MorselScan>(morsels), GetTestSchemaWithIdAndNameColumns(), projection));
+  }
+  auto gather = std::make_shared<Gather>(pipelines, std::make_shared<ThreadPool>(4));
+
+  EXPECT_TRUE(gather->Prepare().ok());
+  auto ids = collectIds(gather);
+  std::sort(ids.begin(), ids.end());
+  std::vector<int64_t> expected_ids;
+  for (int64_t id = 1; id <= 7; id++) { expected_ids.insert(expected_ids.end(), 8, id); }
+  EXPECT_EQ(ids, expected_ids);
+}
+
 }  // namespace physicalplan
 }  // namespace toyquery
 
@@ -0,0 +1,95 @@
+#include "physicalplan/pipeline.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "datasource/datasource.h"
+#include "fmt/core.h"
+#include "test_utils/test_utils.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+using ::toyquery::datasource::CsvDataSource;
+using ::toyquery::testutils::AGE_COLUMN;
+using ::toyquery::testutils::GetTestSchemaWithIdAndNameColumns;
+using ::toyquery::testutils::ID_COLUMN;
+using ::toyquery::testutils::NAME_COLUMN;
+
+class PipelineTest : public ::testing::Test {
+ protected:
+  PipelineTest() { data_source_ = std::make_shared<CsvDataSource>("/tmp/test.csv", 10); }
+
+  // SELECT id, name FROM test WHERE age > 10 ORDER BY id DESC
+  std::shared_ptr<PhysicalPlan> getSortedPlan() {
+    std::vector<std::string> projection;
+    auto scan = std::make_shared<Scan>(data_source_, projection);
+    auto selection = std::make_shared<Selection>(
+        scan,
+        std::make_shared<GreaterThanExpression>(
+            std::make_shared<Column>(AGE_COLUMN), std::make_shared<LiteralLong>(10)));
+    std::vector<std::shared_ptr<PhysicalExpression>> columns = { std::make_shared<Column>(ID_COLUMN),
+                                                                 std::make_shared<Column>(NAME_COLUMN) };
+    auto project = std::make_shared<Projection>(selection, GetTestSchemaWithIdAndNameColumns(), columns);
+    std::vector<SortKey> sort_keys = { SortKey{ std::make_shared<Column>(ID_COLUMN), false } };
+    return std::make_shared<Sort>(project, sort_keys);
+  }
+
+  std::vector<int64_t> collectIds(std::shared_ptr<PhysicalPlan> plan) {
+    std::vector<int64_t> ids;
+    auto batch = plan->Next();
+    while (batch.ok() && (*batch) != nullptr) {
+      auto id_column = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(ID_COLUMN));
+      for (int64_t row = 0; row < id_column->length(); row++) { ids.push_back(id_column->Value(row)); }
+      batch = plan->Next();
+    }
+    EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+    return ids;
+  }
+
+  std::shared_ptr<CsvDataSource> data_source_;
+};
+
+TEST_F(PipelineTest, PlanIsSplitAtPipelineBreakers) {
+  auto sort = getSortedPlan();
+
+  auto pipelines = BuildPipelines(sort);
+  ASSERT_TRUE(pipelines.ok());
+  ASSERT_EQ(pipelines->size(), 2);
+
+  // scan -> selection -> projection -> sort, then the sort output on its own.
+  EXPECT_TRUE(std::dynamic_pointer_cast<Scan>((*pipelines)[0]->Source()) != nullptr);
+  EXPECT_EQ((*pipelines)[0]->NumOperators(), 2);
+  EXPECT_EQ((*pipelines)[0]->Sink(), std::dynamic_pointer_cast<PipelineBreaker>(sort));
+  EXPECT_EQ((*pipelines)[1]->Source(), sort);
+  EXPECT_EQ((*pipelines)[1]->NumOperators(), 0);
+  EXPECT_EQ((*pipelines)[1]->Sink(), nullptr);
+}
+
+TEST_F(PipelineTest, PushBasedExecutionMatchesPullBasedExecution) {
+  auto pull = getSortedPlan();
+  EXPECT_TRUE(pull->Prepare().ok());
+  auto expected_ids = collectIds(pull);
+  EXPECT_EQ(expected_ids, std::vector<int64_t>({ 7, 6, 5, 4 }));
+
+  auto push = std::make_shared<PipelineExecution>(getSortedPlan());
+  EXPECT_TRUE(push->Prepare().ok());
+  EXPECT_EQ(push->Pipelines().size(), 2);
+  EXPECT_EQ(collectIds(push), expected_ids);
+}
+
+TEST_F(PipelineTest, PipelineWithoutSinkCannotRun) {
+  std::vector<std::string> projection;
+  Pipeline pipeline(std::make_shared<Scan>(data_source_, projection), {}, nullptr);
+
+  EXPECT_FALSE(pipeline.Run().ok());
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
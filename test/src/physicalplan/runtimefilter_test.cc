@@ -0,0 +1,142 @@
+#include "physicalplan/runtimefilter.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "test_utils/test_utils.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+using ::toyquery::testutils::GetTestData;
+using ::toyquery::testutils::ID_COLUMN;
+
+std::shared_ptr<arrow::Array> makeInt64Array(std::vector<int64_t> values) {
+  arrow::Int64Builder builder;
+  builder.AppendValues(values);
+  return builder.Finish().ValueOrDie();
+}
+
+TEST(BloomFilterTest, HasNoFalseNegatives) {
+  BloomFilter bloom_filter(1000, 0.01);
+  for (uint64_t i = 0; i < 1000; i++) { bloom_filter.Insert(i * 7919); }
+  for (uint64_t i = 0; i < 1000; i++) { EXPECT_TRUE(bloom_filter.MightContain(i * 7919)); }
+}
+
+TEST(BloomFilterTest, HasFewFalsePositives) {
+  BloomFilter bloom_filter(1000, 0.01);
+  arrow::Int64Builder builder;
+  for (int64_t i = 0; i < 2000; i++) { builder.Append(i); }
+  auto values = builder.Finish().ValueOrDie();
+
+  for (int64_t i = 0; i < 1000; i++) { bloom_filter.Insert(HashArrayValue(*values, i)); }
+
+  int false_positives = 0;
+  for (int64_t i = 1000; i < 2000; i++) { false_positives += bloom_filter.MightContain(HashArrayValue(*values, i)); }
+  EXPECT_LT(false_positives, 50);
+}
+
+TEST(RuntimeFilterTest, LetsEverythingPassBeforePublish) {
+  RuntimeFilter filter("test");
+  auto column = makeInt64Array({ 1, 2, 3 });
+
+  auto might_match_or = filter.MightMatch(column);
+  EXPECT_TRUE(might_match_or.ok());
+  EXPECT_TRUE(*might_match_or);
+
+  auto mask_or = filter.Evaluate(column);
+  EXPECT_TRUE(mask_or.ok());
+  EXPECT_EQ((*mask_or)->true_count(), 3);
+}
+
+TEST(RuntimeFilterTest, FiltersRowsOutsideOfOneSidedRange) {
+  RuntimeFilter filter("test");
+  auto bounds = arrow::Concatenate({ arrow::MakeArrayOfNull(arrow::int64(), 1).ValueOrDie(), makeInt64Array({ 3 }) });
+  EXPECT_TRUE(filter.PublishRange(bounds.ValueOrDie(), true).ok());
+
+  arrow::Int64Builder builder;
+  builder.AppendValues({ -5, 3, 4, 0 }, { true, true, true, false });
+  auto mask_or = filter.Evaluate(builder.Finish().ValueOrDie());
+  EXPECT_TRUE(mask_or.ok());
+
+  // only 4 is above the upper bound, the null is kept.
+  EXPECT_TRUE((*mask_or)->Value(0));
+  EXPECT_TRUE((*mask_or)->Value(1));
+  EXPECT_FALSE((*mask_or)->Value(2));
+  EXPECT_TRUE((*mask_or)->Value(3));
+  EXPECT_EQ(filter.RowsFiltered(), 1);
+}
+
+TEST(RuntimeFilterTest, FiltersRowsNotInBuildSide) {
+  RuntimeFilter filter("test");
+  EXPECT_TRUE(filter.Publish({ makeInt64Array({ 2, 4 }), makeInt64Array({ 8 }) }).ok());
+
+  auto mask_or = filter.Evaluate(makeInt64Array({ 1, 2, 3, 4, 8, 9 }));
+  EXPECT_TRUE(mask_or.ok());
+
+  // 1 and 9 are outside of the [min, max] range, 3 is only dropped if the bloom filter rejects it.
+  auto mask = *mask_or;
+  EXPECT_FALSE(mask->Value(0));
+  EXPECT_TRUE(mask->Value(1));
+  EXPECT_TRUE(mask->Value(3));
+  EXPECT_TRUE(mask->Value(4));
+  EXPECT_FALSE(mask->Value(5));
+  EXPECT_GE(filter.RowsFiltered(), 2);
+}
+
+TEST(RuntimeFilterTest, SkipsBatchOutsideOfBuildRange) {
+  RuntimeFilter filter("test");
+  EXPECT_TRUE(filter.Publish({ makeInt64Array({ 10, 20 }) }).ok());
+
+  auto might_match_or = filter.MightMatch(makeInt64Array({ 1, 2, 3 }));
+  EXPECT_TRUE(might_match_or.ok());
+  EXPECT_FALSE(*might_match_or);
+  EXPECT_EQ(filter.BatchesSkipped(), 1);
+  EXPECT_EQ(filter.RowsFiltered(), 3);
+}
+
+TEST(RuntimeFilterTest, KeepsBatchOverlappingBuildRange) {
+  RuntimeFilter filter("test");
+  EXPECT_TRUE(filter.Publish({ makeInt64Array({ 10, 20 }) }).ok());
+
+  // no value of the batch is in the range but its [min, max] spans it.
+  auto might_match_or = filter.MightMatch(makeInt64Array({ 30, 1 }));
+  EXPECT_TRUE(might_match_or.ok());
+  EXPECT_TRUE(*might_match_or);
+
+  might_match_or = filter.MightMatch(makeInt64Array({ 25, 21 }));
+  EXPECT_TRUE(might_match_or.ok());
+  EXPECT_FALSE(*might_match_or);
+  EXPECT_EQ(filter.BatchesSkipped(), 1);
+}
+
+TEST(RuntimeFilterTest, EmptyBuildSideFiltersEverything) {
+  RuntimeFilter filter("test");
+  EXPECT_TRUE(filter.Publish({}).ok());
+
+  auto might_match_or = filter.MightMatch(makeInt64Array({ 1, 2 }));
+  EXPECT_TRUE(might_match_or.ok());
+  EXPECT_FALSE(*might_match_or);
+}
+
+TEST(RuntimeFilterTest, ApplyRuntimeFiltersOnRecordBatch) {
+  auto filter = std::make_shared<RuntimeFilter>("test");
+  EXPECT_TRUE(filter->Publish({ makeInt64Array({ 3, 4 }) }).ok());
+
+  auto table = GetTestData();
+  auto batch = arrow::TableBatchReader(*table).Next().ValueOrDie();
+
+  auto filtered_or = ApplyRuntimeFilters(batch, { { ID_COLUMN, filter } });
+  EXPECT_TRUE(filtered_or.ok());
+  EXPECT_EQ((*filtered_or)->num_rows(), 2);
+  EXPECT_EQ((*filtered_or)->num_columns(), batch->num_columns());
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
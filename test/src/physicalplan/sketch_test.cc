@@ -0,0 +1,82 @@
+#include "physicalplan/sketch.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace toyquery {
+namespace physicalplan {
+
+TEST(HyperLogLogTest, EstimatesDistinctCountWithinError) {
+  HyperLogLog sketch;
+  for (int repeat = 0; repeat < 3; repeat++) {
+    for (int64_t value = 0; value < 100000; value++) { sketch.Add(HashScalarValue(arrow::Int64Scalar(value))); }
+  }
+
+  // the standard error is 1.6% with 4096 registers, allow for 3 of them.
+  EXPECT_NEAR(sketch.Estimate(), 100000, 100000 * 0.05);
+  EXPECT_EQ(sketch.SizeInBytes(), 4096);
+}
+
+TEST(HyperLogLogTest, IsExactForSmallCounts) {
+  HyperLogLog sketch;
+  for (auto value : { "a", "b", "c", "a" }) { sketch.Add(HashScalarValue(arrow::StringScalar(value))); }
+
+  EXPECT_EQ(sketch.Estimate(), 3);
+}
+
+TEST(HyperLogLogTest, MergesPartialSketches) {
+  HyperLogLog left, right, other_precision(10);
+  for (int64_t value = 0; value < 60000; value++) { left.Add(HashScalarValue(arrow::Int64Scalar(value))); }
+  for (int64_t value = 40000; value < 100000; value++) { right.Add(HashScalarValue(arrow::Int64Scalar(value))); }
+
+  EXPECT_TRUE(left.Merge(right));
+  EXPECT_NEAR(left.Estimate(), 100000, 100000 * 0.05);
+  EXPECT_FALSE(left.Merge(other_precision));
+}
+
+TEST(TDigestTest, EstimatesQuantilesWithinError) {
+  std::vector<double> values;
+  for (int value = 1; value <= 100000; value++) { values.push_back(value); }
+  std::shuffle(values.begin(), values.end(), std::mt19937(42));
+
+  TDigest sketch;
+  for (auto value : values) { sketch.Add(value); }
+
+  EXPECT_NEAR(sketch.Quantile(0.5), 50000, 100000 * 0.01);
+  EXPECT_NEAR(sketch.Quantile(0.99), 99000, 100000 * 0.001);
+  EXPECT_NEAR(sketch.Quantile(0.001), 100, 100000 * 0.001);
+  EXPECT_EQ(sketch.Quantile(0), 1);
+  EXPECT_EQ(sketch.Quantile(1), 100000);
+  EXPECT_EQ(sketch.Count(), 100000);
+  EXPECT_LE(sketch.NumCentroids(), 100);
+}
+
+TEST(TDigestTest, MergesPartialSketches) {
+  TDigest low, high;
+  for (int value = 1; value <= 50000; value++) { low.Add(value); }
+  for (int value = 50001; value <= 100000; value++) { high.Add(value); }
+
+  low.Merge(high);
+  EXPECT_NEAR(low.Quantile(0.25), 25000, 100000 * 0.01);
+  EXPECT_NEAR(low.Quantile(0.75), 75000, 100000 * 0.01);
+  EXPECT_EQ(low.Count(), 100000);
+}
+
+TEST(TDigestTest, EmptyAndSingleValue) {
+  TDigest sketch;
+  EXPECT_TRUE(std::isnan(sketch.Quantile(0.5)));
+
+  sketch.Add(42);
+  EXPECT_EQ(sketch.Quantile(0.1), 42);
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
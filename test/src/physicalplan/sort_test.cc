@@ -0,0 +1,106 @@
+#include "physicalplan/sort.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+
+namespace toyquery {
+namespace physicalplan {
+
+std::shared_ptr<arrow::Array> makeInt64Array(std::vector<int64_t> values, std::vector<bool> is_valid = {}) {
+  arrow::Int64Builder builder;
+  if (is_valid.empty()) {
+    builder.AppendValues(values);
+  } else {
+    builder.AppendValues(values, is_valid);
+  }
+  return builder.Finish().ValueOrDie();
+}
+
+std::shared_ptr<arrow::Array> makeDoubleArray(std::vector<double> values) {
+  arrow::DoubleBuilder builder;
+  builder.AppendValues(values);
+  return builder.Finish().ValueOrDie();
+}
+
+std::shared_ptr<arrow::Array> makeStringArray(std::vector<std::string> values) {
+  arrow::StringBuilder builder;
+  builder.AppendValues(values);
+  return builder.Finish().ValueOrDie();
+}
+
+TEST(SortTest, SortsInt64AscendingWithNullsLast) {
+  auto keys = { makeInt64Array({ 5, -3, 0, 0, -3, 9 }, { true, true, false, true, true, true }) };
+  auto indices = SortIndices(keys, { SortKey{ nullptr, true, false } });
+  EXPECT_EQ(indices, std::vector<int64_t>({ 1, 4, 3, 0, 5, 2 }));
+}
+
+TEST(SortTest, SortsInt64DescendingWithNullsFirst) {
+  auto keys = { makeInt64Array({ 5, -3, 0, 0, -3, 9 }, { true, true, false, true, true, true }) };
+  auto indices = SortIndices(keys, { SortKey{ nullptr, false, true } });
+  EXPECT_EQ(indices, std::vector<int64_t>({ 2, 5, 0, 3, 1, 4 }));
+}
+
+TEST(SortTest, SortsNegativeDoubles) {
+  auto keys = { makeDoubleArray({ 1.5, -2.5, 0.0, -0.0, -10 }) };
+  auto indices = SortIndices(keys, { SortKey{ nullptr, true, false } });
+  EXPECT_EQ(indices, std::vector<int64_t>({ 4, 1, 2, 3, 0 }));
+}
+
+TEST(SortTest, SortsOnMultipleFixedWidthKeys) {
+  auto keys = { makeInt64Array({ 1, 0, 1, 0 }), makeDoubleArray({ 0.5, 0.1, 0.9, 0.2 }) };
+  auto indices = SortIndices(keys, { SortKey{ nullptr, true, false }, SortKey{ nullptr, false, false } });
+  EXPECT_EQ(indices, std::vector<int64_t>({ 3, 1, 2, 0 }));
+}
+
+TEST(SortTest, SortsOnStringAndInt64Keys) {
+  auto keys = { makeStringArray({ "b", "a", "b", "a" }), makeInt64Array({ 1, 2, 0, 1 }) };
+  auto indices = SortIndices(keys, { SortKey{ nullptr, true, false }, SortKey{ nullptr, false, false } });
+  EXPECT_EQ(indices, std::vector<int64_t>({ 1, 3, 0, 2 }));
+}
+
+TEST(SortTest, RadixSortAgreesWithComparison) {
+  std::mt19937_64 rng(42);
+  std::vector<int64_t> values;
+  std::vector<bool> is_valid;
+  for (int i = 0; i < 10000; i++) {
+    values.push_back(static_cast<int64_t>(rng()) >> (rng() % 64));
+    is_valid.push_back(rng() % 10 != 0);
+  }
+
+  std::vector<std::shared_ptr<arrow::Array>> keys = { makeInt64Array(values, is_valid) };
+  std::vector<SortKey> sort_keys = { SortKey{ nullptr, false, true } };
+  auto indices = SortIndices(keys, sort_keys);
+
+  ASSERT_EQ(indices.size(), values.size());
+  for (int i = 1; i < indices.size(); i++) {
+    EXPECT_LE(CompareSortKeys(keys, indices[i - 1], keys, indices[i], sort_keys), 0);
+  }
+}
+
+TEST(LoserTreeTest, MergesSortedSources) {
+  std::vector<std::vector<int>> sources = { { 1, 4, 9 }, {}, { 2, 3, 10, 11 }, { 0, 4 }, { 5 } };
+  std::vector<int> heads(sources.size(), 0);
+  auto less = [&](int a, int b) {
+    bool a_done = heads[a] >= sources[a].size(), b_done = heads[b] >= sources[b].size();
+    if (a_done || b_done) { return !a_done; }
+    return sources[a][heads[a]] < sources[b][heads[b]];
+  };
+
+  LoserTree tree(sources.size(), less);
+  std::vector<int> merged;
+  while (heads[tree.Winner()] < sources[tree.Winner()].size()) {
+    merged.push_back(sources[tree.Winner()][heads[tree.Winner()]++]);
+    tree.Update();
+  }
+  EXPECT_EQ(merged, std::vector<int>({ 0, 1, 2, 3, 4, 4, 5, 9, 10, 11 }));
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
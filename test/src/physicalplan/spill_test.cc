@@ -0,0 +1,76 @@
+#include "physicalplan/spill.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <memory>
+
+#include "test_utils/test_utils.h"
+
+namespace toyquery {
+namespace physicalplan {
+
+using ::toyquery::testutils::GetTestData;
+using ::toyquery::testutils::GetTestSchema;
+
+TEST(SpillFileTest, ReadsBackSpilledBatches) {
+  auto table = GetTestData();
+  auto batch = arrow::TableBatchReader(*table).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+
+  auto writer_or = SpillFileWriter::Open(path, GetTestSchema());
+  EXPECT_TRUE(writer_or.ok()) << writer_or.status().message();
+  auto writer = std::move(*writer_or);
+  EXPECT_TRUE(writer->Write(batch).ok());
+  EXPECT_TRUE(writer->Write(batch->Slice(0, 3)).ok());
+  EXPECT_TRUE(writer->Close().ok());
+  EXPECT_EQ(writer->NumRows(), batch->num_rows() + 3);
+
+  {
+    auto reader_or = SpillFileReader::Open(path);
+    EXPECT_TRUE(reader_or.ok()) << reader_or.status().message();
+    auto reader = std::move(*reader_or);
+
+    auto first_or = reader->Next();
+    EXPECT_TRUE(first_or.ok());
+    EXPECT_TRUE((*first_or)->Equals(*batch));
+
+    auto second_or = reader->Next();
+    EXPECT_TRUE(second_or.ok());
+    EXPECT_EQ((*second_or)->num_rows(), 3);
+
+    auto end_or = reader->Next();
+    EXPECT_TRUE(end_or.ok());
+    EXPECT_EQ(*end_or, nullptr);
+  }
+
+  // the spill file is deleted once read.
+  EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(SpillFileTest, ReadsBackCompressedBatches) {
+  auto table = GetTestData();
+  auto batch = arrow::TableBatchReader(*table).Next().ValueOrDie();
+  auto path = MakeSpillPath("", "test");
+
+  auto writer_or = SpillFileWriter::Open(path, GetTestSchema(), arrow::Compression::LZ4_FRAME);
+  EXPECT_TRUE(writer_or.ok()) << writer_or.status().message();
+  EXPECT_TRUE((*writer_or)->Write(batch).ok());
+  EXPECT_TRUE((*writer_or)->Close().ok());
+
+  auto reader_or = SpillFileReader::Open(path);
+  EXPECT_TRUE(reader_or.ok()) << reader_or.status().message();
+  auto batch_or = (*reader_or)->Next();
+  EXPECT_TRUE(batch_or.ok());
+  EXPECT_TRUE((*batch_or)->Equals(*batch));
+}
+
+TEST(SpillFileTest, MakeSpillPathIsUnique) { EXPECT_NE(MakeSpillPath("", "test"), MakeSpillPath("", "test")); }
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
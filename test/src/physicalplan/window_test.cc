@@ -0,0 +1,150 @@
+#include "physicalplan/window.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+
+namespace toyquery {
+namespace physicalplan {
+
+std::shared_ptr<arrow::Array> makeInt64Array(std::vector<int64_t> values, std::vector<bool> is_valid = {}) {
+  arrow::Int64Builder builder;
+  if (is_valid.empty()) {
+    builder.AppendValues(values);
+  } else {
+    builder.AppendValues(values, is_valid);
+  }
+  return builder.Finish().ValueOrDie();
+}
+
+// a batch with the order key in the first column and the values in the second one.
+std::shared_ptr<arrow::RecordBatch> makeBatch(
+    std::shared_ptr<arrow::Array> order_key,
+    std::shared_ptr<arrow::Array> values) {
+  auto schema = arrow::schema({ arrow::field("key", arrow::int64()), arrow::field("value", values->type()) });
+  return arrow::RecordBatch::Make(schema, order_key->length(), { order_key, values });
+}
+
+std::vector<int64_t> int64Values(const std::shared_ptr<arrow::Array>& array) {
+  auto typed_array = std::static_pointer_cast<arrow::Int64Array>(array);
+  return std::vector<int64_t>(typed_array->raw_values(), typed_array->raw_values() + typed_array->length());
+}
+
+TEST(WindowTest, RankingFunctionsRestartOnEachPartition) {
+  auto batch = makeBatch(makeInt64Array({ 1, 1, 2, 5, 6, 6 }), makeInt64Array({ 0, 0, 0, 0, 0, 0 }));
+  std::vector<SortKey> order_by = { SortKey{ std::make_shared<Column>(0) } };
+  std::vector<std::shared_ptr<arrow::Array>> order_keys = { batch->column(0) };
+  std::vector<int64_t> partitions = { 0, 3, 6 };
+
+  auto row_number = EvaluateWindowFunction({ WindowFunctionType::RowNumber }, batch, partitions, order_keys, order_by);
+  ASSERT_TRUE(row_number.ok());
+  EXPECT_EQ(int64Values(*row_number), std::vector<int64_t>({ 1, 2, 3, 1, 2, 3 }));
+
+  auto rank = EvaluateWindowFunction({ WindowFunctionType::Rank }, batch, partitions, order_keys, order_by);
+  ASSERT_TRUE(rank.ok());
+  EXPECT_EQ(int64Values(*rank), std::vector<int64_t>({ 1, 1, 3, 1, 2, 2 }));
+
+  auto dense_rank = EvaluateWindowFunction({ WindowFunctionType::DenseRank }, batch, partitions, order_keys, order_by);
+  ASSERT_TRUE(dense_rank.ok());
+  EXPECT_EQ(int64Values(*dense_rank), std::vector<int64_t>({ 1, 1, 2, 1, 2, 2 }));
+}
+
+TEST(WindowTest, RunningSumIncludesPeers) {
+  auto batch = makeBatch(makeInt64Array({ 1, 2, 2, 3 }), makeInt64Array({ 1, 2, 3, 4 }));
+  std::vector<SortKey> order_by = { SortKey{ std::make_shared<Column>(0) } };
+
+  // the default frame, RANGE BETWEEN UNBOUNDED PRECEDING AND CURRENT ROW.
+  WindowFunction sum{ WindowFunctionType::Sum, std::make_shared<Column>(1), WindowFrame{} };
+  auto result = EvaluateWindowFunction(sum, batch, { 0, 4 }, { batch->column(0) }, order_by);
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(int64Values(*result), std::vector<int64_t>({ 1, 6, 6, 10 }));
+}
+
+TEST(WindowTest, SlidingRowsFrame) {
+  auto batch = makeBatch(makeInt64Array({ 0, 1, 2, 3, 4, 5 }), makeInt64Array({ 5, 1, 4, 2, 8, 3 }));
+  std::vector<SortKey> order_by = { SortKey{ std::make_shared<Column>(0) } };
+  std::vector<std::shared_ptr<arrow::Array>> order_keys = { batch->column(0) };
+  WindowFrame frame{ WindowFrameUnits::Rows, -1, 1 };
+
+  auto min = EvaluateWindowFunction(
+      { WindowFunctionType::Min, std::make_shared<Column>(1), frame }, batch, { 0, 6 }, order_keys, order_by);
+  ASSERT_TRUE(min.ok());
+  EXPECT_EQ(int64Values(*min), std::vector<int64_t>({ 1, 1, 1, 2, 2, 3 }));
+
+  auto max = EvaluateWindowFunction(
+      { WindowFunctionType::Max, std::make_shared<Column>(1), frame }, batch, { 0, 6 }, order_keys, order_by);
+  ASSERT_TRUE(max.ok());
+  EXPECT_EQ(int64Values(*max), std::vector<int64_t>({ 5, 5, 4, 8, 8, 8 }));
+
+  auto avg = EvaluateWindowFunction(
+      { WindowFunctionType::Avg, std::make_shared<Column>(1), frame }, batch, { 0, 6 }, order_keys, order_by);
+  ASSERT_TRUE(avg.ok());
+  auto averages = std::static_pointer_cast<arrow::DoubleArray>(*avg);
+  std::vector<double> expected = { 3, 10.0 / 3, 7.0 / 3, 14.0 / 3, 13.0 / 3, 5.5 };
+  for (int row = 0; row < expected.size(); row++) { EXPECT_DOUBLE_EQ(averages->Value(row), expected[row]); }
+}
+
+TEST(WindowTest, RangeFrameWithOffsets) {
+  auto batch = makeBatch(makeInt64Array({ 1, 2, 4, 7, 8 }), makeInt64Array({ 1, 1, 1, 1, 1 }));
+  std::vector<SortKey> order_by = { SortKey{ std::make_shared<Column>(0) } };
+
+  // RANGE BETWEEN 2 PRECEDING AND CURRENT ROW.
+  WindowFrame frame{ WindowFrameUnits::Range, -2, 0 };
+  WindowFunction count{ WindowFunctionType::Count, std::make_shared<Column>(1), frame };
+  auto result = EvaluateWindowFunction(count, batch, { 0, 5 }, { batch->column(0) }, order_by);
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(int64Values(*result), std::vector<int64_t>({ 1, 2, 2, 1, 2 }));
+}
+
+TEST(WindowTest, SlidingAggregatesAgreeWithRecomputation) {
+  std::mt19937_64 rng(42);
+  std::vector<int64_t> keys, values;
+  std::vector<bool> is_valid;
+  for (int i = 0; i < 500; i++) {
+    keys.push_back(i);
+    values.push_back(static_cast<int64_t>(rng() % 1000) - 500);
+    is_valid.push_back(rng() % 5 != 0);
+  }
+  auto batch = makeBatch(makeInt64Array(keys), makeInt64Array(values, is_valid));
+  std::vector<SortKey> order_by = { SortKey{ std::make_shared<Column>(0) } };
+  std::vector<int64_t> partitions = { 0, 120, 121, 400, 500 };
+
+  for (auto [start, end] : std::vector<std::pair<int64_t, int64_t>>{ { -3, 2 }, { 1, 4 }, { -7, -2 }, { -5, 0 } }) {
+    WindowFrame frame{ WindowFrameUnits::Rows, start, end };
+    for (auto type : { WindowFunctionType::Sum, WindowFunctionType::Min, WindowFunctionType::Max }) {
+      auto result = EvaluateWindowFunction(
+          { type, std::make_shared<Column>(1), frame }, batch, partitions, { batch->column(0) }, order_by);
+      ASSERT_TRUE(result.ok());
+      auto typed_result = std::static_pointer_cast<arrow::Int64Array>(*result);
+
+      for (int p = 0; p + 1 < partitions.size(); p++) {
+        for (int64_t row = partitions[p]; row < partitions[p + 1]; row++) {
+          bool found = false;
+          int64_t expected = 0;
+          auto lo = std::max(row + start, partitions[p]), hi = std::min(row + end, partitions[p + 1] - 1);
+          for (auto i = lo; i <= hi; i++) {
+            if (!is_valid[i]) { continue; }
+            if (type == WindowFunctionType::Sum) {
+              expected += values[i];
+            } else if (!found || (type == WindowFunctionType::Min ? values[i] < expected : values[i] > expected)) {
+              expected = values[i];
+            }
+            found = true;
+          }
+
+          ASSERT_EQ(typed_result->IsValid(row), found);
+          if (found) { EXPECT_EQ(typed_result->Value(row), expected); }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace physicalplan
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
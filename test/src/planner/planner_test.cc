@@ -0,0 +1,236 @@
+#include "planner/planner.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "datasource/datasource.h"
+#include "fmt/core.h"
+#include "logicalplan/logicalexpression.h"
+#include "logicalplan/logicalplan.h"
+#include "optimization/optimizer.h"
+#include "test_utils/test_utils.h"
+
+namespace toyquery {
+namespace planner {
+
+using ::toyquery::datasource::InMemoryDataSource;
+using ::toyquery::logicalplan::Aggregation;
+using ::toyquery::logicalplan::AggregateExpression;
+using ::toyquery::logicalplan::ApproxCountDistinct;
+using ::toyquery::logicalplan::ApproxPercentile;
+using ::toyquery::logicalplan::Column;
+using ::toyquery::logicalplan::ColumnIndex;
+using ::toyquery::logicalplan::Count;
+using ::toyquery::logicalplan::Gt;
+using ::toyquery::logicalplan::Join;
+using ::toyquery::logicalplan::LiteralLong;
+using ::toyquery::logicalplan::LogicalExpression;
+using ::toyquery::logicalplan::LogicalPlan;
+using ::toyquery::logicalplan::Projection;
+using ::toyquery::logicalplan::Scan;
+using ::toyquery::logicalplan::Selection;
+using ::toyquery::logicalplan::Sum;
+using ::toyquery::optimization::Optimizer;
+using ::toyquery::physicalplan::GraceHashJoin;
+using ::toyquery::physicalplan::HashJoin;
+using ::toyquery::physicalplan::Prefetch;
+using ::toyquery::testutils::GetTestData;
+using ::toyquery::testutils::GetTestSchema;
+
+class QueryPlannerTest : public ::testing::Test {
+ protected:
+  // the test data sixteen times over, so that each group is aggregated from several batches.
+  QueryPlannerTest() {
+    std::vector<std::shared_ptr<arrow::Table>> tables(COPIES, GetTestData());
+    auto source = std::make_shared<InMemoryDataSource>(GetTestSchema(), tables);
+    scan_ = std::make_shared<Scan>("test", source, std::vector<std::string>{});
+  }
+
+  // the value of the second column of the plan output for each value of its first one.
+  std::map<int64_t, int64_t> collect(std::shared_ptr<LogicalPlan> logical_plan, int parallelism) {
+    QueryPlanner planner;
+    planner.SetParallelism(parallelism);
+    auto plan = planner.CreatePhysicalPlan(logical_plan);
+    EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+    EXPECT_TRUE((*plan)->Prepare().ok());
+
+    std::map<int64_t, int64_t> values;
+    auto batch = (*plan)->Next();
+    while (batch.ok() && (*batch) != nullptr) {
+      auto keys = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(0));
+      auto column = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(1));
+      for (int64_t row = 0; row < keys->length(); row++) {
+        EXPECT_EQ(values.count(keys->Value(row)), 0) << fmt::format("{} returned twice", keys->Value(row));
+        values[keys->Value(row)] = column->Value(row);
+      }
+      batch = (*plan)->Next();
+    }
+    EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+    return values;
+  }
+
+  static constexpr int COPIES = 16;
+  std::shared_ptr<Scan> scan_;
+};
+
+TEST_F(QueryPlannerTest, ParallelAggregationMergesGroupsBelowProjection) {
+  // SELECT id, SUM(age) FROM test GROUP BY id HAVING SUM(age) > 40 * COPIES
+  std::vector<std::shared_ptr<LogicalExpression>> group_by = { std::make_shared<Column>("id") };
+  std::vector<std::shared_ptr<AggregateExpression>> aggregates = { std::make_shared<Sum>(
+      std::make_shared<Column>("age")) };
+  auto aggregation = std::make_shared<Aggregation>(scan_, group_by, aggregates);
+  auto having = std::make_shared<Selection>(
+      aggregation, std::make_shared<Gt>(std::make_shared<ColumnIndex>(1), std::make_shared<LiteralLong>(40 * COPIES)));
+  std::vector<std::shared_ptr<LogicalExpression>> projection = { std::make_shared<ColumnIndex>(0),
+                                                                 std::make_shared<ColumnIndex>(1) };
+  auto logical_plan = std::make_shared<Projection>(having, projection);
+
+  std::map<int64_t, int64_t> expected = { { 4, 44 * COPIES }, { 5, 55 * COPIES }, { 6, 66 * COPIES }, { 7, 77 * COPIES } };
+  EXPECT_EQ(collect(logical_plan, 4), expected);
+  EXPECT_EQ(collect(logical_plan, 1), expected);
+}
+
+TEST_F(QueryPlannerTest, OptimizedScanOnlyReadsReferencedColumns) {
+  // SELECT id, SUM(age) FROM test WHERE age > 10 GROUP BY id, the name column isn't read.
+  auto selection = std::make_shared<Selection>(
+      scan_, std::make_shared<Gt>(std::make_shared<Column>("age"), std::make_shared<LiteralLong>(10)));
+  std::vector<std::shared_ptr<LogicalExpression>> group_by = { std::make_shared<Column>("id") };
+  std::vector<std::shared_ptr<AggregateExpression>> aggregates = { std::make_shared<Sum>(
+      std::make_shared<Column>("age")) };
+  auto logical_plan = std::make_shared<Aggregation>(selection, group_by, aggregates);
+
+  Optimizer optimizer;
+  auto optimized_plan = optimizer.Optimize(logical_plan);
+  EXPECT_TRUE(optimized_plan.ok()) << fmt::format("optimization failed with {}", optimized_plan.status().message());
+  auto optimized_aggregation = std::static_pointer_cast<Aggregation>(*optimized_plan);
+  auto optimized_selection = std::static_pointer_cast<Selection>(optimized_aggregation->input_);
+  auto optimized_scan = std::static_pointer_cast<Scan>(optimized_selection->input_);
+  EXPECT_EQ(optimized_scan->projection_, (std::vector<std::string>{ "id", "age" }));
+  EXPECT_EQ(optimized_scan->filter_.size(), 1);
+
+  std::map<int64_t, int64_t> expected = { { 4, 44 * COPIES }, { 5, 55 * COPIES }, { 6, 66 * COPIES }, { 7, 77 * COPIES } };
+  EXPECT_EQ(collect(*optimized_plan, 4), expected);
+}
+
+TEST_F(QueryPlannerTest, ParallelCountDistinctMergesDistinctValues) {
+  // SELECT id, COUNT(DISTINCT name) FROM test GROUP BY id, each id is seen by several pipeline instances.
+  std::vector<std::shared_ptr<LogicalExpression>> group_by = { std::make_shared<Column>("id") };
+  std::vector<std::shared_ptr<AggregateExpression>> aggregates = { std::make_shared<Count>(
+      std::make_shared<Column>("name"), true) };
+  auto logical_plan = std::make_shared<Aggregation>(scan_, group_by, aggregates);
+
+  std::map<int64_t, int64_t> expected = { { 1, 1 }, { 2, 1 }, { 3, 1 }, { 4, 1 }, { 5, 1 }, { 6, 1 }, { 7, 1 } };
+  EXPECT_EQ(collect(logical_plan, 4), expected);
+}
+
+TEST_F(QueryPlannerTest, ParallelApproximateAggregationsMergeSketches) {
+  // SELECT id, APPROX_COUNT_DISTINCT(name), APPROX_PERCENTILE(age, 0.5) FROM test GROUP BY id
+  std::vector<std::shared_ptr<LogicalExpression>> group_by = { std::make_shared<Column>("id") };
+  std::vector<std::shared_ptr<AggregateExpression>> aggregates = {
+    std::make_shared<ApproxCountDistinct>(std::make_shared<Column>("name")),
+    std::make_shared<ApproxPercentile>(std::make_shared<Column>("age"), 0.5)
+  };
+  auto logical_plan = std::make_shared<Aggregation>(scan_, group_by, aggregates);
+
+  QueryPlanner planner;
+  planner.SetParallelism(4);
+  auto plan = planner.CreatePhysicalPlan(logical_plan);
+  EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+  EXPECT_TRUE((*plan)->Prepare().ok());
+
+  // every id has a single name and age, repeated in all the copies of the test data.
+  std::map<int64_t, double> ages = { { 1, 1 }, { 2, 2 }, { 3, 3 }, { 4, 44 }, { 5, 55 }, { 6, 66 }, { 7, 77 } };
+  int64_t num_groups = 0;
+  auto batch = (*plan)->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    auto ids = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(0));
+    auto distinct_names = std::static_pointer_cast<arrow::Int64Array>((*batch)->column(1));
+    auto median_ages = std::static_pointer_cast<arrow::DoubleArray>((*batch)->column(2));
+    for (int64_t row = 0; row < ids->length(); row++) {
+      EXPECT_EQ(distinct_names->Value(row), 1);
+      EXPECT_DOUBLE_EQ(median_ages->Value(row), ages[ids->Value(row)]);
+    }
+    num_groups += ids->length();
+    batch = (*plan)->Next();
+  }
+  EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+  EXPECT_EQ(num_groups, ages.size());
+}
+
+TEST_F(QueryPlannerTest, JoinUnderMemoryLimitIsPlannedAsGraceHashJoin) {
+  std::vector<std::pair<std::string, std::string>> on = { { "id", "id" } };
+  auto logical_plan = std::make_shared<Join>(scan_, scan_, on);
+
+  QueryPlanner planner(1, "");
+  auto plan = planner.CreatePhysicalPlan(logical_plan);
+  EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+  auto join = std::dynamic_pointer_cast<GraceHashJoin>(*plan);
+  EXPECT_NE(join, nullptr);
+
+  // every row of the copies matches the same id in all the copies.
+  EXPECT_TRUE(join->Prepare().ok());
+  int64_t num_rows = 0;
+  auto batch = join->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    num_rows += (*batch)->num_rows();
+    batch = join->Next();
+  }
+  EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+  EXPECT_EQ(num_rows, 7 * COPIES * COPIES);
+  EXPECT_GT(join->Metrics().spilled_partitions, 0);
+  EXPECT_TRUE(join->RuntimeFilters()[0]->IsReady());
+}
+
+TEST_F(QueryPlannerTest, ScansArePrefetchedUnlessTurnedOff) {
+  QueryPlanner planner;
+  auto plan = planner.CreatePhysicalPlan(scan_);
+  EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+  EXPECT_NE(std::dynamic_pointer_cast<Prefetch>(*plan), nullptr);
+
+  planner.SetPrefetchDepth(0);
+  plan = planner.CreatePhysicalPlan(scan_);
+  EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+  EXPECT_EQ(std::dynamic_pointer_cast<Prefetch>(*plan), nullptr);
+}
+
+TEST_F(QueryPlannerTest, RuntimeFilterPassesThroughPrefetchAndProjection) {
+  // SELECT * FROM (SELECT age, id FROM test) JOIN (SELECT * FROM test WHERE id > 5) ON id
+  std::vector<std::shared_ptr<LogicalExpression>> projection = { std::make_shared<Column>("age"),
+                                                                 std::make_shared<Column>("id") };
+  auto probe = std::make_shared<Projection>(scan_, projection);
+  auto build = std::make_shared<Selection>(
+      scan_, std::make_shared<Gt>(std::make_shared<Column>("id"), std::make_shared<LiteralLong>(5)));
+  std::vector<std::pair<std::string, std::string>> on = { { "id", "id" } };
+  auto logical_plan = std::make_shared<Join>(probe, build, on);
+
+  // the scans are prefetched by default.
+  QueryPlanner planner;
+  auto plan = planner.CreatePhysicalPlan(logical_plan);
+  EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+  auto join = std::dynamic_pointer_cast<HashJoin>(*plan);
+  EXPECT_NE(join, nullptr);
+
+  EXPECT_TRUE(join->Prepare().ok());
+  int64_t num_rows = 0;
+  auto batch = join->Next();
+  while (batch.ok() && (*batch) != nullptr) {
+    num_rows += (*batch)->num_rows();
+    batch = join->Next();
+  }
+  EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+
+  // the ids 6 and 7 match all their copies, the probe rows of the other ids are dropped by the filter.
+  EXPECT_EQ(num_rows, 2 * COPIES * COPIES);
+  EXPECT_GT(join->RuntimeFilters()[0]->RowsFiltered(), 0);
+}
+
+}  // namespace planner
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
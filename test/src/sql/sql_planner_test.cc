@@ -0,0 +1,110 @@
+#include "sql/planner.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "datasource/datasource.h"
+#include "fmt/core.h"
+#include "planner/planner.h"
+#include "sql/parser.h"
+#include "sql/tokenizer.h"
+#include "test_utils/test_utils.h"
+
+namespace toyquery {
+namespace sql {
+
+using ::toyquery::dataframe::DataFrame;
+using ::toyquery::dataframe::DataFrameImpl;
+using ::toyquery::datasource::InMemoryDataSource;
+using ::toyquery::logicalplan::Scan;
+using ::toyquery::planner::QueryPlanner;
+using ::toyquery::testutils::GetTestData;
+using ::toyquery::testutils::GetTestSchema;
+
+class SqlPlannerTest : public ::testing::Test {
+ protected:
+  // the test data four times over, so that every pipeline instance gets some morsels.
+  SqlPlannerTest() {
+    std::vector<std::shared_ptr<arrow::Table>> tables(COPIES, GetTestData());
+    auto source = std::make_shared<InMemoryDataSource>(GetTestSchema(), tables);
+    auto scan = std::make_shared<Scan>("test", source, std::vector<std::string>{});
+    tables_["test"] = std::make_shared<DataFrameImpl>(scan);
+  }
+
+  // run the query, with the given parallelism, returning its batches.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> run(absl::string_view sql, int parallelism) {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    auto tokens = Tokenizer(sql).Tokenize();
+    EXPECT_TRUE(tokens.ok()) << fmt::format("tokenizing failed with {}", tokens.status().message());
+    auto select = Parser(*tokens).Parse();
+    EXPECT_TRUE(select.ok()) << fmt::format("parsing failed with {}", select.status().message());
+    auto df = SqlPlanner().CreateDataFrame(std::static_pointer_cast<SqlSelect>(*select), tables_);
+    EXPECT_TRUE(df.ok()) << fmt::format("planning failed with {}", df.status().message());
+    if (!df.ok()) { return batches; }
+
+    QueryPlanner planner;
+    planner.SetParallelism(parallelism);
+    auto plan = planner.CreatePhysicalPlan((*df)->GetLogicalPlan());
+    EXPECT_TRUE(plan.ok()) << fmt::format("planning failed with {}", plan.status().message());
+    EXPECT_TRUE((*plan)->Prepare().ok());
+
+    auto batch = (*plan)->Next();
+    while (batch.ok() && (*batch) != nullptr) {
+      batches.push_back(*batch);
+      batch = (*plan)->Next();
+    }
+    EXPECT_TRUE(batch.ok()) << fmt::format("next failed with {}", batch.status().message());
+    return batches;
+  }
+
+  static constexpr int COPIES = 4;
+  std::map<absl::string_view, std::shared_ptr<DataFrame>> tables_;
+};
+
+TEST_F(SqlPlannerTest, SelectAppliesWhereAndProjection) {
+  int64_t num_rows = 0;
+  for (auto& batch : run("SELECT name FROM test WHERE id > 5", 1)) {
+    EXPECT_EQ(batch->num_columns(), 1);
+    auto names = std::static_pointer_cast<arrow::StringArray>(batch->column(0));
+    for (int64_t row = 0; row < names->length(); row++) {
+      EXPECT_TRUE(names->GetString(row) == "random6" || names->GetString(row) == "random7");
+    }
+    num_rows += batch->num_rows();
+  }
+  EXPECT_EQ(num_rows, 2 * COPIES);
+}
+
+TEST_F(SqlPlannerTest, SelectAppliesGroupByAndHaving) {
+  // the ids above 3 have an age above 40, the ages of each id add up over the copies of the test data.
+  std::map<int64_t, int64_t> distinct_names;
+  std::map<int64_t, int64_t> ages;
+  for (auto& batch : run(
+           "SELECT id, COUNT(DISTINCT name), SUM(age) FROM test WHERE id > 1 GROUP BY id HAVING SUM(age) > 40", 4)) {
+    EXPECT_EQ(batch->num_columns(), 3);
+    auto ids = std::static_pointer_cast<arrow::Int64Array>(batch->column(0));
+    auto names = std::static_pointer_cast<arrow::Int64Array>(batch->column(1));
+    auto sums = std::static_pointer_cast<arrow::Int64Array>(batch->column(2));
+    for (int64_t row = 0; row < ids->length(); row++) {
+      distinct_names[ids->Value(row)] = names->Value(row);
+      ages[ids->Value(row)] = sums->Value(row);
+    }
+  }
+
+  std::map<int64_t, int64_t> expected_distinct_names = { { 4, 1 }, { 5, 1 }, { 6, 1 }, { 7, 1 } };
+  std::map<int64_t, int64_t> expected_ages = {
+    { 4, 44 * COPIES }, { 5, 55 * COPIES }, { 6, 66 * COPIES }, { 7, 77 * COPIES }
+  };
+  EXPECT_EQ(distinct_names, expected_distinct_names);
+  EXPECT_EQ(ages, expected_ages);
+}
+
+}  // namespace sql
+}  // namespace toyquery
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}